@@ -20,8 +20,16 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <cerrno>
 #include <assert.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <sys/mount.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
 #include <stdexcept>
 #include <vector>
 #include <map>
@@ -1045,16 +1053,170 @@ double ElapsedTime::Duration(bool reset) {
 
 //----------------- DynamicLibrary -----------------------------------------------------------------
 
+/**
+ * Loads a shared library with dlopen. Symbols are bound lazily when first called so that
+ * opening a library with many functions is cheap.
+ */
+class DynamicLibraryImpl : public DynamicLibrary
+{
+    void* handle;
+public:
+    explicit DynamicLibraryImpl(const char* modulePath)
+    {
+        handle = dlopen(modulePath, RTLD_LAZY | RTLD_LOCAL);
+    }
+    virtual ~DynamicLibraryImpl()
+    {
+        if (handle)
+            dlclose(handle);
+    }
+    virtual Function FindFunction(const char* name)
+    {
+        return handle ? dlsym(handle, name) : NULL;
+    }
+    virtual bool IsValid()
+    {
+        return handle != NULL;
+    }
+};
+
 /**
  * Implements the platform specific part of library loading.
  * 
  * @param modulePath The path to the module to load.
- * @return A library instance or NULL if the module could not be found or another problem occurred.
+ * @return A library instance which is not valid if the module could not be loaded.
+ */
+DynamicLibrary* DynamicLibrary::Load(const char* modulePath)
+{
+    return new DynamicLibraryImpl(modulePath);
+}
+
+//----------------- MappedFile ---------------------------------------------------------------------
+
+/**
+ * Holds a whole file read-only, either mapped with mmap so pages are only read when the
+ * text is accessed or copied into memory.
+ */
+class MappedFileImpl : public MappedFile
+{
+    void* data;
+    size_t length;
+    bool mapped;
+public:
+    MappedFileImpl(void* data_, size_t length_, bool mapped_) : data(data_), length(length_), mapped(mapped_)
+    {
+    }
+    virtual ~MappedFileImpl()
+    {
+        if (data && mapped)
+            munmap(data, length);
+        else
+            delete []static_cast<char*>(data);
+    }
+    virtual const char* Data() const
+    {
+        return static_cast<const char*>(data);
+    }
+    virtual size_t Length() const
+    {
+        return length;
+    }
+};
+
+// Files smaller than this are copied as reading them takes little time
+static const size_t mapMinimum = 8 * 1024 * 1024;
+
+/**
+ * Whether a file is on a local volume that can not be ejected. Files on other volumes may
+ * change or disappear at any time.
  */
-DynamicLibrary* DynamicLibrary::Load(const char* /* modulePath */)
+static bool OnLocalFixedVolume(int fd)
 {
-    // Not implemented.
-    return NULL;
+    struct statfs sfs;
+    if (fstatfs(fd, &sfs) != 0)
+        return false;
+    if (!(sfs.f_flags & MNT_LOCAL))
+        return false;
+#ifdef MNT_REMOVABLE
+    if (sfs.f_flags & MNT_REMOVABLE)
+        return false;
+#endif
+    return true;
+}
+
+/**
+ * Read length bytes from the start of a file into a new array.
+ * @return The array or NULL if the file is shorter or can not be read.
+ */
+static char* ReadWhole(int fd, size_t length)
+{
+    char* text = new char[length];
+    size_t done = 0;
+    while (done < length)
+    {
+        const ssize_t lenRead = pread(fd, text + done, length - done, static_cast<off_t>(done));
+        if ((lenRead < 0) && (errno == EINTR))
+            continue;
+        if (lenRead <= 0)
+        {
+            delete []text;
+            return NULL;
+        }
+        done += static_cast<size_t>(lenRead);
+    }
+    return text;
+}
+
+/**
+ * Implements the platform specific part of file mapping.
+ *
+ * Pages of a mapping are read from the file when first accessed so if another process
+ * truncates the file, accessing them raises SIGBUS. Small files and files on network or
+ * removable volumes are copied into memory instead so only large files on local fixed
+ * volumes keep that risk.
+ *
+ * @param path The path of the file to map.
+ * @return A mapped file or NULL if the file could not be opened, read or mapped.
+ */
+MappedFile* MappedFile::Open(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* data = NULL;
+    bool mapped = false;
+    if ((length < mapMinimum) || !OnLocalFixedVolume(fd))
+    {
+        if (length > 0)
+        {
+            data = ReadWhole(fd, length);
+            if (!data)
+            {
+                close(fd);
+                return NULL;
+            }
+        }
+    }
+    else
+    {
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return NULL;
+        }
+        mapped = true;
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return new MappedFileImpl(data, length, mapped);
 }
 
 
@@ -55,7 +55,7 @@ void Editor::NotifyStyleToNeeded(int endStyleNeeded) {
 	NotifyParent(scn);
 }
 
-void Editor::NotifyStyleNeeded(Document *, void *, int endStyleNeeded) {
+void Editor::NotifyStyleNeeded(Document *, void *, Sci_Position endStyleNeeded) {
 	NotifyStyleToNeeded(endStyleNeeded);
 }
 
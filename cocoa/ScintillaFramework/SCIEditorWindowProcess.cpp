@@ -409,6 +409,29 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
         case SCI_POSITIONRELATIVE:
             return Platform::Clamp(pdoc->GetRelativePosition(wParam, lParam), 0, pdoc->Length());
             
+        case SCI_GETLINECHARACTERINDEX:
+            return pdoc->LineCharacterIndex();
+            
+        case SCI_ALLOCATELINECHARACTERINDEX:
+            pdoc->AllocateLineCharacterIndex(static_cast<int>(wParam));
+            break;
+            
+        case SCI_RELEASELINECHARACTERINDEX:
+            pdoc->ReleaseLineCharacterIndex(static_cast<int>(wParam));
+            break;
+            
+        case SCI_LINEFROMINDEXPOSITION:
+            return pdoc->LineFromPositionIndex(wParam, static_cast<int>(lParam));
+            
+        case SCI_INDEXPOSITIONFROMLINE:
+            return pdoc->IndexLineStart(wParam, static_cast<int>(lParam));
+            
+        case SCI_INDEXFROMPOSITION:
+            return pdoc->IndexFromPosition(pdoc->ClampPositionIntoDocument(wParam), static_cast<int>(lParam));
+            
+        case SCI_POSITIONFROMINDEX:
+            return pdoc->PositionFromIndex(wParam, static_cast<int>(lParam));
+            
         case SCI_LINESCROLL:
             ScrollTo(topLine + lParam);
             HorizontalScrollTo(xOffset + static_cast<int>(wParam) * vs.spaceWidth);
@@ -1838,8 +1861,10 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
             return 0;
             
         case SCI_CREATEDOCUMENT: {
-			Document *doc = new Document();
+			Document *doc = new Document(static_cast<int>(lParam));
 			doc->AddRef();
+			if (wParam > 0)
+				doc->Allocate(wParam);
 			return reinterpret_cast<sptr_t>(doc);
 		}
             
@@ -1851,14 +1876,31 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
             (reinterpret_cast<Document *>(lParam))->Release();
             break;
             
+        case SCI_GETDOCUMENTOPTIONS:
+            return pdoc->Options();
+            
         case SCI_CREATELOADER: {
-			Document *doc = new Document();
+			Document *doc = new Document(static_cast<int>(lParam));
 			doc->AddRef();
 			doc->Allocate(wParam);
 			doc->SetUndoCollection(false);
 			return reinterpret_cast<sptr_t>(static_cast<ILoader *>(doc));
 		}
             
+        case SCI_CREATEMAPPEDDOCUMENT: {
+			MappedFile *file = MappedFile::Open(reinterpret_cast<const char *>(lParam));
+			if (!file)
+				return 0;
+			Document *doc = new Document(static_cast<int>(wParam) | SC_DOCUMENTOPTION_TEXT_PIECES);
+			doc->AddRef();
+			if (!doc->UseMappedFile(file)) {
+				delete file;
+				doc->Release();
+				return 0;
+			}
+			return reinterpret_cast<sptr_t>(doc);
+		}
+            
         case SCI_SETMODEVENTMASK:
             modEventMask = wParam;
             return 0;
@@ -2208,6 +2250,110 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
             pdoc->AddUndoAction(wParam, lParam & UNDO_MAY_COALESCE);
             break;
             
+        case SCI_SETUNDOMEMORYLIMIT:
+            pdoc->SetUndoMemoryLimit(wParam);
+            break;
+            
+        case SCI_GETUNDOMEMORYLIMIT:
+            return pdoc->UndoMemoryLimit();
+            
+        case SCI_SETUNDOSTEPLIMIT:
+            pdoc->SetUndoStepLimit(static_cast<int>(wParam));
+            break;
+            
+        case SCI_GETUNDOSTEPLIMIT:
+            return pdoc->UndoStepLimit();
+            
+        case SCI_GETUNDOMEMORY:
+            return pdoc->UndoMemory();
+            
+        case SCI_SAVEUNDOHISTORY:
+            return pdoc->SaveUndoHistory(reinterpret_cast<const char *>(lParam));
+            
+        case SCI_LOADUNDOHISTORY: {
+			MappedFile *file = MappedFile::Open(reinterpret_cast<const char *>(lParam));
+			if (!file)
+				return 0;
+			if (!pdoc->LoadUndoHistory(file)) {
+				delete file;
+				return 0;
+			}
+			return 1;
+		}
+            
+        case SCI_SETCHANGEJOURNALSIZE:
+            pdoc->SetChangeJournalSize(static_cast<int>(wParam));
+            break;
+            
+        case SCI_GETCHANGEJOURNALSIZE:
+            return pdoc->ChangeJournalSize();
+            
+        case SCI_SETCHANGEJOURNALTEXTLIMIT:
+            pdoc->SetChangeJournalTextLimit(wParam);
+            break;
+            
+        case SCI_GETCHANGEJOURNALTEXTLIMIT:
+            return pdoc->ChangeJournalTextLimit();
+            
+        case SCI_GETCONTENTVERSION:
+            return pdoc->ContentVersion();
+            
+        case SCI_GETCHANGEJOURNALSTART:
+            return pdoc->Journal().VersionStart();
+            
+        case SCI_GETCHANGESSINCE: {
+			SplitVector<ChangeSpan> changes;
+			if (!pdoc->Journal().ChangesSince(static_cast<int>(wParam), changes))
+				return -1;
+			if (lParam) {
+				Sci_Change *change = reinterpret_cast<Sci_Change *>(lParam);
+				for (int i = 0; i < changes.Length(); i++) {
+					change[i].position = changes[i].position;
+					change[i].lengthRemoved = changes[i].lengthRemoved;
+					change[i].lengthInserted = changes[i].lengthInserted;
+				}
+			}
+			return changes.Length();
+		}
+            
+        case SCI_GETCHANGE: {
+			const JournalEntry *entry = pdoc->Journal().Entry(static_cast<int>(wParam));
+			if (!entry)
+				return 0;
+			if (lParam) {
+				Sci_Change *change = reinterpret_cast<Sci_Change *>(lParam);
+				change->position = entry->position;
+				change->lengthRemoved = entry->insertion ? 0 : entry->length;
+				change->lengthInserted = entry->insertion ? entry->length : 0;
+			}
+			return entry->insertion ? SC_MOD_INSERTTEXT : SC_MOD_DELETETEXT;
+		}
+            
+        case SCI_GETCHANGETEXT: {
+			// As for other string results, the text is NUL terminated and its length returned without the NUL
+			char *ptr = CharPtrFromSPtr(lParam);
+			const Sci_Position lengthText = pdoc->Journal().EntryText(static_cast<int>(wParam), ptr);
+			if (ptr)
+				ptr[lengthText] = '\0';
+			return lengthText;
+		}
+            
+        case SCI_SETBACKGROUNDSTYLING:
+            backgroundStyling = wParam != 0;
+            if (!backgroundStyling)
+                pdoc->FinishBackgroundStyles();
+            break;
+            
+        case SCI_GETBACKGROUNDSTYLING:
+            return backgroundStyling;
+            
+        case SCI_SETLEXINGTHREADS:
+            pdoc->SetLexingThreads(wParam);
+            break;
+            
+        case SCI_GETLEXINGTHREADS:
+            return pdoc->LexingThreads();
+            
         case SCI_SETMOUSESELECTIONRECTANGULARSWITCH:
             mouseSelectionRectangularSwitch = wParam != 0;
             break;
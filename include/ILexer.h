@@ -8,6 +8,8 @@
 #ifndef ILEXER_H
 #define ILEXER_H
 
+#include "Sci_Position.h"
+
 #ifdef SCI_NAMESPACE
 namespace Scintilla {
 #endif
@@ -18,41 +20,51 @@ namespace Scintilla {
 	#define SCI_METHOD
 #endif
 
-enum { dvOriginal=0, dvLineEnd=1 };
+enum { dvOriginal=0, dvLineEnd=1, dvRangePointer=2 };
 
 class IDocument {
 public:
 	virtual int SCI_METHOD Version() const = 0;
 	virtual void SCI_METHOD SetErrorStatus(int status) = 0;
-	virtual int SCI_METHOD Length() const = 0;
-	virtual void SCI_METHOD GetCharRange(char *buffer, int position, int lengthRetrieve) const = 0;
-	virtual char SCI_METHOD StyleAt(int position) const = 0;
-	virtual int SCI_METHOD LineFromPosition(int position) const = 0;
-	virtual int SCI_METHOD LineStart(int line) const = 0;
-	virtual int SCI_METHOD GetLevel(int line) const = 0;
-	virtual int SCI_METHOD SetLevel(int line, int level) = 0;
-	virtual int SCI_METHOD GetLineState(int line) const = 0;
-	virtual int SCI_METHOD SetLineState(int line, int state) = 0;
-	virtual void SCI_METHOD StartStyling(int position, char mask) = 0;
-	virtual bool SCI_METHOD SetStyleFor(int length, char style) = 0;
-	virtual bool SCI_METHOD SetStyles(int length, const char *styles) = 0;
+	virtual Sci_Position SCI_METHOD Length() const = 0;
+	virtual void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const = 0;
+	virtual char SCI_METHOD StyleAt(Sci_Position position) const = 0;
+	virtual Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const = 0;
+	virtual Sci_Position SCI_METHOD LineStart(Sci_Position line) const = 0;
+	virtual int SCI_METHOD GetLevel(Sci_Position line) const = 0;
+	virtual int SCI_METHOD SetLevel(Sci_Position line, int level) = 0;
+	virtual int SCI_METHOD GetLineState(Sci_Position line) const = 0;
+	virtual int SCI_METHOD SetLineState(Sci_Position line, int state) = 0;
+	virtual void SCI_METHOD StartStyling(Sci_Position position, char mask) = 0;
+	virtual bool SCI_METHOD SetStyleFor(Sci_Position length, char style) = 0;
+	virtual bool SCI_METHOD SetStyles(Sci_Position length, const char *styles) = 0;
 	virtual void SCI_METHOD DecorationSetCurrentIndicator(int indicator) = 0;
-	virtual void SCI_METHOD DecorationFillRange(int position, int value, int fillLength) = 0;
-	virtual void SCI_METHOD ChangeLexerState(int start, int end) = 0;
+	virtual void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) = 0;
+	virtual void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) = 0;
 	virtual int SCI_METHOD CodePage() const = 0;
 	virtual bool SCI_METHOD IsDBCSLeadByte(char ch) const = 0;
 	virtual const char * SCI_METHOD BufferPointer() = 0;
-	virtual int SCI_METHOD GetLineIndentation(int line) = 0;
+	virtual int SCI_METHOD GetLineIndentation(Sci_Position line) = 0;
 };
 
 class IDocumentWithLineEnd : public IDocument {
 public:
-	virtual int SCI_METHOD LineEnd(int line) const = 0;
-	virtual int SCI_METHOD GetRelativePosition(int positionStart, int characterOffset) const = 0;
-	virtual int SCI_METHOD GetCharacterAndWidth(int position, int *pWidth) const = 0;
+	virtual Sci_Position SCI_METHOD LineEnd(Sci_Position line) const = 0;
+	virtual Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const = 0;
+	virtual int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const = 0;
+};
+
+// A document which lets lexers read its text in place. The text is held in one or more
+// blocks of memory and ContiguousRangePointer returns a pointer to the text at position,
+// setting *lengthContiguous to the number of bytes from there to the end of its block, or
+// 0 when position is outside the document. No text is moved so the pointer remains valid
+// until the document is modified.
+class IDocumentWithRangePointer : public IDocumentWithLineEnd {
+public:
+	virtual const char * SCI_METHOD ContiguousRangePointer(Sci_Position position, Sci_Position *lengthContiguous) = 0;
 };
 
-enum { lvOriginal=0, lvSubStyles=1 };
+enum { lvOriginal=0, lvSubStyles=1, lvRestart=2 };
 
 class ILexer {
 public:
@@ -64,8 +76,8 @@ public:
 	virtual int SCI_METHOD PropertySet(const char *key, const char *val) = 0;
 	virtual const char * SCI_METHOD DescribeWordListSets() = 0;
 	virtual int SCI_METHOD WordListSet(int n, const char *wl) = 0;
-	virtual void SCI_METHOD Lex(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) = 0;
-	virtual void SCI_METHOD Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) = 0;
+	virtual void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) = 0;
+	virtual void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) = 0;
 	virtual void * SCI_METHOD PrivateCall(int operation, void *pointer) = 0;
 };
 
@@ -83,11 +95,27 @@ public:
 	virtual const char * SCI_METHOD GetSubStyleBases() = 0;
 };
 
+// A lexer which can start at some lines in its initial state, as if they began the document,
+// and produce the same result as lexing through from the start. This allows independent
+// ranges of a document to be lexed concurrently then checked where they join.
+// IsRestartLine is called after the text before line has been lexed and returns true when
+// the state reached at the start of line is equivalent to the initial state.
+// RangeLexer returns a lexer, which may be this lexer when Lex does not modify it, that can
+// lex a range starting at a restart line on another thread. MergeRange then adopts any
+// per-line state held by that lexer for lines [lineStart, lineEnd] and Release is called on
+// it when it is not this lexer.
+class ILexerWithRestart : public ILexerWithSubStyles {
+public:
+	virtual bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess) = 0;
+	virtual ILexerWithRestart * SCI_METHOD RangeLexer() = 0;
+	virtual void SCI_METHOD MergeRange(ILexerWithRestart *rangeLexer, Sci_Position lineStart, Sci_Position lineEnd) = 0;
+};
+
 class ILoader {
 public:
 	virtual int SCI_METHOD Release() = 0;
 	// Returns a status code from SC_STATUS_*
-	virtual int SCI_METHOD AddData(char *data, int length) = 0;
+	virtual int SCI_METHOD AddData(char *data, Sci_Position length) = 0;
 	virtual void * SCI_METHOD ConvertToDocument() = 0;
 };
 
@@ -71,6 +71,8 @@
 
 #endif
 
+#include <stddef.h>
+
 #ifdef SCI_NAMESPACE
 namespace Scintilla {
 #endif
@@ -458,6 +460,23 @@ namespace Scintilla {
         static DynamicLibrary *Load(const char *modulePath);
     };
     
+    /**
+     * Read-only view of a file's contents mapped into memory
+     */
+    class MappedFile {
+    public:
+        virtual ~MappedFile() {}
+        
+        /// @return Pointer to the first byte of the file which is not NUL terminated.
+        virtual const char *Data() const = 0;
+        
+        /// @return Number of bytes in the file.
+        virtual size_t Length() const = 0;
+        
+        /// @return An instance of a MappedFile subclass with "path" mapped, or NULL on failure.
+        static MappedFile *Open(const char *path);
+    };
+    
     /**
      * Platform class used to retrieve system wide parameters such as double click speed
      * and chrome colour. Not a creatable object, more of a module with several functions.
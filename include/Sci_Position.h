@@ -0,0 +1,34 @@
+// Scintilla source code edit control
+/** @file Sci_Position.h
+ ** Define the Sci_Position type used in Scintilla's internal and external interfaces.
+ ** These need to be available to clients written in C so are not in a C++ namespace.
+ **/
+// Copyright 2013 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef SCI_POSITION_H
+#define SCI_POSITION_H
+
+#include <stddef.h>
+
+/* Positions and line numbers are normally 32 bit ints which limits documents to 2 GB.
+ * Defining SCI_LARGE_FILE_SUPPORT makes them pointer-sized so documents can be larger
+ * at the cost of more memory for line, style run and undo data. */
+
+#ifdef SCI_LARGE_FILE_SUPPORT
+
+/* Basic signed type used throughout interface */
+typedef ptrdiff_t Sci_Position;
+
+/* Unsigned variant used for ILexer::Lex and ILexer::Fold */
+typedef size_t Sci_PositionU;
+
+#else
+
+typedef int Sci_Position;
+
+typedef unsigned int Sci_PositionU;
+
+#endif
+
+#endif
@@ -40,6 +40,8 @@ typedef unsigned long uptr_t;
 typedef long sptr_t;
 #endif
 
+#include "Sci_Position.h"
+
 typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 
 /* ++Autogenerated -- start of section automatically generated from Scintilla.iface */
@@ -626,10 +628,14 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SELECTIONISRECTANGLE 2372
 #define SCI_SETZOOM 2373
 #define SCI_GETZOOM 2374
+#define SC_DOCUMENTOPTION_DEFAULT 0
+#define SC_DOCUMENTOPTION_TEXT_PIECES 0x1
+#define SC_DOCUMENTOPTION_STYLE_RUNS 0x2
 #define SCI_CREATEDOCUMENT 2375
 #define SCI_ADDREFDOCUMENT 2376
 #define SCI_RELEASEDOCUMENT 2377
 #define SCI_GETMODEVENTMASK 2378
+#define SCI_GETDOCUMENTOPTIONS 2379
 #define SCI_SETFOCUS 2380
 #define SCI_GETFOCUS 2381
 #define SC_STATUS_OK 0
@@ -683,6 +689,16 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_POSITIONBEFORE 2417
 #define SCI_POSITIONAFTER 2418
 #define SCI_POSITIONRELATIVE 2670
+#define SC_LINECHARACTERINDEX_NONE 0
+#define SC_LINECHARACTERINDEX_UTF32 1
+#define SC_LINECHARACTERINDEX_UTF16 2
+#define SCI_GETLINECHARACTERINDEX 2672
+#define SCI_ALLOCATELINECHARACTERINDEX 2673
+#define SCI_RELEASELINECHARACTERINDEX 2674
+#define SCI_LINEFROMINDEXPOSITION 2675
+#define SCI_INDEXPOSITIONFROMLINE 2676
+#define SCI_INDEXFROMPOSITION 2677
+#define SCI_POSITIONFROMINDEX 2678
 #define SCI_COPYRANGE 2419
 #define SCI_COPYTEXT 2420
 #define SC_SEL_STREAM 0
@@ -809,6 +825,26 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_ALLOCATEEXTENDEDSTYLES 2553
 #define UNDO_MAY_COALESCE 1
 #define SCI_ADDUNDOACTION 2560
+#define SCI_SETUNDOMEMORYLIMIT 2679
+#define SCI_GETUNDOMEMORYLIMIT 2680
+#define SCI_SETUNDOSTEPLIMIT 2681
+#define SCI_GETUNDOSTEPLIMIT 2682
+#define SCI_GETUNDOMEMORY 2683
+#define SCI_SAVEUNDOHISTORY 2684
+#define SCI_LOADUNDOHISTORY 2685
+#define SCI_SETCHANGEJOURNALSIZE 2686
+#define SCI_GETCHANGEJOURNALSIZE 2687
+#define SCI_SETCHANGEJOURNALTEXTLIMIT 2688
+#define SCI_GETCHANGEJOURNALTEXTLIMIT 2689
+#define SCI_GETCONTENTVERSION 2690
+#define SCI_GETCHANGEJOURNALSTART 2691
+#define SCI_GETCHANGESSINCE 2692
+#define SCI_GETCHANGE 2693
+#define SCI_GETCHANGETEXT 2694
+#define SCI_SETBACKGROUNDSTYLING 2695
+#define SCI_GETBACKGROUNDSTYLING 2696
+#define SCI_SETLEXINGTHREADS 2697
+#define SCI_GETLEXINGTHREADS 2698
 #define SCI_CHARPOSITIONFROMPOINT 2561
 #define SCI_CHARPOSITIONFROMPOINTCLOSE 2562
 #define SCI_SETMOUSESELECTIONRECTANGULARSWITCH 2668
@@ -882,6 +918,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETTECHNOLOGY 2630
 #define SCI_GETTECHNOLOGY 2631
 #define SCI_CREATELOADER 2632
+#define SCI_CREATEMAPPEDDOCUMENT 2671
 #define SCI_FINDINDICATORSHOW 2640
 #define SCI_FINDINDICATORFLASH 2641
 #define SCI_FINDINDICATORHIDE 2642
@@ -1041,6 +1078,13 @@ struct Sci_TextToFind {
 	struct Sci_CharacterRange chrgText;
 };
 
+/* A replacement of lengthRemoved bytes at position with lengthInserted bytes. */
+struct Sci_Change {
+	Sci_Position position;
+	Sci_Position lengthRemoved;
+	Sci_Position lengthInserted;
+};
+
 #define CharacterRange Sci_CharacterRange
 #define TextRange Sci_TextRange
 #define TextToFind Sci_TextToFind
@@ -16,7 +16,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -30,6 +34,7 @@
 #include "LexerModule.h"
 #include "OptionSet.h"
 #include "SparseState.h"
+#include "Checkpoints.h"
 #include "SubStyles.h"
 
 #ifdef SCI_NAMESPACE
@@ -128,15 +133,36 @@ static std::vector<std::string> Tokenize(const std::string &s) {
 }
 
 struct PPDefinition {
-	int line;
 	std::string key;
 	std::string value;
 	bool isUndef;
-	PPDefinition(int line_, const std::string &key_, const std::string &value_, bool isUndef_ = false) :
-		line(line_), key(key_), value(value_), isUndef(isUndef_) {
+	PPDefinition() : isUndef(false) {
+	}
+	PPDefinition(const std::string &key_, const std::string &value_, bool isUndef_ = false) :
+		key(key_), value(value_), isUndef(isUndef_) {
+	}
+	bool operator==(const PPDefinition &other) const {
+		return (key == other.key) && (value == other.value) && (isUndef == other.isUndef);
 	}
 };
 
+// FNV-1a hashing of the values that make up the state of a line.
+static unsigned int HashBytes(unsigned int hash, const char *bytes, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static unsigned int HashInt(unsigned int hash, int value) {
+	return HashBytes(hash, reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static unsigned int HashString(unsigned int hash, const std::string &s) {
+	return HashInt(HashBytes(hash, s.c_str(), s.length()), static_cast<int>(s.length()));
+}
+
 class LinePPState {
 	int state;
 	int ifTaken;
@@ -150,6 +176,15 @@ class LinePPState {
 public:
 	LinePPState() : state(0), ifTaken(0), level(-1) {
 	}
+	bool operator==(const LinePPState &other) const {
+		return (state == other.state) && (ifTaken == other.ifTaken) && (level == other.level);
+	}
+	unsigned int Hash(unsigned int hash) const {
+		return HashInt(HashInt(HashInt(hash, state), ifTaken), level);
+	}
+	bool IsInitial() const {
+		return (state == 0) && (ifTaken == 0) && (level == -1);
+	}
 	bool IsInactive() const {
 		return state != 0;
 	}
@@ -183,21 +218,167 @@ public:
 	}
 };
 
-// Hold the preprocessor state for each line seen.
-// Currently one entry per line but could become sparse with just one entry per preprocessor line.
-class PPStates {
-	std::vector<LinePPState> vlls;
+// The state at the end of a line along with any definition made and the identifiers
+// read by any conditional on the line.
+struct PPLine {
+	LinePPState preproc;
+	std::string rawStringTerminator;
+	int definition;
+	int conditional;
+	PPLine() : definition(0), conditional(0) {
+	}
+	bool operator==(const PPLine &other) const {
+		return (preproc == other.preproc) && (rawStringTerminator == other.rawStringTerminator) &&
+			(definition == other.definition) && (conditional == other.conditional);
+	}
+	unsigned int Hash() const {
+		return HashInt(HashInt(HashString(preproc.Hash(2166136261u), rawStringTerminator), definition), conditional);
+	}
+};
+
+// Values identified by a hash of their contents, so equal values are given the same
+// identifier whichever lexer added them first. The default value is identified by 0.
+template <typename T>
+class HashedValues {
+	std::map<int, T> values;
+	// Identifiers are probed in unsigned arithmetic so they wrap instead of overflowing
+	// and are only converted to int to be stored. 0 is reserved for the default value.
+	static unsigned int Probe(unsigned int id) {
+		return (id == 0) ? 1 : id;
+	}
+	// The identifier probed after id
+	static int Next(int id) {
+		return static_cast<int>(Probe(static_cast<unsigned int>(id) + 1));
+	}
 public:
-	LinePPState ForLine(int line) const {
-		if ((line > 0) && (vlls.size() > static_cast<size_t>(line))) {
-			return vlls[line];
-		} else {
-			return LinePPState();
+	int Add(const T &value, unsigned int hash) {
+		if (value == T())
+			return 0;
+		for (unsigned int probe = Probe(hash);; probe = Probe(probe + 1)) {
+			const int id = static_cast<int>(probe);
+			typename std::map<int, T>::const_iterator it = values.find(id);
+			if (it == values.end()) {
+				values[id] = value;
+				return id;
+			} else if (it->second == value) {
+				return id;
+			}
+		}
+	}
+	T ValueAt(int id) const {
+		typename std::map<int, T>::const_iterator it = values.find(id);
+		return (it != values.end()) ? it->second : T();
+	}
+	size_t size() const {
+		return values.size();
+	}
+	// Remove the values whose identifiers are not in ids. A value is also kept while the
+	// identifier after it is kept so values moved past it by Add are still found.
+	void Retain(const std::set<int> &ids) {
+		typename std::map<int, T>::iterator it = values.end();
+		while (it != values.begin()) {
+			--it;
+			if (!ids.count(it->first) && !values.count(Next(it->first)))
+				values.erase(it++);
+		}
+	}
+};
+
+// The preprocessor state of each line is held in the document as the line state so it
+// moves with the text when lines are inserted or deleted and stays valid for the lines
+// after an edit. Line states are identifiers for values shared by a lexer and the range
+// lexers made from it which run on other threads. The same text is given the same line
+// states however it was divided when lexed.
+class PPLineStates {
+	std::mutex mutex;
+	HashedValues<PPLine> lines;
+	HashedValues<PPDefinition> definitions;
+	HashedValues<std::vector<std::string> > conditionals;
+public:
+	int LineValue(const PPLine &ppLine) {
+		std::lock_guard<std::mutex> guard(mutex);
+		return lines.Add(ppLine, ppLine.Hash());
+	}
+	PPLine Line(int lineState) {
+		std::lock_guard<std::mutex> guard(mutex);
+		return lines.ValueAt(lineState);
+	}
+	int DefinitionValue(const PPDefinition &definition) {
+		std::lock_guard<std::mutex> guard(mutex);
+		return definitions.Add(definition,
+			HashInt(HashString(HashString(2166136261u, definition.key), definition.value), definition.isUndef));
+	}
+	PPDefinition Definition(int definition) {
+		std::lock_guard<std::mutex> guard(mutex);
+		return definitions.ValueAt(definition);
+	}
+	int ConditionalValue(const std::vector<std::string> &identifiers) {
+		std::lock_guard<std::mutex> guard(mutex);
+		unsigned int hash = 2166136261u;
+		for (std::vector<std::string>::const_iterator it = identifiers.begin(); it != identifiers.end(); ++it)
+			hash = HashString(hash, *it);
+		return conditionals.Add(identifiers, hash);
+	}
+	size_t size() {
+		std::lock_guard<std::mutex> guard(mutex);
+		return lines.size();
+	}
+	// Remove the values not used by any of the line states.
+	void Retain(const std::set<int> &lineStates) {
+		std::lock_guard<std::mutex> guard(mutex);
+		std::set<int> definitionsUsed;
+		std::set<int> conditionalsUsed;
+		for (std::set<int>::const_iterator it = lineStates.begin(); it != lineStates.end(); ++it) {
+			const PPLine ppLine = lines.ValueAt(*it);
+			definitionsUsed.insert(ppLine.definition);
+			conditionalsUsed.insert(ppLine.conditional);
 		}
+		lines.Retain(lineStates);
+		definitions.Retain(definitionsUsed);
+		conditionals.Retain(conditionalsUsed);
+	}
+	// True when a conditional on the line reads any of the identifiers.
+	bool ReadsAny(int lineState, const std::set<std::string> &identifiers) {
+		std::lock_guard<std::mutex> guard(mutex);
+		const int conditional = lines.ValueAt(lineState).conditional;
+		if (!conditional)
+			return false;
+		const std::vector<std::string> read = conditionals.ValueAt(conditional);
+		for (std::vector<std::string>::const_iterator it = read.begin(); it != read.end(); ++it) {
+			if (identifiers.count(*it))
+				return true;
+		}
+		return false;
+	}
+};
+
+// The definitions in effect at a line are a chain of the definitions made before it,
+// held as nodes that each add one definition to the table identified by its parent.
+// Table 0 is the definitions set through the keyword list.
+class PPDefinitionTables {
+	std::vector<std::pair<int, int> > nodes;
+	std::map<std::pair<int, int>, int> nodeIndices;
+public:
+	PPDefinitionTables() {
+		nodes.push_back(std::pair<int, int>(0, 0));
+	}
+	int Add(int table, int definition) {
+		const std::pair<int, int> node(table, definition);
+		std::map<std::pair<int, int>, int>::const_iterator it = nodeIndices.find(node);
+		if (it != nodeIndices.end())
+			return it->second;
+		const int index = static_cast<int>(nodes.size());
+		nodes.push_back(node);
+		nodeIndices[node] = index;
+		return index;
 	}
-	void Add(int line, LinePPState lls) {
-		vlls.resize(line+1);
-		vlls[line] = lls;
+	// The definitions of table from the earliest to the latest
+	std::vector<int> Definitions(int table) const {
+		std::vector<int> definitions;
+		for (; table > 0; table = nodes[table].first)
+			definitions.push_back(nodes[table].second);
+		std::reverse(definitions.begin(), definitions.end());
+		return definitions;
 	}
 };
 
@@ -314,15 +495,37 @@ struct OptionSetCPP : public OptionSet<OptionsCPP> {
 
 static const char styleSubable[] = {SCE_C_IDENTIFIER, SCE_C_COMMENTDOCKEYWORD, 0};
 
-class LexerCPP : public ILexerWithSubStyles {
+class LexerCPP : public ILexerWithRestart {
 	bool caseSensitive;
 	CharacterSet setWord;
+	CharacterSet setOKBeforeRE;
 	CharacterSet setNegationOp;
 	CharacterSet setArithmethicOp;
 	CharacterSet setRelOp;
 	CharacterSet setLogicalOp;
-	PPStates vlls;
-	std::vector<PPDefinition> ppDefineHistory;
+	std::shared_ptr<PPLineStates> ppLineStates;
+	PPDefinitionTables definitionTables;
+	// The definitions table at the start of some lines
+	Checkpoints<int> definitionCheckpoints;
+	// The definitions of the most recent table used
+	int tableDefinitions;
+	std::map<std::string, std::string> definitionsOfTable;
+	// Identifiers whose definitions differ from when the text after lineDefinitionsChanged
+	// was last lexed
+	std::set<std::string> definitionsChanged;
+	int lineDefinitionsChanged;
+	// The most recent line state set, as most lines have the same state as the line before
+	PPLine ppLineLast;
+	int lineStateLast;
+	// Values that no line state uses are collected once there are twice as many as were
+	// kept by the last collection.
+	size_t valuesKept;
+	// Lex is called with the document itself on the thread that made the lexer and with
+	// views of the document on other threads. A view may be discarded without committing
+	// so the document may still use the line states overwritten through it.
+	std::thread::id threadDocument;
+	const IDocument *accessOverwritten;
+	std::set<int> lineStatesOverwritten;
 	WordList keywords;
 	WordList keywords2;
 	WordList keywords3;
@@ -331,7 +534,6 @@ class LexerCPP : public ILexerWithSubStyles {
 	std::map<std::string, std::string> preprocessorDefinitionsStart;
 	OptionsCPP options;
 	OptionSetCPP osCPP;
-	SparseState<std::string> rawStringTerminators;
 	enum { activeFlag = 0x40 };
 	enum { ssIdentifier, ssDocKeyword };
 	SubStyles subStyles;
@@ -339,10 +541,18 @@ public:
 	LexerCPP(bool caseSensitive_) :
 		caseSensitive(caseSensitive_),
 		setWord(CharacterSet::setAlphaNum, "._", 0x80, true),
+		setOKBeforeRE(CharacterSet::setNone, "([{=,:;!%^&*|?~+-"),
 		setNegationOp(CharacterSet::setNone, "!"),
 		setArithmethicOp(CharacterSet::setNone, "+-/*%"),
 		setRelOp(CharacterSet::setNone, "=!<>"),
 		setLogicalOp(CharacterSet::setNone, "|&"),
+		ppLineStates(new PPLineStates()),
+		tableDefinitions(-1),
+		lineDefinitionsChanged(-1),
+		lineStateLast(0),
+		valuesKept(0),
+		threadDocument(std::this_thread::get_id()),
+		accessOverwritten(0),
 		subStyles(styleSubable, 0x80, 0x40, activeFlag) {
 	}
 	virtual ~LexerCPP() {
@@ -351,7 +561,7 @@ public:
 		delete this;
 	}
 	int SCI_METHOD Version() const {
-		return lvSubStyles;
+		return lvRestart;
 	}
 	const char * SCI_METHOD PropertyNames() {
 		return osCPP.PropertyNames();
@@ -367,8 +577,8 @@ public:
 		return osCPP.DescribeWordListSets();
 	}
 	int SCI_METHOD WordListSet(int n, const char *wl);
-	void SCI_METHOD Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
-	void SCI_METHOD Fold(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
 
 	void * SCI_METHOD PrivateCall(int, void *) {
 		return 0;
@@ -408,6 +618,10 @@ public:
 		return styleSubable;
 	}
 
+	bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess);
+	ILexerWithRestart * SCI_METHOD RangeLexer();
+	void SCI_METHOD MergeRange(ILexerWithRestart *rangeLexer, Sci_Position lineStart, Sci_Position lineEnd);
+
 	static ILexer *LexerFactoryCPP() {
 		return new LexerCPP(true);
 	}
@@ -417,8 +631,14 @@ public:
 	static int MaskActive(int style) {
 		return style & ~activeFlag;
 	}
+	int DefinitionsTable(int line, LexAccessor &styler);
+	void SetDefinitions(int table);
+	int SetLineState(int line, PPLine &ppLine, int table, LexAccessor &styler);
+	void CollectValues(IDocument *pAccess, LexAccessor &styler);
+	int FirstLineReadingChanged(int line, LexAccessor &styler);
 	void EvaluateTokens(std::vector<std::string> &tokens);
 	bool EvaluateExpression(const std::string &expr, const std::map<std::string, std::string> &preprocessorDefinitions);
+	std::vector<std::string> IdentifiersIn(const std::string &expr) const;
 };
 
 int SCI_METHOD LexerCPP::PropertySet(const char *key, const char *val) {
@@ -476,25 +696,125 @@ int SCI_METHOD LexerCPP::WordListSet(int n, const char *wl) {
 						preprocessorDefinitionsStart[name] = val;
 					}
 				}
+				tableDefinitions = -1;
 			}
 		}
 	}
 	return firstModification;
 }
 
-// Functor used to truncate history
-struct After {
-	int line;
-	After(int line_) : line(line_) {}
-	bool operator()(PPDefinition &p) const {
-		return p.line > line;
+// The definitions table at the start of line, from the nearest checkpoint before it and
+// the definitions made on the lines in between.
+int LexerCPP::DefinitionsTable(int line, LexAccessor &styler) {
+	int table = 0;
+	int lineTable = definitionCheckpoints.Restart(line, table);
+	if (lineTable < 0) {
+		lineTable = 0;
+		table = 0;
 	}
-};
+	int lineStatePrevious = 0;
+	for (; lineTable < line; lineTable++) {
+		if (definitionCheckpoints.Due(lineTable))
+			definitionCheckpoints.Record(lineTable, table);
+		const int lineState = styler.GetLineState(lineTable);
+		if (lineState && (lineState != lineStatePrevious)) {
+			const int definition = ppLineStates->Line(lineState).definition;
+			if (definition)
+				table = definitionTables.Add(table, definition);
+		}
+		lineStatePrevious = lineState;
+	}
+	return table;
+}
+
+void LexerCPP::SetDefinitions(int table) {
+	if (table == tableDefinitions)
+		return;
+	definitionsOfTable = preprocessorDefinitionsStart;
+	const std::vector<int> definitions = definitionTables.Definitions(table);
+	for (std::vector<int>::const_iterator it = definitions.begin(); it != definitions.end(); ++it) {
+		const PPDefinition definition = ppLineStates->Definition(*it);
+		if (definition.isUndef)
+			definitionsOfTable.erase(definition.key);
+		else
+			definitionsOfTable[definition.key] = definition.value;
+	}
+	tableDefinitions = table;
+}
+
+// Set the line state of line, noting when it makes a different definition than when it
+// was lexed before, then clear the definition and conditional of ppLine for the next line.
+// Returns the definitions table after line.
+int LexerCPP::SetLineState(int line, PPLine &ppLine, int table, LexAccessor &styler) {
+	if (!(ppLine == ppLineLast)) {
+		lineStateLast = ppLineStates->LineValue(ppLine);
+		ppLineLast = ppLine;
+	}
+	const int lineStatePrevious = styler.GetLineState(line);
+	if (lineStateLast != lineStatePrevious) {
+		const int definitionPrevious = lineStatePrevious ? ppLineStates->Line(lineStatePrevious).definition : 0;
+		if (definitionPrevious != ppLine.definition) {
+			if (definitionPrevious)
+				definitionsChanged.insert(ppLineStates->Definition(definitionPrevious).key);
+			if (ppLine.definition)
+				definitionsChanged.insert(ppLineStates->Definition(ppLine.definition).key);
+		}
+		if (std::this_thread::get_id() != threadDocument)
+			lineStatesOverwritten.insert(lineStatePrevious);
+		styler.SetLineState(line, lineStateLast);
+	}
+	if (ppLine.definition)
+		table = definitionTables.Add(table, ppLine.definition);
+	ppLine.definition = 0;
+	ppLine.conditional = 0;
+	if (definitionCheckpoints.Due(line + 1))
+		definitionCheckpoints.Record(line + 1, table);
+	return table;
+}
+
+// Values are only added while lexing so, when enough have been added, remove those not used
+// by any line state and rebuild the definitions tables from the values kept. Range lexers
+// share the values so this waits until there are none.
+void LexerCPP::CollectValues(IDocument *pAccess, LexAccessor &styler) {
+	if ((std::this_thread::get_id() == threadDocument) || (pAccess != accessOverwritten)) {
+		lineStatesOverwritten.clear();
+		accessOverwritten = pAccess;
+	}
+	if ((ppLineStates.use_count() > 1) || (ppLineStates->size() < std::max<size_t>(valuesKept * 2, 0x400)))
+		return;
+	std::set<int> lineStates(lineStatesOverwritten);
+	lineStates.insert(lineStateLast);
+	const int lineEnd = styler.GetLine(styler.Length()) + 1;
+	int lineStatePrevious = 0;
+	for (int line = 0; line < lineEnd; line++) {
+		const int lineState = styler.GetLineState(line);
+		if (lineState != lineStatePrevious)
+			lineStates.insert(lineState);
+		lineStatePrevious = lineState;
+	}
+	ppLineStates->Retain(lineStates);
+	valuesKept = ppLineStates->size();
+	definitionTables = PPDefinitionTables();
+	definitionCheckpoints.Clear();
+	tableDefinitions = -1;
+}
+
+// The first line from line with a conditional that reads a definition that changed, or -1.
+int LexerCPP::FirstLineReadingChanged(int line, LexAccessor &styler) {
+	const int lineEnd = styler.GetLine(styler.Length()) + 1;
+	int lineStatePrevious = 0;
+	for (; line < lineEnd; line++) {
+		const int lineState = styler.GetLineState(line);
+		if (lineState && (lineState != lineStatePrevious) && ppLineStates->ReadsAny(lineState, definitionsChanged))
+			return line;
+		lineStatePrevious = lineState;
+	}
+	return -1;
+}
 
-void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	LexAccessor styler(pAccess);
 
-	CharacterSet setOKBeforeRE(CharacterSet::setNone, "([{=,:;!%^&*|?~+-");
 	CharacterSet setCouldBePostOp(CharacterSet::setNone, "+-");
 
 	CharacterSet setDoxygen(CharacterSet::setAlpha, "$@\\&<>#{}[]");
@@ -539,32 +859,27 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 		}
 	}
 
-	StyleContext sc(startPos, length, initStyle, styler, static_cast<char>(0xff));
-	LinePPState preproc = vlls.ForLine(lineCurrent);
-
-	bool definitionsChanged = false;
+	CollectValues(pAccess, styler);
 
-	// Truncate ppDefineHistory before current line
-
-	if (!options.updatePreprocessor)
-		ppDefineHistory.clear();
-
-	std::vector<PPDefinition>::iterator itInvalid = std::find_if(ppDefineHistory.begin(), ppDefineHistory.end(), After(lineCurrent-1));
-	if (itInvalid != ppDefineHistory.end()) {
-		ppDefineHistory.erase(itInvalid, ppDefineHistory.end());
-		definitionsChanged = true;
-	}
-
-	std::map<std::string, std::string> preprocessorDefinitions = preprocessorDefinitionsStart;
-	for (std::vector<PPDefinition>::iterator itDef = ppDefineHistory.begin(); itDef != ppDefineHistory.end(); ++itDef) {
-		if (itDef->isUndef)
-			preprocessorDefinitions.erase(itDef->key);
-		else
-			preprocessorDefinitions[itDef->key] = itDef->value;
-	}
-
-	std::string rawStringTerminator = rawStringTerminators.ValueAt(lineCurrent-1);
-	SparseState<std::string> rawSTNew(lineCurrent);
+	StyleContext sc(startPos, length, initStyle, styler, static_cast<char>(0xff));
+	// The state at the start of the line is held in the line state of the line before
+	PPLine ppLine;
+	if (lineCurrent > 0)
+		ppLine = ppLineStates->Line(styler.GetLineState(lineCurrent-1));
+	LinePPState preproc = ppLine.preproc;
+	std::string rawStringTerminator = ppLine.rawStringTerminator;
+	ppLine.definition = 0;
+	ppLine.conditional = 0;
+
+	int table = DefinitionsTable(lineCurrent, styler);
+	SetDefinitions(table);
+	std::map<std::string, std::string> preprocessorDefinitions;
+	preprocessorDefinitions.swap(definitionsOfTable);
+	tableDefinitions = -1;
+	// Differences in definitions found by lexing the text before this line are still to
+	// be checked against the conditionals after it.
+	if (lineCurrent != lineDefinitionsChanged)
+		definitionsChanged.clear();
 
 	int activitySet = preproc.IsInactive() ? activeFlag : 0;
 
@@ -599,20 +914,21 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 		}
 
 		if (sc.atLineEnd) {
+			ppLine.preproc = preproc;
+			ppLine.rawStringTerminator = rawStringTerminator;
+			table = SetLineState(lineCurrent, ppLine, table, styler);
 			lineCurrent++;
 			lineEndNext = styler.LineEnd(lineCurrent);
-			vlls.Add(lineCurrent, preproc);
-			if (rawStringTerminator != "") {
-				rawSTNew.Set(lineCurrent-1, rawStringTerminator);
-			}
 		}
 
 		// Handle line continuation generically.
 		if (sc.ch == '\\') {
 			if (static_cast<int>((sc.currentPos+1)) >= lineEndNext) {
+				ppLine.preproc = preproc;
+				ppLine.rawStringTerminator = rawStringTerminator;
+				table = SetLineState(lineCurrent, ppLine, table, styler);
 				lineCurrent++;
 				lineEndNext = styler.LineEnd(lineCurrent);
-				vlls.Add(lineCurrent, preproc);
 				sc.Forward();
 				if (sc.ch == '\r' && sc.chNext == '\n') {
 					// Even in UTF-8, \r and \n are separate
@@ -655,7 +971,7 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 					} else if (keywords4.InList(s)) {
 						sc.ChangeState(SCE_C_GLOBALCLASS|activitySet);
 					} else {
-						int subStyle = classifierIdentifiers.ValueFor(s);
+						int subStyle = classifierIdentifiers.ValueFor(s, strlen(s));
 						if (subStyle >= 0) {
 							sc.ChangeState(subStyle|activitySet);
 						}
@@ -759,7 +1075,7 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 					if (!IsASpace(sc.ch)) {
 						sc.ChangeState(SCE_C_COMMENTDOCKEYWORDERROR|activitySet);
 					} else if (!keywords3.InList(s + 1)) {
-						int subStyleCDKW = classifierDocKeyWords.ValueFor(s+1);
+						int subStyleCDKW = classifierDocKeyWords.ValueFor(s+1, strlen(s+1));
 						if (subStyleCDKW >= 0) {
 							sc.ChangeState(subStyleCDKW|activitySet);
 						} else {
@@ -860,9 +1176,11 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 
 		if (sc.atLineEnd && !atLineEndBeforeSwitch) {
 			// State exit processing consumed characters up to end of line.
+			ppLine.preproc = preproc;
+			ppLine.rawStringTerminator = rawStringTerminator;
+			table = SetLineState(lineCurrent, ppLine, table, styler);
 			lineCurrent++;
 			lineEndNext = styler.LineEnd(lineCurrent);
-			vlls.Add(lineCurrent, preproc);
 		}
 
 		// Determine if a new state should be entered.
@@ -953,10 +1271,12 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 							std::string restOfLine = GetRestOfLine(styler, sc.currentPos + i + 1, false);
 							bool foundDef = preprocessorDefinitions.find(restOfLine) != preprocessorDefinitions.end();
 							preproc.StartSection(isIfDef == foundDef);
+							ppLine.conditional = ppLineStates->ConditionalValue(std::vector<std::string>(1, restOfLine));
 						} else if (sc.Match("if")) {
 							std::string restOfLine = GetRestOfLine(styler, sc.currentPos + 2, true);
 							bool ifGood = EvaluateExpression(restOfLine, preprocessorDefinitions);
 							preproc.StartSection(ifGood);
+							ppLine.conditional = ppLineStates->ConditionalValue(IdentifiersIn(restOfLine));
 						} else if (sc.Match("else")) {
 							if (!preproc.CurrentIfTaken()) {
 								preproc.InvertCurrentLevel();
@@ -971,9 +1291,10 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 							}
 						} else if (sc.Match("elif")) {
 							// Ensure only one chosen out of #if .. #elif .. #elif .. #else .. #endif
+							std::string restOfLine = GetRestOfLine(styler, sc.currentPos + 2, true);
+							ppLine.conditional = ppLineStates->ConditionalValue(IdentifiersIn(restOfLine));
 							if (!preproc.CurrentIfTaken()) {
 								// Similar to #if
-								std::string restOfLine = GetRestOfLine(styler, sc.currentPos + 2, true);
 								bool ifGood = EvaluateExpression(restOfLine, preprocessorDefinitions);
 								if (ifGood) {
 									preproc.InvertCurrentLevel();
@@ -1004,8 +1325,7 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 											value = tokens[1];
 										}
 										preprocessorDefinitions[key] = value;
-										ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value));
-										definitionsChanged = true;
+										ppLine.definition = ppLineStates->DefinitionValue(PPDefinition(key, value));
 									}
 								}
 							}
@@ -1017,8 +1337,7 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 								if (tokens.size() >= 1) {
 									key = tokens[0];
 									preprocessorDefinitions.erase(key);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, "", true));
-									definitionsChanged = true;
+									ppLine.definition = ppLineStates->DefinitionValue(PPDefinition(key, "", true));
 								}
 							}
 						}
@@ -1036,17 +1355,101 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 		continuationLine = false;
 		sc.Forward();
 	}
-	const bool rawStringsChanged = rawStringTerminators.Merge(rawSTNew, lineCurrent);
-	if (definitionsChanged || rawStringsChanged)
-		styler.ChangeLexerState(startPos, startPos + length);
 	sc.Complete();
+	// The lines after the range were lexed with the earlier definitions so, when those
+	// changed, the first conditional that reads a changed definition must be lexed again.
+	lineDefinitionsChanged = lineCurrent;
+	if (!definitionsChanged.empty()) {
+		const int lineReading = FirstLineReadingChanged(lineCurrent, styler);
+		if (lineReading >= 0)
+			styler.ChangeLexerState(styler.LineStart(lineReading), styler.Length());
+		else
+			definitionsChanged.clear();
+	}
+	// Keep the definitions for lexing from here unless the range ended within a line
+	// that made a definition.
+	if (!ppLine.definition) {
+		tableDefinitions = table;
+		definitionsOfTable.swap(preprocessorDefinitions);
+	}
+}
+
+// Skip white space and comments to find the character that will next set chPrevNonWhite
+// when lexing from pos in the default state.
+static int FirstVisibleChar(LexAccessor &styler, int pos) {
+	const int lengthDoc = styler.Length();
+	while (pos < lengthDoc) {
+		const char ch = styler.SafeGetCharAt(pos);
+		const char chNext = styler.SafeGetCharAt(pos + 1);
+		if (IsASpace(ch)) {
+			pos++;
+		} else if ((ch == '/') && (chNext == '*')) {
+			pos += 2;
+			while ((pos < lengthDoc) && !((styler.SafeGetCharAt(pos) == '*') && (styler.SafeGetCharAt(pos + 1) == '/')))
+				pos++;
+			pos += 2;
+		} else if ((ch == '/') && (chNext == '/')) {
+			// Line comments continue onto the next line after a '\'
+			int line = styler.GetLine(pos);
+			while ((line < styler.GetLine(lengthDoc)) &&
+				(styler.SafeGetCharAt(styler.LineEnd(line) - 1) == '\\'))
+				line++;
+			pos = styler.LineStart(line + 1);
+		} else {
+			return static_cast<unsigned char>(ch);
+		}
+	}
+	return ' ';
+}
+
+// Lexing can restart at a line that starts in the default state outside any preprocessor
+// conditional or raw string when no definitions have been made before it. The previous
+// visible character decides whether a '/' is a regular expression so, when it could, the
+// next visible character must not be '/'.
+bool SCI_METHOD LexerCPP::IsRestartLine(Sci_Position line, IDocument *pAccess) {
+	if (line <= 0)
+		return true;
+	LexAccessor styler(pAccess);
+	const int lineStart = styler.LineStart(line);
+	const PPLine ppLine = ppLineStates->Line(styler.GetLineState(line - 1));
+	if ((styler.StyleAt(lineStart - 1) != SCE_C_DEFAULT) || !ppLine.preproc.IsInitial() ||
+		(ppLine.rawStringTerminator != "") || (DefinitionsTable(line, styler) != 0))
+		return false;
+	int back = lineStart - 1;
+	while ((back >= 0) && (IsASpace(styler.SafeGetCharAt(back)) || IsSpaceEquiv(MaskActive(styler.StyleAt(back)))))
+		back--;
+	if ((back >= 0) && setOKBeforeRE.Contains(styler.SafeGetCharAt(back)) &&
+		(FirstVisibleChar(styler, lineStart) == '/'))
+		return false;
+	return true;
+}
+
+ILexerWithRestart * SCI_METHOD LexerCPP::RangeLexer() {
+	// Lex modifies the definitions held by the lexer so use a copy of the settings that
+	// shares the values of line states
+	LexerCPP *lexer = new LexerCPP(caseSensitive);
+	lexer->ppLineStates = ppLineStates;
+	lexer->setWord = setWord;
+	lexer->keywords = keywords;
+	lexer->keywords2 = keywords2;
+	lexer->keywords3 = keywords3;
+	lexer->keywords4 = keywords4;
+	lexer->ppDefinitions = ppDefinitions;
+	lexer->preprocessorDefinitionsStart = preprocessorDefinitionsStart;
+	lexer->options = options;
+	lexer->subStyles = subStyles;
+	return lexer;
+}
+
+void SCI_METHOD LexerCPP::MergeRange(ILexerWithRestart *, Sci_Position, Sci_Position) {
+	// The state of the range is all in the line states committed with its styles
 }
 
 // Store both the current line's fold level and the next lines in the
 // level store to make it easy to pick up with each increment
 // and to make it possible to fiddle the current level for "} else {".
 
-void SCI_METHOD LexerCPP::Fold(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerCPP::Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 
 	if (!options.fold)
 		return;
@@ -1305,5 +1708,25 @@ bool LexerCPP::EvaluateExpression(const std::string &expr, const std::map<std::s
 	return !isFalse;
 }
 
+// The words in an expression that EvaluateExpression looks up as definitions
+std::vector<std::string> LexerCPP::IdentifiersIn(const std::string &expr) const {
+	std::vector<std::string> identifiers;
+	std::string word;
+	for (const char *cp = expr.c_str();; cp++) {
+		if (*cp && setWord.Contains(static_cast<unsigned char>(*cp))) {
+			word += *cp;
+		} else {
+			if (!word.empty() && !(word[0] >= '0' && word[0] <= '9'))
+				identifiers.push_back(word);
+			word = "";
+			if (!*cp)
+				break;
+		}
+	}
+	std::sort(identifiers.begin(), identifiers.end());
+	identifiers.erase(std::unique(identifiers.begin(), identifiers.end()), identifiers.end());
+	return identifiers;
+}
+
 LexerModule lmCPP(SCLEX_CPP, LexerCPP::LexerFactoryCPP, "cpp", cppWordLists);
 LexerModule lmCPPNoCase(SCLEX_CPPNOCASE, LexerCPP::LexerFactoryCPPInsensitive, "cppnocase", cppWordLists);
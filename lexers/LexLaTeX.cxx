@@ -41,6 +41,12 @@ struct latexFoldSave {
 	latexFoldSave(const latexFoldSave &save) : structLev(save.structLev) {
 		for (int i = 0; i < 8; ++i) openBegins[i] = save.openBegins[i];
 	}
+	bool operator==(const latexFoldSave &other) const {
+		if (structLev != other.structLev) return false;
+		for (int i = 0; i < 8; ++i)
+			if (openBegins[i] != other.openBegins[i]) return false;
+		return true;
+	}
 	int openBegins[8];
 	int structLev;
 };
@@ -48,8 +54,11 @@ struct latexFoldSave {
 class LexerLaTeX : public LexerBase {
 private:
 	vector<int> modes;
+	bool modesChanged;	// A mode held for a line was changed by this Lex
+	int linesModes;	// Lines in the document when modes were last held
 	void setMode(int line, int mode) {
 		if (line >= static_cast<int>(modes.size())) modes.resize(line + 1, 0);
+		if (modes[line] != mode) modesChanged = true;
 		modes[line] = mode;
 	}
 	int getMode(int line) {
@@ -62,8 +71,11 @@ private:
 	}
 	
 	vector<latexFoldSave> saves;
+	bool savesChanged;	// A save held for a line was changed by this Fold
+	int linesSaves;	// Lines in the document when saves were last held
 	void setSave(int line, const latexFoldSave &save) {
 		if (line >= static_cast<int>(saves.size())) saves.resize(line + 1);
+		if (!(saves[line] == save)) savesChanged = true;
 		saves[line] = save;
 	}
 	void getSave(int line, latexFoldSave &save) {
@@ -78,11 +90,13 @@ private:
 			saves.resize(numLines + 128);
 	}
 public:
+	LexerLaTeX() : modesChanged(false), linesModes(0), savesChanged(false), linesSaves(0) {
+	}
 	static ILexer *LexerFactoryLaTeX() {
 		return new LexerLaTeX();
 	}
-	void SCI_METHOD Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
-	void SCI_METHOD Fold(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
 };
 
 static bool latexIsSpecial(int ch) {
@@ -184,11 +198,12 @@ static inline void latexStateReset(int &mode, int &state) {
 
 // There are cases not handled correctly, like $abcd\textrm{what is $x+y$}z+w$.
 // But I think it's already good enough.
-void SCI_METHOD LexerLaTeX::Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerLaTeX::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	// startPos is assumed to be the first character of a line
 	Accessor styler(pAccess, &props);
 	styler.StartAt(startPos);
 	int mode = getMode(styler.GetLine(startPos) - 1);
+	modesChanged = false;
 	int state = initStyle;
 	if (state == SCE_L_ERROR || state == SCE_L_SHORTCMD || state == SCE_L_SPECIAL)   // should not happen
 		latexStateReset(mode, state);
@@ -456,7 +471,14 @@ void SCI_METHOD LexerLaTeX::Lex(unsigned int startPos, int length, int initStyle
 			break;
 		}
 	}
+	// Modes are held by line number and are not moved when lines are inserted or deleted
+	// so any held for lines after the range can not be relied on until those are lexed
+	// when a mode in the range changed or the number of lines changed.
+	const int lines = styler.GetLine(styler.Length());
 	if (lengthDoc == styler.Length()) truncModes(styler.GetLine(lengthDoc - 1));
+	else if ((modesChanged || lines != linesModes) && static_cast<int>(modes.size()) > styler.GetLine(lengthDoc))
+		styler.ChangeLexerState(startPos, lengthDoc);
+	linesModes = lines;
 	styler.ColourTo(lengthDoc - 1, state);
 	styler.Flush();
 }
@@ -470,7 +492,7 @@ static int latexFoldSaveToInt(const latexFoldSave &save) {
 
 // Change folding state while processing a line
 // Return the level before the first relevant command
-void SCI_METHOD LexerLaTeX::Fold(unsigned int startPos, int length, int, IDocument *pAccess) {
+void SCI_METHOD LexerLaTeX::Fold(Sci_PositionU startPos, Sci_Position length, int, IDocument *pAccess) {
 	const char *structWords[7] = {"part", "chapter", "section", "subsection",
 		"subsubsection", "paragraph", "subparagraph"};
 	Accessor styler(pAccess, &props);
@@ -478,6 +500,7 @@ void SCI_METHOD LexerLaTeX::Fold(unsigned int startPos, int length, int, IDocume
 	int curLine = styler.GetLine(startPos);
 	latexFoldSave save;
 	getSave(curLine - 1, save);
+	savesChanged = false;
 	do {
 		char ch, buf[16];
 		int i, j, lev = -1;
@@ -529,6 +552,12 @@ void SCI_METHOD LexerLaTeX::Fold(unsigned int startPos, int length, int, IDocume
 			truncSaves(curLine);
 		}
 	} while (startPos < endPos);
+	// As with modes, saves after the range can not be relied on until those lines are folded
+	const int lines = styler.GetLine(styler.Length());
+	if ((savesChanged || lines != linesSaves) && static_cast<int>(startPos) < styler.Length() &&
+		static_cast<int>(saves.size()) > curLine)
+		styler.ChangeLexerState(endPos - length, endPos);
+	linesSaves = lines;
 	styler.Flush();
 }
 
@@ -347,6 +347,15 @@ static void ColouriseLuaDoc(
 	sc.Complete();
 }
 
+// Lexing can restart at a line when the line before it ended in the default state
+// and was not inside a long string or block comment which is held in the line state.
+static bool IsLuaRestartLine(int line, Accessor &styler) {
+	if (line <= 0)
+		return true;
+	return (styler.StyleAt(styler.LineStart(line) - 1) == SCE_LUA_DEFAULT) &&
+		(styler.GetLineState(line - 1) == 0);
+}
+
 static void FoldLuaDoc(unsigned int startPos, int length, int /* initStyle */, WordList *[],
                        Accessor &styler) {
 	unsigned int lengthDoc = startPos + length;
@@ -433,4 +442,4 @@ static const char * const luaWordListDesc[] = {
 	0
 };
 
-LexerModule lmLua(SCLEX_LUA, ColouriseLuaDoc, "lua", FoldLuaDoc, luaWordListDesc);
+LexerModule lmLua(SCLEX_LUA, ColouriseLuaDoc, "lua", FoldLuaDoc, luaWordListDesc, 5, IsLuaRestartLine);
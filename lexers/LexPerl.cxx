@@ -15,7 +15,9 @@
 #include <ctype.h>
 
 #include <string>
+#include <vector>
 #include <map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -27,6 +29,8 @@
 #include "CharacterSet.h"
 #include "LexerModule.h"
 #include "OptionSet.h"
+#include "SparseState.h"
+#include "Checkpoints.h"
 
 #ifdef SCI_NAMESPACE
 using namespace Scintilla;
@@ -335,6 +339,43 @@ struct OptionSetPerl : public OptionSet<OptionsPerl> {
 	}
 };
 
+// Everything the lexer carries from one line to the next so that styling can
+// resume at the start of a line where this was recorded.
+struct PerlState {
+	int style;
+	int hereDocState;
+	int hereDocQuote;
+	bool hereDocQuoted;
+	std::string hereDocDelimiter;
+	int quoteRep;
+	int quoteCount;
+	int quoteUp;
+	int quoteDown;
+	int numState;
+	int dotCount;
+	int backFlag;
+	unsigned int backPos;
+	PerlState() : style(SCE_PL_DEFAULT), hereDocState(0), hereDocQuote(0), hereDocQuoted(false),
+		quoteRep(1), quoteCount(0), quoteUp(0), quoteDown(0),
+		numState(PERLNUM_DECIMAL), dotCount(0), backFlag(BACK_NONE), backPos(0) {
+	}
+	bool operator==(const PerlState &other) const {
+		return (style == other.style) &&
+			(hereDocState == other.hereDocState) &&
+			(hereDocQuote == other.hereDocQuote) &&
+			(hereDocQuoted == other.hereDocQuoted) &&
+			(hereDocDelimiter == other.hereDocDelimiter) &&
+			(quoteRep == other.quoteRep) &&
+			(quoteCount == other.quoteCount) &&
+			(quoteUp == other.quoteUp) &&
+			(quoteDown == other.quoteDown) &&
+			(numState == other.numState) &&
+			(dotCount == other.dotCount) &&
+			(backFlag == other.backFlag) &&
+			(backPos == other.backPos);
+	}
+};
+
 class LexerPerl : public ILexer {
 	CharacterSet setWordStart;
 	CharacterSet setWord;
@@ -343,6 +384,7 @@ class LexerPerl : public ILexer {
 	WordList keywords;
 	OptionsPerl options;
 	OptionSetPerl osPerl;
+	Checkpoints<PerlState> checkpoints;
 public:
 	LexerPerl() :
 		setWordStart(CharacterSet::setAlpha, "_", 0x80, true),
@@ -372,8 +414,8 @@ public:
 		return osPerl.DescribeWordListSets();
 	}
 	int SCI_METHOD WordListSet(int n, const char *wl);
-	void SCI_METHOD Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
-	void SCI_METHOD Fold(unsigned int startPos, int length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
 
 	void *SCI_METHOD PrivateCall(int, void *) {
 		return 0;
@@ -515,7 +557,7 @@ void LexerPerl::InterpolateSegment(StyleContext &sc, int maxSeg, bool isPattern)
 		sc.SetState(sc.state - INTERPOLATE_SHIFT);
 }
 
-void SCI_METHOD LexerPerl::Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	LexAccessor styler(pAccess);
 
 	// keywords that forces /PATTERN/ at all times; should track vim's behaviour
@@ -602,101 +644,145 @@ void SCI_METHOD LexerPerl::Lex(unsigned int startPos, int length, int initStyle,
 
 	unsigned int endPos = startPos + length;
 
-	// Backtrack to beginning of style if required...
-	// If in a long distance lexical state, backtrack to find quote characters.
-	// Includes strings (may be multi-line), numbers (additional state), format
-	// bodies, as well as POD sections.
-	if (initStyle == SCE_PL_HERE_Q
-	    || initStyle == SCE_PL_HERE_QQ
-	    || initStyle == SCE_PL_HERE_QX
-	    || initStyle == SCE_PL_FORMAT
-	    || initStyle == SCE_PL_HERE_QQ_VAR
-	    || initStyle == SCE_PL_HERE_QX_VAR
-	   ) {
-		// backtrack through multiple styles to reach the delimiter start
-		int delim = (initStyle == SCE_PL_FORMAT) ? SCE_PL_FORMAT_IDENT:SCE_PL_HERE_DELIM;
-		while ((startPos > 1) && (styler.StyleAt(startPos) != delim)) {
-			startPos--;
-		}
-		startPos = styler.LineStart(styler.GetLine(startPos));
-		initStyle = styler.StyleAt(startPos - 1);
-	}
-	if (initStyle == SCE_PL_STRING
-	    || initStyle == SCE_PL_STRING_QQ
-	    || initStyle == SCE_PL_BACKTICKS
-	    || initStyle == SCE_PL_STRING_QX
-	    || initStyle == SCE_PL_REGEX
-	    || initStyle == SCE_PL_STRING_QR
-	    || initStyle == SCE_PL_REGSUBST
-	    || initStyle == SCE_PL_STRING_VAR
-	    || initStyle == SCE_PL_STRING_QQ_VAR
-	    || initStyle == SCE_PL_BACKTICKS_VAR
-	    || initStyle == SCE_PL_STRING_QX_VAR
-	    || initStyle == SCE_PL_REGEX_VAR
-	    || initStyle == SCE_PL_STRING_QR_VAR
-	    || initStyle == SCE_PL_REGSUBST_VAR
-	   ) {
-		// for interpolation, must backtrack through a mix of two different styles
-		int otherStyle = (initStyle >= SCE_PL_STRING_VAR) ?
-			initStyle - INTERPOLATE_SHIFT : initStyle + INTERPOLATE_SHIFT;
-		while (startPos > 1) {
-			int st = styler.StyleAt(startPos - 1);
-			if ((st != initStyle) && (st != otherStyle))
-				break;
-			startPos--;
-		}
-		initStyle = SCE_PL_DEFAULT;
-	} else if (initStyle == SCE_PL_STRING_Q
-	        || initStyle == SCE_PL_STRING_QW
-	        || initStyle == SCE_PL_XLAT
-	        || initStyle == SCE_PL_CHARACTER
-	        || initStyle == SCE_PL_NUMBER
-	        || initStyle == SCE_PL_IDENTIFIER
-	        || initStyle == SCE_PL_ERROR
-	        || initStyle == SCE_PL_SUB_PROTOTYPE
-	   ) {
-		while ((startPos > 1) && (styler.StyleAt(startPos - 1) == initStyle)) {
-			startPos--;
-		}
-		initStyle = SCE_PL_DEFAULT;
-	} else if (initStyle == SCE_PL_POD
-	        || initStyle == SCE_PL_POD_VERB
-	          ) {
-		// POD backtracking finds preceeding blank lines and goes back past them
-		int ln = styler.GetLine(startPos);
-		if (ln > 0) {
-			initStyle = styler.StyleAt(styler.LineStart(--ln));
-			if (initStyle == SCE_PL_POD || initStyle == SCE_PL_POD_VERB) {
-				while (ln > 0 && styler.GetLineState(ln) == SCE_PL_DEFAULT)
-					ln--;
-			}
-			startPos = styler.LineStart(++ln);
-			initStyle = styler.StyleAt(startPos - 1);
-		} else {
-			startPos = 0;
-			initStyle = SCE_PL_DEFAULT;
-		}
-	}
-
 	// backFlag, backPos are additional state to aid identifier corner cases.
 	// Look backwards past whitespace and comments in order to detect either
 	// operator or keyword. Later updated as we go along.
 	int backFlag = BACK_NONE;
 	unsigned int backPos = startPos;
-	if (backPos > 0) {
-		backPos--;
-		skipWhitespaceComment(styler, backPos);
-		if (styler.StyleAt(backPos) == SCE_PL_OPERATOR)
-			backFlag = BACK_OPERATOR;
-		else if (styler.StyleAt(backPos) == SCE_PL_WORD)
-			backFlag = BACK_KEYWORD;
-		backPos++;
+
+	// Resume from a checkpoint just before startPos when there is one as backtracking
+	// through long strings, here docs and POD may go back a long way.
+	PerlState restart;
+	const int lineRestart = checkpoints.RestartNear(styler.GetLine(startPos), restart);
+	if (lineRestart >= 0) {
+		startPos = styler.LineStart(lineRestart);
+		initStyle = restart.style;
+		HereDoc.State = restart.hereDocState;
+		HereDoc.Quote = restart.hereDocQuote;
+		HereDoc.Quoted = restart.hereDocQuoted;
+		HereDoc.DelimiterLength = 0;
+		HereDoc.Delimiter[0] = '\0';
+		for (size_t i = 0; i < restart.hereDocDelimiter.length(); i++)
+			HereDoc.Append(static_cast<unsigned char>(restart.hereDocDelimiter[i]));
+		Quote.Rep = restart.quoteRep;
+		Quote.Count = restart.quoteCount;
+		Quote.Up = restart.quoteUp;
+		Quote.Down = restart.quoteDown;
+		numState = restart.numState;
+		dotCount = restart.dotCount;
+		backFlag = restart.backFlag;
+		backPos = restart.backPos;
+	} else {
+		// Backtrack to beginning of style if required...
+		// If in a long distance lexical state, backtrack to find quote characters.
+		// Includes strings (may be multi-line), numbers (additional state), format
+		// bodies, as well as POD sections.
+		if (initStyle == SCE_PL_HERE_Q
+		    || initStyle == SCE_PL_HERE_QQ
+		    || initStyle == SCE_PL_HERE_QX
+		    || initStyle == SCE_PL_FORMAT
+		    || initStyle == SCE_PL_HERE_QQ_VAR
+		    || initStyle == SCE_PL_HERE_QX_VAR
+		   ) {
+			// backtrack through multiple styles to reach the delimiter start
+			int delim = (initStyle == SCE_PL_FORMAT) ? SCE_PL_FORMAT_IDENT:SCE_PL_HERE_DELIM;
+			while ((startPos > 1) && (styler.StyleAt(startPos) != delim)) {
+				startPos--;
+			}
+			startPos = styler.LineStart(styler.GetLine(startPos));
+			initStyle = styler.StyleAt(startPos - 1);
+		}
+		if (initStyle == SCE_PL_STRING
+		    || initStyle == SCE_PL_STRING_QQ
+		    || initStyle == SCE_PL_BACKTICKS
+		    || initStyle == SCE_PL_STRING_QX
+		    || initStyle == SCE_PL_REGEX
+		    || initStyle == SCE_PL_STRING_QR
+		    || initStyle == SCE_PL_REGSUBST
+		    || initStyle == SCE_PL_STRING_VAR
+		    || initStyle == SCE_PL_STRING_QQ_VAR
+		    || initStyle == SCE_PL_BACKTICKS_VAR
+		    || initStyle == SCE_PL_STRING_QX_VAR
+		    || initStyle == SCE_PL_REGEX_VAR
+		    || initStyle == SCE_PL_STRING_QR_VAR
+		    || initStyle == SCE_PL_REGSUBST_VAR
+		   ) {
+			// for interpolation, must backtrack through a mix of two different styles
+			int otherStyle = (initStyle >= SCE_PL_STRING_VAR) ?
+				initStyle - INTERPOLATE_SHIFT : initStyle + INTERPOLATE_SHIFT;
+			while (startPos > 1) {
+				int st = styler.StyleAt(startPos - 1);
+				if ((st != initStyle) && (st != otherStyle))
+					break;
+				startPos--;
+			}
+			initStyle = SCE_PL_DEFAULT;
+		} else if (initStyle == SCE_PL_STRING_Q
+		        || initStyle == SCE_PL_STRING_QW
+		        || initStyle == SCE_PL_XLAT
+		        || initStyle == SCE_PL_CHARACTER
+		        || initStyle == SCE_PL_NUMBER
+		        || initStyle == SCE_PL_IDENTIFIER
+		        || initStyle == SCE_PL_ERROR
+		        || initStyle == SCE_PL_SUB_PROTOTYPE
+		   ) {
+			while ((startPos > 1) && (styler.StyleAt(startPos - 1) == initStyle)) {
+				startPos--;
+			}
+			initStyle = SCE_PL_DEFAULT;
+		} else if (initStyle == SCE_PL_POD
+		        || initStyle == SCE_PL_POD_VERB
+		          ) {
+			// POD backtracking finds preceeding blank lines and goes back past them
+			int ln = styler.GetLine(startPos);
+			if (ln > 0) {
+				initStyle = styler.StyleAt(styler.LineStart(--ln));
+				if (initStyle == SCE_PL_POD || initStyle == SCE_PL_POD_VERB) {
+					while (ln > 0 && styler.GetLineState(ln) == SCE_PL_DEFAULT)
+						ln--;
+				}
+				startPos = styler.LineStart(++ln);
+				initStyle = styler.StyleAt(startPos - 1);
+			} else {
+				startPos = 0;
+				initStyle = SCE_PL_DEFAULT;
+			}
+		}
+
+		backPos = startPos;
+		if (backPos > 0) {
+			backPos--;
+			skipWhitespaceComment(styler, backPos);
+			if (styler.StyleAt(backPos) == SCE_PL_OPERATOR)
+				backFlag = BACK_OPERATOR;
+			else if (styler.StyleAt(backPos) == SCE_PL_WORD)
+				backFlag = BACK_KEYWORD;
+			backPos++;
+		}
 	}
 
 	StyleContext sc(startPos, endPos - startPos, initStyle, styler, static_cast<char>(STYLE_MAX));
 
 	for (; sc.More(); sc.Forward()) {
 
+		if (sc.atLineStart && checkpoints.Due(sc.currentLine)) {
+			PerlState state;
+			state.style = sc.state;
+			state.hereDocState = HereDoc.State;
+			state.hereDocQuote = HereDoc.Quote;
+			state.hereDocQuoted = HereDoc.Quoted;
+			state.hereDocDelimiter.assign(HereDoc.Delimiter, HereDoc.DelimiterLength);
+			state.quoteRep = Quote.Rep;
+			state.quoteCount = Quote.Count;
+			state.quoteUp = Quote.Up;
+			state.quoteDown = Quote.Down;
+			state.numState = numState;
+			state.dotCount = dotCount;
+			state.backFlag = backFlag;
+			state.backPos = backPos;
+			checkpoints.Record(sc.currentLine, state);
+		}
+
 		// Determine if the current state should terminate.
 		switch (sc.state) {
 		case SCE_PL_OPERATOR:
@@ -1557,7 +1643,7 @@ void SCI_METHOD LexerPerl::Lex(unsigned int startPos, int length, int initStyle,
 #define PERL_HEADFOLD_SHIFT		4
 #define PERL_HEADFOLD_MASK		0xF0
 
-void SCI_METHOD LexerPerl::Fold(unsigned int startPos, int length, int /* initStyle */, IDocument *pAccess) {
+void SCI_METHOD LexerPerl::Fold(Sci_PositionU startPos, Sci_Position length, int /* initStyle */, IDocument *pAccess) {
 
 	if (!options.fold)
 		return;
@@ -406,6 +406,49 @@ static void ColourisePyDoc(unsigned int startPos, int length, int initStyle,
 	sc.Complete();
 }
 
+// ColourisePyDoc starts on the line before startPos so it can restart at a line when the line
+// before that begins in the default state. The next identifier may also depend on the last
+// keyword: class, def and import affect it unless another word comes between them while cdef
+// and cpdef affect all identifiers up to the next operator.
+static bool IsPyRestartLine(int line, Accessor &styler) {
+	if (styler.GetPropertyInt("tab.timmy.whinge.level") != 0) {
+		// Indentation indicators continue over lines
+		return false;
+	}
+	if (line <= 1)
+		return true;
+	int pos = styler.LineStart(line - 1) - 1;
+	if (styler.StyleAt(pos) != SCE_P_DEFAULT)
+		return false;
+	bool wordAfter = false;
+	while (pos >= 0) {
+		const int style = styler.StyleAt(pos);
+		int startRun = pos;
+		while ((startRun > 0) && (styler.StyleAt(startRun - 1) == style))
+			startRun--;
+		if (style == SCE_P_OPERATOR) {
+			return true;
+		} else if (style == SCE_P_WORD) {
+			char s[100];
+			int len = 0;
+			for (int i = startRun; (i <= pos) && (len < static_cast<int>(sizeof(s)) - 1); i++)
+				s[len++] = styler[i];
+			s[len] = '\0';
+			if ((0 == strcmp(s, "cdef")) || (0 == strcmp(s, "cpdef")))
+				return false;
+			if (!wordAfter && ((0 == strcmp(s, "class")) || (0 == strcmp(s, "def")) ||
+				(0 == strcmp(s, "import")) || (0 == strcmp(s, "cimport"))))
+				return false;
+			wordAfter = true;
+		} else if ((style == SCE_P_IDENTIFIER) || (style == SCE_P_WORD2) ||
+			(style == SCE_P_CLASSNAME) || (style == SCE_P_DEFNAME)) {
+			wordAfter = true;
+		}
+		pos = startRun - 1;
+	}
+	return true;
+}
+
 static bool IsCommentLine(int line, Accessor &styler) {
 	int pos = styler.LineStart(line);
 	int eol_pos = styler.LineStart(line + 1) - 1;
@@ -567,5 +610,5 @@ static const char *const pythonWordListDesc[] = {
 };
 
 LexerModule lmPython(SCLEX_PYTHON, ColourisePyDoc, "python", FoldPyDoc,
-					 pythonWordListDesc);
+					 pythonWordListDesc, 5, IsPyRestartLine);
 
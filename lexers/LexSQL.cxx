@@ -218,6 +218,19 @@ public :
 		return sqlStatement.ValueAt(lineNumber);
 	}
 
+	bool HasStatesAfter(int lineNumber) const {
+		return sqlStatement.HasAfter(lineNumber);
+	}
+
+	// Take back the states after lineNumber from before folding when the state of that line
+	// is the same so the later states still follow from it.
+	bool RestoreAfter(int lineNumber, SQLStates &before) {
+		if (sqlStatement.ValueAt(lineNumber) != before.sqlStatement.ValueAt(lineNumber))
+			return false;
+		sqlStatement.ReplaceAfter(lineNumber, before.sqlStatement);
+		return true;
+	}
+
 	SQLStates() {}
 
 private :
@@ -304,7 +317,7 @@ struct OptionSetSQL : public OptionSet<OptionsSQL> {
 
 class LexerSQL : public ILexer {
 public :
-	LexerSQL() {}
+	LexerSQL() : linesStates(0) {}
 
 	virtual ~LexerSQL() {}
 
@@ -340,8 +353,8 @@ public :
 	}
 
 	int SCI_METHOD WordListSet(int n, const char *wl);
-	void SCI_METHOD Lex (unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
-	void SCI_METHOD Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Lex (Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess);
 
 	void * SCI_METHOD PrivateCall(int, void *) {
 		return 0;
@@ -389,6 +402,7 @@ private:
 	OptionsSQL options;
 	OptionSetSQL osSQL;
 	SQLStates sqlStates;
+	int linesStates;	// Lines in the document when states were last set
 
 	WordList keywords1;
 	WordList keywords2;
@@ -439,7 +453,7 @@ int SCI_METHOD LexerSQL::WordListSet(int n, const char *wl) {
 	return firstModification;
 }
 
-void SCI_METHOD LexerSQL::Lex(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerSQL::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	LexAccessor styler(pAccess);
 	StyleContext sc(startPos, length, initStyle, styler);
 	int styleBeforeDCKeyword = SCE_SQL_DEFAULT;
@@ -593,7 +607,7 @@ void SCI_METHOD LexerSQL::Lex(unsigned int startPos, int length, int initStyle,
 	sc.Complete();
 }
 
-void SCI_METHOD LexerSQL::Fold(unsigned int startPos, int length, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerSQL::Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	if (!options.fold)
 		return;
 	LexAccessor styler(pAccess);
@@ -644,6 +658,12 @@ void SCI_METHOD LexerSQL::Fold(unsigned int startPos, int length, int initStyle,
 		}
 	}
 	
+	// Folding discards the states of lines after the range
+	const bool statesAfter = sqlStates.HasStatesAfter(styler.GetLine(endPos));
+	SQLStates statesBefore;
+	if (statesAfter)
+		statesBefore = sqlStates;
+
 	int levelNext = levelCurrent;
 	char chNext = styler[startPos];
 	int styleNext = styler.StyleAt(startPos);
@@ -928,6 +948,14 @@ void SCI_METHOD LexerSQL::Fold(unsigned int startPos, int length, int initStyle,
 			visibleChars++;
 		}
 	}
+	// The discarded states are taken back unless the state the range ends with changed or
+	// lines were inserted or deleted, moving the lines the states are held for.
+	const int lines = styler.GetLine(docLength);
+	if (statesAfter && (endPos < docLength)) {
+		if ((lines != linesStates) || !sqlStates.RestoreAfter(lineCurrent, statesBefore))
+			styler.ChangeLexerState(startPos, endPos);
+	}
+	linesStates = lines;
 }
 
 LexerModule lmSQL(SCLEX_SQL, LexerSQL::LexerFactorySQL, "sql", sqlWordListDesc);
@@ -100,12 +100,13 @@ static inline bool IsATADS3Operator(const int ch) {
                 || ch == '@' || ch == '&' || ch == '~';
 }
 
+// Only ASCII as in UTF-8 ch may be beyond the range of the ctype functions
 static inline bool IsAWordChar(const int ch) {
-        return isalnum(ch) || ch == '_';
+        return (ch < 0x80) && (isalnum(ch) || ch == '_');
 }
 
 static inline bool IsAWordStart(const int ch) {
-        return isalpha(ch) || ch == '_';
+        return (ch < 0x80) && (isalpha(ch) || ch == '_');
 }
 
 static inline bool IsAHexDigit(const int ch) {
@@ -0,0 +1,99 @@
+// Scintilla source code edit control
+/** @file Checkpoints.h
+ ** Hold the complete state of a lexer at the start of some lines.
+ ** A lexer asked to style from a line can resume from the nearest checkpoint before it
+ ** instead of searching back through the document for a point where it is safe to start.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef CHECKPOINTS_H
+#define CHECKPOINTS_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+// T holds whatever the lexer needs to continue from the start of a line, including the
+// style at that point, and must be default constructible and comparable with ==.
+// A checkpoint for a line depends only on the text before that line so it remains valid
+// until the lexer is asked to style from a position before that line.
+template <typename T>
+class Checkpoints {
+	struct Checkpoint {
+		int line;
+		T state;
+		Checkpoint() : line(-1), state() {
+		}
+		Checkpoint(int line_, const T &state_) : line(line_), state(state_) {
+		}
+		bool operator==(const Checkpoint &other) const {
+			return (line == other.line) && (state == other.state);
+		}
+		bool operator!=(const Checkpoint &other) const {
+			return !(*this == other);
+		}
+	};
+	// Each value includes its line so the entry found for any line is the nearest
+	// checkpoint at or before it even when lines were passed over without recording.
+	SparseState<Checkpoint> checkpoints;
+	int interval;
+	int lineLast;
+
+public:
+	explicit Checkpoints(int interval_=32) : interval(interval_), lineLast(-1) {
+	}
+
+	// True when the lexer should record its state at the start of line.
+	bool Due(int line) const {
+		return (lineLast < 0) || (line < lineLast) || (line >= lineLast + interval);
+	}
+
+	// Record the state at the start of line, discarding any checkpoints after it.
+	void Record(int line, const T &state) {
+		checkpoints.Set(line, Checkpoint(line, state));
+		lineLast = line;
+	}
+
+	// Called when styling starts at the start of line: discards checkpoints after line
+	// as the text after line may have changed. Returns the line of the nearest checkpoint
+	// at or before line and sets state to its state, or returns -1 when there is none.
+	int Restart(int line, T &state) {
+		const Checkpoint checkpoint = checkpoints.ValueAt(line);
+		if (checkpoint.line < 0) {
+			Clear();
+			return -1;
+		}
+		checkpoints.Delete(checkpoint.line + 1);
+		lineLast = checkpoint.line;
+		state = checkpoint.state;
+		return checkpoint.line;
+	}
+
+	// As Restart but only uses a checkpoint within one interval before line, for lexers
+	// that can find a place to start near line some other way: after lexing stopped early
+	// the nearest checkpoint may be far back. Returns -1 when there is none that near,
+	// leaving the checkpoints before line.
+	int RestartNear(int line, T &state) {
+		const Checkpoint checkpoint = checkpoints.ValueAt(line);
+		if ((checkpoint.line >= 0) && (checkpoint.line + interval >= line))
+			return Restart(line, state);
+		checkpoints.Delete(line + 1);
+		lineLast = checkpoint.line;
+		return -1;
+	}
+
+	void Clear() {
+		checkpoints.Delete(0);
+		lineLast = -1;
+	}
+
+	size_t size() const {
+		return checkpoints.size();
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
@@ -24,21 +24,42 @@ private:
 	 * in case there is some backtracking. */
 	enum {bufferSize=4000, slopSize=bufferSize/8};
 	char buf[bufferSize+1];
-	int startPos;
-	int endPos;
+	/** @a text points at the character at @a startPos either in @a buf or, when the
+	 * document can provide it, directly in the document's own contiguous memory. */
+	const char *text;
+	IDocumentWithRangePointer *pContiguous;
+	Sci_Position startPos;
+	Sci_Position endPos;
 	int codePage;
 	enum EncodingType encodingType;
-	int lenDoc;
+	Sci_Position lenDoc;
 	int mask;
 	char styleBuf[bufferSize];
 	int validLen;
 	char chFlags;
 	char chWhile;
-	unsigned int startSeg;
-	int startPosStyling;
+	Sci_PositionU startSeg;
+	Sci_Position startPosStyling;
 	int documentVersion;
 
-	void Fill(int position) {
+	void Fill(Sci_Position position) {
+		if (pContiguous) {
+			// Read in place when the slop before position lies in the same block as position
+			Sci_Position start = position - slopSize;
+			if (start < 0)
+				start = 0;
+			Sci_Position lengthContiguous = 0;
+			const char *contiguous = pContiguous->ContiguousRangePointer(start, &lengthContiguous);
+			if (contiguous && (start + lengthContiguous > position)) {
+				startPos = start;
+				endPos = start + lengthContiguous;
+				if (endPos > lenDoc)
+					endPos = lenDoc;
+				text = contiguous;
+				return;
+			}
+		}
+		text = buf;
 		startPos = position - slopSize;
 		if (startPos + bufferSize > lenDoc)
 			startPos = lenDoc - bufferSize;
@@ -54,7 +75,7 @@ private:
 
 public:
 	LexAccessor(IDocument *pAccess_) :
-		pAccess(pAccess_), startPos(extremePosition), endPos(0),
+		pAccess(pAccess_), text(buf), pContiguous(0), startPos(extremePosition), endPos(0),
 		codePage(pAccess->CodePage()), 
 		encodingType(enc8bit),
 		lenDoc(pAccess->Length()),
@@ -72,12 +93,15 @@ public:
 		case 1361:
 			encodingType = encDBCS;
 		}
+		if (documentVersion >= dvRangePointer) {
+			pContiguous = static_cast<IDocumentWithRangePointer *>(pAccess);
+		}
 	}
-	char operator[](int position) {
+	char operator[](Sci_Position position) {
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	IDocumentWithLineEnd *MultiByteAccess() const {
 		if (documentVersion >= dvLineEnd) {
@@ -86,7 +110,7 @@ public:
 		return 0;
 	}
 	/** Safe version of operator[], returning a defined value for invalid position. */
-	char SafeGetCharAt(int position, char chDefault=' ') {
+	char SafeGetCharAt(Sci_Position position, char chDefault=' ') {
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 			if (position < startPos || position >= endPos) {
@@ -94,7 +118,7 @@ public:
 				return chDefault;
 			}
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	bool IsLeadByte(char ch) const {
 		return pAccess->IsDBCSLeadByte(ch);
@@ -102,7 +126,7 @@ public:
 	EncodingType Encoding() const {
 		return encodingType;
 	}
-	bool Match(int pos, const char *s) {
+	bool Match(Sci_Position pos, const char *s) {
 		for (int i=0; *s; i++) {
 			if (*s != SafeGetCharAt(pos+i))
 				return false;
@@ -110,21 +134,21 @@ public:
 		}
 		return true;
 	}
-	char StyleAt(int position) const {
+	char StyleAt(Sci_Position position) const {
 		return static_cast<char>(pAccess->StyleAt(position) & mask);
 	}
-	int GetLine(int position) const {
+	Sci_Position GetLine(Sci_Position position) const {
 		return pAccess->LineFromPosition(position);
 	}
-	int LineStart(int line) const {
+	Sci_Position LineStart(Sci_Position line) const {
 		return pAccess->LineStart(line);
 	}
-	int LineEnd(int line) {
+	Sci_Position LineEnd(Sci_Position line) {
 		if (documentVersion >= dvLineEnd) {
 			return (static_cast<IDocumentWithLineEnd *>(pAccess))->LineEnd(line);
 		} else {
 			// Old interface means only '\r', '\n' and '\r\n' line ends.
-			int startNext = pAccess->LineStart(line+1);
+			Sci_Position startNext = pAccess->LineStart(line+1);
 			char chLineEnd = SafeGetCharAt(startNext-1);
 			if (chLineEnd == '\n' && (SafeGetCharAt(startNext-2)  == '\r'))
 				return startNext - 2;
@@ -132,10 +156,10 @@ public:
 				return startNext - 1;
 		}
 	}
-	int LevelAt(int line) const {
+	int LevelAt(Sci_Position line) const {
 		return pAccess->GetLevel(line);
 	}
-	int Length() const {
+	Sci_Position Length() const {
 		return lenDoc;
 	}
 	void Flush() {
@@ -146,14 +170,14 @@ public:
 			validLen = 0;
 		}
 	}
-	int GetLineState(int line) const {
+	int GetLineState(Sci_Position line) const {
 		return pAccess->GetLineState(line);
 	}
-	int SetLineState(int line, int state) {
+	int SetLineState(Sci_Position line, int state) {
 		return pAccess->SetLineState(line, state);
 	}
 	// Style setting
-	void StartAt(unsigned int start, char chMask=31) {
+	void StartAt(Sci_PositionU start, char chMask=31) {
 		// Store the mask specified for use with StyleAt.
 		mask = chMask;
 		pAccess->StartStyling(start, chMask);
@@ -163,13 +187,13 @@ public:
 		chFlags = chFlags_;
 		chWhile = chWhile_;
 	}
-	unsigned int GetStartSegment() const {
+	Sci_PositionU GetStartSegment() const {
 		return startSeg;
 	}
-	void StartSegment(unsigned int pos) {
+	void StartSegment(Sci_PositionU pos) {
 		startSeg = pos;
 	}
-	void ColourTo(unsigned int pos, int chAttr) {
+	void ColourTo(Sci_PositionU pos, int chAttr) {
 		// Only perform styling if non empty range
 		if (pos != startSeg - 1) {
 			assert(pos >= startSeg);
@@ -186,7 +210,7 @@ public:
 				if (chAttr != chWhile)
 					chFlags = 0;
 				chAttr = static_cast<char>(chAttr | chFlags);
-				for (unsigned int i = startSeg; i <= pos; i++) {
+				for (Sci_PositionU i = startSeg; i <= pos; i++) {
 					assert((startPosStyling + validLen) < Length());
 					styleBuf[validLen++] = static_cast<char>(chAttr);
 				}
@@ -194,15 +218,15 @@ public:
 		}
 		startSeg = pos+1;
 	}
-	void SetLevel(int line, int level) {
+	void SetLevel(Sci_Position line, int level) {
 		pAccess->SetLevel(line, level);
 	}
-	void IndicatorFill(int start, int end, int indicator, int value) {
+	void IndicatorFill(Sci_Position start, Sci_Position end, int indicator, int value) {
 		pAccess->DecorationSetCurrentIndicator(indicator);
 		pAccess->DecorationFillRange(start, value, end - start);
 	}
 
-	void ChangeLexerState(int start, int end) {
+	void ChangeLexerState(Sci_Position start, Sci_Position end) {
 		pAccess->ChangeLexerState(start, end);
 	}
 };
@@ -90,3 +90,52 @@ int SCI_METHOD LexerBase::WordListSet(int n, const char *wl) {
 void * SCI_METHOD LexerBase::PrivateCall(int, void *) {
 	return 0;
 }
+
+int SCI_METHOD LexerBase::LineEndTypesSupported() {
+	return SC_LINE_END_TYPE_DEFAULT;
+}
+
+int SCI_METHOD LexerBase::AllocateSubStyles(int, int) {
+	return -1;
+}
+
+int SCI_METHOD LexerBase::SubStylesStart(int) {
+	return -1;
+}
+
+int SCI_METHOD LexerBase::SubStylesLength(int) {
+	return 0;
+}
+
+int SCI_METHOD LexerBase::StyleFromSubStyle(int subStyle) {
+	return subStyle;
+}
+
+int SCI_METHOD LexerBase::PrimaryStyleFromStyle(int style) {
+	return style;
+}
+
+void SCI_METHOD LexerBase::FreeSubStyles() {
+}
+
+void SCI_METHOD LexerBase::SetIdentifiers(int, const char *) {
+}
+
+int SCI_METHOD LexerBase::DistanceToSecondaryStyles() {
+	return 0;
+}
+
+const char * SCI_METHOD LexerBase::GetSubStyleBases() {
+	return "";
+}
+
+bool SCI_METHOD LexerBase::IsRestartLine(Sci_Position, IDocument *) {
+	return false;
+}
+
+ILexerWithRestart * SCI_METHOD LexerBase::RangeLexer() {
+	return 0;
+}
+
+void SCI_METHOD LexerBase::MergeRange(ILexerWithRestart *, Sci_Position, Sci_Position) {
+}
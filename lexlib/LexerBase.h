@@ -13,7 +13,9 @@ namespace Scintilla {
 #endif
 
 // A simple lexer with no state
-class LexerBase : public ILexer {
+// Provides empty sub-style and restart methods so that derived lexers may opt in to
+// those interfaces by overriding Version.
+class LexerBase : public ILexerWithRestart {
 protected:
 	PropSetSimple props;
 	enum {numWordLists=KEYWORDSET_MAX+1};
@@ -29,9 +31,24 @@ public:
 	int SCI_METHOD PropertySet(const char *key, const char *val);
 	const char * SCI_METHOD DescribeWordListSets();
 	int SCI_METHOD WordListSet(int n, const char *wl);
-	void SCI_METHOD Lex(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) = 0;
-	void SCI_METHOD Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) = 0;
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) = 0;
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) = 0;
 	void * SCI_METHOD PrivateCall(int operation, void *pointer);
+
+	int SCI_METHOD LineEndTypesSupported();
+	int SCI_METHOD AllocateSubStyles(int styleBase, int numberStyles);
+	int SCI_METHOD SubStylesStart(int styleBase);
+	int SCI_METHOD SubStylesLength(int styleBase);
+	int SCI_METHOD StyleFromSubStyle(int subStyle);
+	int SCI_METHOD PrimaryStyleFromStyle(int style);
+	void SCI_METHOD FreeSubStyles();
+	void SCI_METHOD SetIdentifiers(int style, const char *identifiers);
+	int SCI_METHOD DistanceToSecondaryStyles();
+	const char * SCI_METHOD GetSubStyleBases();
+
+	bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess);
+	ILexerWithRestart * SCI_METHOD RangeLexer();
+	void SCI_METHOD MergeRange(ILexerWithRestart *rangeLexer, Sci_Position lineStart, Sci_Position lineEnd);
 };
 
 #ifdef SCI_NAMESPACE
@@ -35,11 +35,13 @@ LexerModule::LexerModule(int language_,
 	const char *languageName_,
 	LexerFunction fnFolder_,
         const char *const wordListDescriptions_[],
-	int styleBits_) :
+	int styleBits_,
+	LexerRestartFunction fnRestart_) :
 	language(language_),
 	fnLexer(fnLexer_),
 	fnFolder(fnFolder_),
 	fnFactory(0),
+	fnRestart(fnRestart_),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
 	languageName(languageName_) {
@@ -54,6 +56,7 @@ LexerModule::LexerModule(int language_,
 	fnLexer(0),
 	fnFolder(0),
 	fnFactory(fnFactory_),
+	fnRestart(0),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
 	languageName(languageName_) {
@@ -117,3 +120,7 @@ void LexerModule::Fold(unsigned int startPos, int lengthDoc, int initStyle,
 		fnFolder(startPos, lengthDoc, initStyle, keywordlists, styler);
 	}
 }
+
+bool LexerModule::IsRestartLine(int line, Accessor &styler) const {
+	return fnRestart && fnRestart(line, styler);
+}
@@ -18,6 +18,7 @@ class WordList;
 typedef void (*LexerFunction)(unsigned int startPos, int lengthDoc, int initStyle,
                   WordList *keywordlists[], Accessor &styler);
 typedef ILexer *(*LexerFactoryFunction)();
+typedef bool (*LexerRestartFunction)(int line, Accessor &styler);
 
 /**
  * A LexerModule is responsible for lexing and folding a particular language.
@@ -30,6 +31,7 @@ protected:
 	LexerFunction fnLexer;
 	LexerFunction fnFolder;
 	LexerFactoryFunction fnFactory;
+	LexerRestartFunction fnRestart;
 	const char * const * wordListDescriptions;
 	int styleBits;
 
@@ -40,7 +42,8 @@ public:
 		const char *languageName_=0,
 		LexerFunction fnFolder_=0,
 		const char * const wordListDescriptions_[] = NULL,
-		int styleBits_=5);
+		int styleBits_=5,
+		LexerRestartFunction fnRestart_=0);
 	LexerModule(int language_,
 		LexerFactoryFunction fnFactory_,
 		const char *languageName_,
@@ -56,13 +59,17 @@ public:
 
 	int GetStyleBitsNeeded() const;
 
-	ILexer *Create() const;
+	virtual ILexer *Create() const;
 
 	virtual void Lex(unsigned int startPos, int length, int initStyle,
                   WordList *keywordlists[], Accessor &styler) const;
 	virtual void Fold(unsigned int startPos, int length, int initStyle,
                   WordList *keywordlists[], Accessor &styler) const;
 
+	// A restart function reports lines where lexing may start in the initial state
+	bool CanRestart() const { return fnRestart != 0; }
+	bool IsRestartLine(int line, Accessor &styler) const;
+
 	friend class Catalogue;
 };
 
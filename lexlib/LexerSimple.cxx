@@ -38,20 +38,35 @@ LexerSimple::LexerSimple(const LexerModule *module_) : module(module_) {
 	}
 }
 
+int SCI_METHOD LexerSimple::Version() const {
+	return module->CanRestart() ? lvRestart : lvOriginal;
+}
+
 const char * SCI_METHOD LexerSimple::DescribeWordListSets() {
 	return wordLists.c_str();
 }
 
-void SCI_METHOD LexerSimple::Lex(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerSimple::Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
 	Accessor astyler(pAccess, &props);
 	module->Lex(startPos, lengthDoc, initStyle, keyWordLists, astyler);
 	astyler.Flush();
 }
 
-void SCI_METHOD LexerSimple::Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess) {
+void SCI_METHOD LexerSimple::Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
 	if (props.GetInt("fold")) {
 		Accessor astyler(pAccess, &props);
 		module->Fold(startPos, lengthDoc, initStyle, keyWordLists, astyler);
 		astyler.Flush();
 	}
 }
+
+bool SCI_METHOD LexerSimple::IsRestartLine(Sci_Position line, IDocument *pAccess) {
+	Accessor astyler(pAccess, &props);
+	return module->IsRestartLine(line, astyler);
+}
+
+// The lexing function only reads the properties and word lists so
+// ranges can be lexed concurrently by this lexer.
+ILexerWithRestart * SCI_METHOD LexerSimple::RangeLexer() {
+	return this;
+}
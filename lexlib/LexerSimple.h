@@ -18,9 +18,12 @@ class LexerSimple : public LexerBase {
 	std::string wordLists;
 public:
 	LexerSimple(const LexerModule *module_);
+	int SCI_METHOD Version() const;
 	const char * SCI_METHOD DescribeWordListSets();
-	void SCI_METHOD Lex(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
-	void SCI_METHOD Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess);
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess);
+	bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess);
+	ILexerWithRestart * SCI_METHOD RangeLexer();
 };
 
 #ifdef SCI_NAMESPACE
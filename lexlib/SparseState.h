@@ -73,6 +73,21 @@ public:
 	size_t size() const {
 		return states.size();
 	}
+	bool HasAfter(int position) const {
+		return !states.empty() && (states.back().position > position);
+	}
+	// Replace the states after position with those of other, for when the states up to
+	// position have been set again and the later states in other still follow from them.
+	void ReplaceAfter(int position, const SparseState<T> &other) {
+		Delete(position + 1);
+		State searchValue(position + 1, T());
+		typename stateVector::const_iterator it =
+			std::lower_bound(other.states.begin(), other.states.end(), searchValue);
+		for (; it != other.states.end(); ++it) {
+			if (states.empty() || (it->value != states.back().value))
+				states.push_back(*it);
+		}
+	}
 
 	// Returns true if Merge caused a significant change
 	bool Merge(const SparseState<T> &other, int ignoreAfter) {
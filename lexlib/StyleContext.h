@@ -26,19 +26,27 @@ static inline int MakeLowerCase(int ch) {
 class StyleContext {
 	LexAccessor &styler;
 	IDocumentWithLineEnd *multiByteAccess;
-	unsigned int endPos;
-	unsigned int lengthDocument;
+	Sci_PositionU endPos;
+	Sci_PositionU lengthDocument;
 	
 	// Used for optimizing GetRelativeCharacter
-	unsigned int posRelative;
-	unsigned int currentPosLastRelative;
+	Sci_PositionU posRelative;
+	Sci_PositionU currentPosLastRelative;
 	int offsetRelative;
 
 	StyleContext &operator=(const StyleContext &);
 
 	void GetNextChar() {
 		if (multiByteAccess) {
-			chNext = multiByteAccess->GetCharacterAndWidth(currentPos+width, &widthNext);
+			// Bytes below 0x80 are whole characters in UTF-8 and DBCS so most source text
+			// is taken from the accessor's buffer without asking the document to decode it.
+			const unsigned char byteNext = static_cast<unsigned char>(styler.SafeGetCharAt(currentPos+width, 0));
+			if (byteNext < 0x80) {
+				chNext = byteNext;
+				widthNext = 1;
+			} else {
+				chNext = multiByteAccess->GetCharacterAndWidth(currentPos+width, &widthNext);
+			}
 		} else {
 			chNext = static_cast<unsigned char>(styler.SafeGetCharAt(currentPos+width, 0));
 			widthNext = 1;
@@ -46,26 +54,26 @@ class StyleContext {
 		// End of line determined from line end position, allowing CR, LF, 
 		// CRLF and Unicode line ends as set by document.
 		if (currentLine < lineDocEnd)
-			atLineEnd = static_cast<int>(currentPos) >= (lineStartNext-1);
+			atLineEnd = static_cast<Sci_Position>(currentPos) >= (lineStartNext-1);
 		else // Last line
-			atLineEnd = static_cast<int>(currentPos) >= lineStartNext;
+			atLineEnd = static_cast<Sci_Position>(currentPos) >= lineStartNext;
 	}
 
 public:
-	unsigned int currentPos;
-	int currentLine;
-	int lineDocEnd;
-	int lineStartNext;
+	Sci_PositionU currentPos;
+	Sci_Position currentLine;
+	Sci_Position lineDocEnd;
+	Sci_Position lineStartNext;
 	bool atLineStart;
 	bool atLineEnd;
 	int state;
 	int chPrev;
 	int ch;
-	int width;
+	Sci_Position width;
 	int chNext;
-	int widthNext;
+	Sci_Position widthNext;
 
-	StyleContext(unsigned int startPos, unsigned int length,
+	StyleContext(Sci_PositionU startPos, Sci_PositionU length,
                         int initStyle, LexAccessor &styler_, char chMask=31) :
 		styler(styler_),
 		multiByteAccess(0),
@@ -90,11 +98,11 @@ public:
 		styler.StartSegment(startPos);
 		currentLine = styler.GetLine(startPos);
 		lineStartNext = styler.LineStart(currentLine+1);
-		lengthDocument = static_cast<unsigned int>(styler.Length());
+		lengthDocument = static_cast<Sci_PositionU>(styler.Length());
 		if (endPos == lengthDocument)
 			endPos++;
 		lineDocEnd = styler.GetLine(lengthDocument);
-		atLineStart = static_cast<unsigned int>(styler.LineStart(currentLine)) == startPos;
+		atLineStart = static_cast<Sci_PositionU>(styler.LineStart(currentLine)) == startPos;
 
 		// Variable width is now 0 so GetNextChar gets the char at currentPos into chNext/widthNext
 		width = 0;
@@ -154,7 +162,7 @@ public:
 		styler.ColourTo(currentPos - ((currentPos > lengthDocument) ? 2 : 1), state);
 		state = state_;
 	}
-	int LengthCurrent() const {
+	Sci_Position LengthCurrent() const {
 		return currentPos - styler.GetStartSegment();
 	}
 	int GetRelative(int n) {
@@ -171,7 +179,7 @@ public:
 				offsetRelative = 0;
 			}
 			int diffRelative = n - offsetRelative;
-			int posNew = multiByteAccess->GetRelativePosition(posRelative, diffRelative);
+			Sci_Position posNew = multiByteAccess->GetRelativePosition(posRelative, diffRelative);
 			int chReturn = multiByteAccess->GetCharacterAndWidth(posNew, 0);
 			posRelative = posNew;
 			currentPosLastRelative = currentPos;
@@ -12,11 +12,87 @@
 namespace Scintilla {
 #endif
 
+// Styles for words held in a hash table so that lexers can look up an identifier
+// in their own buffer without building a string. The map is only used to build
+// the table and to copy it when identifiers change.
+class WordStyleTable {
+	struct Entry {
+		unsigned int hash;
+		size_t start;
+		size_t length;
+		int style;
+		Entry() : hash(0), start(0), length(0), style(-1) {
+		}
+	};
+	std::map<std::string, int> wordToStyle;
+	std::string text;
+	std::vector<Entry> entries;
+	size_t mask;
+
+	static unsigned int Hash(const char *s, size_t length) {
+		// FNV-1a
+		unsigned int hash = 2166136261u;
+		for (size_t i = 0; i < length; i++)
+			hash = (hash ^ static_cast<unsigned char>(s[i])) * 16777619u;
+		return hash;
+	}
+
+public:
+	WordStyleTable() : mask(0) {
+	}
+
+	void SetIdentifiers(int style, const char *identifiers) {
+		while (*identifiers) {
+			const char *cpSpace = identifiers;
+			while (*cpSpace && !(*cpSpace == ' ' || *cpSpace == '\t' || *cpSpace == '\r' || *cpSpace == '\n'))
+				cpSpace++;
+			if (cpSpace > identifiers) {
+				std::string word(identifiers, cpSpace - identifiers);
+				wordToStyle[word] = style;
+			}
+			identifiers = cpSpace;
+			if (*identifiers)
+				identifiers++;
+		}
+		// Rebuild with at least twice as many slots as words so that probes stay short
+		size_t size = 8;
+		while (size < wordToStyle.size() * 2)
+			size *= 2;
+		mask = size - 1;
+		text.clear();
+		entries.assign(size, Entry());
+		for (std::map<std::string, int>::const_iterator it=wordToStyle.begin(); it != wordToStyle.end(); ++it) {
+			const unsigned int hash = Hash(it->first.c_str(), it->first.length());
+			size_t slot = hash & mask;
+			while (entries[slot].style >= 0)
+				slot = (slot + 1) & mask;
+			entries[slot].hash = hash;
+			entries[slot].start = text.length();
+			entries[slot].length = it->first.length();
+			entries[slot].style = it->second;
+			text += it->first;
+		}
+	}
+
+	int ValueFor(const char *s, size_t length) const {
+		const unsigned int hash = Hash(s, length);
+		for (size_t slot = hash & mask; entries[slot].style >= 0; slot = (slot + 1) & mask) {
+			const Entry &entry = entries[slot];
+			if ((entry.hash == hash) && (entry.length == length) &&
+				(0 == memcmp(text.c_str() + entry.start, s, length)))
+				return entry.style;
+		}
+		return -1;
+	}
+};
+
 class WordClassifier {
 	int baseStyle;
 	int firstStyle;
 	int lenStyles;
-	std::map<std::string, int> wordToStyle;
+	// Not changed once made so copies of the classifier, such as those used by
+	// lexers working on ranges of a document, share it.
+	std::shared_ptr<const WordStyleTable> wordStyles;
 
 public:
 
@@ -26,7 +102,7 @@ public:
 	void Allocate(int firstStyle_, int lenStyles_) {
 		firstStyle = firstStyle_;
 		lenStyles = lenStyles_;
-		wordToStyle.clear();
+		wordStyles.reset();
 	}
 
 	int Base() const {
@@ -44,15 +120,15 @@ public:
 	void Clear() {
 		firstStyle = 0;
 		lenStyles = 0;
-		wordToStyle.clear();
+		wordStyles.reset();
+	}
+
+	int ValueFor(const char *s, size_t length) const {
+		return wordStyles ? wordStyles->ValueFor(s, length) : -1;
 	}
 
 	int ValueFor(const std::string &s) const {
-		std::map<std::string, int>::const_iterator it = wordToStyle.find(s);
-		if (it != wordToStyle.end())
-			return it->second;
-		else
-			return -1;
+		return ValueFor(s.c_str(), s.length());
 	}
 
 	bool IncludesStyle(int style) const {
@@ -60,18 +136,9 @@ public:
 	}
 
 	void SetIdentifiers(int style, const char *identifiers) {
-		while (*identifiers) {
-			const char *cpSpace = identifiers;
-			while (*cpSpace && !(*cpSpace == ' ' || *cpSpace == '\t' || *cpSpace == '\r' || *cpSpace == '\n'))
-				cpSpace++;
-			if (cpSpace > identifiers) {
-				std::string word(identifiers, cpSpace - identifiers);
-				wordToStyle[word] = style;
-			}
-			identifiers = cpSpace;
-			if (*identifiers)
-				identifiers++;
-		}
+		WordStyleTable *changed = wordStyles ? new WordStyleTable(*wordStyles) : new WordStyleTable();
+		changed->SetIdentifiers(style, identifiers);
+		wordStyles.reset(changed);
 	}
 };
 
@@ -66,14 +66,116 @@ static char **ArrayFromWordList(char *wordlist, int *len, bool onlyLineEnds = fa
 	return keywords;
 }
 
+/**
+ * Words are found through hash tables built when the list is set so that looking
+ * up a word costs about the same for lists of 3000 words as for lists of 30.
+ * The hash is FNV-1a which can be extended a character at a time.
+ */
+static const unsigned int hashStart = 2166136261u;
+
+static inline unsigned int HashNext(unsigned int hash, char ch) {
+	return (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+}
+
+static unsigned int HashString(const char *s, size_t length) {
+	unsigned int hash = hashStart;
+	for (size_t i = 0; i < length; i++)
+		hash = HashNext(hash, s[i]);
+	return hash;
+}
+
+/**
+ * Abbreviation markers are punctuation so a word is entered into the head table for
+ * each punctuation character it contains, keyed by the text before that character.
+ */
+static inline bool IsHeadEnd(char ch) {
+	const unsigned char uch = static_cast<unsigned char>(ch);
+	return (uch > ' ') && (uch < 0x7f) &&
+		!((uch >= '0' && uch <= '9') || (uch >= 'A' && uch <= 'Z') || (uch >= 'a' && uch <= 'z'));
+}
+
+static inline bool IsFirstOccurrence(const char *word, size_t position) {
+	return strchr(word, word[position]) == word + position;
+}
+
+static inline unsigned int HeadLengthBit(size_t length) {
+	return 1u << ((length < 31) ? length : 31);
+}
+
+/**
+ * Allocate a table with at least twice as many slots as entries so that
+ * runs of filled slots stay short.
+ */
+static int *AllocateTable(int entries, unsigned int *mask) {
+	unsigned int size = 8;
+	while (size < static_cast<unsigned int>(entries) * 2)
+		size *= 2;
+	int *table = new int[size];
+	for (unsigned int i = 0; i < size; i++)
+		table[i] = -1;
+	*mask = size - 1;
+	return table;
+}
+
+static void InsertIntoTable(int *table, unsigned int mask, unsigned int hash, int index) {
+	unsigned int slot = hash & mask;
+	while (table[slot] >= 0)
+		slot = (slot + 1) & mask;
+	table[slot] = index;
+}
+
+static int *CopyTable(const int *table, unsigned int mask) {
+	int *copy = new int[mask + 1];
+	memcpy(copy, table, (mask + 1) * sizeof(int));
+	return copy;
+}
+
 WordList::WordList(bool onlyLineEnds_) :
-	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_) {
+	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_),
+	wordTable(0), headTable(0), wordMask(0), headMask(0), headLengths(0) {
+}
+
+WordList::WordList(const WordList &other) :
+	words(0), list(0), len(0), onlyLineEnds(other.onlyLineEnds),
+	wordTable(0), headTable(0), wordMask(0), headMask(0), headLengths(0) {
+	Copy(other);
 }
 
 WordList::~WordList() { 
 	Clear();
 }
 
+WordList &WordList::operator=(const WordList &other) {
+	if (this != &other) {
+		Clear();
+		onlyLineEnds = other.onlyLineEnds;
+		Copy(other);
+	}
+	return *this;
+}
+
+/**
+ * The words point into list which ends at the terminator pointed to by the sentinel
+ * so copy list and point each word at the same offset in the copy.
+ */
+void WordList::Copy(const WordList &other) {
+	if (other.words) {
+		const size_t lengthList = other.words[other.len] - other.list + 1;
+		list = new char[lengthList];
+		memcpy(list, other.list, lengthList);
+		words = new char *[other.len + 1];
+		for (int i = 0; i <= other.len; i++)
+			words[i] = list + (other.words[i] - other.list);
+		len = other.len;
+		memcpy(starts, other.starts, sizeof(starts));
+		wordTable = CopyTable(other.wordTable, other.wordMask);
+		wordMask = other.wordMask;
+		headTable = CopyTable(other.headTable, other.headMask);
+		headMask = other.headMask;
+		headLengths = other.headLengths;
+	}
+}
+
 WordList::operator bool() const {
 	return len ? true : false;
 }
@@ -96,10 +198,17 @@ void WordList::Clear() {
 	if (words) {
 		delete []list;
 		delete []words;
+		delete []wordTable;
+		delete []headTable;
 	}
 	words = 0;
 	list = 0;
 	len = 0;
+	wordTable = 0;
+	headTable = 0;
+	wordMask = 0;
+	headMask = 0;
+	headLengths = 0;
 }
 
 #ifdef _MSC_VER
@@ -136,34 +245,30 @@ void WordList::Set(const char *s) {
 		unsigned char indexChar = words[l][0];
 		starts[indexChar] = l;
 	}
-}
-
-/** Check whether a string is in the list.
- * List elements are either exact matches or prefixes.
- * Prefix elements start with '^' and match all strings that start with the rest of the element
- * so '^GTK_' matches 'GTK_X', 'GTK_MAJOR_VERSION', and 'GTK_'.
- */
-bool WordList::InList(const char *s) const {
-	if (0 == words)
-		return false;
-	unsigned char firstChar = s[0];
-	int j = starts[firstChar];
-	if (j >= 0) {
-		while (static_cast<unsigned char>(words[j][0]) == firstChar) {
-			if (s[1] == words[j][1]) {
-				const char *a = words[j] + 1;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					b++;
-				}
-				if (!*a && !*b)
-					return true;
+	wordTable = AllocateTable(len, &wordMask);
+	int heads = 0;
+	for (int w = 0; w < len; w++) {
+		InsertIntoTable(wordTable, wordMask, HashString(words[w], strlen(words[w])), w);
+		for (size_t i = 1; words[w][i]; i++) {
+			if (IsHeadEnd(words[w][i]) && IsFirstOccurrence(words[w], i))
+				heads++;
+		}
+	}
+	headTable = AllocateTable(heads, &headMask);
+	for (int h = 0; h < len; h++) {
+		for (size_t i = 1; words[h][i]; i++) {
+			if (IsHeadEnd(words[h][i]) && IsFirstOccurrence(words[h], i)) {
+				InsertIntoTable(headTable, headMask, HashNext(HashString(words[h], i), words[h][i]), h);
+				headLengths |= HeadLengthBit(i);
 			}
-			j++;
 		}
 	}
-	j = starts[static_cast<unsigned int>('^')];
+}
+
+/** Check whether s starts with any of the prefix elements, which start with '^'.
+ */
+bool WordList::InPrefixes(const char *s) const {
+	int j = starts[static_cast<unsigned int>('^')];
 	if (j >= 0) {
 		while (words[j][0] == '^') {
 			const char *a = words[j] + 1;
@@ -180,6 +285,46 @@ bool WordList::InList(const char *s) const {
 	return false;
 }
 
+/** Check whether a string is in the list.
+ * List elements are either exact matches or prefixes.
+ * Prefix elements start with '^' and match all strings that start with the rest of the element
+ * so '^GTK_' matches 'GTK_X', 'GTK_MAJOR_VERSION', and 'GTK_'.
+ */
+bool WordList::InList(const char *s) const {
+	if (0 == words)
+		return false;
+	const unsigned int hash = HashString(s, strlen(s));
+	for (unsigned int slot = hash & wordMask; wordTable[slot] >= 0; slot = (slot + 1) & wordMask) {
+		if (0 == strcmp(words[wordTable[slot]], s))
+			return true;
+	}
+	return InPrefixes(s);
+}
+
+static bool MatchesAbbreviated(const char *word, const char *s, const char marker) {
+	if (word[0] != s[0])
+		return false;
+	bool isSubword = false;
+	int start = 1;
+	if (word[1] == marker) {
+		isSubword = true;
+		start++;
+	}
+	if (s[1] != word[start])
+		return false;
+	const char *a = word + start;
+	const char *b = s + 1;
+	while (*a && *a == *b) {
+		a++;
+		if (*a == marker) {
+			isSubword = true;
+			a++;
+		}
+		b++;
+	}
+	return (!*a || isSubword) && !*b;
+}
+
 /** similar to InList, but word s can be a substring of keyword.
  * eg. the keyword define is defined as def~ine. This means the word must start
  * with def to be a keyword, but also defi, defin and define are valid.
@@ -188,48 +333,37 @@ bool WordList::InList(const char *s) const {
 bool WordList::InListAbbreviated(const char *s, const char marker) const {
 	if (0 == words)
 		return false;
-	unsigned char firstChar = s[0];
-	int j = starts[firstChar];
-	if (j >= 0) {
-		while (static_cast<unsigned char>(words[j][0]) == firstChar) {
-			bool isSubword = false;
-			int start = 1;
-			if (words[j][1] == marker) {
-				isSubword = true;
-				start++;
-			}
-			if (s[1] == words[j][start]) {
-				const char *a = words[j] + start;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					if (*a == marker) {
-						isSubword = true;
-						a++;
-					}
-					b++;
-				}
-				if ((!*a || isSubword) && !*b)
+	if (IsHeadEnd(marker) && !strchr(s, marker)) {
+		// Any abbreviated word that matches has a head, the text before its first marker,
+		// which is a prefix of s so look up the prefixes of s with the lengths of heads.
+		unsigned int hash = hashStart;
+		for (const char *end = s; *end; end++) {
+			hash = HashNext(hash, *end);
+			if (!(headLengths & HeadLengthBit(end - s + 1)))
+				continue;
+			const unsigned int hashHead = HashNext(hash, marker);
+			for (unsigned int slot = hashHead & headMask; headTable[slot] >= 0; slot = (slot + 1) & headMask) {
+				if (MatchesAbbreviated(words[headTable[slot]], s, marker))
 					return true;
 			}
-			j++;
 		}
-	}
-	j = starts[static_cast<unsigned int>('^')];
-	if (j >= 0) {
-		while (words[j][0] == '^') {
-			const char *a = words[j] + 1;
-			const char *b = s;
-			while (*a && *a == *b) {
-				a++;
-				b++;
-			}
-			if (!*a)
+		for (unsigned int slot = hash & wordMask; wordTable[slot] >= 0; slot = (slot + 1) & wordMask) {
+			if (0 == strcmp(words[wordTable[slot]], s))
 				return true;
-			j++;
+		}
+	} else {
+		// Markers that are not punctuation or that appear in s are not in the head table
+		unsigned char firstChar = s[0];
+		int j = starts[firstChar];
+		if (j >= 0) {
+			while (static_cast<unsigned char>(words[j][0]) == firstChar) {
+				if (MatchesAbbreviated(words[j], s, marker))
+					return true;
+				j++;
+			}
 		}
 	}
-	return false;
+	return InPrefixes(s);
 }
 
 const char *WordList::WordAt(int n) const {
@@ -21,9 +21,20 @@ class WordList {
 	int len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
 	int starts[256];
+	// Open addressing hash tables of indices into words with -1 in empty slots.
+	// Each has a power of 2 size so the mask gives the slot for a hash.
+	int *wordTable;	///< Each word by the hash of the whole word
+	int *headTable;	///< Each word by the hash of its text before each punctuation character
+	unsigned int wordMask;
+	unsigned int headMask;
+	unsigned int headLengths;	///< Bit n set for heads of n characters, bit 31 for longer heads too
+	void Copy(const WordList &other);
+	bool InPrefixes(const char *s) const;
 public:
 	WordList(bool onlyLineEnds_ = false);
+	WordList(const WordList &other);
 	~WordList();
+	WordList &operator=(const WordList &other);
 	operator bool() const;
 	bool operator!=(const WordList &other) const;
 	int Length() const;
@@ -12,7 +12,10 @@
 #include <stdarg.h>
 #include <assert.h>
 
+#include <string>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -28,27 +31,67 @@ using namespace Scintilla;
 static std::vector<LexerModule *> lexerCatalogue;
 static int nextLanguage = SCLEX_AUTOMATIC+1;
 
+// Modules are indexed by language and by name so that switching lexers does not scan
+// the whole catalogue. When several modules share a language or name the first one
+// added is found, as with a search through lexerCatalogue.
+typedef std::unordered_map<int, LexerModule *> ModulesOfLanguage;
+typedef std::unordered_map<std::string, LexerModule *> ModulesOfName;
+static ModulesOfLanguage modulesOfLanguage;
+static ModulesOfName modulesOfName;
+static LexerModuleLoader loader = 0;
+
+static LexerModule *ModuleOfLanguage(int language) {
+	ModulesOfLanguage::const_iterator it = modulesOfLanguage.find(language);
+	return (it != modulesOfLanguage.end()) ? it->second : 0;
+}
+
+static LexerModule *ModuleOfName(const char *languageName) {
+	ModulesOfName::const_iterator it = modulesOfName.find(languageName);
+	return (it != modulesOfName.end()) ? it->second : 0;
+}
+
+static void IndexModule(LexerModule *plm) {
+	modulesOfLanguage.insert(ModulesOfLanguage::value_type(plm->GetLanguage(), plm));
+	if (plm->languageName)
+		modulesOfName.insert(ModulesOfName::value_type(plm->languageName, plm));
+}
+
+// The built in lexers are only added to the catalogue when a module that has not been
+// added by the application is looked for, or when the whole catalogue is listed.
 const LexerModule *Catalogue::Find(int language) {
-	Scintilla_LinkLexers();
-	for (std::vector<LexerModule *>::iterator it=lexerCatalogue.begin();
-		it != lexerCatalogue.end(); ++it) {
-		if ((*it)->GetLanguage() == language) {
-			return *it;
-		}
+	const LexerModule *plm = ModuleOfLanguage(language);
+	if (!plm && Scintilla_LinkLexers()) {
+		plm = ModuleOfLanguage(language);
 	}
-	return 0;
+	return plm;
 }
 
 const LexerModule *Catalogue::Find(const char *languageName) {
-	Scintilla_LinkLexers();
-	if (languageName) {
-		for (std::vector<LexerModule *>::iterator it=lexerCatalogue.begin();
-			it != lexerCatalogue.end(); ++it) {
-			if ((*it)->languageName && (0 == strcmp((*it)->languageName, languageName))) {
-				return *it;
-			}
-		}
+	if (!languageName)
+		return 0;
+	const LexerModule *plm = ModuleOfName(languageName);
+	if (!plm && Scintilla_LinkLexers()) {
+		plm = ModuleOfName(languageName);
+	}
+	if (!plm && loader && loader(languageName)) {
+		plm = ModuleOfName(languageName);
 	}
+	return plm;
+}
+
+int Catalogue::Count() {
+	Scintilla_LinkLexers();
+	if (loader)
+		loader(0);
+	return static_cast<int>(lexerCatalogue.size());
+}
+
+const LexerModule *Catalogue::At(int index) {
+	Scintilla_LinkLexers();
+	if (loader)
+		loader(0);
+	if ((index >= 0) && (index < static_cast<int>(lexerCatalogue.size())))
+		return lexerCatalogue[index];
 	return 0;
 }
 
@@ -56,14 +99,38 @@ void Catalogue::AddLexerModule(LexerModule *plm) {
 	if (plm->GetLanguage() == SCLEX_AUTOMATIC) {
 		plm->language = nextLanguage;
 		nextLanguage++;
+	} else if (ModuleOfLanguage(plm->GetLanguage()) == plm) {
+		// Already added by the application before the built in lexers were linked
+		return;
 	}
 	lexerCatalogue.push_back(plm);
+	IndexModule(plm);
+}
+
+// Modules hidden by plm become the ones found so the indexes are rebuilt.
+void Catalogue::RemoveLexerModule(LexerModule *plm) {
+	std::vector<LexerModule *>::iterator it = std::find(lexerCatalogue.begin(), lexerCatalogue.end(), plm);
+	if (it == lexerCatalogue.end())
+		return;
+	lexerCatalogue.erase(it);
+	modulesOfLanguage.clear();
+	modulesOfName.clear();
+	for (it=lexerCatalogue.begin(); it != lexerCatalogue.end(); ++it) {
+		IndexModule(*it);
+	}
+}
+
+void Catalogue::SetLoader(LexerModuleLoader loader_) {
+	loader = loader_;
 }
 
 // To add or remove a lexer, add or remove its file and run LexGen.py.
 
 // Force a reference to all of the Scintilla lexers so that the linker will
 // not remove the code of the lexers.
+// Defining SCI_EMPTYCATALOGUE leaves out all of the lexers so that an application
+// can add only the modules it uses with Catalogue::AddLexerModule.
+// Returns 1 when the lexers were added by this call.
 int Scintilla_LinkLexers() {
 
 	static int initialised = 0;
@@ -71,6 +138,8 @@ int Scintilla_LinkLexers() {
 		return 0;
 	initialised = 1;
 
+#ifndef SCI_EMPTYCATALOGUE
+
 // Shorten the code that declares a lexer and ensures it is linked in by calling a method.
 #define LINK_LEXER(lexer) extern LexerModule lexer; Catalogue::AddLexerModule(&lexer);
 
@@ -187,5 +256,7 @@ int Scintilla_LinkLexers() {
 
 //--Autogenerated -- end of automatically generated section
 
+#endif
+
 	return 1;
 }
@@ -12,11 +12,19 @@
 namespace Scintilla {
 #endif
 
+// Called when a language name is not found to add modules that are only loaded when used.
+// Returns true when modules were added. A NULL name asks for every module to be added.
+typedef bool (*LexerModuleLoader)(const char *languageName);
+
 class Catalogue {
 public:
 	static const LexerModule *Find(int language);
 	static const LexerModule *Find(const char *languageName);
 	static void AddLexerModule(LexerModule *plm);
+	static void RemoveLexerModule(LexerModule *plm);
+	static void SetLoader(LexerModuleLoader loader_);
+	static int Count();
+	static const LexerModule *At(int index);
 };
 
 #ifdef SCI_NAMESPACE
@@ -11,12 +11,29 @@
 #include <stdarg.h>
 
 #include <algorithm>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CELLBUFFER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #include "Platform.h"
 
 #include "Scintilla.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "SegmentedVector.h"
+#include "PieceTable.h"
+#include "RunStyles.h"
 #include "CellBuffer.h"
 #include "UniConversion.h"
 
@@ -34,6 +51,8 @@ LineVector::~LineVector() {
 
 void LineVector::Init() {
 	starts.DeleteAll();
+	startsUTF16.starts.DeleteAll();
+	startsUTF32.starts.DeleteAll();
 	if (perLine) {
 		perLine->Init();
 	}
@@ -43,12 +62,17 @@ void LineVector::SetPerLine(PerLine *pl) {
 	perLine = pl;
 }
 
-void LineVector::InsertText(int line, int delta) {
+void LineVector::InsertText(Sci_Position line, Sci_Position delta) {
 	starts.InsertText(line, delta);
 }
 
-void LineVector::InsertLine(int line, int position, bool lineStart) {
+void LineVector::InsertLine(Sci_Position line, Sci_Position position, bool lineStart) {
 	starts.InsertPartition(line, position);
+	// Inserted lines are empty in the character indices until their widths are set
+	if (startsUTF16.Active())
+		startsUTF16.starts.InsertPartition(line, startsUTF16.starts.PositionFromPartition(line));
+	if (startsUTF32.Active())
+		startsUTF32.starts.InsertPartition(line, startsUTF32.starts.PositionFromPartition(line));
 	if (perLine) {
 		if ((line > 0) && lineStart)
 			line--;
@@ -56,21 +80,127 @@ void LineVector::InsertLine(int line, int position, bool lineStart) {
 	}
 }
 
-void LineVector::SetLineStart(int line, int position) {
+// Insert lines whose starts are the increasing positions in lineStarts
+void LineVector::InsertLines(Sci_Position line, const Sci_Position *lineStarts, Sci_Position lines, bool lineStart) {
+	starts.InsertPartitions(line, lineStarts, lines);
+	for (Sci_Position l = line; l < line + lines; l++) {
+		if (startsUTF16.Active())
+			startsUTF16.starts.InsertPartition(l, startsUTF16.starts.PositionFromPartition(l));
+		if (startsUTF32.Active())
+			startsUTF32.starts.InsertPartition(l, startsUTF32.starts.PositionFromPartition(l));
+	}
+	if (perLine) {
+		if ((line > 0) && lineStart)
+			line--;
+		perLine->InsertLines(line, lines);
+	}
+}
+
+void LineVector::SetLineStart(Sci_Position line, Sci_Position position) {
 	starts.SetPartitionStartPosition(line, position);
 }
 
-void LineVector::RemoveLine(int line) {
+void LineVector::RemoveLine(Sci_Position line) {
 	starts.RemovePartition(line);
+	if (startsUTF16.Active())
+		startsUTF16.starts.RemovePartition(line);
+	if (startsUTF32.Active())
+		startsUTF32.starts.RemovePartition(line);
 	if (perLine) {
 		perLine->RemoveLine(line);
 	}
 }
 
-int LineVector::LineFromPosition(int pos) const {
+Sci_Position LineVector::LineFromPosition(Sci_Position pos) const {
 	return starts.PartitionFromPosition(pos);
 }
 
+LineStartIndex *LineVector::IndexFor(int lineCharacterIndex) {
+	if (lineCharacterIndex == SC_LINECHARACTERINDEX_UTF16)
+		return &startsUTF16;
+	else if (lineCharacterIndex == SC_LINECHARACTERINDEX_UTF32)
+		return &startsUTF32;
+	return 0;
+}
+
+const LineStartIndex *LineVector::IndexFor(int lineCharacterIndex) const {
+	if (lineCharacterIndex == SC_LINECHARACTERINDEX_UTF16)
+		return &startsUTF16;
+	else if (lineCharacterIndex == SC_LINECHARACTERINDEX_UTF32)
+		return &startsUTF32;
+	return 0;
+}
+
+int LineVector::LineCharacterIndex() const {
+	int lineCharacterIndex = SC_LINECHARACTERINDEX_NONE;
+	if (startsUTF32.Active())
+		lineCharacterIndex |= SC_LINECHARACTERINDEX_UTF32;
+	if (startsUTF16.Active())
+		lineCharacterIndex |= SC_LINECHARACTERINDEX_UTF16;
+	return lineCharacterIndex;
+}
+
+// Returns true when an index is created and so needs the widths of every line set.
+bool LineVector::AllocateLineCharacterIndex(int lineCharacterIndex) {
+	bool created = false;
+	const int indices[] = {SC_LINECHARACTERINDEX_UTF32, SC_LINECHARACTERINDEX_UTF16};
+	for (size_t i = 0; i < sizeof(indices) / sizeof(indices[0]); i++) {
+		if (lineCharacterIndex & indices[i]) {
+			LineStartIndex *index = IndexFor(indices[i]);
+			index->refCount++;
+			if (index->refCount == 1) {
+				index->starts.DeleteAll();
+				for (Sci_Position line = 1; line < Lines(); line++) {
+					index->starts.InsertPartition(line, 0);
+				}
+				created = true;
+			}
+		}
+	}
+	return created;
+}
+
+// Returns true when an index is discarded.
+bool LineVector::ReleaseLineCharacterIndex(int lineCharacterIndex) {
+	bool released = false;
+	const int indices[] = {SC_LINECHARACTERINDEX_UTF32, SC_LINECHARACTERINDEX_UTF16};
+	for (size_t i = 0; i < sizeof(indices) / sizeof(indices[0]); i++) {
+		if (lineCharacterIndex & indices[i]) {
+			LineStartIndex *index = IndexFor(indices[i]);
+			if (index->refCount > 0) {
+				index->refCount--;
+				if (index->refCount == 0) {
+					index->starts.DeleteAll();
+					released = true;
+				}
+			}
+		}
+	}
+	return released;
+}
+
+void LineVector::SetLineCharacterWidths(Sci_Position line, const CharacterWidths &widths) {
+	if (startsUTF16.Active())
+		startsUTF16.SetLineWidth(line, widths.utf16);
+	if (startsUTF32.Active())
+		startsUTF32.SetLineWidth(line, widths.utf32);
+}
+
+// Without an index, the character index is the position.
+Sci_Position LineVector::IndexLineStart(Sci_Position line, int lineCharacterIndex) const {
+	const LineStartIndex *index = IndexFor(lineCharacterIndex);
+	if (index && index->Active())
+		return index->starts.PositionFromPartition(line);
+	return LineStart(line);
+}
+
+Sci_Position LineVector::LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const {
+	const LineStartIndex *index = IndexFor(lineCharacterIndex);
+	if (index && index->Active())
+		return index->starts.PartitionFromPosition(pos);
+	return LineFromPosition(pos);
+}
+
 Action::Action() {
 	at = startAction;
 	position = 0;
@@ -83,34 +213,25 @@ Action::~Action() {
 	Destroy();
 }
 
-void Action::Create(actionType at_, int position_, const char *data_, int lenData_, bool mayCoalesce_) {
-	delete []data;
-	data = NULL;
+void Action::Create(actionType at_, Sci_Position position_, const char *data_, Sci_Position lenData_, bool mayCoalesce_) {
 	position = position_;
 	at = at_;
-	if (lenData_) {
-		data = new char[lenData_];
-		memcpy(data, data_, lenData_);
-	}
+	data = lenData_ ? data_ : 0;
 	lenData = lenData_;
 	mayCoalesce = mayCoalesce_;
 }
 
 void Action::Destroy() {
-	delete []data;
 	data = 0;
 }
 
 void Action::Grab(Action *source) {
-	delete []data;
-
 	position = source->position;
 	at = source->at;
 	data = source->data;
 	lenData = source->lenData;
 	mayCoalesce = source->mayCoalesce;
 
-	// Ownership of source data transferred to this
 	source->position = 0;
 	source->at = startAction;
 	source->data = 0;
@@ -118,6 +239,87 @@ void Action::Grab(Action *source) {
 	source->mayCoalesce = true;
 }
 
+UndoArena::UndoArena(Sci_Position blockSize_) : used(0), blockSize(blockSize_), allocated(0) {
+}
+
+UndoArena::~UndoArena() {
+	DeleteAll();
+}
+
+void UndoArena::RemoveBlock(Sci_Position block) {
+	delete []blocks.ValueAt(block);
+	allocated -= sizes.ValueAt(block);
+	blocks.Delete(block);
+	sizes.Delete(block);
+}
+
+void UndoArena::DeleteAll() {
+	for (Sci_Position block = 0; block < blocks.Length(); block++) {
+		delete []blocks.ValueAt(block);
+	}
+	blocks.DeleteAll();
+	sizes.DeleteAll();
+	used = 0;
+	allocated = 0;
+}
+
+const char *UndoArena::Append(const char *s, Sci_Position length) {
+	if (length <= 0)
+		return 0;
+	const Sci_Position last = blocks.Length() - 1;
+	if ((last < 0) || (used + length > sizes.ValueAt(last))) {
+		// Text larger than a block is given a block of its own
+		const Sci_Position size = std::max(blockSize, length);
+		blocks.Insert(blocks.Length(), new char[size]);
+		sizes.Insert(sizes.Length(), size);
+		allocated += size;
+		used = 0;
+	}
+	char *text = blocks.ValueAt(blocks.Length() - 1) + used;
+	memcpy(text, s, length);
+	used += length;
+	return text;
+}
+
+bool UndoArena::Extend(const char *end, const char *s, Sci_Position length) {
+	const Sci_Position last = blocks.Length() - 1;
+	if ((last < 0) || (end != blocks.ValueAt(last) + used) || (used + length > sizes.ValueAt(last)))
+		return false;
+	memcpy(blocks.ValueAt(last) + used, s, length);
+	used += length;
+	return true;
+}
+
+void UndoArena::ReleaseAfter(const char *end) {
+	Sci_Position block = end ? blocks.Length() - 1 : -1;
+	while (block >= 0) {
+		const char *body = blocks.ValueAt(block);
+		if ((end > body) && (end <= body + sizes.ValueAt(block)))
+			break;
+		block--;
+	}
+	if (block < 0) {
+		DeleteAll();
+		return;
+	}
+	while (blocks.Length() > block + 1) {
+		RemoveBlock(block + 1);
+	}
+	used = end - blocks.ValueAt(block);
+}
+
+void UndoArena::ReleaseBefore(const char *start) {
+	for (Sci_Position block = 0; block < blocks.Length(); block++) {
+		const char *body = blocks.ValueAt(block);
+		if ((start >= body) && (start < body + sizes.ValueAt(block))) {
+			for (Sci_Position blockRemove = 0; blockRemove < block; blockRemove++) {
+				RemoveBlock(0);
+			}
+			return;
+		}
+	}
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -135,6 +337,10 @@ void Action::Grab(Action *source) {
 // operation. If there is no outstanding BeginUndoAction call then a new operation is started
 // unless it looks as if the new action is caused by the user typing or deleting a stream of text.
 // Sequences that look like typing or deletion are coalesced into a single user operation.
+// When typing or forward deletion continues the previous action of the same operation, its
+// text is appended to that action's text instead of adding an action.
+// The text of all actions is held in an arena in the order of the actions. Limits on the
+// number of user operations or on memory use remove the oldest operations, never the current one.
 
 UndoHistory::UndoHistory() {
 
@@ -144,6 +350,9 @@ UndoHistory::UndoHistory() {
 	currentAction = 0;
 	undoSequenceDepth = 0;
 	savePoint = 0;
+	mappedHistory = 0;
+	memoryLimit = 0;
+	stepLimit = 0;
 
 	actions[currentAction].Create(startAction);
 }
@@ -151,6 +360,8 @@ UndoHistory::UndoHistory() {
 UndoHistory::~UndoHistory() {
 	delete []actions;
 	actions = 0;
+	delete mappedHistory;
+	mappedHistory = 0;
 }
 
 void UndoHistory::EnsureUndoRoom() {
@@ -160,15 +371,114 @@ void UndoHistory::EnsureUndoRoom() {
 		// Run out of undo nodes so extend the array
 		int lenActionsNew = lenActions * 2;
 		Action *actionsNew = new Action[lenActionsNew];
-		for (int act = 0; act <= currentAction; act++)
+		for (int act = 0; act <= maxAction; act++)
+			actionsNew[act].Grab(&actions[act]);
+		delete []actions;
+		lenActions = lenActionsNew;
+		actions = actionsNew;
+	}
+}
+
+// Actions after the current action are about to be discarded so release their text
+void UndoHistory::ReleaseRedoText() {
+	int act = currentAction;
+	while ((act > 0) && (actions[act].lenData == 0)) {
+		act--;
+	}
+	arena.ReleaseAfter((act > 0) ? actions[act].data + actions[act].lenData : 0);
+}
+
+// Extend the text of the previous action when this action continues it
+bool UndoHistory::CoalesceText(actionType at, Sci_Position position, const char *data, Sci_Position lengthData) {
+	if ((currentAction < 1) || (lengthData <= 0))
+		return false;
+	Action &actPrevious = actions[currentAction - 1];
+	if ((at != actPrevious.at) || (actPrevious.lenData == 0))
+		return false;
+	if ((at == insertAction) && (position != (actPrevious.position + actPrevious.lenData)))
+		return false;
+	if ((at == removeAction) && (position != actPrevious.position))
+		return false;
+	if ((at != insertAction) && (at != removeAction))
+		return false;
+	if (!arena.Extend(actPrevious.data + actPrevious.lenData, data, lengthData))
+		return false;
+	actPrevious.lenData += lengthData;
+	return true;
+}
+
+// Find the oldest user operations that are over the limits and remove them
+void UndoHistory::TrimOldest() {
+	int removeTo = 0;
+	if (stepLimit > 0) {
+		int steps = 0;
+		for (int act = currentAction - 1; act > 0; act--) {
+			if (actions[act].at == startAction) {
+				steps++;
+				if (steps >= stepLimit) {
+					removeTo = act;
+					break;
+				}
+			}
+		}
+	}
+	if ((memoryLimit > 0) && (Memory() > memoryLimit)) {
+		// Remove down to three quarters of the limit so that trimming is not repeated for each action
+		const Sci_Position excess = Memory() - memoryLimit * 3 / 4;
+		Sci_Position released = 0;
+		for (int act = 1; act < currentAction; act++) {
+			if (actions[act].at == startAction) {
+				removeTo = std::max(removeTo, act);
+				if (released >= excess)
+					break;
+			}
+			released += actions[act].lenData;
+		}
+	}
+	if (removeTo > 0)
+		RemoveOldest(removeTo);
+}
+
+// Remove the actions before actionsToRemove which is the start of a user operation
+void UndoHistory::RemoveOldest(int actionsToRemove) {
+	PLATFORM_ASSERT(actions[actionsToRemove].at == startAction);
+	for (int act = 0; act + actionsToRemove <= maxAction; act++) {
+		actions[act].Grab(&actions[act + actionsToRemove]);
+	}
+	maxAction -= actionsToRemove;
+	currentAction -= actionsToRemove;
+	// Can not return to a save point that has been removed
+	savePoint = (savePoint >= actionsToRemove) ? savePoint - actionsToRemove : -1;
+	if ((lenActions > 100) && (maxAction < lenActions / 4)) {
+		// Mostly unused so shrink the array
+		const int lenActionsNew = lenActions / 2;
+		Action *actionsNew = new Action[lenActionsNew];
+		for (int act = 0; act <= maxAction; act++)
 			actionsNew[act].Grab(&actions[act]);
 		delete []actions;
 		lenActions = lenActionsNew;
 		actions = actionsNew;
 	}
+	int act = 1;
+	while ((act <= maxAction) && (actions[act].lenData == 0)) {
+		act++;
+	}
+	if (act <= maxAction)
+		arena.ReleaseBefore(actions[act].data);
+	else
+		arena.DeleteAll();
+	if (mappedHistory) {
+		// Loaded actions are the oldest so when the first remaining text is elsewhere none are left
+		const char *mappedStart = mappedHistory->Data();
+		if ((act > maxAction) || (actions[act].data < mappedStart) ||
+			(actions[act].data >= mappedStart + mappedHistory->Length())) {
+			delete mappedHistory;
+			mappedHistory = 0;
+		}
+	}
 }
 
-const char *UndoHistory::AppendAction(actionType at, int position, const char *data, int lengthData,
+const char *UndoHistory::AppendAction(actionType at, Sci_Position position, const char *data, Sci_Position lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
 	//Platform::DebugPrintf("%% %d action %d %d %d\n", at, position, lengthData, currentAction);
@@ -177,6 +487,9 @@ const char *UndoHistory::AppendAction(actionType at, int position, const char *d
 	if (currentAction < savePoint) {
 		savePoint = -1;
 	}
+	if (currentAction < maxAction) {
+		ReleaseRedoText();
+	}
 	int oldCurrentAction = currentAction;
 	if (currentAction >= 1) {
 		if (0 == undoSequenceDepth) {
@@ -232,11 +545,20 @@ const char *UndoHistory::AppendAction(actionType at, int position, const char *d
 		currentAction++;
 	}
 	startSequence = oldCurrentAction != currentAction;
+	if (!startSequence && mayCoalesce && CoalesceText(at, position, data, lengthData)) {
+		maxAction = currentAction;
+		const Action &actCoalesced = actions[currentAction - 1];
+		return actCoalesced.data + actCoalesced.lenData - lengthData;
+	}
 	int actionWithData = currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
+	actions[currentAction].Create(at, position, arena.Append(data, lengthData), lengthData, mayCoalesce);
 	currentAction++;
 	actions[currentAction].Create(startAction);
 	maxAction = currentAction;
+	if (startSequence && ((stepLimit > 0) || (memoryLimit > 0))) {
+		TrimOldest();
+		actionWithData = currentAction - 1;
+	}
 	return actions[actionWithData].data;
 }
 
@@ -244,6 +566,8 @@ void UndoHistory::BeginUndoAction() {
 	EnsureUndoRoom();
 	if (undoSequenceDepth == 0) {
 		if (actions[currentAction].at != startAction) {
+			if (currentAction < maxAction)
+				ReleaseRedoText();
 			currentAction++;
 			actions[currentAction].Create(startAction);
 			maxAction = currentAction;
@@ -259,6 +583,8 @@ void UndoHistory::EndUndoAction() {
 	undoSequenceDepth--;
 	if (0 == undoSequenceDepth) {
 		if (actions[currentAction].at != startAction) {
+			if (currentAction < maxAction)
+				ReleaseRedoText();
 			currentAction++;
 			actions[currentAction].Create(startAction);
 			maxAction = currentAction;
@@ -278,6 +604,225 @@ void UndoHistory::DeleteUndoHistory() {
 	currentAction = 0;
 	actions[currentAction].Create(startAction);
 	savePoint = 0;
+	arena.DeleteAll();
+	delete mappedHistory;
+	mappedHistory = 0;
+}
+
+void UndoHistory::SetMemoryLimit(Sci_Position memoryLimit_) {
+	memoryLimit = memoryLimit_;
+	TrimOldest();
+}
+
+Sci_Position UndoHistory::MemoryLimit() const {
+	return memoryLimit;
+}
+
+void UndoHistory::SetStepLimit(int stepLimit_) {
+	stepLimit = stepLimit_;
+	TrimOldest();
+}
+
+int UndoHistory::StepLimit() const {
+	return stepLimit;
+}
+
+Sci_Position UndoHistory::Memory() const {
+	return arena.Allocated() + lenActions * sizeof(Action);
+}
+
+namespace {
+
+// An undo history file starts with a signature that includes the format version followed by
+// the length and hash of the content, the number of the last action, the current action and
+// the save point plus 1. Each action is then a byte of its type with the top bit set if it may
+// coalesce, its position, the length of its text, and its text.
+// Numbers are unsigned LEB128 so small numbers take a byte. Positions are zigzag encoded
+// as container actions store a token, which may be negative, in the position.
+const char undoSignature[] = "SciUndo1";
+const size_t lengthUndoSignature = 8;
+const unsigned char undoMayCoalesce = 0x80;
+
+void WriteNumber(FILE *fp, Sci_PositionU value) {
+	while (value >= 0x80) {
+		putc(static_cast<int>((value & 0x7f) | 0x80), fp);
+		value >>= 7;
+	}
+	putc(static_cast<int>(value), fp);
+}
+
+void WriteSigned(FILE *fp, Sci_Position value) {
+	if (value < 0)
+		WriteNumber(fp, (static_cast<Sci_PositionU>(-(value + 1)) << 1) | 1);
+	else
+		WriteNumber(fp, static_cast<Sci_PositionU>(value) << 1);
+}
+
+bool ReadNumber(const char *&p, const char *end, Sci_PositionU &value) {
+	value = 0;
+	for (unsigned int shift = 0; (p < end) && (shift < sizeof(Sci_PositionU) * 8); shift += 7) {
+		const unsigned char byte = static_cast<unsigned char>(*p++);
+		value |= static_cast<Sci_PositionU>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+bool ReadSigned(const char *&p, const char *end, Sci_Position &value) {
+	Sci_PositionU encoded = 0;
+	if (!ReadNumber(p, end, encoded))
+		return false;
+	if (encoded & 1)
+		value = -static_cast<Sci_Position>(encoded >> 1) - 1;
+	else
+		value = static_cast<Sci_Position>(encoded >> 1);
+	return true;
+}
+
+// Check that every action lies within the text it applies to. The actions before current
+// lead to text of contentLength so the length before each is found by working back from
+// current, and the length after each redoable action by working forward.
+bool ActionsFitContent(const Action *actions, int maxAction, int currentAction, Sci_Position contentLength) {
+	if (actions[currentAction].at != startAction)
+		return false;
+	for (int act = 0; act <= maxAction; act++) {
+		const Action &action = actions[act];
+		if ((action.lenData < 0) || ((action.at != containerAction) && (action.position < 0)))
+			return false;
+		if ((action.at == startAction || action.at == containerAction) && (action.lenData != 0))
+			return false;
+	}
+	Sci_Position length = contentLength;
+	for (int act = currentAction - 1; act >= 0; act--) {
+		const Action &action = actions[act];
+		if (action.at == insertAction) {
+			// Inserted text is within the text after the insertion
+			if ((action.lenData > length) || (action.position > length - action.lenData))
+				return false;
+			length -= action.lenData;
+		} else if (action.at == removeAction) {
+			if (action.position > length)
+				return false;
+			length += action.lenData;
+		}
+	}
+	length = contentLength;
+	for (int act = currentAction; act <= maxAction; act++) {
+		const Action &action = actions[act];
+		if (action.at == insertAction) {
+			if (action.position > length)
+				return false;
+			length += action.lenData;
+		} else if (action.at == removeAction) {
+			if ((action.lenData > length) || (action.position > length - action.lenData))
+				return false;
+			length -= action.lenData;
+		}
+	}
+	return true;
+}
+
+}
+
+bool UndoHistory::Save(const char *path, unsigned int contentHash, Sci_Position contentLength) const {
+	// Write to a temporary file then replace so that a file that is currently loaded,
+	// and so mapped, is not changed
+	const size_t lengthPath = strlen(path);
+	char *pathTemporary = new char[lengthPath + 5];
+	memcpy(pathTemporary, path, lengthPath);
+	memcpy(pathTemporary + lengthPath, ".tmp", 5);
+	FILE *fp = fopen(pathTemporary, "wb");
+	if (!fp) {
+		delete []pathTemporary;
+		return false;
+	}
+	fwrite(undoSignature, 1, lengthUndoSignature, fp);
+	WriteNumber(fp, contentLength);
+	WriteNumber(fp, contentHash);
+	WriteNumber(fp, maxAction);
+	WriteNumber(fp, currentAction);
+	WriteNumber(fp, savePoint + 1);
+	for (int act = 0; act <= maxAction; act++) {
+		const Action &action = actions[act];
+		putc(action.at | (action.mayCoalesce ? undoMayCoalesce : 0), fp);
+		WriteSigned(fp, action.position);
+		WriteNumber(fp, action.lenData);
+		if (action.lenData)
+			fwrite(action.data, 1, action.lenData, fp);
+	}
+	const bool written = !ferror(fp);
+	bool saved = (fclose(fp) == 0) && written;
+	if (saved) {
+#ifdef _WIN32
+		// rename does not replace an existing file on Windows
+		remove(path);
+#endif
+		saved = rename(pathTemporary, path) == 0;
+	}
+	if (!saved)
+		remove(pathTemporary);
+	delete []pathTemporary;
+	return saved;
+}
+
+bool UndoHistory::Load(MappedFile *file, unsigned int contentHash, Sci_Position contentLength) {
+	const char *p = file->Data();
+	const char *end = p + file->Length();
+	if ((file->Length() < lengthUndoSignature) || (memcmp(p, undoSignature, lengthUndoSignature) != 0))
+		return false;
+	p += lengthUndoSignature;
+	Sci_PositionU lengthFile = 0;
+	Sci_PositionU hashFile = 0;
+	Sci_PositionU maxActionFile = 0;
+	Sci_PositionU currentActionFile = 0;
+	Sci_PositionU savePointFile = 0;
+	if (!ReadNumber(p, end, lengthFile) || !ReadNumber(p, end, hashFile) ||
+		!ReadNumber(p, end, maxActionFile) || !ReadNumber(p, end, currentActionFile) ||
+		!ReadNumber(p, end, savePointFile))
+		return false;
+	// A history for different content can not be applied
+	if ((lengthFile != static_cast<Sci_PositionU>(contentLength)) || (hashFile != contentHash))
+		return false;
+	// Each action takes at least 3 bytes
+	if ((maxActionFile > file->Length() / 3) || (currentActionFile > maxActionFile) ||
+		(savePointFile > maxActionFile + 1))
+		return false;
+	const int lenActionsLoaded = std::max(100, static_cast<int>(maxActionFile) + 3);
+	Action *actionsLoaded = new Action[lenActionsLoaded];
+	bool valid = true;
+	for (Sci_PositionU act = 0; valid && (act <= maxActionFile); act++) {
+		const unsigned char type = (p < end) ? static_cast<unsigned char>(*p++) : 0xff;
+		const int at = type & ~undoMayCoalesce;
+		Sci_Position position = 0;
+		Sci_PositionU lenData = 0;
+		valid = (at <= containerAction) && ReadSigned(p, end, position) && ReadNumber(p, end, lenData) &&
+			(lenData <= static_cast<Sci_PositionU>(end - p));
+		if (valid) {
+			actionsLoaded[act].Create(static_cast<actionType>(at), position, p,
+				static_cast<Sci_Position>(lenData), (type & undoMayCoalesce) != 0);
+			p += lenData;
+		}
+	}
+	// Positions that do not fit the text would make undo and redo go outside the buffer
+	if (!valid || (actionsLoaded[0].at != startAction) ||
+		!ActionsFitContent(actionsLoaded, static_cast<int>(maxActionFile), static_cast<int>(currentActionFile), contentLength)) {
+		delete []actionsLoaded;
+		return false;
+	}
+	delete []actions;
+	actions = actionsLoaded;
+	lenActions = lenActionsLoaded;
+	maxAction = static_cast<int>(maxActionFile);
+	currentAction = static_cast<int>(currentActionFile);
+	savePoint = static_cast<int>(savePointFile) - 1;
+	undoSequenceDepth = 0;
+	arena.DeleteAll();
+	delete mappedHistory;
+	mappedHistory = file;
+	if ((stepLimit > 0) || (memoryLimit > 0))
+		TrimOldest();
+	return true;
 }
 
 void UndoHistory::SetSavePoint() {
@@ -338,63 +883,893 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
-CellBuffer::CellBuffer() {
+namespace {
+
+// Adapt a SplitVector<char> or PieceTable to ISubstance
+template <typename STORE>
+class Substance : public ISubstance {
+	STORE body;
+public:
+	Substance() {
+	}
+	virtual ~Substance() {
+	}
+	STORE &Body() {
+		return body;
+	}
+	virtual char ValueAt(Sci_Position position) const {
+		return body.ValueAt(position);
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		body.GetRange(buffer, position, retrieveLength);
+	}
+	virtual Sci_Position Length() const {
+		return body.Length();
+	}
+	virtual void ReAllocate(Sci_Position newSize) {
+		body.ReAllocate(newSize);
+	}
+	virtual void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		body.InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+	}
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		body.DeleteRange(position, deleteLength);
+	}
+	virtual const char *BufferPointer() {
+		return body.BufferPointer();
+	}
+	virtual const char *RangePointer(Sci_Position position, Sci_Position rangeLength) {
+		return body.RangePointer(position, rangeLength);
+	}
+	virtual Sci_Position GapPosition() const {
+		return body.GapPosition();
+	}
+	virtual const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const {
+		return body.ContiguousRangePointer(position, lengthContiguous);
+	}
+};
+
+
+// A style byte for each position
+class StyleBytes : public IStyles {
+	SplitVector<char> body;
+public:
+	StyleBytes() {
+	}
+	virtual ~StyleBytes() {
+	}
+	virtual char ValueAt(Sci_Position position) const {
+		return body.ValueAt(position);
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		body.GetRange(buffer, position, retrieveLength);
+	}
+	virtual Sci_Position Length() const {
+		return body.Length();
+	}
+	virtual void ReAllocate(Sci_Position newSize) {
+		body.ReAllocate(newSize);
+	}
+	virtual void InsertSpace(Sci_Position position, Sci_Position insertLength) {
+		body.InsertValue(position, insertLength, 0);
+	}
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		body.DeleteRange(position, deleteLength);
+	}
+	virtual bool SetMasked(Sci_Position position, Sci_Position lengthStyle, char styleValue, char mask) {
+		bool changed = false;
+		while (lengthStyle--) {
+			char curVal = body.ValueAt(position);
+			if ((curVal & mask) != styleValue) {
+				body.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
+				changed = true;
+			}
+			position++;
+		}
+		return changed;
+	}
+};
+
+// Runs of positions with the same style
+class StyleRuns : public IStyles {
+	RunStyles body;
+public:
+	StyleRuns() {
+	}
+	virtual ~StyleRuns() {
+	}
+	virtual char ValueAt(Sci_Position position) const {
+		if ((position < 0) || (position >= body.Length()))
+			return 0;
+		return static_cast<char>(body.ValueAt(position));
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		const Sci_Position end = position + retrieveLength;
+		while (position < end) {
+			const Sci_Position endRun = std::min(body.EndRun(position), end);
+			memset(buffer, body.ValueAt(position), endRun - position);
+			buffer += endRun - position;
+			position = endRun;
+		}
+	}
+	virtual Sci_Position Length() const {
+		return body.Length();
+	}
+	virtual void ReAllocate(Sci_Position) {
+	}
+	virtual void InsertSpace(Sci_Position position, Sci_Position insertLength) {
+		body.InsertSpace(position, insertLength);
+		// InsertSpace may extend the surrounding run so ensure new positions are 0
+		body.FillRange(position, 0, insertLength);
+	}
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		body.DeleteRange(position, deleteLength);
+	}
+	virtual bool SetMasked(Sci_Position position, Sci_Position lengthStyle, char styleValue, char mask) {
+		// Each run has a single value so only needs to be changed once
+		bool changed = false;
+		const Sci_Position end = position + lengthStyle;
+		while (position < end) {
+			const Sci_Position endRun = std::min(body.EndRun(position), end);
+			const char curVal = static_cast<char>(body.ValueAt(position));
+			if ((curVal & mask) != styleValue) {
+				const unsigned char newVal = static_cast<unsigned char>((curVal & ~mask) | styleValue);
+				Sci_Position positionFill = position;
+				Sci_Position lengthFill = endRun - position;
+				body.FillRange(positionFill, newVal, lengthFill);
+				changed = true;
+			}
+			position = endRun;
+		}
+		return changed;
+	}
+};
+
+#if defined(CELLBUFFER_SSE2) || defined(__AVX2__)
+inline int FirstBit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Return the index of the first byte from start that may end a line, or end if none.
+// That is CR, LF and, when highBytes, any byte with the top bit set as NEL, LS and PS
+// are multibyte in UTF-8. Most bytes can not end a line so are checked 16 or 32 at a time.
+Sci_Position NextLineEndCandidate(const char *s, Sci_Position start, Sci_Position end, bool highBytes) {
+	Sci_Position i = start;
+#if defined(__AVX2__)
+	const __m256i cr32 = _mm256_set1_epi8('\r');
+	const __m256i lf32 = _mm256_set1_epi8('\n');
+	for (; i + 32 <= end; i += 32) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+		const __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr32), _mm256_cmpeq_epi8(chunk, lf32));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(match));
+		if (highBytes)
+			mask |= static_cast<unsigned int>(_mm256_movemask_epi8(chunk));
+		if (mask)
+			return i + FirstBit(mask);
+	}
+#endif
+#if defined(CELLBUFFER_SSE2)
+	const __m128i cr16 = _mm_set1_epi8('\r');
+	const __m128i lf16 = _mm_set1_epi8('\n');
+	for (; i + 16 <= end; i += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+		const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, cr16), _mm_cmpeq_epi8(chunk, lf16));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(match));
+		if (highBytes)
+			mask |= static_cast<unsigned int>(_mm_movemask_epi8(chunk));
+		if (mask)
+			return i + FirstBit(mask);
+	}
+#endif
+	for (; i < end; i++) {
+		const unsigned char ch = s[i];
+		if ((ch == '\r') || (ch == '\n') || (highBytes && !UTF8IsAscii(ch)))
+			return i;
+	}
+	return end;
+}
+
+// Line starts are collected and inserted together to avoid updating the line
+// partitioning and per line data for each line of a large insertion.
+const Sci_Position lineStartsBatch = 1024;
+
+}
+
+void ChangedRange::Reset() {
+	changed = false;
+	start = 0;
+	end = 0;
+}
+
+void ChangedRange::Insert(Sci_Position position, Sci_Position insertLength) {
+	if (!changed) {
+		changed = true;
+		start = position;
+		end = position + insertLength;
+	} else {
+		start = std::min(start, position);
+		end = (position <= end) ? end + insertLength : position + insertLength;
+	}
+}
+
+void ChangedRange::Delete(Sci_Position position, Sci_Position deleteLength) {
+	if (!changed) {
+		changed = true;
+		start = position;
+		end = position;
+	} else {
+		start = std::min(start, position);
+		end = (end >= position + deleteLength) ? end - deleteLength : position;
+	}
+}
+
+void ChangedRange::Change(Sci_Position position, Sci_Position changeLength) {
+	if (!changed) {
+		changed = true;
+		start = position;
+		end = position + changeLength;
+	} else {
+		start = std::min(start, position);
+		end = std::max(end, position + changeLength);
+	}
+}
+
+ChangeJournal::ChangeJournal() {
+	versionStart = 0;
+	textBase = 0;
+	sizeLimit = 0;
+	textLimit = 0;
+}
+
+ChangeJournal::~ChangeJournal() {
+}
+
+void ChangeJournal::DeleteAll(int version) {
+	entries.DeleteAll();
+	text.DeleteAll();
+	versionStart = version;
+	textBase = 0;
+}
+
+void ChangeJournal::SetSizeLimit(int sizeLimit_, int version) {
+	sizeLimit = std::max(sizeLimit_, 0);
+	if (sizeLimit == 0)
+		DeleteAll(version);
+	else
+		Trim();
+}
+
+int ChangeJournal::SizeLimit() const {
+	return sizeLimit;
+}
+
+void ChangeJournal::SetTextLimit(Sci_Position textLimit_) {
+	textLimit = std::max<Sci_Position>(textLimit_, 0);
+	Trim();
+}
+
+Sci_Position ChangeJournal::TextLimit() const {
+	return textLimit;
+}
+
+void ChangeJournal::RemoveOldest(int entriesToRemove) {
+	entriesToRemove = std::min(entriesToRemove, static_cast<int>(entries.Length()));
+	Sci_Position textKept = textBase + text.Length();
+	for (int i = entriesToRemove; i < entries.Length(); i++) {
+		if (entries[i].textStart >= textBase) {
+			textKept = entries[i].textStart;
+			break;
+		}
+	}
+	text.DeleteRange(0, textKept - textBase);
+	textBase = textKept;
+	entries.DeleteRange(0, entriesToRemove);
+	versionStart += entriesToRemove;
+}
+
+void ChangeJournal::Trim() {
+	if (entries.Length() > sizeLimit) {
+		// Remove an extra eighth so entries are not moved for each change
+		RemoveOldest(static_cast<int>(entries.Length()) - sizeLimit + sizeLimit / 8);
+	}
+	if (text.Length() > textLimit) {
+		// Drop the text of the oldest changes, keeping whole changes, down to
+		// seven eighths of the limit. The text of the newest change fits so is kept.
+		const Sci_Position textEnd = textBase + text.Length();
+		Sci_Position textKept = textEnd;
+		for (int i = 0; i < entries.Length(); i++) {
+			const Sci_Position textStart = entries[i].textStart;
+			if (textStart >= textBase) {
+				textKept = textStart;
+				if (textEnd - textStart <= textLimit - textLimit / 8)
+					break;
+			}
+		}
+		if (textEnd - textKept > textLimit)
+			textKept = textEnd;
+		text.DeleteRange(0, textKept - textBase);
+		textBase = textKept;
+	}
+}
+
+void ChangeJournal::Record(int version, bool insertion, Sci_Position position, const char *s, Sci_Position length) {
+	if (sizeLimit <= 0) {
+		versionStart = version;
+		return;
+	}
+	if (version != VersionEnd() + 1) {
+		// Missed a change so start again from version
+		DeleteAll(version);
+		return;
+	}
+	JournalEntry entry;
+	entry.insertion = insertion;
+	entry.position = position;
+	entry.length = length;
+	if (s && (length <= textLimit)) {
+		entry.textStart = textBase + text.Length();
+		text.InsertFromArray(text.Length(), s, 0, length);
+	}
+	entries.Insert(entries.Length(), entry);
+	Trim();
+}
+
+int ChangeJournal::VersionStart() const {
+	return versionStart;
+}
+
+int ChangeJournal::VersionEnd() const {
+	return versionStart + static_cast<int>(entries.Length());
+}
+
+const JournalEntry *ChangeJournal::Entry(int version) const {
+	if ((version <= versionStart) || (version > VersionEnd()))
+		return 0;
+	return &entries[version - versionStart - 1];
+}
+
+Sci_Position ChangeJournal::EntryText(int version, char *buffer) const {
+	const JournalEntry *entry = Entry(version);
+	if (!entry || (entry->textStart < textBase))
+		return 0;
+	if (buffer)
+		text.GetRange(buffer, entry->textStart - textBase, entry->length);
+	return entry->length;
+}
+
+bool ChangeJournal::ChangesSince(int version, SplitVector<ChangeSpan> &changes) const {
+	changes.DeleteAll();
+	if ((version < versionStart) || (version > VersionEnd()))
+		return false;
+	for (int i = version - versionStart; i < entries.Length(); i++) {
+		const JournalEntry &entry = entries[i];
+		const Sci_Position removed = entry.insertion ? 0 : entry.length;
+		const Sci_Position inserted = entry.insertion ? entry.length : 0;
+		// Find the first span ending at or after the change
+		Sci_Position first = 0;
+		Sci_Position upper = changes.Length();
+		while (first < upper) {
+			const Sci_Position middle = (first + upper) / 2;
+			if (changes[middle].position + changes[middle].lengthInserted < entry.position)
+				first = middle + 1;
+			else
+				upper = middle;
+		}
+		// Merge the change with the spans it touches. Text in the merged range
+		// outside the spans is unchanged since version.
+		Sci_Position start = entry.position;
+		Sci_Position end = entry.position + removed;
+		Sci_Position spansRemoved = 0;
+		Sci_Position spansInserted = 0;
+		Sci_Position last = first;
+		while ((last < changes.Length()) && (changes[last].position <= entry.position + removed)) {
+			const ChangeSpan &span = changes[last];
+			start = std::min(start, span.position);
+			end = std::max(end, span.position + span.lengthInserted);
+			spansRemoved += span.lengthRemoved;
+			spansInserted += span.lengthInserted;
+			last++;
+		}
+		const ChangeSpan merged(start, end - start - spansInserted + spansRemoved, end - start - removed + inserted);
+		changes.DeleteRange(first, last - first);
+		if (merged.lengthRemoved || merged.lengthInserted) {
+			changes.Insert(first, merged);
+			first++;
+		}
+		for (Sci_Position j = first; j < changes.Length(); j++) {
+			changes[j].position += inserted - removed;
+		}
+	}
+	return true;
+}
+
+namespace {
+
+// Snapshots are made of spans of blocks that are shared between snapshots.
+// Blocks are never modified once filled and the reference counts are atomic as
+// snapshots are released on other threads.
+
+template <typename T>
+class SharedBlock {
+	std::atomic<int> refCount;
+
+	// Private so SharedBlock objects can not be copied
+	SharedBlock(const SharedBlock &);
+
+public:
+	T *values;
+
+	explicit SharedBlock(Sci_Position size) : refCount(1), values(new T[size]) {
+	}
+	~SharedBlock() {
+		delete []values;
+	}
+	void AddRef() {
+		refCount++;
+	}
+	void Release() {
+		if (--refCount == 0)
+			delete this;
+	}
+};
+
+struct TextSpan {
+	SharedBlock<char> *text;
+	SharedBlock<char> *styles;	///< 0 when every style is 0
+	Sci_Position offset;
+	Sci_Position length;
+};
+
+struct LineSpan {
+	SharedBlock<Sci_Position> *starts;
+	Sci_Position offset;
+	Sci_Position lines;
+	Sci_Position delta;	///< Added to the starts as text before may have changed length
+};
+
+const Sci_Position snapshotTextBlock = 0x10000;
+const Sci_Position snapshotLineBlock = 0x4000;
+
+// Find the span containing a position given the start of each span followed by the end.
+size_t SpanFromStart(const std::vector<Sci_Position> &spanStarts, Sci_Position position) {
+	const size_t span = std::upper_bound(spanStarts.begin(), spanStarts.end(), position) - spanStarts.begin();
+	return (span > 0) ? span - 1 : 0;
+}
+
+class BufferSnapshot : public ISnapshot {
+	std::atomic<int> refCount;
+	SnapshotLink *link;	///< Set when the buffer may share blocks from this snapshot
+	int version;
+	std::vector<TextSpan> textSpans;
+	std::vector<Sci_Position> textStarts;	///< Position of each text span then the length
+	std::vector<LineSpan> lineSpans;
+	std::vector<Sci_Position> lineFirsts;	///< First line of each line span then the number of lines
+
+	// Private so BufferSnapshot objects can not be copied
+	BufferSnapshot(const BufferSnapshot &);
+
+	void GetRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve, bool styles) const {
+		if (position < 0) {
+			const Sci_Position lengthBefore = std::min(-position, lengthRetrieve);
+			memset(buffer, 0, lengthBefore);
+			buffer += lengthBefore;
+			position += lengthBefore;
+			lengthRetrieve -= lengthBefore;
+		}
+		size_t span = SpanFromStart(textStarts, position);
+		while ((lengthRetrieve > 0) && (span < textSpans.size())) {
+			const TextSpan &ts = textSpans[span];
+			const Sci_Position offset = position - textStarts[span];
+			const Sci_Position lengthCopy = std::min(ts.length - offset, lengthRetrieve);
+			if (!styles)
+				memcpy(buffer, ts.text->values + ts.offset + offset, lengthCopy);
+			else if (ts.styles)
+				memcpy(buffer, ts.styles->values + ts.offset + offset, lengthCopy);
+			else
+				memset(buffer, 0, lengthCopy);
+			buffer += lengthCopy;
+			position += lengthCopy;
+			lengthRetrieve -= lengthCopy;
+			span++;
+		}
+		if (lengthRetrieve > 0)
+			memset(buffer, 0, lengthRetrieve);
+	}
+
+public:
+	explicit BufferSnapshot(int version_) : refCount(1), link(0), version(version_) {
+		textStarts.push_back(0);
+		lineFirsts.push_back(0);
+	}
+	virtual ~BufferSnapshot();
+	void ReleaseBlocks() {
+		for (size_t span = 0; span < textSpans.size(); span++) {
+			textSpans[span].text->Release();
+			if (textSpans[span].styles)
+				textSpans[span].styles->Release();
+		}
+		for (size_t span = 0; span < lineSpans.size(); span++) {
+			lineSpans[span].starts->Release();
+		}
+	}
+
+	// Building is performed before the snapshot is shared
+	void AppendText(const TextSpan &ts) {
+		if (ts.length <= 0)
+			return;
+		ts.text->AddRef();
+		if (ts.styles)
+			ts.styles->AddRef();
+		textSpans.push_back(ts);
+		textStarts.push_back(textStarts.back() + ts.length);
+	}
+	void AppendTextFrom(const BufferSnapshot &other, Sci_Position position, Sci_Position length) {
+		size_t span = SpanFromStart(other.textStarts, position);
+		while ((length > 0) && (span < other.textSpans.size())) {
+			TextSpan ts = other.textSpans[span];
+			const Sci_Position offset = position - other.textStarts[span];
+			ts.offset += offset;
+			ts.length = std::min(ts.length - offset, length);
+			AppendText(ts);
+			position += ts.length;
+			length -= ts.length;
+			span++;
+		}
+	}
+	void AppendLines(const LineSpan &ls) {
+		if (ls.lines <= 0)
+			return;
+		ls.starts->AddRef();
+		lineSpans.push_back(ls);
+		lineFirsts.push_back(lineFirsts.back() + ls.lines);
+	}
+	void AppendLinesFrom(const BufferSnapshot &other, Sci_Position line, Sci_Position lines, Sci_Position delta) {
+		size_t span = SpanFromStart(other.lineFirsts, line);
+		while ((lines > 0) && (span < other.lineSpans.size())) {
+			LineSpan ls = other.lineSpans[span];
+			const Sci_Position offset = line - other.lineFirsts[span];
+			ls.offset += offset;
+			ls.lines = std::min(ls.lines - offset, lines);
+			ls.delta += delta;
+			AppendLines(ls);
+			line += ls.lines;
+			lines -= ls.lines;
+			span++;
+		}
+	}
+	// Many small spans make access slower so when there are too many, copy everything
+	bool Fragmented() const {
+		return (textSpans.size() > static_cast<size_t>(32 + 2 * Length() / snapshotTextBlock)) ||
+			(lineSpans.size() > static_cast<size_t>(32 + 2 * Lines() / snapshotLineBlock));
+	}
+
+	void SetLink(SnapshotLink *link_);
+
+	virtual void AddRef() {
+		refCount++;
+	}
+	// Add a reference unless the snapshot is already being deleted.
+	bool AddRefIfReferenced() {
+		int count = refCount.load();
+		while (count > 0) {
+			if (refCount.compare_exchange_weak(count, count + 1))
+				return true;
+		}
+		return false;
+	}
+	virtual void Release() {
+		if (--refCount == 0)
+			delete this;
+	}
+	virtual int Version() const {
+		return version;
+	}
+	virtual Sci_Position Length() const {
+		return textStarts.back();
+	}
+	virtual char CharAt(Sci_Position position) const {
+		char ch = 0;
+		GetRange(&ch, position, 1, false);
+		return ch;
+	}
+	virtual void GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+		GetRange(buffer, position, lengthRetrieve, false);
+	}
+	virtual char StyleAt(Sci_Position position) const {
+		char styleAt = 0;
+		GetRange(&styleAt, position, 1, true);
+		return styleAt;
+	}
+	virtual void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+		GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve, true);
+	}
+	virtual Sci_Position Lines() const {
+		return lineFirsts.back();
+	}
+	virtual Sci_Position LineStart(Sci_Position line) const {
+		if (line <= 0)
+			return 0;
+		if (line >= Lines())
+			return Length();
+		const size_t span = SpanFromStart(lineFirsts, line);
+		const LineSpan &ls = lineSpans[span];
+		return ls.starts->values[ls.offset + line - lineFirsts[span]] + ls.delta;
+	}
+	virtual Sci_Position LineFromPosition(Sci_Position position) const {
+		// Binary search for the last line starting at or before position
+		Sci_Position lower = 0;
+		Sci_Position upper = Lines() - 1;
+		while (lower < upper) {
+			const Sci_Position middle = (lower + upper + 1) / 2;
+			if (LineStart(middle) <= position)
+				lower = middle;
+			else
+				upper = middle - 1;
+		}
+		return lower;
+	}
+	virtual const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const {
+		if ((position < 0) || (position >= Length())) {
+			lengthContiguous = 0;
+			return 0;
+		}
+		const size_t span = SpanFromStart(textStarts, position);
+		const TextSpan &ts = textSpans[span];
+		const Sci_Position offset = position - textStarts[span];
+		lengthContiguous = ts.length - offset;
+		return ts.text->values + ts.offset + offset;
+	}
+};
+
+}
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/**
+ * Refers to the last snapshot of a buffer without holding a reference to it so the
+ * next snapshot can share its blocks while it is held elsewhere but it is freed as soon
+ * as it is released. Snapshots are released on other threads so access is locked.
+ */
+class SnapshotLink {
+	std::mutex mutex;
+	BufferSnapshot *last;
+	std::atomic<int> refCount;
+
+	// Private so SnapshotLink objects can not be copied
+	SnapshotLink(const SnapshotLink &);
+
+public:
+	SnapshotLink() : last(0), refCount(1) {
+	}
+	void AddRef() {
+		refCount++;
+	}
+	void Release() {
+		if (--refCount == 0)
+			delete this;
+	}
+	/// The last snapshot with a reference added or 0 when it has been released.
+	BufferSnapshot *Acquire() {
+		std::lock_guard<std::mutex> guard(mutex);
+		if (last && last->AddRefIfReferenced())
+			return last;
+		return 0;
+	}
+	void SetLast(BufferSnapshot *snapshot) {
+		std::lock_guard<std::mutex> guard(mutex);
+		last = snapshot;
+	}
+	void Forget(BufferSnapshot *snapshot) {
+		std::lock_guard<std::mutex> guard(mutex);
+		if (last == snapshot)
+			last = 0;
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+BufferSnapshot::~BufferSnapshot() {
+	if (link) {
+		link->Forget(this);
+		link->Release();
+	}
+	ReleaseBlocks();
+}
+
+void BufferSnapshot::SetLink(SnapshotLink *link_) {
+	link = link_;
+	link->AddRef();
+	link->SetLast(this);
+}
+
+CellBuffer::CellBuffer(bool pieceTable, bool styleRuns) {
+	if (pieceTable)
+		substance = new Substance<PieceTable>();
+	else
+		substance = new Substance<SplitVector<char> >();
+	mappedFile = 0;
+	// Styles are allocated when first set as many documents are never styled
+	style = 0;
+	useStyleRuns = styleRuns;
 	readOnly = false;
+	utf8Substance = false;
 	utf8LineEnds = 0;
 	collectingUndo = true;
+	contentVersion = 0;
+	snapshotLink = new SnapshotLink();
 }
 
 CellBuffer::~CellBuffer() {
+	delete substance;
+	substance = 0;
+	delete mappedFile;
+	mappedFile = 0;
+	delete style;
+	style = 0;
+	snapshotLink->Release();
+	snapshotLink = 0;
 }
 
-char CellBuffer::CharAt(int position) const {
-	return substance.ValueAt(position);
+char CellBuffer::CharAt(Sci_Position position) const {
+	return substance->ValueAt(position);
 }
 
-void CellBuffer::GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+void CellBuffer::GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 	if (lengthRetrieve < 0)
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > substance.Length()) {
-		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", position,
-		                      lengthRetrieve, substance.Length());
+	if ((position + lengthRetrieve) > substance->Length()) {
+		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", static_cast<int>(position),
+		                      static_cast<int>(lengthRetrieve), static_cast<int>(substance->Length()));
 		return;
 	}
-	substance.GetRange(buffer, position, lengthRetrieve);
+	substance->GetRange(buffer, position, lengthRetrieve);
 }
 
-char CellBuffer::StyleAt(int position) const {
-	return style.ValueAt(position);
+char CellBuffer::StyleAt(Sci_Position position) const {
+	return style ? style->ValueAt(position) : 0;
 }
 
-void CellBuffer::GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const {
+void CellBuffer::GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 	if (lengthRetrieve < 0)
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > style.Length()) {
-		Platform::DebugPrintf("Bad GetStyleRange %d for %d of %d\n", position,
-		                      lengthRetrieve, style.Length());
+	if ((position + lengthRetrieve) > substance->Length()) {
+		Platform::DebugPrintf("Bad GetStyleRange %d for %d of %d\n", static_cast<int>(position),
+		                      static_cast<int>(lengthRetrieve), static_cast<int>(substance->Length()));
 		return;
 	}
-	style.GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
+	if (style)
+		style->GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
+	else
+		memset(buffer, 0, lengthRetrieve);
 }
 
 const char *CellBuffer::BufferPointer() {
-	return substance.BufferPointer();
+	return substance->BufferPointer();
+}
+
+const char *CellBuffer::RangePointer(Sci_Position position, Sci_Position rangeLength) {
+	return substance->RangePointer(position, rangeLength);
+}
+
+Sci_Position CellBuffer::GapPosition() const {
+	return substance->GapPosition();
+}
+
+const char *CellBuffer::ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const {
+	return substance->ContiguousRangePointer(position, lengthContiguous);
+}
+
+int CellBuffer::ContentVersion() const {
+	return contentVersion;
+}
+
+ISnapshot *CellBuffer::Snapshot() {
+	BufferSnapshot *previous = snapshotLink->Acquire();
+	if (previous && !changedSinceSnapshot.changed)
+		return previous;
+	const Sci_Position length = substance->Length();
+	const Sci_Position lines = Lines();
+	// Share the text before and after the changed range with the previous snapshot
+	Sci_Position prefix = 0;
+	Sci_Position suffix = 0;
+	if (previous && !previous->Fragmented()) {
+		prefix = std::max<Sci_Position>(changedSinceSnapshot.start, 0);
+		suffix = std::max<Sci_Position>(length - changedSinceSnapshot.end, 0);
+	}
+	const Sci_Position lengthPrevious = previous ? previous->Length() : 0;
+	BufferSnapshot *snapshot = new BufferSnapshot(contentVersion);
+	if (prefix > 0)
+		snapshot->AppendTextFrom(*previous, 0, prefix);
+	for (Sci_Position position = prefix; position < length - suffix;) {
+		TextSpan ts;
+		ts.offset = 0;
+		ts.length = std::min(snapshotTextBlock, length - suffix - position);
+		ts.text = new SharedBlock<char>(ts.length);
+		substance->GetRange(ts.text->values, position, ts.length);
+		ts.styles = 0;
+		if (style) {
+			ts.styles = new SharedBlock<char>(ts.length);
+			style->GetRange(ts.styles->values, position, ts.length);
+		}
+		snapshot->AppendText(ts);
+		ts.text->Release();
+		if (ts.styles)
+			ts.styles->Release();
+		position += ts.length;
+	}
+	if (suffix > 0)
+		snapshot->AppendTextFrom(*previous, lengthPrevious - suffix, suffix);
+
+	// Whether there is a line start at a position depends on the character there and
+	// up to 3 characters before for Unicode line ends so the lines that can be shared
+	// are those that start at least that far into the unchanged text.
+	const Sci_Position linesPrefix = (prefix > 0) ? lv.LineFromPosition(prefix - 1) + 1 : 0;
+	const Sci_Position lineSuffix = (suffix > 0) ? lv.LineFromPosition(length - suffix + 2) + 1 : lines;
+	if (linesPrefix > 0)
+		snapshot->AppendLinesFrom(*previous, 0, linesPrefix, 0);
+	for (Sci_Position line = linesPrefix; line < lineSuffix;) {
+		LineSpan ls;
+		ls.offset = 0;
+		ls.lines = std::min(snapshotLineBlock, lineSuffix - line);
+		ls.delta = 0;
+		ls.starts = new SharedBlock<Sci_Position>(ls.lines);
+		for (Sci_Position l = 0; l < ls.lines; l++) {
+			ls.starts->values[l] = lv.LineStart(line + l);
+		}
+		snapshot->AppendLines(ls);
+		ls.starts->Release();
+		line += ls.lines;
+	}
+	if (lineSuffix < lines) {
+		const Sci_Position lineSuffixPrevious = previous->LineFromPosition(lengthPrevious - suffix + 2) + 1;
+		PLATFORM_ASSERT(previous->Lines() - lineSuffixPrevious == lines - lineSuffix);
+		snapshot->AppendLinesFrom(*previous, lineSuffixPrevious, lines - lineSuffix, length - lengthPrevious);
+	}
+
+	snapshot->SetLink(snapshotLink);
+	if (previous)
+		previous->Release();
+	changedSinceSnapshot.Reset();
+	return snapshot;
 }
 
-const char *CellBuffer::RangePointer(int position, int rangeLength) {
-	return substance.RangePointer(position, rangeLength);
+void CellBuffer::SetChangeJournalSize(int sizeLimit) {
+	journal.SetSizeLimit(sizeLimit, contentVersion);
 }
 
-int CellBuffer::GapPosition() const {
-	return substance.GapPosition();
+int CellBuffer::ChangeJournalSize() const {
+	return journal.SizeLimit();
+}
+
+void CellBuffer::SetChangeJournalTextLimit(Sci_Position textLimit) {
+	journal.SetTextLimit(textLimit);
+}
+
+Sci_Position CellBuffer::ChangeJournalTextLimit() const {
+	return journal.TextLimit();
+}
+
+const ChangeJournal &CellBuffer::Journal() const {
+	return journal;
 }
 
 // The char* returned is to an allocation owned by the undo history
-const char *CellBuffer::InsertString(int position, const char *s, int insertLength, bool &startSequence) {
+const char *CellBuffer::InsertString(Sci_Position position, const char *s, Sci_Position insertLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	const char *data = s;
 	if (!readOnly) {
@@ -409,34 +1784,52 @@ const char *CellBuffer::InsertString(int position, const char *s, int insertLeng
 	return data;
 }
 
-bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
+// Until styles are allocated every style is 0 so setting 0 changes nothing
+void CellBuffer::AllocateStyles() {
+	if (useStyleRuns)
+		style = new StyleRuns();
+	else
+		style = new StyleBytes();
+	style->InsertSpace(0, substance->Length());
+}
+
+bool CellBuffer::SetStyleAt(Sci_Position position, char styleValue, char mask) {
 	styleValue &= mask;
-	char curVal = style.ValueAt(position);
-	if ((curVal & mask) != styleValue) {
-		style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
-		return true;
-	} else {
+	if ((position < 0) || (position >= substance->Length()))
 		return false;
+	if (!style) {
+		if (styleValue == 0)
+			return false;
+		AllocateStyles();
 	}
+	if (!style->SetMasked(position, 1, styleValue, mask))
+		return false;
+	changedSinceSnapshot.Change(position, 1);
+	return true;
 }
 
-bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, char mask) {
-	bool changed = false;
+bool CellBuffer::SetStyleFor(Sci_Position position, Sci_Position lengthStyle, char styleValue, char mask) {
 	PLATFORM_ASSERT(lengthStyle == 0 ||
-		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
-	while (lengthStyle--) {
-		char curVal = style.ValueAt(position);
-		if ((curVal & mask) != styleValue) {
-			style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
-			changed = true;
-		}
-		position++;
+		(lengthStyle > 0 && lengthStyle + position <= substance->Length()));
+	if (lengthStyle <= 0)
+		return false;
+	if (!style) {
+		if ((styleValue & mask) == 0)
+			return false;
+		AllocateStyles();
 	}
-	return changed;
+	if (!style->SetMasked(position, lengthStyle, styleValue, mask))
+		return false;
+	changedSinceSnapshot.Change(position, lengthStyle);
+	return true;
+}
+
+bool CellBuffer::HasStyles() const {
+	return style != 0;
 }
 
 // The char* returned is to an allocation owned by the undo history
-const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startSequence) {
+const char *CellBuffer::DeleteChars(Sci_Position position, Sci_Position deleteLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	PLATFORM_ASSERT(deleteLength > 0);
 	const char *data = 0;
@@ -444,7 +1837,7 @@ const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startS
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
 			// The gap would be moved to position anyway for the deletion so this doesn't cost extra
-			data = substance.RangePointer(position, deleteLength);
+			data = substance->RangePointer(position, deleteLength);
 			data = uh.AppendAction(removeAction, position, data, deleteLength, startSequence);
 		}
 
@@ -453,31 +1846,133 @@ const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startS
 	return data;
 }
 
-int CellBuffer::Length() const {
-	return substance.Length();
+Sci_Position CellBuffer::Length() const {
+	return substance->Length();
 }
 
-void CellBuffer::Allocate(int newSize) {
-	substance.ReAllocate(newSize);
-	style.ReAllocate(newSize);
+void CellBuffer::Allocate(Sci_Position newSize) {
+	substance->ReAllocate(newSize);
+	if (style)
+		style->ReAllocate(newSize);
+}
+
+// Use the contents of a mapped file in place instead of copying them into the buffer.
+// Edits are held by a piece table so the file is never written.
+// Takes ownership of the file when successful.
+bool CellBuffer::UseMappedFile(MappedFile *file) {
+	const Sci_Position length = static_cast<Sci_Position>(file->Length());
+	if ((substance->Length() != 0) || (length < 0) || (static_cast<size_t>(length) != file->Length()))
+		return false;
+	Substance<PieceTable> *pieces = new Substance<PieceTable>();
+	pieces->Body().SetOriginal(file->Data(), length);
+	delete substance;
+	substance = pieces;
+	delete mappedFile;
+	mappedFile = file;
+	if (style)
+		style->InsertSpace(0, length);
+	contentVersion++;
+	changedSinceSnapshot.Insert(0, length);
+	// The text of the file is not copied into the journal
+	journal.Record(contentVersion, true, 0, 0, length);
+	ResetLineEnds();
+	return true;
 }
 
 void CellBuffer::SetLineEndTypes(int utf8LineEnds_) {
 	if (utf8LineEnds != utf8LineEnds_) {
 		utf8LineEnds = utf8LineEnds_;
+		// Lines may change throughout the text
+		changedSinceSnapshot.Change(0, Length());
 		ResetLineEnds();
 	}
 }
 
+void CellBuffer::SetUTF8Substance(bool utf8Substance_) {
+	if (utf8Substance != utf8Substance_) {
+		utf8Substance = utf8Substance_;
+		if (lv.LineCharacterIndex() != SC_LINECHARACTERINDEX_NONE) {
+			RecalculateIndexLineStarts(0, Lines() - 1);
+		}
+	}
+}
+
+int CellBuffer::LineCharacterIndex() const {
+	return lv.LineCharacterIndex();
+}
+
+void CellBuffer::AllocateLineCharacterIndex(int lineCharacterIndex) {
+	if (lv.AllocateLineCharacterIndex(lineCharacterIndex)) {
+		// Changed so recalculate whole file
+		RecalculateIndexLineStarts(0, Lines() - 1);
+	}
+}
+
+void CellBuffer::ReleaseLineCharacterIndex(int lineCharacterIndex) {
+	lv.ReleaseLineCharacterIndex(lineCharacterIndex);
+}
+
+Sci_Position CellBuffer::IndexLineStart(Sci_Position line, int lineCharacterIndex) const {
+	return lv.IndexLineStart(line, lineCharacterIndex);
+}
+
+Sci_Position CellBuffer::LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const {
+	return lv.LineFromPositionIndex(pos, lineCharacterIndex);
+}
+
+// Count characters in the same way as Document::GetCharacterAndWidth with invalid
+// bytes counted as one character each and characters outside the Basic Multilingual
+// Plane as two UTF-16 code units.
+CharacterWidths CellBuffer::CountCharacterWidths(Sci_Position position, Sci_Position length) const {
+	CharacterWidths widths;
+	if (!utf8Substance) {
+		widths.utf32 = length;
+		widths.utf16 = length;
+		return widths;
+	}
+	const Sci_Position blockSize = 0x1000;
+	unsigned char text[blockSize + UTF8MaxBytes];
+	const Sci_Position end = position + length;
+	while (position < end) {
+		// Retrieve a few extra bytes so characters starting in the block are complete
+		const Sci_Position lengthBlock = std::min(end - position, blockSize + UTF8MaxBytes - 1);
+		substance->GetRange(reinterpret_cast<char *>(text), position, lengthBlock);
+		const Sci_Position lengthStarts = std::min(lengthBlock, blockSize);
+		Sci_Position i = 0;
+		while (i < lengthStarts) {
+			const unsigned char ch = text[i];
+			int widthBytes = 1;
+			if (!UTF8IsAscii(ch)) {
+				const int utf8status = UTF8Classify(text + i, static_cast<int>(lengthBlock - i));
+				if (!(utf8status & UTF8MaskInvalid)) {
+					widthBytes = utf8status & UTF8MaskWidth;
+				}
+			}
+			widths.utf32++;
+			widths.utf16 += (widthBytes == UTF8MaxBytes) ? 2 : 1;
+			i += widthBytes;
+		}
+		position += i;
+	}
+	return widths;
+}
+
+void CellBuffer::RecalculateIndexLineStarts(Sci_Position lineFirst, Sci_Position lineLast) {
+	for (Sci_Position line = lineFirst; line <= lineLast; line++) {
+		const Sci_Position start = LineStart(line);
+		lv.SetLineCharacterWidths(line, CountCharacterWidths(start, LineStart(line + 1) - start));
+	}
+}
+
 void CellBuffer::SetPerLine(PerLine *pl) {
 	lv.SetPerLine(pl);
 }
 
-int CellBuffer::Lines() const {
+Sci_Position CellBuffer::Lines() const {
 	return lv.Lines();
 }
 
-int CellBuffer::LineStart(int line) const {
+Sci_Position CellBuffer::LineStart(Sci_Position line) const {
 	if (line < 0)
 		return 0;
 	else if (line >= Lines())
@@ -504,20 +1999,20 @@ bool CellBuffer::IsSavePoint() const {
 
 // Without undo
 
-void CellBuffer::InsertLine(int line, int position, bool lineStart) {
+void CellBuffer::InsertLine(Sci_Position line, Sci_Position position, bool lineStart) {
 	lv.InsertLine(line, position, lineStart);
 }
 
-void CellBuffer::RemoveLine(int line) {
+void CellBuffer::RemoveLine(Sci_Position line) {
 	lv.RemoveLine(line);
 }
 
-bool CellBuffer::UTF8LineEndOverlaps(int position) const {
+bool CellBuffer::UTF8LineEndOverlaps(Sci_Position position) const {
 	unsigned char bytes[] = {
-		static_cast<unsigned char>(substance.ValueAt(position-2)),
-		static_cast<unsigned char>(substance.ValueAt(position-1)),
-		static_cast<unsigned char>(substance.ValueAt(position)),
-		static_cast<unsigned char>(substance.ValueAt(position+1)),
+		static_cast<unsigned char>(substance->ValueAt(position-2)),
+		static_cast<unsigned char>(substance->ValueAt(position-1)),
+		static_cast<unsigned char>(substance->ValueAt(position)),
+		static_cast<unsigned char>(substance->ValueAt(position+1)),
 	};
 	return UTF8IsSeparator(bytes) || UTF8IsSeparator(bytes+1) || UTF8IsNEL(bytes+1);
 }
@@ -526,58 +2021,103 @@ void CellBuffer::ResetLineEnds() {
 	// Reinitialize line data -- too much work to preserve
 	lv.Init();
 
-	int position = 0;
-	int length = Length();
-	int lineInsert = 1;
-	bool atLineStart = true;
+	Sci_Position length = Length();
+	Sci_Position lineInsert = 1;
 	lv.InsertText(lineInsert-1, length);
 	unsigned char chBeforePrev = 0;
 	unsigned char chPrev = 0;
-	for (int i = 0; i < length; i++) {
-		unsigned char ch = substance.ValueAt(position + i);
+	// Scan a block at a time as retrieving each character from the substance is slow
+	const Sci_Position blockSize = 0x8000;
+	char text[blockSize];
+	for (Sci_Position position = 0; position < length; position += blockSize) {
+		const Sci_Position lengthBlock = std::min(length - position, blockSize);
+		substance->GetRange(text, position, lengthBlock);
+		lineInsert = InsertLineEnds(lineInsert, position, text, lengthBlock, true, chBeforePrev, chPrev);
+	}
+	if (lv.LineCharacterIndex() != SC_LINECHARACTERINDEX_NONE) {
+		RecalculateIndexLineStarts(0, Lines() - 1);
+	}
+}
+
+// Add the lines ended within s, which has been inserted at position, starting at
+// lineInsert. chBeforePrev and chPrev are the two characters before s on entry and
+// the last two characters of s on return. Returns the line following those inserted.
+Sci_Position CellBuffer::InsertLineEnds(Sci_Position lineInsert, Sci_Position position, const char *s, Sci_Position insertLength,
+	bool atLineStart, unsigned char &chBeforePrev, unsigned char &chPrev) {
+	Sci_Position lineStarts[lineStartsBatch];
+	Sci_Position lineStartsCount = 0;
+	Sci_Position i = 0;
+	while (i < insertLength) {
+		const Sci_Position next = NextLineEndCandidate(s, i, insertLength, utf8LineEnds != 0);
+		if (next > i) {
+			// Skipped characters can not end lines but later characters may look back at them
+			chBeforePrev = (next - i >= 2) ? s[next - 2] : chPrev;
+			chPrev = s[next - 1];
+			i = next;
+			if (i >= insertLength)
+				break;
+		}
+		const unsigned char ch = s[i];
+		bool lineEnd = false;
 		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
+			lineEnd = true;
 		} else if (ch == '\n') {
 			if (chPrev == '\r') {
 				// Patch up what was end of line
-				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
+				if (lineStartsCount > 0)
+					lineStarts[lineStartsCount - 1] = (position + i) + 1;
+				else
+					lv.SetLineStart(lineInsert - 1, (position + i) + 1);
 			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+				lineEnd = true;
 			}
 		} else if (utf8LineEnds) {
 			unsigned char back3[3] = {chBeforePrev, chPrev, ch};
-			if (UTF8IsSeparator(back3) || UTF8IsNEL(back3+1)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+			lineEnd = UTF8IsSeparator(back3) || UTF8IsNEL(back3+1);
+		}
+		if (lineEnd) {
+			if (lineStartsCount == lineStartsBatch) {
+				lv.InsertLines(lineInsert, lineStarts, lineStartsCount, atLineStart);
+				lineInsert += lineStartsCount;
+				lineStartsCount = 0;
 			}
+			lineStarts[lineStartsCount++] = (position + i) + 1;
 		}
 		chBeforePrev = chPrev;
 		chPrev = ch;
+		i++;
 	}
+	if (lineStartsCount > 0) {
+		lv.InsertLines(lineInsert, lineStarts, lineStartsCount, atLineStart);
+		lineInsert += lineStartsCount;
+	}
+	return lineInsert;
 }
 
-void CellBuffer::BasicInsertString(int position, const char *s, int insertLength) {
+void CellBuffer::BasicInsertString(Sci_Position position, const char *s, Sci_Position insertLength) {
 	if (insertLength == 0)
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
+	contentVersion++;
+	changedSinceSnapshot.Insert(position, insertLength);
+	journal.Record(contentVersion, true, position, s, insertLength);
 
-	unsigned char chAfter = substance.ValueAt(position);
+	unsigned char chAfter = substance->ValueAt(position);
 	bool breakingUTF8LineEnd = false;
 	if (utf8LineEnds && UTF8IsTrailByte(chAfter)) {
 		breakingUTF8LineEnd = UTF8LineEndOverlaps(position);
 	}
 
-	substance.InsertFromArray(position, s, 0, insertLength);
-	style.InsertValue(position, insertLength, 0);
+	substance->InsertFromArray(position, s, 0, insertLength);
+	if (style)
+		style->InsertSpace(position, insertLength);
 
-	int lineInsert = lv.LineFromPosition(position) + 1;
+	Sci_Position lineInsert = lv.LineFromPosition(position) + 1;
 	bool atLineStart = lv.LineStart(lineInsert-1) == position;
 	// Point all the lines after the insertion point further along in the buffer
 	lv.InsertText(lineInsert-1, insertLength);
-	unsigned char chBeforePrev = substance.ValueAt(position - 2);
-	unsigned char chPrev = substance.ValueAt(position - 1);
+	unsigned char chBeforePrev = substance->ValueAt(position - 2);
+	unsigned char chPrev = substance->ValueAt(position - 1);
 	if (chPrev == '\r' && chAfter == '\n') {
 		// Splitting up a crlf pair at position
 		InsertLine(lineInsert, position, false);
@@ -586,30 +2126,8 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 	if (breakingUTF8LineEnd) {
 		RemoveLine(lineInsert);
 	}
-	unsigned char ch = ' ';
-	for (int i = 0; i < insertLength; i++) {
-		ch = s[i];
-		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
-		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				// Patch up what was end of line
-				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
-			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
-		} else if (utf8LineEnds) {
-			unsigned char back3[3] = {chBeforePrev, chPrev, ch};
-			if (UTF8IsSeparator(back3) || UTF8IsNEL(back3+1)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
-		}
-		chBeforePrev = chPrev;
-		chPrev = ch;
-	}
+	lineInsert = InsertLineEnds(lineInsert, position, s, insertLength, atLineStart, chBeforePrev, chPrev);
+	const unsigned char ch = s[insertLength - 1];
 	// Joining two lines where last insertion is cr and following substance starts with lf
 	if (chAfter == '\n') {
 		if (ch == '\r') {
@@ -619,7 +2137,7 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 	} else if (utf8LineEnds && !UTF8IsAscii(chAfter)) {
 		// May have end of UTF-8 line end in buffer and start in insertion
 		for (int j = 0; j < UTF8SeparatorLength-1; j++) {
-			unsigned char chAt = substance.ValueAt(position + insertLength + j);
+			unsigned char chAt = substance->ValueAt(position + insertLength + j);
 			unsigned char back3[3] = {chBeforePrev, chPrev, chAt};
 			if (UTF8IsSeparator(back3)) {
 				InsertLine(lineInsert, (position + insertLength + j) + 1, atLineStart);
@@ -633,13 +2151,20 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 			chPrev = chAt;
 		}
 	}
+	if (lv.LineCharacterIndex() != SC_LINECHARACTERINDEX_NONE) {
+		RecalculateIndexLineStarts(LineFromPosition(position - 1), LineFromPosition(position + insertLength));
+	}
 }
 
-void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
+void CellBuffer::BasicDeleteChars(Sci_Position position, Sci_Position deleteLength) {
 	if (deleteLength == 0)
 		return;
+	contentVersion++;
+	changedSinceSnapshot.Delete(position, deleteLength);
+	journal.Record(contentVersion, false, position,
+		journal.KeepsText(deleteLength) ? substance->RangePointer(position, deleteLength) : 0, deleteLength);
 
-	if ((position == 0) && (deleteLength == substance.Length())) {
+	if ((position == 0) && (deleteLength == substance->Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
 		lv.Init();
@@ -647,11 +2172,11 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 		// Have to fix up line positions before doing deletion as looking at text in buffer
 		// to work out which lines have been removed
 
-		int lineRemove = lv.LineFromPosition(position) + 1;
+		Sci_Position lineRemove = lv.LineFromPosition(position) + 1;
 		lv.InsertText(lineRemove-1, - (deleteLength));
-		unsigned char chPrev = substance.ValueAt(position - 1);
+		unsigned char chPrev = substance->ValueAt(position - 1);
 		unsigned char chBefore = chPrev;
-		unsigned char chNext = substance.ValueAt(position);
+		unsigned char chNext = substance->ValueAt(position);
 		bool ignoreNL = false;
 		if (chPrev == '\r' && chNext == '\n') {
 			// Move back one
@@ -666,8 +2191,8 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 		}
 
 		unsigned char ch = chNext;
-		for (int i = 0; i < deleteLength; i++) {
-			chNext = substance.ValueAt(position + i + 1);
+		for (Sci_Position i = 0; i < deleteLength; i++) {
+			chNext = substance->ValueAt(position + i + 1);
 			if (ch == '\r') {
 				if (chNext != '\n') {
 					RemoveLine(lineRemove);
@@ -681,7 +2206,7 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 			} else if (utf8LineEnds) {
 				if (!UTF8IsAscii(ch)) {
 					unsigned char next3[3] = {ch, chNext,
-						static_cast<unsigned char>(substance.ValueAt(position + i + 2))};
+						static_cast<unsigned char>(substance->ValueAt(position + i + 2))};
 					if (UTF8IsSeparator(next3) || UTF8IsNEL(next3)) {
 						RemoveLine(lineRemove);
 					}
@@ -692,15 +2217,19 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 		}
 		// May have to fix up end if last deletion causes cr to be next to lf
 		// or removes one of a crlf pair
-		char chAfter = substance.ValueAt(position + deleteLength);
+		char chAfter = substance->ValueAt(position + deleteLength);
 		if (chBefore == '\r' && chAfter == '\n') {
 			// Using lineRemove-1 as cr ended line before start of deletion
 			RemoveLine(lineRemove - 1);
 			lv.SetLineStart(lineRemove - 1, position + 1);
 		}
 	}
-	substance.DeleteRange(position, deleteLength);
-	style.DeleteRange(position, deleteLength);
+	substance->DeleteRange(position, deleteLength);
+	if (style)
+		style->DeleteRange(position, deleteLength);
+	if (lv.LineCharacterIndex() != SC_LINECHARACTERINDEX_NONE) {
+		RecalculateIndexLineStarts(LineFromPosition(position - 1), LineFromPosition(position));
+	}
 }
 
 bool CellBuffer::SetUndoCollection(bool collectUndo) {
@@ -730,6 +2259,52 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(Sci_Position memoryLimit) {
+	uh.SetMemoryLimit(memoryLimit);
+}
+
+Sci_Position CellBuffer::UndoMemoryLimit() const {
+	return uh.MemoryLimit();
+}
+
+void CellBuffer::SetUndoStepLimit(int stepLimit) {
+	uh.SetStepLimit(stepLimit);
+}
+
+int CellBuffer::UndoStepLimit() const {
+	return uh.StepLimit();
+}
+
+Sci_Position CellBuffer::UndoMemory() const {
+	return uh.Memory();
+}
+
+// Identifies the content an undo history applies to.
+unsigned int CellBuffer::ContentHash() const {
+	// 32 bit FNV-1a
+	unsigned int hash = 2166136261u;
+	char buffer[0x8000];
+	const Sci_Position length = substance->Length();
+	for (Sci_Position position = 0; position < length;) {
+		const Sci_Position lengthBlock = std::min<Sci_Position>(sizeof(buffer), length - position);
+		substance->GetRange(buffer, position, lengthBlock);
+		for (Sci_Position i = 0; i < lengthBlock; i++) {
+			hash = (hash ^ static_cast<unsigned char>(buffer[i])) * 16777619u;
+		}
+		position += lengthBlock;
+	}
+	return hash;
+}
+
+bool CellBuffer::SaveUndoHistory(const char *path) const {
+	return uh.Save(path, ContentHash(), substance->Length());
+}
+
+// Takes ownership of file when successful.
+bool CellBuffer::LoadUndoHistory(MappedFile *file) {
+	return uh.Load(file, ContentHash(), substance->Length());
+}
+
 bool CellBuffer::CanUndo() const {
 	return uh.CanUndo();
 }
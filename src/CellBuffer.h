@@ -17,8 +17,80 @@ class PerLine {
 public:
 	virtual ~PerLine() {}
 	virtual void Init()=0;
-	virtual void InsertLine(int)=0;
-	virtual void RemoveLine(int)=0;
+	virtual void InsertLine(Sci_Position line)=0;
+	/// Same as InsertLine called lines times at line.
+	virtual void InsertLines(Sci_Position line, Sci_Position lines)=0;
+	virtual void RemoveLine(Sci_Position line)=0;
+};
+
+/**
+ * Interface to the storage of the text so CellBuffer can use either a gap
+ * buffer or a piece table. Matches the subset of SplitVector<char> used.
+ */
+class ISubstance {
+public:
+	virtual ~ISubstance() {}
+	virtual char ValueAt(Sci_Position position) const=0;
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const=0;
+	virtual Sci_Position Length() const=0;
+	virtual void ReAllocate(Sci_Position newSize)=0;
+	virtual void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength)=0;
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength)=0;
+	virtual const char *BufferPointer()=0;
+	virtual const char *RangePointer(Sci_Position position, Sci_Position rangeLength)=0;
+	virtual Sci_Position GapPosition() const=0;
+	virtual const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const=0;
+};
+
+/**
+ * Interface to the storage of styles so CellBuffer can use either a byte for each
+ * position or runs of equal style which are smaller when runs are long, as for
+ * unlexed or mostly comment or plain text, but larger when styles change often.
+ */
+class IStyles {
+public:
+	virtual ~IStyles() {}
+	virtual char ValueAt(Sci_Position position) const=0;
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const=0;
+	virtual Sci_Position Length() const=0;
+	virtual void ReAllocate(Sci_Position newSize)=0;
+	/// Inserted positions have style 0.
+	virtual void InsertSpace(Sci_Position position, Sci_Position insertLength)=0;
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength)=0;
+	/// Set the bits in mask of each style in a range to styleValue.
+	/// @return true if any style is changed.
+	virtual bool SetMasked(Sci_Position position, Sci_Position lengthStyle, char styleValue, char mask)=0;
+};
+
+/**
+ * Number of characters in a range as UTF-32 and UTF-16 code units.
+ */
+struct CharacterWidths {
+	Sci_Position utf32;
+	Sci_Position utf16;
+	CharacterWidths() : utf32(0), utf16(0) {
+	}
+};
+
+/**
+ * The start of each line as a count of characters in one encoding so positions can be
+ * converted to and from character indices in logarithmic time.
+ * Reference counted as several clients, such as accessibility and IME, may want it.
+ */
+class LineStartIndex {
+public:
+	int refCount;
+	BlockPartitioning starts;
+
+	LineStartIndex() : refCount(0), starts(256) {
+	}
+	bool Active() const {
+		return refCount > 0;
+	}
+	void SetLineWidth(Sci_Position line, Sci_Position width) {
+		const Sci_Position widthCurrent = starts.PositionFromPartition(line + 1) - starts.PositionFromPartition(line);
+		starts.InsertText(line, width - widthCurrent);
+	}
 };
 
 /**
@@ -26,8 +98,13 @@ public:
  */
 class LineVector {
 
-	Partitioning starts;
+	BlockPartitioning starts;
 	PerLine *perLine;
+	LineStartIndex startsUTF16;
+	LineStartIndex startsUTF32;
+
+	LineStartIndex *IndexFor(int lineCharacterIndex);
+	const LineStartIndex *IndexFor(int lineCharacterIndex) const;
 
 public:
 
@@ -36,18 +113,27 @@ public:
 	void Init();
 	void SetPerLine(PerLine *pl);
 
-	void InsertText(int line, int delta);
-	void InsertLine(int line, int position, bool lineStart);
-	void SetLineStart(int line, int position);
-	void RemoveLine(int line);
-	int Lines() const {
+	void InsertText(Sci_Position line, Sci_Position delta);
+	void InsertLine(Sci_Position line, Sci_Position position, bool lineStart);
+	void InsertLines(Sci_Position line, const Sci_Position *lineStarts, Sci_Position lines, bool lineStart);
+	void SetLineStart(Sci_Position line, Sci_Position position);
+	void RemoveLine(Sci_Position line);
+	Sci_Position Lines() const {
 		return starts.Partitions();
 	}
-	int LineFromPosition(int pos) const;
-	int LineStart(int line) const {
+	Sci_Position LineFromPosition(Sci_Position pos) const;
+	Sci_Position LineStart(Sci_Position line) const {
 		return starts.PositionFromPartition(line);
 	}
 
+	/// Character indices are only maintained when allocated.
+	int LineCharacterIndex() const;
+	bool AllocateLineCharacterIndex(int lineCharacterIndex);
+	bool ReleaseLineCharacterIndex(int lineCharacterIndex);
+	void SetLineCharacterWidths(Sci_Position line, const CharacterWidths &widths);
+	Sci_Position IndexLineStart(Sci_Position line, int lineCharacterIndex) const;
+	Sci_Position LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const;
+
 	int MarkValue(int line);
 	int AddMark(int line, int marker);
 	void MergeMarkers(int pos);
@@ -69,22 +155,58 @@ enum actionType { insertAction, removeAction, startAction, containerAction };
 
 /**
  * Actions are used to store all the information required to perform one undo/redo step.
+ * The text of an action is owned by the UndoArena of its UndoHistory.
  */
 class Action {
 public:
 	actionType at;
-	int position;
-	char *data;
-	int lenData;
+	Sci_Position position;
+	const char *data;
+	Sci_Position lenData;
 	bool mayCoalesce;
 
 	Action();
 	~Action();
-	void Create(actionType at_, int position_=0, const char *data_=0, int lenData_=0, bool mayCoalesce_=true);
+	void Create(actionType at_, Sci_Position position_=0, const char *data_=0, Sci_Position lenData_=0, bool mayCoalesce_=true);
 	void Destroy();
 	void Grab(Action *source);
 };
 
+/**
+ * Holds the text of undo actions in large blocks instead of an allocation for each action.
+ * Text is added in the order of the actions so it is released from the end when actions
+ * that could be redone are discarded and from the start when the oldest actions are trimmed.
+ */
+class UndoArena {
+	SplitVector<char *> blocks;
+	SplitVector<Sci_Position> sizes;
+	Sci_Position used;	///< Bytes used in the last block
+	Sci_Position blockSize;
+	Sci_Position allocated;
+
+	void RemoveBlock(Sci_Position block);
+
+	// Private so UndoArena objects can not be copied
+	UndoArena(const UndoArena &);
+
+public:
+	UndoArena(Sci_Position blockSize_=0x10000);
+	~UndoArena();
+	void DeleteAll();
+
+	/// Copy text to the end of the arena and return its address which remains valid until released.
+	const char *Append(const char *s, Sci_Position length);
+	/// Append text if it can follow on from the text ending at end in the same block.
+	bool Extend(const char *end, const char *s, Sci_Position length);
+	/// Release the text after end which is the end of text in the arena or 0 to release everything.
+	void ReleaseAfter(const char *end);
+	/// Release the blocks before the one holding start.
+	void ReleaseBefore(const char *start);
+	Sci_Position Allocated() const {
+		return allocated;
+	}
+};
+
 /**
  *
  */
@@ -95,8 +217,16 @@ class UndoHistory {
 	int currentAction;
 	int undoSequenceDepth;
 	int savePoint;
+	UndoArena arena;
+	MappedFile *mappedHistory;	///< Holds the text of actions loaded from a file
+	Sci_Position memoryLimit;
+	int stepLimit;
 
 	void EnsureUndoRoom();
+	void ReleaseRedoText();
+	bool CoalesceText(actionType at, Sci_Position position, const char *data, Sci_Position lengthData);
+	void TrimOldest();
+	void RemoveOldest(int actionsToRemove);
 
 	// Private so UndoHistory objects can not be copied
 	UndoHistory(const UndoHistory &);
@@ -105,13 +235,27 @@ public:
 	UndoHistory();
 	~UndoHistory();
 
-	const char *AppendAction(actionType at, int position, const char *data, int length, bool &startSequence, bool mayCoalesce=true);
+	const char *AppendAction(actionType at, Sci_Position position, const char *data, Sci_Position length, bool &startSequence, bool mayCoalesce=true);
 
 	void BeginUndoAction();
 	void EndUndoAction();
 	void DropUndoSequence();
 	void DeleteUndoHistory();
 
+	/// The oldest user operations are removed when there are more than the step limit
+	/// or the history uses more memory than the memory limit. 0 is unlimited.
+	void SetMemoryLimit(Sci_Position memoryLimit_);
+	Sci_Position MemoryLimit() const;
+	void SetStepLimit(int stepLimit_);
+	int StepLimit() const;
+	Sci_Position Memory() const;
+
+	/// The history can be written to a file and loaded again when the content matches.
+	/// The text of loaded actions stays in the file, which the history then owns, so it
+	/// can be paged out by the system instead of using memory.
+	bool Save(const char *path, unsigned int contentHash, Sci_Position contentLength) const;
+	bool Load(MappedFile *file, unsigned int contentHash, Sci_Position contentLength);
+
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
 	void SetSavePoint();
@@ -129,6 +273,134 @@ public:
 	void CompletedRedoStep();
 };
 
+class SnapshotLink;
+
+/**
+ * An immutable view of the text, styles and lines of a CellBuffer at one version.
+ * Snapshots may be read and released on any thread while the buffer is edited.
+ * Positions outside the text return 0 as for CellBuffer.
+ */
+class ISnapshot {
+public:
+	virtual ~ISnapshot() {}
+	virtual void AddRef()=0;
+	virtual void Release()=0;
+	/// The ContentVersion of the buffer when the snapshot was made.
+	virtual int Version() const=0;
+	virtual Sci_Position Length() const=0;
+	virtual char CharAt(Sci_Position position) const=0;
+	virtual void GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const=0;
+	virtual char StyleAt(Sci_Position position) const=0;
+	virtual void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const=0;
+	virtual Sci_Position Lines() const=0;
+	virtual Sci_Position LineStart(Sci_Position line) const=0;
+	virtual Sci_Position LineFromPosition(Sci_Position position) const=0;
+	/// Pointer to the text at position in its block with the length to the end of the block.
+	virtual const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const=0;
+};
+
+/**
+ * The range of a buffer changed since some point, in current positions.
+ * Text before start and from end onwards has not changed although that after end may have moved.
+ */
+class ChangedRange {
+public:
+	bool changed;
+	Sci_Position start;
+	Sci_Position end;
+
+	ChangedRange() : changed(false), start(0), end(0) {
+	}
+	void Reset();
+	void Insert(Sci_Position position, Sci_Position insertLength);
+	void Delete(Sci_Position position, Sci_Position deleteLength);
+	void Change(Sci_Position position, Sci_Position changeLength);
+};
+
+/**
+ * One insertion or deletion recorded by a ChangeJournal.
+ */
+class JournalEntry {
+public:
+	bool insertion;
+	Sci_Position position;
+	Sci_Position length;
+	Sci_Position textStart;	///< Offset of the text in the journal or -1 when not kept
+
+	JournalEntry() : insertion(false), position(0), length(0), textStart(-1) {
+	}
+};
+
+/**
+ * The replacement of lengthRemoved bytes by lengthInserted bytes at position.
+ */
+class ChangeSpan {
+public:
+	Sci_Position position;
+	Sci_Position lengthRemoved;
+	Sci_Position lengthInserted;
+
+	ChangeSpan(Sci_Position position_=0, Sci_Position lengthRemoved_=0, Sci_Position lengthInserted_=0) :
+		position(position_), lengthRemoved(lengthRemoved_), lengthInserted(lengthInserted_) {
+	}
+};
+
+/**
+ * Records recent changes to the text by the ContentVersion they produced so that
+ * consumers mirroring the document can retrieve the changes since the version they
+ * last saw instead of handling each modification as it happens.
+ * Holds at most sizeLimit changes and, optionally, their text up to textLimit bytes.
+ * The oldest changes are discarded as new ones are recorded.
+ */
+class ChangeJournal {
+	SplitVector<JournalEntry> entries;
+	SplitVector<char> text;
+	int versionStart;	///< Version before the oldest entry
+	Sci_Position textBase;	///< Offset of the first byte held in text
+	int sizeLimit;
+	Sci_Position textLimit;
+
+	void RemoveOldest(int entriesToRemove);
+	void Trim();
+
+	// Private so ChangeJournal objects can not be copied
+	ChangeJournal(const ChangeJournal &);
+
+public:
+	ChangeJournal();
+	~ChangeJournal();
+
+	/// Forget all changes so the journal starts at version.
+	void DeleteAll(int version);
+	/// 0 turns the journal off.
+	void SetSizeLimit(int sizeLimit_, int version);
+	int SizeLimit() const;
+	/// The text of changes is kept while it fits in textLimit bytes. 0 keeps no text.
+	void SetTextLimit(Sci_Position textLimit_);
+	Sci_Position TextLimit() const;
+
+	/// Whether the text of a change of length would be kept so is worth retrieving.
+	bool KeepsText(Sci_Position length) const {
+		return (sizeLimit > 0) && (length <= textLimit);
+	}
+	/// Record the change that produced version. s may be 0 when the text is not available.
+	void Record(int version, bool insertion, Sci_Position position, const char *s, Sci_Position length);
+
+	/// Changes producing versions after VersionStart up to VersionEnd are available.
+	int VersionStart() const;
+	int VersionEnd() const;
+	/// The change that produced version or 0 if it is not in the journal.
+	const JournalEntry *Entry(int version) const;
+	/// Copy the text of the change that produced version to buffer, if not 0, and
+	/// return its length or 0 when not kept.
+	Sci_Position EntryText(int version, char *buffer) const;
+	/// Combine the changes since version into spans in ascending order of current position.
+	/// Applying the spans in order to the text at version, replacing lengthRemoved bytes
+	/// at position with the current text from position, produces the current text.
+	/// @return false if version is not in the journal.
+	bool ChangesSince(int version, SplitVector<ChangeSpan> &changes) const;
+};
+
 /**
  * Holder for an expandable array of characters that supports undo and line markers.
  * Based on article "Data Structures in a Bit-Mapped Text Editor"
@@ -136,9 +408,12 @@ public:
  */
 class CellBuffer {
 private:
-	SplitVector<char> substance;
-	SplitVector<char> style;
+	ISubstance *substance;
+	MappedFile *mappedFile;
+	IStyles *style;	///< 0 until a style other than 0 is set
+	bool useStyleRuns;
 	bool readOnly;
+	bool utf8Substance;
 	int utf8LineEnds;
 
 	bool collectingUndo;
@@ -146,44 +421,89 @@ private:
 
 	LineVector lv;
 
-	bool UTF8LineEndOverlaps(int position) const;
+	int contentVersion;
+	SnapshotLink *snapshotLink;	///< Finds the last snapshot while it is held to share its blocks
+	ChangedRange changedSinceSnapshot;
+	ChangeJournal journal;
+
+	void AllocateStyles();
+	unsigned int ContentHash() const;
+	CharacterWidths CountCharacterWidths(Sci_Position position, Sci_Position length) const;
+	void RecalculateIndexLineStarts(Sci_Position lineFirst, Sci_Position lineLast);
+	bool UTF8LineEndOverlaps(Sci_Position position) const;
 	void ResetLineEnds();
+	Sci_Position InsertLineEnds(Sci_Position lineInsert, Sci_Position position, const char *s, Sci_Position insertLength,
+		bool atLineStart, unsigned char &chBeforePrev, unsigned char &chPrev);
 	/// Actions without undo
-	void BasicInsertString(int position, const char *s, int insertLength);
-	void BasicDeleteChars(int position, int deleteLength);
+	void BasicInsertString(Sci_Position position, const char *s, Sci_Position insertLength);
+	void BasicDeleteChars(Sci_Position position, Sci_Position deleteLength);
+
+	// Private so CellBuffer objects can not be copied
+	CellBuffer(const CellBuffer &);
 
 public:
 
-	CellBuffer();
+	/// A piece table is better for very large documents edited in many places
+	/// and style runs use less memory than a style byte for each position when
+	/// the average run is longer than the size of a position plus an int
+	CellBuffer(bool pieceTable=false, bool styleRuns=false);
 	~CellBuffer();
 
 	/// Retrieving positions outside the range of the buffer works and returns 0
-	char CharAt(int position) const;
-	void GetCharRange(char *buffer, int position, int lengthRetrieve) const;
-	char StyleAt(int position) const;
-	void GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const;
+	char CharAt(Sci_Position position) const;
+	void GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
+	char StyleAt(Sci_Position position) const;
+	void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
 	const char *BufferPointer();
-	const char *RangePointer(int position, int rangeLength);
-	int GapPosition() const;
-
-	int Length() const;
-	void Allocate(int newSize);
+	const char *RangePointer(Sci_Position position, Sci_Position rangeLength);
+	Sci_Position GapPosition() const;
+	const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const;
+
+	/// Increases with each change to the text but not to styles.
+	int ContentVersion() const;
+	/// Returns a referenced snapshot which the caller must release.
+	/// Blocks unchanged since the previous snapshot are shared with it so only changed
+	/// blocks are copied, but only while the previous snapshot is still held: the buffer
+	/// does not keep it so, once released, the next snapshot copies everything. Callers
+	/// that take snapshots repeatedly hold the last one until the next is taken.
+	/// Must be called on the thread that modifies the buffer.
+	ISnapshot *Snapshot();
+
+	/// The change journal is off until a size limit is set.
+	void SetChangeJournalSize(int sizeLimit);
+	int ChangeJournalSize() const;
+	void SetChangeJournalTextLimit(Sci_Position textLimit);
+	Sci_Position ChangeJournalTextLimit() const;
+	const ChangeJournal &Journal() const;
+
+	Sci_Position Length() const;
+	void Allocate(Sci_Position newSize);
+	bool UseMappedFile(MappedFile *file);
 	int GetLineEndTypes() const { return utf8LineEnds; }
 	void SetLineEndTypes(int utf8LineEnds_);
 	void SetPerLine(PerLine *pl);
-	int Lines() const;
-	int LineStart(int line) const;
-	int LineFromPosition(int pos) const { return lv.LineFromPosition(pos); }
-	void InsertLine(int line, int position, bool lineStart);
-	void RemoveLine(int line);
-	const char *InsertString(int position, const char *s, int insertLength, bool &startSequence);
+	Sci_Position Lines() const;
+	Sci_Position LineStart(Sci_Position line) const;
+	Sci_Position LineFromPosition(Sci_Position pos) const { return lv.LineFromPosition(pos); }
+	/// Character indices count each byte as a character unless the text is UTF-8.
+	void SetUTF8Substance(bool utf8Substance_);
+	int LineCharacterIndex() const;
+	void AllocateLineCharacterIndex(int lineCharacterIndex);
+	void ReleaseLineCharacterIndex(int lineCharacterIndex);
+	Sci_Position IndexLineStart(Sci_Position line, int lineCharacterIndex) const;
+	Sci_Position LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const;
+	void InsertLine(Sci_Position line, Sci_Position position, bool lineStart);
+	void RemoveLine(Sci_Position line);
+	const char *InsertString(Sci_Position position, const char *s, Sci_Position insertLength, bool &startSequence);
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
-	bool SetStyleAt(int position, char styleValue, char mask='\377');
-	bool SetStyleFor(int position, int length, char styleValue, char mask);
+	bool SetStyleAt(Sci_Position position, char styleValue, char mask='\377');
+	bool SetStyleFor(Sci_Position position, Sci_Position length, char styleValue, char mask);
+	/// False until a style other than 0 is set as unstyled documents store no styles.
+	bool HasStyles() const;
 
-	const char *DeleteChars(int position, int deleteLength, bool &startSequence);
+	const char *DeleteChars(Sci_Position position, Sci_Position deleteLength, bool &startSequence);
 
 	bool IsReadOnly() const;
 	void SetReadOnly(bool set);
@@ -199,6 +519,13 @@ public:
 	void EndUndoAction();
 	void AddUndoAction(int token, bool mayCoalesce);
 	void DeleteUndoHistory();
+	void SetUndoMemoryLimit(Sci_Position memoryLimit);
+	Sci_Position UndoMemoryLimit() const;
+	void SetUndoStepLimit(int stepLimit);
+	int UndoStepLimit() const;
+	Sci_Position UndoMemory() const;
+	bool SaveUndoHistory(const char *path) const;
+	bool LoadUndoHistory(MappedFile *file);
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
@@ -11,6 +11,7 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
@@ -50,7 +51,7 @@ void ContractionState::Clear() {
 	linesInDocument = 1;
 }
 
-int ContractionState::LinesInDoc() const {
+Sci_Position ContractionState::LinesInDoc() const {
 	if (OneToOne()) {
 		return linesInDocument;
 	} else {
@@ -58,7 +59,7 @@ int ContractionState::LinesInDoc() const {
 	}
 }
 
-int ContractionState::LinesDisplayed() const {
+Sci_Position ContractionState::LinesDisplayed() const {
 	if (OneToOne()) {
 		return linesInDocument;
 	} else {
@@ -66,7 +67,7 @@ int ContractionState::LinesDisplayed() const {
 	}
 }
 
-int ContractionState::DisplayFromDoc(int lineDoc) const {
+Sci_Position ContractionState::DisplayFromDoc(Sci_Position lineDoc) const {
 	if (OneToOne()) {
 		return (lineDoc <= linesInDocument) ? lineDoc : linesInDocument;
 	} else {
@@ -76,7 +77,7 @@ int ContractionState::DisplayFromDoc(int lineDoc) const {
 	}
 }
 
-int ContractionState::DocFromDisplay(int lineDisplay) const {
+Sci_Position ContractionState::DocFromDisplay(Sci_Position lineDisplay) const {
 	if (OneToOne()) {
 		return lineDisplay;
 	} else {
@@ -86,13 +87,13 @@ int ContractionState::DocFromDisplay(int lineDisplay) const {
 		if (lineDisplay > LinesDisplayed()) {
 			return displayLines->PartitionFromPosition(LinesDisplayed());
 		}
-		int lineDoc = displayLines->PartitionFromPosition(lineDisplay);
+		Sci_Position lineDoc = displayLines->PartitionFromPosition(lineDisplay);
 		PLATFORM_ASSERT(GetVisible(lineDoc));
 		return lineDoc;
 	}
 }
 
-void ContractionState::InsertLine(int lineDoc) {
+void ContractionState::InsertLine(Sci_Position lineDoc) {
 	if (OneToOne()) {
 		linesInDocument++;
 	} else {
@@ -102,20 +103,20 @@ void ContractionState::InsertLine(int lineDoc) {
 		expanded->SetValueAt(lineDoc, 1);
 		heights->InsertSpace(lineDoc, 1);
 		heights->SetValueAt(lineDoc, 1);
-		int lineDisplay = DisplayFromDoc(lineDoc);
+		Sci_Position lineDisplay = DisplayFromDoc(lineDoc);
 		displayLines->InsertPartition(lineDoc, lineDisplay);
 		displayLines->InsertText(lineDoc, 1);
 	}
 }
 
-void ContractionState::InsertLines(int lineDoc, int lineCount) {
-	for (int l = 0; l < lineCount; l++) {
+void ContractionState::InsertLines(Sci_Position lineDoc, Sci_Position lineCount) {
+	for (Sci_Position l = 0; l < lineCount; l++) {
 		InsertLine(lineDoc + l);
 	}
 	Check();
 }
 
-void ContractionState::DeleteLine(int lineDoc) {
+void ContractionState::DeleteLine(Sci_Position lineDoc) {
 	if (OneToOne()) {
 		linesInDocument--;
 	} else {
@@ -129,14 +130,14 @@ void ContractionState::DeleteLine(int lineDoc) {
 	}
 }
 
-void ContractionState::DeleteLines(int lineDoc, int lineCount) {
-	for (int l = 0; l < lineCount; l++) {
+void ContractionState::DeleteLines(Sci_Position lineDoc, Sci_Position lineCount) {
+	for (Sci_Position l = 0; l < lineCount; l++) {
 		DeleteLine(lineDoc);
 	}
 	Check();
 }
 
-bool ContractionState::GetVisible(int lineDoc) const {
+bool ContractionState::GetVisible(Sci_Position lineDoc) const {
 	if (OneToOne()) {
 		return true;
 	} else {
@@ -146,17 +147,17 @@ bool ContractionState::GetVisible(int lineDoc) const {
 	}
 }
 
-bool ContractionState::SetVisible(int lineDocStart, int lineDocEnd, bool visible_) {
+bool ContractionState::SetVisible(Sci_Position lineDocStart, Sci_Position lineDocEnd, bool visible_) {
 	if (OneToOne() && visible_) {
 		return false;
 	} else {
 		EnsureData();
-		int delta = 0;
+		Sci_Position delta = 0;
 		Check();
 		if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
-			for (int line = lineDocStart; line <= lineDocEnd; line++) {
+			for (Sci_Position line = lineDocStart; line <= lineDocEnd; line++) {
 				if (GetVisible(line) != visible_) {
-					int difference = visible_ ? heights->ValueAt(line) : -heights->ValueAt(line);
+					Sci_Position difference = visible_ ? heights->ValueAt(line) : -heights->ValueAt(line);
 					visible->SetValueAt(line, visible_ ? 1 : 0);
 					displayLines->InsertText(line, difference);
 					delta += difference;
@@ -178,7 +179,7 @@ bool ContractionState::HiddenLines() const {
 	}
 }
 
-bool ContractionState::GetExpanded(int lineDoc) const {
+bool ContractionState::GetExpanded(Sci_Position lineDoc) const {
 	if (OneToOne()) {
 		return true;
 	} else {
@@ -187,7 +188,7 @@ bool ContractionState::GetExpanded(int lineDoc) const {
 	}
 }
 
-bool ContractionState::SetExpanded(int lineDoc, bool expanded_) {
+bool ContractionState::SetExpanded(Sci_Position lineDoc, bool expanded_) {
 	if (OneToOne() && expanded_) {
 		return false;
 	} else {
@@ -203,7 +204,7 @@ bool ContractionState::SetExpanded(int lineDoc, bool expanded_) {
 	}
 }
 
-int ContractionState::ContractedNext(int lineDocStart) const {
+Sci_Position ContractionState::ContractedNext(Sci_Position lineDocStart) const {
 	if (OneToOne()) {
 		return -1;
 	} else {
@@ -211,7 +212,7 @@ int ContractionState::ContractedNext(int lineDocStart) const {
 		if (!expanded->ValueAt(lineDocStart)) {
 			return lineDocStart;
 		} else {
-			int lineDocNextChange = expanded->EndRun(lineDocStart);
+			Sci_Position lineDocNextChange = expanded->EndRun(lineDocStart);
 			if (lineDocNextChange < LinesInDoc())
 				return lineDocNextChange;
 			else
@@ -220,7 +221,7 @@ int ContractionState::ContractedNext(int lineDocStart) const {
 	}
 }
 
-int ContractionState::GetHeight(int lineDoc) const {
+int ContractionState::GetHeight(Sci_Position lineDoc) const {
 	if (OneToOne()) {
 		return 1;
 	} else {
@@ -230,7 +231,7 @@ int ContractionState::GetHeight(int lineDoc) const {
 
 // Set the number of display lines needed for this line.
 // Return true if this is a change.
-bool ContractionState::SetHeight(int lineDoc, int height) {
+bool ContractionState::SetHeight(Sci_Position lineDoc, int height) {
 	if (OneToOne() && (height == 1)) {
 		return false;
 	} else if (lineDoc < LinesInDoc()) {
@@ -252,7 +253,7 @@ bool ContractionState::SetHeight(int lineDoc, int height) {
 }
 
 void ContractionState::ShowAll() {
-	int lines = LinesInDoc();
+	Sci_Position lines = LinesInDoc();
 	Clear();
 	linesInDocument = lines;
 }
@@ -261,14 +262,14 @@ void ContractionState::ShowAll() {
 
 void ContractionState::Check() const {
 #ifdef CHECK_CORRECTNESS
-	for (int vline = 0; vline < LinesDisplayed(); vline++) {
-		const int lineDoc = DocFromDisplay(vline);
+	for (Sci_Position vline = 0; vline < LinesDisplayed(); vline++) {
+		const Sci_Position lineDoc = DocFromDisplay(vline);
 		PLATFORM_ASSERT(GetVisible(lineDoc));
 	}
-	for (int lineDoc = 0; lineDoc < LinesInDoc(); lineDoc++) {
-		const int displayThis = DisplayFromDoc(lineDoc);
-		const int displayNext = DisplayFromDoc(lineDoc + 1);
-		const int height = displayNext - displayThis;
+	for (Sci_Position lineDoc = 0; lineDoc < LinesInDoc(); lineDoc++) {
+		const Sci_Position displayThis = DisplayFromDoc(lineDoc);
+		const Sci_Position displayNext = DisplayFromDoc(lineDoc + 1);
+		const Sci_Position height = displayNext - displayThis;
 		PLATFORM_ASSERT(height >= 0);
 		if (GetVisible(lineDoc)) {
 			PLATFORM_ASSERT(GetHeight(lineDoc) == height);
@@ -20,7 +20,7 @@ class ContractionState {
 	RunStyles *expanded;
 	RunStyles *heights;
 	Partitioning *displayLines;
-	int linesInDocument;
+	Sci_Position linesInDocument;
 
 	void EnsureData();
 
@@ -36,26 +36,26 @@ public:
 
 	void Clear();
 
-	int LinesInDoc() const;
-	int LinesDisplayed() const;
-	int DisplayFromDoc(int lineDoc) const;
-	int DocFromDisplay(int lineDisplay) const;
+	Sci_Position LinesInDoc() const;
+	Sci_Position LinesDisplayed() const;
+	Sci_Position DisplayFromDoc(Sci_Position lineDoc) const;
+	Sci_Position DocFromDisplay(Sci_Position lineDisplay) const;
 
-	void InsertLine(int lineDoc);
-	void InsertLines(int lineDoc, int lineCount);
-	void DeleteLine(int lineDoc);
-	void DeleteLines(int lineDoc, int lineCount);
+	void InsertLine(Sci_Position lineDoc);
+	void InsertLines(Sci_Position lineDoc, Sci_Position lineCount);
+	void DeleteLine(Sci_Position lineDoc);
+	void DeleteLines(Sci_Position lineDoc, Sci_Position lineCount);
 
-	bool GetVisible(int lineDoc) const;
-	bool SetVisible(int lineDocStart, int lineDocEnd, bool visible);
+	bool GetVisible(Sci_Position lineDoc) const;
+	bool SetVisible(Sci_Position lineDocStart, Sci_Position lineDocEnd, bool visible);
 	bool HiddenLines() const;
 
-	bool GetExpanded(int lineDoc) const;
-	bool SetExpanded(int lineDoc, bool expanded);
-	int ContractedNext(int lineDocStart) const;
+	bool GetExpanded(Sci_Position lineDoc) const;
+	bool SetExpanded(Sci_Position lineDoc, bool expanded);
+	Sci_Position ContractedNext(Sci_Position lineDocStart) const;
 
-	int GetHeight(int lineDoc) const;
-	bool SetHeight(int lineDoc, int height);
+	int GetHeight(Sci_Position lineDoc) const;
+	bool SetHeight(Sci_Position lineDoc, int height);
 
 	void ShowAll();
 	void Check() const;
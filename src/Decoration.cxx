@@ -57,7 +57,7 @@ Decoration *DecorationList::DecorationFromIndicator(int indicator) {
 	return 0;
 }
 
-Decoration *DecorationList::Create(int indicator, int length) {
+Decoration *DecorationList::Create(int indicator, Sci_Position length) {
 	currentIndicator = indicator;
 	Decoration *decoNew = new Decoration(indicator);
 	decoNew->rs.InsertSpace(0, length);
@@ -113,7 +113,7 @@ void DecorationList::SetCurrentValue(int value) {
 	currentValue = value ? value : 1;
 }
 
-bool DecorationList::FillRange(int &position, int value, int &fillLength) {
+bool DecorationList::FillRange(Sci_Position &position, int value, Sci_Position &fillLength) {
 	if (!current) {
 		current = DecorationFromIndicator(currentIndicator);
 		if (!current) {
@@ -127,7 +127,7 @@ bool DecorationList::FillRange(int &position, int value, int &fillLength) {
 	return changed;
 }
 
-void DecorationList::InsertSpace(int position, int insertLength) {
+void DecorationList::InsertSpace(Sci_Position position, Sci_Position insertLength) {
 	const bool atEnd = position == lengthDocument;
 	lengthDocument += insertLength;
 	for (Decoration *deco=root; deco; deco = deco->next) {
@@ -138,7 +138,7 @@ void DecorationList::InsertSpace(int position, int insertLength) {
 	}
 }
 
-void DecorationList::DeleteRange(int position, int deleteLength) {
+void DecorationList::DeleteRange(Sci_Position position, Sci_Position deleteLength) {
 	lengthDocument -= deleteLength;
 	Decoration *deco;
 	for (deco=root; deco; deco = deco->next) {
@@ -159,7 +159,7 @@ void DecorationList::DeleteAnyEmpty() {
 	}
 }
 
-int DecorationList::AllOnFor(int position) const {
+int DecorationList::AllOnFor(Sci_Position position) const {
 	int mask = 0;
 	for (Decoration *deco=root; deco; deco = deco->next) {
 		if (deco->rs.ValueAt(position)) {
@@ -169,7 +169,7 @@ int DecorationList::AllOnFor(int position) const {
 	return mask;
 }
 
-int DecorationList::ValueAt(int indicator, int position) {
+int DecorationList::ValueAt(int indicator, Sci_Position position) {
 	Decoration *deco = DecorationFromIndicator(indicator);
 	if (deco) {
 		return deco->rs.ValueAt(position);
@@ -177,7 +177,7 @@ int DecorationList::ValueAt(int indicator, int position) {
 	return 0;
 }
 
-int DecorationList::Start(int indicator, int position) {
+Sci_Position DecorationList::Start(int indicator, Sci_Position position) {
 	Decoration *deco = DecorationFromIndicator(indicator);
 	if (deco) {
 		return deco->rs.StartRun(position);
@@ -185,7 +185,7 @@ int DecorationList::Start(int indicator, int position) {
 	return 0;
 }
 
-int DecorationList::End(int indicator, int position) {
+Sci_Position DecorationList::End(int indicator, Sci_Position position) {
 	Decoration *deco = DecorationFromIndicator(indicator);
 	if (deco) {
 		return deco->rs.EndRun(position);
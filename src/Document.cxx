@@ -13,7 +13,12 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "Platform.h"
 
@@ -41,17 +46,32 @@ static inline bool IsPunctuation(char ch) {
 	return IsASCII(ch) && ispunct(ch);
 }
 
-void LexInterface::Colourise(int start, int end) {
+static inline int UnicodeFromBytes(const unsigned char *us) {
+	if (us[0] < 0xC2) {
+		return us[0];
+	} else if (us[0] < 0xE0) {
+		return ((us[0] & 0x1F) << 6) + (us[1] & 0x3F);
+	} else if (us[0] < 0xF0) {
+		return ((us[0] & 0xF) << 12) + ((us[1] & 0x3F) << 6) + (us[2] & 0x3F);
+	} else if (us[0] < 0xF5) {
+		return ((us[0] & 0x7) << 18) + ((us[1] & 0x3F) << 12) + ((us[2] & 0x3F) << 6) + (us[3] & 0x3F);
+	}
+	return us[0];
+}
+
+void LexInterface::Colourise(Sci_Position start, Sci_Position end) {
 	if (pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
 		// fold points are discovered while performing styling and the folding
 		// code looks for child lines which may trigger styling.
 		performingStyle = true;
+		// The lexer can not be used by the worker at the same time
+		StopBackground();
 
-		int lengthDoc = pdoc->Length();
+		Sci_Position lengthDoc = pdoc->Length();
 		if (end == -1)
 			end = lengthDoc;
-		int len = end - start;
+		Sci_Position len = end - start;
 
 		PLATFORM_ASSERT(len >= 0);
 		PLATFORM_ASSERT(start + len <= lengthDoc);
@@ -60,8 +80,9 @@ void LexInterface::Colourise(int start, int end) {
 		if (start > 0)
 			styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
 
-		if (len > 0) {
-			instance->Lex(start, len, styleStart, pdoc);
+		if ((len > 0) && !LexUntilConverged(start, end, styleStart)) {
+			if (!LexInRanges(start, end, styleStart))
+				instance->Lex(start, len, styleStart, pdoc);
 			instance->Fold(start, len, styleStart, pdoc);
 		}
 
@@ -71,6 +92,7 @@ void LexInterface::Colourise(int start, int end) {
 
 int LexInterface::LineEndTypesSupported() {
 	if (instance) {
+		BackgroundPause pause(this);
 		int interfaceVersion = instance->Version();
 		if (interfaceVersion >= lvSubStyles) {
 			ILexerWithSubStyles *ssinstance = static_cast<ILexerWithSubStyles *>(instance);
@@ -80,7 +102,969 @@ int LexInterface::LineEndTypesSupported() {
 	return 0;
 }
 
-Document::Document() {
+namespace {
+
+// Lexing in the background is performed in chunks which end at line starts. Chunks before
+// the priority position are smaller so that the visible text is committed quickly.
+const Sci_Position backgroundPriorityChunk = 0x4000;
+const Sci_Position backgroundChunk = 0x40000;
+// Bytes of styles committed by one call to CommitBackground to keep the UI responsive
+const Sci_Position backgroundCommitLimit = 0x100000;
+// Smallest range lexed on its own thread when styling on several threads
+const Sci_Position threadedRangeMinimum = 0x40000;
+// Restyling over earlier styles is checked for convergence after each chunk. Chunks start
+// small so styling stops soon after an edit and grow while it does not converge.
+const Sci_Position convergeChunk = 0x400;
+const Sci_Position convergeChunkMaximum = 0x40000;
+// Lines restyled the same as before after the last change for styling to stop
+const Sci_Position convergeLines = 8;
+// Fold levels and line states are copied to a LexerView in blocks of lines when first used
+const Sci_Position lineDataBlock = 0x400;
+
+int StyleBefore(const Document *pdoc, Sci_Position position) {
+	return (position > 0) ? (pdoc->StyleAt(position - 1) & pdoc->stylingBitsMask) : 0;
+}
+
+// The end of a chunk starting at position: the start of the line after position + chunk
+Sci_Position ChunkEnd(const Document *pdoc, Sci_Position position, Sci_Position chunk, Sci_Position end) {
+	if (position + chunk >= end)
+		return end;
+	return std::min(pdoc->LineStart(pdoc->LineFromPosition(position + chunk) + 1), end);
+}
+
+struct DecorationFill {
+	int indicator;
+	Sci_Position position;
+	int value;
+	Sci_Position fillLength;
+	DecorationFill(int indicator_, Sci_Position position_, int value_, Sci_Position fillLength_) :
+		indicator(indicator_), position(position_), value(value_), fillLength(fillLength_) {
+	}
+};
+
+/**
+ * The results of lexing and folding one chunk to be committed to the document when
+ * its text is still at version.
+ */
+struct StyledChunk {
+	int version;
+	Sci_Position end;
+	Sci_Position styleStart;
+	std::string styles;
+	Sci_Position lineFirst;
+	std::vector<int> levels;
+	Sci_Position lineStateFirst;
+	std::vector<int> lineStates;
+	std::vector<std::pair<Sci_Position, Sci_Position> > lexerStateChanges;
+	std::vector<DecorationFill> decorations;
+	int errorStatus;
+
+	StyledChunk() : version(0), end(0), styleStart(0), lineFirst(0), lineStateFirst(0), errorStatus(0) {
+	}
+	void ClipBefore(Sci_Position position, Sci_Position line);
+};
+
+// Drop anything written before position or line, such as when a lexer backs up.
+void StyledChunk::ClipBefore(Sci_Position position, Sci_Position line) {
+	if (styleStart < position) {
+		const Sci_Position clip = std::min<Sci_Position>(position - styleStart, styles.length());
+		styles.erase(0, clip);
+		styleStart += clip;
+	}
+	if (lineFirst < line) {
+		const Sci_Position clip = std::min<Sci_Position>(line - lineFirst, levels.size());
+		levels.erase(levels.begin(), levels.begin() + clip);
+		lineFirst += clip;
+	}
+	if (lineStateFirst < line) {
+		const Sci_Position clip = std::min<Sci_Position>(line - lineStateFirst, lineStates.size());
+		lineStates.erase(lineStates.begin(), lineStates.begin() + clip);
+		lineStateFirst += clip;
+	}
+	std::vector<DecorationFill> decorationsAfter;
+	for (size_t i = 0; i < decorations.size(); i++) {
+		DecorationFill fill = decorations[i];
+		if (fill.position < position) {
+			fill.fillLength -= position - fill.position;
+			fill.position = position;
+		}
+		if (fill.fillLength > 0)
+			decorationsAfter.push_back(fill);
+	}
+	decorations.swap(decorationsAfter);
+}
+
+// Apply the results of lexing a chunk to the document.
+void ApplyStyledChunk(Document *pdoc, const StyledChunk *chunk) {
+	if (chunk->styles.length()) {
+		pdoc->StartStyling(chunk->styleStart, '\377');
+		pdoc->SetStyles(chunk->styles.length(), chunk->styles.c_str());
+	}
+	for (size_t i = 0; i < chunk->levels.size(); i++) {
+		pdoc->SetLevel(chunk->lineFirst + i, chunk->levels[i]);
+	}
+	for (size_t i = 0; i < chunk->lineStates.size(); i++) {
+		pdoc->SetLineState(chunk->lineStateFirst + i, chunk->lineStates[i]);
+	}
+	for (size_t i = 0; i < chunk->lexerStateChanges.size(); i++) {
+		pdoc->ChangeLexerState(chunk->lexerStateChanges[i].first, chunk->lexerStateChanges[i].second);
+	}
+	for (size_t i = 0; i < chunk->decorations.size(); i++) {
+		const DecorationFill &fill = chunk->decorations[i];
+		pdoc->DecorationSetCurrentIndicator(fill.indicator);
+		pdoc->DecorationFillRange(fill.position, fill.value, fill.fillLength);
+	}
+	if (chunk->errorStatus)
+		pdoc->SetErrorStatus(chunk->errorStatus);
+}
+
+/**
+ * The document seen by a lexer running on a worker thread. Text and lines come from an
+ * immutable snapshot and the styles, fold levels and line states written by the lexer are
+ * held over those of the document. Fold levels and line states are copied from the document
+ * a block of lines at a time when first used so starting a pass does not copy every line.
+ * What has been written since the last chunk is taken as a StyledChunk.
+ * Only single byte and UTF-8 documents are supported.
+ */
+class LexerView : public IDocumentWithRangePointer {
+	ISnapshot *snapshot;
+	Document *pdoc;	///< Only used to copy fold levels and line states
+	int codePage;
+	int tabInChars;
+	std::string styles;	///< Styles written in this pass, starting at stylesStart
+	Sci_Position stylesStart;
+	Sci_Position endStyled;
+	char stylingMask;
+	Sci_Position lines;
+	// Blocks of lineDataBlock lines, empty until copied
+	mutable std::vector<std::vector<int> > levels;
+	mutable std::vector<std::vector<int> > lineStates;
+	Sci_Position clearedLine;	///< Lines before this are seen with initial levels and states
+	int currentIndicator;
+	std::string text;	///< Contiguous copy of the text made when BufferPointer is called
+	Sci_Position clearedEnd;	///< Text before this is seen as unstyled
+
+	// Written since the last chunk was taken
+	Sci_Position changedStart;
+	Sci_Position changedEnd;
+	Sci_Position levelFirst;
+	Sci_Position levelEnd;
+	Sci_Position lineStateFirst;
+	Sci_Position lineStateEnd;
+	StyledChunk *chunk;
+
+	char SnapshotStyle(Sci_Position position) const {
+		return (position < clearedEnd) ? 0 : snapshot->StyleAt(position);
+	}
+	void CoverStyles(Sci_Position position, Sci_Position length);
+	void CopyLines(Sci_Position line) const;
+	int &LevelOfLine(Sci_Position line) const {
+		CopyLines(line);
+		return levels[line / lineDataBlock][line % lineDataBlock];
+	}
+	int &LineStateOfLine(Sci_Position line) const {
+		CopyLines(line);
+		return lineStates[line / lineDataBlock][line % lineDataBlock];
+	}
+
+	// Private so LexerView objects can not be copied
+	LexerView(const LexerView &);
+
+public:
+	ILexer *instance;
+	int version;
+	Sci_Position start;
+	Sci_Position end;
+	int stylingBitsMask;
+
+	/// Takes over the reference to snapshot_ which must be of pdoc_.
+	LexerView(Document *pdoc_, ISnapshot *snapshot_, ILexer *instance_, Sci_Position start_);
+	virtual ~LexerView();
+	StyledChunk *TakeChunk(Sci_Position chunkEnd);
+	void ClearBefore(Sci_Position line);
+
+	int SCI_METHOD Version() const {
+		return dvRangePointer;
+	}
+	void SCI_METHOD SetErrorStatus(int status) {
+		chunk->errorStatus = status;
+	}
+	Sci_Position SCI_METHOD Length() const {
+		return snapshot->Length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+		snapshot->GetCharRange(buffer, position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(Sci_Position position) const;
+	Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const {
+		return snapshot->LineFromPosition(position);
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Position line) const {
+		return snapshot->LineStart(line);
+	}
+	int SCI_METHOD GetLevel(Sci_Position line) const;
+	int SCI_METHOD SetLevel(Sci_Position line, int level);
+	int SCI_METHOD GetLineState(Sci_Position line) const;
+	int SCI_METHOD SetLineState(Sci_Position line, int state);
+	void SCI_METHOD StartStyling(Sci_Position position, char mask);
+	bool SCI_METHOD SetStyleFor(Sci_Position length, char style);
+	bool SCI_METHOD SetStyles(Sci_Position length, const char *stylesSet);
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) {
+		currentIndicator = indicator;
+	}
+	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) {
+		chunk->decorations.push_back(DecorationFill(currentIndicator, position, value, fillLength));
+	}
+	void SCI_METHOD ChangeLexerState(Sci_Position startChange, Sci_Position endChange) {
+		chunk->lexerStateChanges.push_back(std::pair<Sci_Position, Sci_Position>(startChange, endChange));
+	}
+	int SCI_METHOD CodePage() const {
+		return codePage;
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char) const {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer();
+	int SCI_METHOD GetLineIndentation(Sci_Position line);
+	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const;
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const;
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const;
+	const char * SCI_METHOD ContiguousRangePointer(Sci_Position position, Sci_Position *lengthContiguous) {
+		return snapshot->ContiguousRangePointer(position, *lengthContiguous);
+	}
+};
+
+LexerView::LexerView(Document *pdoc_, ISnapshot *snapshot_, ILexer *instance_, Sci_Position start_) {
+	snapshot = snapshot_;
+	pdoc = pdoc_;
+	codePage = pdoc->dbcsCodePage;
+	tabInChars = pdoc->tabInChars;
+	stylesStart = start_;
+	endStyled = start_;
+	stylingMask = 0;
+	lines = snapshot->Lines();
+	levels.resize((lines + lineDataBlock - 1) / lineDataBlock);
+	lineStates.resize(levels.size());
+	clearedLine = 0;
+	currentIndicator = 0;
+	clearedEnd = 0;
+	changedStart = 0;
+	changedEnd = 0;
+	levelFirst = 0;
+	levelEnd = 0;
+	lineStateFirst = 0;
+	lineStateEnd = 0;
+	chunk = new StyledChunk();
+	instance = instance_;
+	version = pdoc->ContentVersion();
+	start = start_;
+	end = snapshot->Length();
+	stylingBitsMask = pdoc->stylingBitsMask;
+}
+
+LexerView::~LexerView() {
+	delete chunk;
+	chunk = 0;
+	snapshot->Release();
+	snapshot = 0;
+}
+
+StyledChunk *LexerView::TakeChunk(Sci_Position chunkEnd) {
+	StyledChunk *taken = chunk;
+	taken->version = version;
+	taken->end = chunkEnd;
+	if (changedStart < changedEnd) {
+		taken->styleStart = changedStart;
+		taken->styles = styles.substr(changedStart - stylesStart, changedEnd - changedStart);
+	}
+	if (levelFirst < levelEnd) {
+		taken->lineFirst = levelFirst;
+		for (Sci_Position line = levelFirst; line < levelEnd; line++) {
+			taken->levels.push_back(LevelOfLine(line));
+		}
+	}
+	if (lineStateFirst < lineStateEnd) {
+		taken->lineStateFirst = lineStateFirst;
+		for (Sci_Position line = lineStateFirst; line < lineStateEnd; line++) {
+			taken->lineStates.push_back(LineStateOfLine(line));
+		}
+	}
+	changedStart = changedEnd = 0;
+	levelFirst = levelEnd = 0;
+	lineStateFirst = lineStateEnd = 0;
+	chunk = new StyledChunk();
+	return taken;
+}
+
+// Show the lines before line as if they had not been styled so that lexing
+// from line starts in the lexer's initial state.
+void LexerView::ClearBefore(Sci_Position line) {
+	clearedEnd = LineStart(line);
+	clearedLine = line;
+	// Blocks copied later are cleared as they are copied
+	for (size_t block = 0; block < levels.size(); block++) {
+		const Sci_Position lineFirst = block * lineDataBlock;
+		for (Sci_Position i = 0; (i < static_cast<Sci_Position>(levels[block].size())) && (lineFirst + i < line); i++) {
+			levels[block][i] = SC_FOLDLEVELBASE;
+			lineStates[block][i] = 0;
+		}
+	}
+}
+
+// Copy the block of fold levels and line states containing line from the document
+// unless it has already been copied.
+void LexerView::CopyLines(Sci_Position line) const {
+	const size_t block = line / lineDataBlock;
+	if (levels[block].empty()) {
+		const Sci_Position lineFirst = block * lineDataBlock;
+		const Sci_Position count = std::min(lineDataBlock, lines - lineFirst);
+		levels[block].resize(count);
+		lineStates[block].resize(count);
+		pdoc->CopyLineData(lineFirst, count, &levels[block][0], &lineStates[block][0]);
+		for (Sci_Position i = 0; (i < count) && (lineFirst + i < clearedLine); i++) {
+			levels[block][i] = SC_FOLDLEVELBASE;
+			lineStates[block][i] = 0;
+		}
+	}
+}
+
+// Extend the styles written in this pass to include a range, filling from the snapshot.
+void LexerView::CoverStyles(Sci_Position position, Sci_Position length) {
+	if (position < stylesStart) {
+		std::string before;
+		for (Sci_Position pos = position; pos < stylesStart; pos++) {
+			before.push_back(SnapshotStyle(pos));
+		}
+		styles.insert(0, before);
+		stylesStart = position;
+	}
+	for (Sci_Position pos = stylesStart + styles.length(); pos < position + length; pos++) {
+		styles.push_back(SnapshotStyle(pos));
+	}
+	if (changedStart < changedEnd) {
+		changedStart = std::min(changedStart, position);
+		changedEnd = std::max(changedEnd, position + length);
+	} else {
+		changedStart = position;
+		changedEnd = position + length;
+	}
+}
+
+char SCI_METHOD LexerView::StyleAt(Sci_Position position) const {
+	if ((position >= stylesStart) && (position < stylesStart + static_cast<Sci_Position>(styles.length())))
+		return styles[position - stylesStart];
+	return SnapshotStyle(position);
+}
+
+int SCI_METHOD LexerView::GetLevel(Sci_Position line) const {
+	if ((line >= 0) && (line < lines))
+		return LevelOfLine(line);
+	return SC_FOLDLEVELBASE;
+}
+
+int SCI_METHOD LexerView::SetLevel(Sci_Position line, int level) {
+	if ((line < 0) || (line >= lines))
+		return SC_FOLDLEVELBASE;
+	int &levelLine = LevelOfLine(line);
+	const int prev = levelLine;
+	levelLine = level;
+	if (levelFirst < levelEnd) {
+		levelFirst = std::min(levelFirst, line);
+		levelEnd = std::max(levelEnd, line + 1);
+	} else {
+		levelFirst = line;
+		levelEnd = line + 1;
+	}
+	return prev;
+}
+
+int SCI_METHOD LexerView::GetLineState(Sci_Position line) const {
+	if ((line >= 0) && (line < lines))
+		return LineStateOfLine(line);
+	return 0;
+}
+
+int SCI_METHOD LexerView::SetLineState(Sci_Position line, int state) {
+	if ((line < 0) || (line >= lines))
+		return 0;
+	int &stateLine = LineStateOfLine(line);
+	const int prev = stateLine;
+	stateLine = state;
+	if (lineStateFirst < lineStateEnd) {
+		lineStateFirst = std::min(lineStateFirst, line);
+		lineStateEnd = std::max(lineStateEnd, line + 1);
+	} else {
+		lineStateFirst = line;
+		lineStateEnd = line + 1;
+	}
+	return prev;
+}
+
+void SCI_METHOD LexerView::StartStyling(Sci_Position position, char mask) {
+	stylingMask = mask;
+	endStyled = position;
+}
+
+bool SCI_METHOD LexerView::SetStyleFor(Sci_Position length, char style) {
+	if ((endStyled < 0) || (endStyled + length > Length()))
+		return false;
+	CoverStyles(endStyled, length);
+	style &= stylingMask;
+	for (Sci_Position i = 0; i < length; i++) {
+		char &styleAt = styles[endStyled + i - stylesStart];
+		styleAt = static_cast<char>((styleAt & ~stylingMask) | style);
+	}
+	endStyled += length;
+	return true;
+}
+
+bool SCI_METHOD LexerView::SetStyles(Sci_Position length, const char *stylesSet) {
+	if ((endStyled < 0) || (endStyled + length > Length()))
+		return false;
+	CoverStyles(endStyled, length);
+	for (Sci_Position i = 0; i < length; i++) {
+		char &styleAt = styles[endStyled + i - stylesStart];
+		styleAt = static_cast<char>((styleAt & ~stylingMask) | (stylesSet[i] & stylingMask));
+	}
+	endStyled += length;
+	return true;
+}
+
+const char * SCI_METHOD LexerView::BufferPointer() {
+	if (static_cast<Sci_Position>(text.length()) != Length()) {
+		text.resize(Length());
+		if (Length())
+			snapshot->GetCharRange(&text[0], 0, Length());
+	}
+	return text.c_str();
+}
+
+int SCI_METHOD LexerView::GetLineIndentation(Sci_Position line) {
+	int indent = 0;
+	if ((line >= 0) && (line < snapshot->Lines())) {
+		for (Sci_Position i = LineStart(line); i < Length(); i++) {
+			const char ch = snapshot->CharAt(i);
+			if (ch == ' ')
+				indent++;
+			else if (ch == '\t')
+				indent = ((indent / tabInChars) + 1) * tabInChars;
+			else
+				return indent;
+		}
+	}
+	return indent;
+}
+
+Sci_Position SCI_METHOD LexerView::LineEnd(Sci_Position line) const {
+	if (line >= snapshot->Lines() - 1)
+		return LineStart(line + 1);
+	Sci_Position position = LineStart(line + 1);
+	if (SC_CP_UTF8 == codePage) {
+		const unsigned char bytes[] = {
+			static_cast<unsigned char>(snapshot->CharAt(position-3)),
+			static_cast<unsigned char>(snapshot->CharAt(position-2)),
+			static_cast<unsigned char>(snapshot->CharAt(position-1)),
+		};
+		if (UTF8IsSeparator(bytes))
+			return position - UTF8SeparatorLength;
+		if (UTF8IsNEL(bytes+1))
+			return position - UTF8NELLength;
+	}
+	position--; // Back over CR or LF
+	// When line terminator is CR+LF, may need to go back one more
+	if ((position > LineStart(line)) && (snapshot->CharAt(position - 1) == '\r'))
+		position--;
+	return position;
+}
+
+Sci_Position SCI_METHOD LexerView::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+	Sci_Position pos = positionStart;
+	if (SC_CP_UTF8 == codePage) {
+		while ((characterOffset > 0) && (pos < Length())) {
+			Sci_Position width = 1;
+			GetCharacterAndWidth(pos, &width);
+			pos += width;
+			characterOffset--;
+		}
+		while ((characterOffset < 0) && (pos > 0)) {
+			// Back over trail bytes to a lead byte whose character ends at pos
+			Sci_Position posLead = pos - 1;
+			while ((posLead > 0) && (posLead > pos - UTF8MaxBytes) &&
+				UTF8IsTrailByte(static_cast<unsigned char>(snapshot->CharAt(posLead))))
+				posLead--;
+			Sci_Position width = 1;
+			GetCharacterAndWidth(posLead, &width);
+			pos = (posLead + width == pos) ? posLead : pos - 1;
+			characterOffset++;
+		}
+		if (characterOffset != 0)
+			return INVALID_POSITION;
+	} else {
+		pos = positionStart + characterOffset;
+		if ((pos < 0) || (pos > Length()))
+			return INVALID_POSITION;
+	}
+	return pos;
+}
+
+int SCI_METHOD LexerView::GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const {
+	const unsigned char leadByte = static_cast<unsigned char>(snapshot->CharAt(position));
+	int character = leadByte;
+	int bytesInCharacter = 1;
+	if ((SC_CP_UTF8 == codePage) && !UTF8IsAscii(leadByte)) {
+		const int widthCharBytes = UTF8BytesOfLead[leadByte];
+		unsigned char charBytes[UTF8MaxBytes] = {leadByte,0,0,0};
+		for (int b=1; b<widthCharBytes; b++)
+			charBytes[b] = static_cast<unsigned char>(snapshot->CharAt(position+b));
+		const int utf8status = UTF8Classify(charBytes, widthCharBytes);
+		if (utf8status & UTF8MaskInvalid) {
+			// Report as singleton surrogate values which are invalid Unicode
+			character =  0xDC80 + leadByte;
+		} else {
+			bytesInCharacter = utf8status & UTF8MaskWidth;
+			character = UnicodeFromBytes(charBytes);
+		}
+	}
+	if (pWidth)
+		*pWidth = bytesInCharacter;
+	return character;
+}
+
+}
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/**
+ * Fold levels and line states are changed on the UI thread while LexerViews copy them on
+ * worker threads so both hold this lock.
+ */
+class LineDataLock {
+public:
+	std::mutex mutex;
+};
+
+/**
+ * Runs a lexer on a worker thread over LexerViews, one pass at a time, and queues
+ * the chunks produced until they are committed on the UI thread.
+ */
+class BackgroundLexer {
+	std::mutex mutex;
+	std::condition_variable wake;	///< The worker waits for a pass or to quit
+	std::condition_variable idle;	///< Waiting for the worker to finish a pass
+	LexerView *pending;	///< Pass waiting for the worker
+	bool running;
+	bool quitting;
+	int version;	///< Version of the pending or running pass
+	std::atomic<int> stop;
+	std::atomic<Sci_Position> priorityEnd;
+	std::deque<StyledChunk *> ready;
+	std::mutex lexing;	///< Held by the worker while the lexer runs over a chunk
+	std::thread worker;
+
+	void Run();
+	void Lex(LexerView *view);
+	void DiscardLocked();
+
+	// Private so BackgroundLexer objects can not be copied
+	BackgroundLexer(const BackgroundLexer &);
+
+public:
+	enum { stopNone, stopFinish, stopCancel };
+
+	BackgroundLexer();
+	~BackgroundLexer();
+	/// Update the priority when the pass for version is still wanted.
+	bool Continue(int version_, Sci_Position priorityEnd_);
+	/// Replace any current pass and results with a new pass over view.
+	void Start(LexerView *view, Sci_Position priorityEnd_);
+	/// Stop the running pass after its current chunk keeping or discarding its results.
+	void Stop(int stopMode);
+	void WaitIdle();
+	/// Wait for the current chunk and hold the worker before the next until resumed.
+	void Pause() {
+		lexing.lock();
+	}
+	void Resume() {
+		lexing.unlock();
+	}
+	/// Commit ready chunks up to about limit bytes of styles and return true while more are expected.
+	bool Commit(Document *pdoc, Sci_Position limit);
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+BackgroundLexer::BackgroundLexer() : pending(0), running(false), quitting(false), version(0), stop(stopNone), priorityEnd(0) {
+	worker = std::thread(&BackgroundLexer::Run, this);
+}
+
+BackgroundLexer::~BackgroundLexer() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		quitting = true;
+		stop = stopCancel;
+		DiscardLocked();
+		wake.notify_one();
+	}
+	worker.join();
+}
+
+void BackgroundLexer::DiscardLocked() {
+	delete pending;
+	pending = 0;
+	for (std::deque<StyledChunk *>::iterator it = ready.begin(); it != ready.end(); ++it) {
+		delete *it;
+	}
+	ready.clear();
+}
+
+void BackgroundLexer::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!quitting) {
+		if (!pending) {
+			wake.wait(lock);
+			continue;
+		}
+		LexerView *view = pending;
+		pending = 0;
+		running = true;
+		stop = stopNone;
+		lock.unlock();
+		Lex(view);
+		delete view;
+		lock.lock();
+		running = false;
+		idle.notify_all();
+	}
+}
+
+void BackgroundLexer::Lex(LexerView *view) {
+	Sci_Position pos = view->start;
+	while ((pos < view->end) && (stop == stopNone)) {
+		Sci_Position posEnd = view->end;
+		const Sci_Position lengthChunk = (pos < priorityEnd) ? backgroundPriorityChunk : backgroundChunk;
+		if (pos + lengthChunk < posEnd)
+			posEnd = view->LineStart(view->LineFromPosition(pos + lengthChunk) + 1);
+		int styleStart = 0;
+		if (pos > 0)
+			styleStart = view->StyleAt(pos - 1) & view->stylingBitsMask;
+		{
+			std::unique_lock<std::mutex> lockLexing(lexing);
+			view->instance->Lex(pos, posEnd - pos, styleStart, view);
+			view->instance->Fold(pos, posEnd - pos, styleStart, view);
+		}
+		StyledChunk *chunk = view->TakeChunk(posEnd);
+		std::unique_lock<std::mutex> lock(mutex);
+		if (stop == stopCancel)
+			delete chunk;
+		else
+			ready.push_back(chunk);
+		pos = posEnd;
+	}
+}
+
+bool BackgroundLexer::Continue(int version_, Sci_Position priorityEnd_) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if ((version != version_) || (stop != stopNone) || (!running && !pending && ready.empty()))
+		return false;
+	if (priorityEnd < priorityEnd_)
+		priorityEnd = priorityEnd_;
+	return true;
+}
+
+void BackgroundLexer::Start(LexerView *view, Sci_Position priorityEnd_) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (running)
+		stop = stopCancel;
+	DiscardLocked();
+	pending = view;
+	version = view->version;
+	priorityEnd = priorityEnd_;
+	wake.notify_one();
+}
+
+void BackgroundLexer::Stop(int stopMode) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (running && (stop < stopMode))
+		stop = stopMode;
+	if (stopMode == stopCancel) {
+		DiscardLocked();
+	} else {
+		delete pending;
+		pending = 0;
+	}
+}
+
+void BackgroundLexer::WaitIdle() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running || pending) {
+		idle.wait(lock);
+	}
+}
+
+bool BackgroundLexer::Commit(Document *pdoc, Sci_Position limit) {
+	Sci_Position committed = 0;
+	while (committed < limit) {
+		StyledChunk *chunk = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (ready.empty())
+				break;
+			chunk = ready.front();
+			ready.pop_front();
+		}
+		if (chunk->version != pdoc->ContentVersion()) {
+			// The text has changed since the pass started
+			delete chunk;
+			Stop(stopCancel);
+			return false;
+		}
+		if (committed == 0)
+			pdoc->IncrementStyleClock();
+		ApplyStyledChunk(pdoc, chunk);
+		committed += chunk->styles.length() + 1;
+		delete chunk;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	return running || pending || !ready.empty();
+}
+
+LexInterface::~LexInterface() {
+	delete background;
+	background = 0;
+	if (snapshotLast)
+		snapshotLast->Release();
+	snapshotLast = 0;
+}
+
+// Snapshots only share blocks with a previous snapshot that is still held so the last one
+// is kept, at the cost of its memory, to avoid copying the whole document for each pass.
+// The caller owns a reference to the returned snapshot.
+ISnapshot *LexInterface::TakeSnapshot() {
+	ISnapshot *snapshot = pdoc->Snapshot();
+	snapshot->AddRef();
+	if (snapshotLast)
+		snapshotLast->Release();
+	snapshotLast = snapshot;
+	return snapshot;
+}
+
+bool LexInterface::CanStyleInBackground() const {
+	// The LexerView does not handle DBCS
+	return pdoc && instance && ((pdoc->dbcsCodePage == 0) || (pdoc->dbcsCodePage == SC_CP_UTF8));
+}
+
+void LexInterface::StyleInBackground(Sci_Position priorityEnd) {
+	if (!CanStyleInBackground() || performingStyle)
+		return;
+	const Sci_Position endStyled = pdoc->GetEndStyled();
+	if (endStyled >= pdoc->Length())
+		return;
+	if (!background)
+		background = new BackgroundLexer();
+	if (!background->Continue(pdoc->ContentVersion(), priorityEnd)) {
+		const Sci_Position start = pdoc->LineStart(pdoc->LineFromPosition(endStyled));
+		background->Start(new LexerView(pdoc, TakeSnapshot(), instance, start), priorityEnd);
+	}
+}
+
+// Committing sets fold levels which may lead to styling being needed by the folding code
+// so performingStyle is held to prevent a nested commit or Colourise.
+bool LexInterface::CommitBackground() {
+	if (!background || performingStyle)
+		return false;
+	performingStyle = true;
+	const bool more = background->Commit(pdoc, backgroundCommitLimit);
+	performingStyle = false;
+	return more;
+}
+
+void LexInterface::FinishBackground() {
+	if (background && !performingStyle) {
+		performingStyle = true;
+		background->Stop(BackgroundLexer::stopFinish);
+		background->WaitIdle();
+		while (background->Commit(pdoc, backgroundCommitLimit)) {
+		}
+		performingStyle = false;
+	}
+}
+
+void LexInterface::StopBackground() {
+	if (background) {
+		background->Stop(BackgroundLexer::stopCancel);
+		background->WaitIdle();
+	}
+}
+
+void LexInterface::CancelBackground() {
+	if (background)
+		background->Stop(BackgroundLexer::stopCancel);
+}
+
+void LexInterface::PauseBackground() {
+	if (background)
+		background->Pause();
+}
+
+void LexInterface::ResumeBackground() {
+	if (background)
+		background->Resume();
+}
+
+namespace {
+
+// A range lexed on its own thread over a view as if the range started the document.
+struct LexRange {
+	ILexerWithRestart *lexer;
+	LexerView *view;
+	Sci_Position start;
+	Sci_Position end;
+	StyledChunk *chunk;
+	LexRange(ILexerWithRestart *lexer_, LexerView *view_, Sci_Position start_, Sci_Position end_) :
+		lexer(lexer_), view(view_), start(start_), end(end_), chunk(0) {
+	}
+};
+
+void LexRangeOnThread(LexRange *range) {
+	range->lexer->Lex(range->start, range->end - range->start, 0, range->view);
+	range->chunk = range->view->TakeChunk(range->end);
+}
+
+}
+
+// When the range reaches styles kept from before an edit, lex and fold in chunks and stop
+// once the styles, line states and fold levels are the same as before, keeping the earlier
+// styles. Returns false when there are no earlier styles to reach.
+bool LexInterface::LexUntilConverged(Sci_Position start, Sci_Position end, int styleStart) {
+	if ((pdoc->ReuseStart() >= pdoc->ReuseEnd()) || (start > pdoc->ReuseStart()) || (end <= pdoc->ReuseStart()))
+		return false;
+
+	pdoc->TrackStylingChanges(true);
+	Sci_Position chunk = convergeChunk;
+	Sci_Position pos = start;
+	bool converged = false;
+	while ((pos < end) && !converged) {
+		const Sci_Position chunkEnd = ChunkEnd(pdoc, pos, chunk, end);
+		instance->Lex(pos, chunkEnd - pos, (pos == start) ? styleStart : StyleBefore(pdoc, pos), pdoc);
+		pos = chunkEnd;
+		// The earlier styles are discarded when the lexer reports changes to other state
+		if (pdoc->ReuseStart() >= pdoc->ReuseEnd())
+			break;
+		// Lexers that set fold levels while lexing, rather than in a separate folder, only
+		// change levels here so they also have to reproduce the earlier levels.
+		converged = pdoc->StylingConvergedAt(pos, true);
+		chunk = std::min(chunk * 2, convergeChunkMaximum);
+	}
+	if (!converged) {
+		if (pos < end)
+			instance->Lex(pos, end - pos, StyleBefore(pdoc, pos), pdoc);
+		instance->Fold(start, end - start, styleStart, pdoc);
+		pdoc->TrackStylingChanges(false);
+		return true;
+	}
+
+	// The earlier styles are only kept up to where the lexer reported that later text
+	// depends on state it changed, unless lexing has already passed there.
+	Sci_Position reuseTo = pdoc->ReuseEnd();
+	if (pdoc->ReuseBreak() > pos)
+		reuseTo = std::min(reuseTo, pdoc->ReuseBreak());
+
+	// Adding or removing a fold point changes the levels after it while the styles stay
+	// the same so continue folding over the earlier styles until the levels converge too.
+	instance->Fold(start, pos - start, styleStart, pdoc);
+	const Sci_Position endFold = std::min(end, reuseTo);
+	bool convergedFold = pdoc->StylingConvergedAt(pos, true);
+	chunk = convergeChunk;
+	while ((pos < endFold) && !convergedFold) {
+		const Sci_Position chunkEnd = ChunkEnd(pdoc, pos, chunk, endFold);
+		instance->Fold(pos, chunkEnd - pos, StyleBefore(pdoc, pos), pdoc);
+		pos = chunkEnd;
+		convergedFold = pdoc->StylingConvergedAt(pos, true);
+		chunk = std::min(chunk * 2, convergeChunkMaximum);
+	}
+	pdoc->ReuseStylesTo(convergedFold ? reuseTo : pos);
+
+	// Style any of the range that is after the kept styles, which may converge again with
+	// the earlier styles after a break
+	if (end > pdoc->GetEndStyled()) {
+		const Sci_Position startRest = pdoc->LineStart(pdoc->LineFromPosition(pdoc->GetEndStyled()));
+		const int styleRest = StyleBefore(pdoc, startRest);
+		if (!LexUntilConverged(startRest, end, styleRest)) {
+			instance->Lex(startRest, end - startRest, styleRest, pdoc);
+			instance->Fold(startRest, end - startRest, styleRest, pdoc);
+		}
+	}
+	return true;
+}
+
+// A large range is divided at line starts. The first part is lexed into the document while
+// each other part is lexed on its own thread as if it started the document. Then, in order,
+// each part is committed if the lexer finds that the text before it reached its initial state
+// or is lexed again into the document.
+bool LexInterface::LexInRanges(Sci_Position start, Sci_Position end, int styleStart) {
+	if ((pdoc->LexingThreads() < 2) || (instance->Version() < lvRestart) ||
+		((pdoc->dbcsCodePage != 0) && (pdoc->dbcsCodePage != SC_CP_UTF8)))
+		return false;
+	const Sci_Position parts = std::min<Sci_Position>(pdoc->LexingThreads(), (end - start) / threadedRangeMinimum);
+	std::vector<Sci_Position> starts;
+	for (Sci_Position part = 1; part < parts; part++) {
+		const Sci_Position partStart = pdoc->LineStart(pdoc->LineFromPosition(start + (end - start) * part / parts) + 1);
+		if ((partStart < end) && (starts.empty() || (partStart > starts.back())))
+			starts.push_back(partStart);
+	}
+	if (starts.empty())
+		return false;
+
+	ILexerWithRestart *lexer = static_cast<ILexerWithRestart *>(instance);
+	std::vector<LexRange> ranges;
+	ranges.reserve(starts.size());
+	for (size_t i = 0; i < starts.size(); i++) {
+		ILexerWithRestart *rangeLexer = lexer->RangeLexer();
+		if (!rangeLexer)
+			break;
+		LexerView *view = new LexerView(pdoc, TakeSnapshot(), rangeLexer, starts[i]);
+		view->ClearBefore(pdoc->LineFromPosition(starts[i]));
+		const Sci_Position rangeEnd = (i + 1 < starts.size()) ? starts[i + 1] : end;
+		ranges.push_back(LexRange(rangeLexer, view, starts[i], rangeEnd));
+	}
+	std::vector<std::thread> threads;
+	if (ranges.size() == starts.size()) {
+		for (size_t i = 0; i < ranges.size(); i++) {
+			threads.push_back(std::thread(LexRangeOnThread, &ranges[i]));
+		}
+		instance->Lex(start, starts[0] - start, styleStart, pdoc);
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+	}
+	for (size_t i = 0; i < ranges.size(); i++) {
+		LexRange &range = ranges[i];
+		if (range.chunk) {
+			const Sci_Position line = pdoc->LineFromPosition(range.start);
+			if (lexer->IsRestartLine(line, pdoc)) {
+				range.chunk->ClipBefore(range.start, line);
+				ApplyStyledChunk(pdoc, range.chunk);
+				lexer->MergeRange(range.lexer, line, pdoc->LineFromPosition(range.end));
+			} else {
+				const int styleRange = pdoc->StyleAt(range.start - 1) & pdoc->stylingBitsMask;
+				instance->Lex(range.start, range.end - range.start, styleRange, pdoc);
+			}
+			delete range.chunk;
+		}
+		delete range.view;
+		if (range.lexer != lexer)
+			range.lexer->Release();
+	}
+	return threads.size() > 0;
+}
+
+Document::Document(int options_) :
+	options(options_),
+	cb((options_ & SC_DOCUMENTOPTION_TEXT_PIECES) != 0, (options_ & SC_DOCUMENTOPTION_STYLE_RUNS) != 0) {
 	refCount = 0;
 	pcf = NULL;
 #ifdef _WIN32
@@ -98,6 +1082,14 @@ Document::Document() {
 	enteredModification = 0;
 	enteredStyling = 0;
 	enteredReadOnlyCount = 0;
+	lexingThreads = 1;
+	reuseStart = 0;
+	reuseEnd = 0;
+	reuseBreak = 0;
+	trackingChanges = false;
+	endStyleChanged = -1;
+	lineStateChanged = -1;
+	lineLevelChanged = -1;
 	tabInChars = 8;
 	indentInChars = 0;
 	actualIndentInChars = 8;
@@ -115,6 +1107,7 @@ Document::Document() {
 	perLineData[ldState] = new LineState();
 	perLineData[ldMargin] = new LineAnnotation();
 	perLineData[ldAnnotation] = new LineAnnotation();
+	lineDataLock = new LineDataLock();
 
 	cb.SetPerLine(this);
 
@@ -125,10 +1118,15 @@ Document::~Document() {
 	for (std::vector<WatcherWithUserData>::iterator it = watchers.begin(); it != watchers.end(); ++it) {
 		it->watcher->NotifyDeleted(this, it->userData);
 	}
+	// The background pass may be copying fold levels and line states
+	if (pli)
+		pli->StopBackground();
 	for (int j=0; j<ldSize; j++) {
 		delete perLineData[j];
 		perLineData[j] = 0;
 	}
+	delete lineDataLock;
+	lineDataLock = 0;
 	delete regex;
 	regex = 0;
 	delete pli;
@@ -138,6 +1136,7 @@ Document::~Document() {
 }
 
 void Document::Init() {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
 			perLineData[j]->Init();
@@ -155,6 +1154,7 @@ bool Document::SetDBCSCodePage(int dbcsCodePage_) {
 	if (dbcsCodePage != dbcsCodePage_) {
 		dbcsCodePage = dbcsCodePage_;
 		SetCaseFolder(NULL);
+		cb.SetUTF8Substance(SC_CP_UTF8 == dbcsCodePage);
 		cb.SetLineEndTypes(lineEndBitSet & LineEndTypesSupported());
 		return true;
 	} else {
@@ -178,14 +1178,24 @@ bool Document::SetLineEndTypesAllowed(int lineEndBitSet_) {
 	}
 }
 
-void Document::InsertLine(int line) {
+void Document::InsertLine(Sci_Position line) {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
 			perLineData[j]->InsertLine(line);
 	}
 }
 
-void Document::RemoveLine(int line) {
+void Document::InsertLines(Sci_Position line, Sci_Position lines) {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			perLineData[j]->InsertLines(line, lines);
+	}
+}
+
+void Document::RemoveLine(Sci_Position line) {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
 			perLineData[j]->RemoveLine(line);
@@ -211,15 +1221,15 @@ void Document::SetSavePoint() {
 	NotifySavePoint(true);
 }
 
-int Document::GetMark(int line) {
+int Document::GetMark(Sci_Position line) {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkValue(line);
 }
 
-int Document::MarkerNext(int lineStart, int mask) const {
+Sci_Position Document::MarkerNext(Sci_Position lineStart, int mask) const {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkerNext(lineStart, mask);
 }
 
-int Document::AddMark(int line, int markerNum) {
+int Document::AddMark(Sci_Position line, int markerNum) {
 	if (line >= 0 && line <= LinesTotal()) {
 		int prev = static_cast<LineMarkers *>(perLineData[ldMarkers])->
 			AddMark(line, markerNum, LinesTotal());
@@ -231,7 +1241,7 @@ int Document::AddMark(int line, int markerNum) {
 	}
 }
 
-void Document::AddMarkSet(int line, int valueSet) {
+void Document::AddMarkSet(Sci_Position line, int valueSet) {
 	if (line < 0 || line > LinesTotal()) {
 		return;
 	}
@@ -244,7 +1254,7 @@ void Document::AddMarkSet(int line, int valueSet) {
 	NotifyModified(mh);
 }
 
-void Document::DeleteMark(int line, int markerNum) {
+void Document::DeleteMark(Sci_Position line, int markerNum) {
 	static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteMark(line, markerNum, false);
 	DocModification mh(SC_MOD_CHANGEMARKER, LineStart(line), 0, 0, 0, line);
 	NotifyModified(mh);
@@ -270,19 +1280,19 @@ void Document::DeleteAllMarks(int markerNum) {
 	}
 }
 
-int Document::LineFromHandle(int markerHandle) {
+Sci_Position Document::LineFromHandle(int markerHandle) {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers])->LineFromHandle(markerHandle);
 }
 
-int SCI_METHOD Document::LineStart(int line) const {
+Sci_Position SCI_METHOD Document::LineStart(Sci_Position line) const {
 	return cb.LineStart(line);
 }
 
-int SCI_METHOD Document::LineEnd(int line) const {
+Sci_Position SCI_METHOD Document::LineEnd(Sci_Position line) const {
 	if (line >= LinesTotal() - 1) {
 		return LineStart(line + 1);
 	} else {
-		int position = LineStart(line + 1);
+		Sci_Position position = LineStart(line + 1);
 		if (SC_CP_UTF8 == dbcsCodePage) {
 			unsigned char bytes[] = {
 				static_cast<unsigned char>(cb.CharAt(position-3)),
@@ -312,27 +1322,27 @@ void SCI_METHOD Document::SetErrorStatus(int status) {
 	}
 }
 
-int SCI_METHOD Document::LineFromPosition(int pos) const {
+Sci_Position SCI_METHOD Document::LineFromPosition(Sci_Position pos) const {
 	return cb.LineFromPosition(pos);
 }
 
-int Document::LineEndPosition(int position) const {
+Sci_Position Document::LineEndPosition(Sci_Position position) const {
 	return LineEnd(LineFromPosition(position));
 }
 
-bool Document::IsLineEndPosition(int position) const {
+bool Document::IsLineEndPosition(Sci_Position position) const {
 	return LineEnd(LineFromPosition(position)) == position;
 }
 
-bool Document::IsPositionInLineEnd(int position) const {
+bool Document::IsPositionInLineEnd(Sci_Position position) const {
 	return position >= LineEnd(LineFromPosition(position));
 }
 
-int Document::VCHomePosition(int position) const {
-	int line = LineFromPosition(position);
-	int startPosition = LineStart(line);
-	int endLine = LineEnd(line);
-	int startText = startPosition;
+Sci_Position Document::VCHomePosition(Sci_Position position) const {
+	Sci_Position line = LineFromPosition(position);
+	Sci_Position startPosition = LineStart(line);
+	Sci_Position endLine = LineEnd(line);
+	Sci_Position startText = startPosition;
 	while (startText < endLine && (cb.CharAt(startText) == ' ' || cb.CharAt(startText) == '\t'))
 		startText++;
 	if (position == startText)
@@ -341,9 +1351,17 @@ int Document::VCHomePosition(int position) const {
 		return startText;
 }
 
-int SCI_METHOD Document::SetLevel(int line, int level) {
-	int prev = static_cast<LineLevels *>(perLineData[ldLevels])->SetLevel(line, level, LinesTotal());
+int SCI_METHOD Document::SetLevel(Sci_Position line, int level) {
+	int prev;
+	{
+		std::unique_lock<std::mutex> lock(lineDataLock->mutex);
+		prev = static_cast<LineLevels *>(perLineData[ldLevels])->SetLevel(line, level, LinesTotal());
+	}
 	if (prev != level) {
+		if (trackingChanges)
+			lineLevelChanged = std::max(lineLevelChanged, line);
+		else if ((LineStart(line + 1) > reuseStart) && (LineStart(line) < reuseEnd))
+			DiscardReusableStyles();
 		DocModification mh(SC_MOD_CHANGEFOLD | SC_MOD_CHANGEMARKER,
 		                   LineStart(line), 0, 0, 0, line);
 		mh.foldLevelNow = level;
@@ -353,11 +1371,12 @@ int SCI_METHOD Document::SetLevel(int line, int level) {
 	return prev;
 }
 
-int SCI_METHOD Document::GetLevel(int line) const {
+int SCI_METHOD Document::GetLevel(Sci_Position line) const {
 	return static_cast<LineLevels *>(perLineData[ldLevels])->GetLevel(line);
 }
 
 void Document::ClearLevels() {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
 	static_cast<LineLevels *>(perLineData[ldLevels])->ClearLevels();
 }
 
@@ -368,12 +1387,12 @@ static bool IsSubordinate(int levelStart, int levelTry) {
 		return (levelStart & SC_FOLDLEVELNUMBERMASK) < (levelTry & SC_FOLDLEVELNUMBERMASK);
 }
 
-int Document::GetLastChild(int lineParent, int level, int lastLine) {
+Sci_Position Document::GetLastChild(Sci_Position lineParent, int level, Sci_Position lastLine) {
 	if (level == -1)
 		level = GetLevel(lineParent) & SC_FOLDLEVELNUMBERMASK;
-	int maxLine = LinesTotal();
-	int lookLastLine = (lastLine != -1) ? Platform::Minimum(LinesTotal() - 1, lastLine) : -1;
-	int lineMaxSubord = lineParent;
+	Sci_Position maxLine = LinesTotal();
+	Sci_Position lookLastLine = (lastLine != -1) ? Platform::Minimum(LinesTotal() - 1, lastLine) : -1;
+	Sci_Position lineMaxSubord = lineParent;
 	while (lineMaxSubord < maxLine - 1) {
 		EnsureStyledTo(LineStart(lineMaxSubord + 2));
 		if (!IsSubordinate(level, GetLevel(lineMaxSubord + 1)))
@@ -393,9 +1412,9 @@ int Document::GetLastChild(int lineParent, int level, int lastLine) {
 	return lineMaxSubord;
 }
 
-int Document::GetFoldParent(int line) const {
+Sci_Position Document::GetFoldParent(Sci_Position line) const {
 	int level = GetLevel(line) & SC_FOLDLEVELNUMBERMASK;
-	int lineLook = line - 1;
+	Sci_Position lineLook = line - 1;
 	while ((lineLook > 0) && (
 	            (!(GetLevel(lineLook) & SC_FOLDLEVELHEADERFLAG)) ||
 	            ((GetLevel(lineLook) & SC_FOLDLEVELNUMBERMASK) >= level))
@@ -410,9 +1429,9 @@ int Document::GetFoldParent(int line) const {
 	}
 }
 
-void Document::GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, int line, int lastLine) {
+void Document::GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, Sci_Position line, Sci_Position lastLine) {
 	int level = GetLevel(line);
-	int lookLastLine = Platform::Maximum(line, lastLine) + 1;
+	Sci_Position lookLastLine = Platform::Maximum(line, lastLine) + 1;
 
 	int lookLine = line;
 	int lookLineLevel = level;
@@ -480,11 +1499,11 @@ void Document::GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, in
 	highlightDelimiter.firstChangeableLineAfter = firstChangeableLineAfter;
 }
 
-int Document::ClampPositionIntoDocument(int pos) const {
+Sci_Position Document::ClampPositionIntoDocument(Sci_Position pos) const {
 	return Platform::Clamp(pos, 0, Length());
 }
 
-bool Document::IsCrLf(int pos) const {
+bool Document::IsCrLf(Sci_Position pos) const {
 	if (pos < 0)
 		return false;
 	if (pos >= (Length() - 1))
@@ -492,7 +1511,7 @@ bool Document::IsCrLf(int pos) const {
 	return (cb.CharAt(pos) == '\r') && (cb.CharAt(pos + 1) == '\n');
 }
 
-int Document::LenChar(int pos) {
+int Document::LenChar(Sci_Position pos) {
 	if (pos < 0) {
 		return 1;
 	} else if (IsCrLf(pos)) {
@@ -500,7 +1519,7 @@ int Document::LenChar(int pos) {
 	} else if (SC_CP_UTF8 == dbcsCodePage) {
 		const unsigned char leadByte = static_cast<unsigned char>(cb.CharAt(pos));
 		const int widthCharBytes = UTF8BytesOfLead[leadByte];
-		int lengthDoc = Length();
+		Sci_Position lengthDoc = Length();
 		if ((pos + widthCharBytes) > lengthDoc)
 			return lengthDoc - pos;
 		else
@@ -512,8 +1531,8 @@ int Document::LenChar(int pos) {
 	}
 }
 
-bool Document::InGoodUTF8(int pos, int &start, int &end) const {
-	int trail = pos;
+bool Document::InGoodUTF8(Sci_Position pos, int &start, int &end) const {
+	Sci_Position trail = pos;
 	while ((trail>0) && (pos-trail < UTF8MaxBytes) && UTF8IsTrailByte(static_cast<unsigned char>(cb.CharAt(trail-1))))
 		trail--;
 	start = (trail > 0) ? trail-1 : trail;
@@ -524,7 +1543,7 @@ bool Document::InGoodUTF8(int pos, int &start, int &end) const {
 		return false;
 	} else {
 		int trailBytes = widthCharBytes - 1;
-		int len = pos - start;
+		Sci_Position len = pos - start;
 		if (len > trailBytes)
 			// pos too far from lead
 			return false;
@@ -544,7 +1563,7 @@ bool Document::InGoodUTF8(int pos, int &start, int &end) const {
 // When lines are terminated with \r\n pairs which should be treated as one character.
 // When displaying DBCS text such as Japanese.
 // If moving, move the position in the indicated direction.
-int Document::MovePositionOutsideChar(int pos, int moveDir, bool checkLineEnd) {
+Sci_Position Document::MovePositionOutsideChar(Sci_Position pos, int moveDir, bool checkLineEnd) {
 	//Platform::DebugPrintf("NoCRLF %d %d\n", pos, moveDir);
 	// If out of range, just return minimum/maximum value.
 	if (pos <= 0)
@@ -611,7 +1630,7 @@ int Document::MovePositionOutsideChar(int pos, int moveDir, bool checkLineEnd) {
 // NextPosition moves between valid positions - it can not handle a position in the middle of a
 // multi-byte character. It is used to iterate through text more efficiently than MovePositionOutsideChar.
 // A \r\n pair is treated as two characters.
-int Document::NextPosition(int pos, int moveDir) const {
+Sci_Position Document::NextPosition(Sci_Position pos, int moveDir) const {
 	// If out of range, just return minimum/maximum value.
 	int increment = (moveDir > 0) ? 1 : -1;
 	if (pos + increment <= 0)
@@ -689,9 +1708,9 @@ int Document::NextPosition(int pos, int moveDir) const {
 	return pos;
 }
 
-bool Document::NextCharacter(int &pos, int moveDir) const {
+bool Document::NextCharacter(Sci_Position &pos, int moveDir) const {
 	// Returns true if pos changed
-	int posNext = NextPosition(pos, moveDir);
+	Sci_Position posNext = NextPosition(pos, moveDir);
 	if (posNext == pos) {
 		return false;
 	} else {
@@ -700,26 +1719,35 @@ bool Document::NextCharacter(int &pos, int moveDir) const {
 	}
 }
 
-static inline int UnicodeFromBytes(const unsigned char *us) {
-	if (us[0] < 0xC2) {
-		return us[0];
-	} else if (us[0] < 0xE0) {
-		return ((us[0] & 0x1F) << 6) + (us[1] & 0x3F);
-	} else if (us[0] < 0xF0) {
-		return ((us[0] & 0xF) << 12) + ((us[1] & 0x3F) << 6) + (us[2] & 0x3F);
-	} else if (us[0] < 0xF5) {
-		return ((us[0] & 0x7) << 18) + ((us[1] & 0x3F) << 12) + ((us[2] & 0x3F) << 6) + (us[3] & 0x3F);
-	}
-	return us[0];
-}
+// Moves shorter than this are quicker to perform by stepping through characters
+static const Sci_Position relativeIndexThreshold = 100;
 
 // Return -1  on out-of-bounds
-int SCI_METHOD Document::GetRelativePosition(int positionStart, int characterOffset) const {
-	int pos = positionStart;
+Sci_Position SCI_METHOD Document::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+	Sci_Position pos = positionStart;
+	if ((SC_CP_UTF8 == dbcsCodePage) && (cb.LineCharacterIndex() & SC_LINECHARACTERINDEX_UTF32) &&
+		((characterOffset > relativeIndexThreshold) || (characterOffset < -relativeIndexThreshold))) {
+		// Long moves go through the line character index when positionStart is between characters
+		const Sci_Position line = LineFromPosition(positionStart);
+		Sci_Position posLine = LineStart(line);
+		Sci_Position indexStart = cb.IndexLineStart(line, SC_LINECHARACTERINDEX_UTF32);
+		while (posLine < positionStart) {
+			Sci_Position width = 1;
+			GetCharacterAndWidth(posLine, &width);
+			posLine += width;
+			indexStart++;
+		}
+		if (posLine == positionStart) {
+			const Sci_Position index = indexStart + characterOffset;
+			if ((index < 0) || (index > cb.IndexLineStart(LinesTotal(), SC_LINECHARACTERINDEX_UTF32)))
+				return INVALID_POSITION;
+			return PositionFromIndex(index, SC_LINECHARACTERINDEX_UTF32);
+		}
+	}
 	if (dbcsCodePage) {
 		const int increment = (characterOffset > 0) ? 1 : -1;
 		while (characterOffset != 0) {
-			const int posNext = NextPosition(pos, increment);
+			const Sci_Position posNext = NextPosition(pos, increment);
 			if (posNext == pos)
 				return INVALID_POSITION;
 			pos = posNext;
@@ -733,7 +1761,7 @@ int SCI_METHOD Document::GetRelativePosition(int positionStart, int characterOff
 	return pos;
 }
 
-int SCI_METHOD Document::GetCharacterAndWidth(int position, int *pWidth) const {
+int SCI_METHOD Document::GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const {
 	int character;
 	int bytesInCharacter = 1;
 	if (dbcsCodePage) {
@@ -863,9 +1891,44 @@ EncodingFamily Document::CodePageFamily() const {
 		return efEightBit;
 }
 
-void Document::ModifiedAt(int pos) {
+void Document::ModifiedAt(Sci_Position pos) {
 	if (endStyled > pos)
 		endStyled = pos;
+	// Styles after pos may no longer be what the lexer would produce
+	if (reuseEnd > pos)
+		DiscardReusableStyles();
+	if (pli)
+		pli->CancelBackground();
+}
+
+// The text at pos was changed by inserting and deleting text. Styles for the text after
+// the change remain valid for the text before the change and may be reused if restyling
+// from the change reproduces them.
+void Document::ModifiedText(Sci_Position pos, Sci_Position lengthInserted, Sci_Position lengthDeleted) {
+	// Restyle from the character before a deletion at the end of the document
+	const Sci_Position posStyle = ((pos < Length()) || (pos == 0)) ? pos : pos - 1;
+	if (endStyled > posStyle) {
+		// Styles kept from an earlier edit are beyond endStyled so continue to wait for
+		// styling to reach them. Otherwise keep the styles after this change.
+		if (reuseStart >= reuseEnd) {
+			reuseStart = pos;
+			reuseEnd = endStyled;
+		}
+		endStyled = posStyle;
+	}
+	if (pos < reuseEnd) {
+		// Only the text after the change and the styles after it are kept
+		if (reuseStart < pos + lengthDeleted)
+			reuseStart = pos + lengthDeleted;
+		if (reuseEnd <= reuseStart) {
+			DiscardReusableStyles();
+		} else {
+			reuseStart += lengthInserted - lengthDeleted;
+			reuseEnd += lengthInserted - lengthDeleted;
+		}
+	}
+	if (pli)
+		pli->CancelBackground();
 }
 
 void Document::CheckReadOnly() {
@@ -879,7 +1942,7 @@ void Document::CheckReadOnly() {
 // Document only modified by gateways DeleteChars, InsertString, Undo, Redo, and SetStyleAt.
 // SetStyleAt does not change the persistent state of a document
 
-bool Document::DeleteChars(int pos, int len) {
+bool Document::DeleteChars(Sci_Position pos, Sci_Position len) {
 	if (len <= 0)
 		return false;
 	if ((pos + len) > Length())
@@ -895,16 +1958,13 @@ bool Document::DeleteChars(int pos, int len) {
 			        SC_MOD_BEFOREDELETE | SC_PERFORMED_USER,
 			        pos, len,
 			        0, 0));
-			int prevLinesTotal = LinesTotal();
+			Sci_Position prevLinesTotal = LinesTotal();
 			bool startSavePoint = cb.IsSavePoint();
 			bool startSequence = false;
 			const char *text = cb.DeleteChars(pos, len, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			if ((pos < Length()) || (pos == 0))
-				ModifiedAt(pos);
-			else
-				ModifiedAt(pos-1);
+			ModifiedText(pos, 0, len);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_DELETETEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -919,7 +1979,7 @@ bool Document::DeleteChars(int pos, int len) {
 /**
  * Insert a string with a length.
  */
-bool Document::InsertString(int position, const char *s, int insertLength) {
+bool Document::InsertString(Sci_Position position, const char *s, Sci_Position insertLength) {
 	if (insertLength <= 0) {
 		return false;
 	}
@@ -934,13 +1994,13 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 			        SC_MOD_BEFOREINSERT | SC_PERFORMED_USER,
 			        position, insertLength,
 			        0, s));
-			int prevLinesTotal = LinesTotal();
+			Sci_Position prevLinesTotal = LinesTotal();
 			bool startSavePoint = cb.IsSavePoint();
 			bool startSequence = false;
 			const char *text = cb.InsertString(position, s, insertLength, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			ModifiedAt(position);
+			ModifiedText(position, insertLength, 0);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -952,9 +2012,9 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 	return !cb.IsReadOnly();
 }
 
-int SCI_METHOD Document::AddData(char *data, int length) {
+int SCI_METHOD Document::AddData(char *data, Sci_Position length) {
 	try {
-		int position = Length();
+		Sci_Position position = Length();
 		InsertString(position,data, length);
 	} catch (std::bad_alloc &) {
 		return SC_STATUS_BADALLOC;
@@ -968,6 +2028,24 @@ void * SCI_METHOD Document::ConvertToDocument() {
 	return this;
 }
 
+// Base an empty document on a mapped file so the text is not copied when loading.
+// The document is made read-only; if that is cleared, edited spans are copied.
+bool Document::UseMappedFile(MappedFile *file) {
+	if (!cb.UseMappedFile(file))
+		return false;
+	cb.SetReadOnly(true);
+	return true;
+}
+
+// Replace the undo history with one saved for the same text.
+// Takes ownership of file when successful.
+bool Document::LoadUndoHistory(MappedFile *file) {
+	if (!cb.LoadUndoHistory(file))
+		return false;
+	NotifySavePoint(cb.IsSavePoint());
+	return true;
+}
+
 int Document::Undo() {
 	int newPos = -1;
 	CheckReadOnly();
@@ -983,7 +2061,7 @@ int Document::Undo() {
 			int prevRemoveActionPos = -1;
 			int prevRemoveActionLen = 0;
 			for (int step = 0; step < steps; step++) {
-				const int prevLinesTotal = LinesTotal();
+				const Sci_Position prevLinesTotal = LinesTotal();
 				const Action &action = cb.GetUndoStep();
 				if (action.at == removeAction) {
 					NotifyModified(DocModification(
@@ -1004,7 +2082,11 @@ int Document::Undo() {
 				}
 				cb.PerformUndoStep();
 				if (action.at != containerAction) {
-					ModifiedAt(action.position);
+					// With undo, a removal inserts text and an insertion deletes it
+					if (action.at == removeAction)
+						ModifiedText(action.position, action.lenData, 0);
+					else
+						ModifiedText(action.position, 0, action.lenData);
 					newPos = action.position;
 				}
 
@@ -1063,7 +2145,7 @@ int Document::Redo() {
 			bool multiLine = false;
 			int steps = cb.StartRedo();
 			for (int step = 0; step < steps; step++) {
-				const int prevLinesTotal = LinesTotal();
+				const Sci_Position prevLinesTotal = LinesTotal();
 				const Action &action = cb.GetRedoStep();
 				if (action.at == insertAction) {
 					NotifyModified(DocModification(
@@ -1078,7 +2160,10 @@ int Document::Redo() {
 				}
 				cb.PerformRedoStep();
 				if (action.at != containerAction) {
-					ModifiedAt(action.position);
+					if (action.at == insertAction)
+						ModifiedText(action.position, action.lenData, 0);
+					else
+						ModifiedText(action.position, 0, action.lenData);
 					newPos = action.position;
 				}
 
@@ -1116,7 +2201,7 @@ int Document::Redo() {
 /**
  * Insert a single character.
  */
-bool Document::InsertChar(int pos, char ch) {
+bool Document::InsertChar(Sci_Position pos, char ch) {
 	char chs[1];
 	chs[0] = ch;
 	return InsertString(pos, chs, 1);
@@ -1125,21 +2210,21 @@ bool Document::InsertChar(int pos, char ch) {
 /**
  * Insert a null terminated string.
  */
-bool Document::InsertCString(int position, const char *s) {
+bool Document::InsertCString(Sci_Position position, const char *s) {
 	return InsertString(position, s, static_cast<int>(s ? strlen(s) : 0));
 }
 
-void Document::DelChar(int pos) {
+void Document::DelChar(Sci_Position pos) {
 	DeleteChars(pos, LenChar(pos));
 }
 
-void Document::DelCharBack(int pos) {
+void Document::DelCharBack(Sci_Position pos) {
 	if (pos <= 0) {
 		return;
 	} else if (IsCrLf(pos - 2)) {
 		DeleteChars(pos - 2, 2);
 	} else if (dbcsCodePage) {
-		int startChar = NextPosition(pos, -1);
+		Sci_Position startChar = NextPosition(pos, -1);
 		DeleteChars(startChar, pos - startChar);
 	} else {
 		DeleteChars(pos - 1, 1);
@@ -1165,11 +2250,11 @@ static std::string CreateIndentation(int indent, int tabSize, bool insertSpaces)
 	return indentation;
 }
 
-int SCI_METHOD Document::GetLineIndentation(int line) {
+int SCI_METHOD Document::GetLineIndentation(Sci_Position line) {
 	int indent = 0;
 	if ((line >= 0) && (line < LinesTotal())) {
-		int lineStart = LineStart(line);
-		int length = Length();
+		Sci_Position lineStart = LineStart(line);
+		Sci_Position length = Length();
 		for (int i = lineStart; i < length; i++) {
 			char ch = cb.CharAt(i);
 			if (ch == ' ')
@@ -1183,34 +2268,34 @@ int SCI_METHOD Document::GetLineIndentation(int line) {
 	return indent;
 }
 
-void Document::SetLineIndentation(int line, int indent) {
+void Document::SetLineIndentation(Sci_Position line, int indent) {
 	int indentOfLine = GetLineIndentation(line);
 	if (indent < 0)
 		indent = 0;
 	if (indent != indentOfLine) {
 		std::string linebuf = CreateIndentation(indent, tabInChars, !useTabs);
-		int thisLineStart = LineStart(line);
-		int indentPos = GetLineIndentPosition(line);
+		Sci_Position thisLineStart = LineStart(line);
+		Sci_Position indentPos = GetLineIndentPosition(line);
 		UndoGroup ug(this);
 		DeleteChars(thisLineStart, indentPos - thisLineStart);
 		InsertCString(thisLineStart, linebuf.c_str());
 	}
 }
 
-int Document::GetLineIndentPosition(int line) const {
+Sci_Position Document::GetLineIndentPosition(Sci_Position line) const {
 	if (line < 0)
 		return 0;
-	int pos = LineStart(line);
-	int length = Length();
+	Sci_Position pos = LineStart(line);
+	Sci_Position length = Length();
 	while ((pos < length) && IsSpaceOrTab(cb.CharAt(pos))) {
 		pos++;
 	}
 	return pos;
 }
 
-int Document::GetColumn(int pos) {
+int Document::GetColumn(Sci_Position pos) {
 	int column = 0;
-	int line = LineFromPosition(pos);
+	Sci_Position line = LineFromPosition(pos);
 	if ((line >= 0) && (line < LinesTotal())) {
 		for (int i = LineStart(line); i < pos;) {
 			char ch = cb.CharAt(i);
@@ -1232,7 +2317,7 @@ int Document::GetColumn(int pos) {
 	return column;
 }
 
-int Document::CountCharacters(int startPos, int endPos) {
+Sci_Position Document::CountCharacters(Sci_Position startPos, Sci_Position endPos) {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
 	int count = 0;
@@ -1246,8 +2331,79 @@ int Document::CountCharacters(int startPos, int endPos) {
 	return count;
 }
 
-int Document::FindColumn(int line, int column) {
-	int position = LineStart(line);
+// Count the characters as UTF-32 or UTF-16 code units between two positions
+// by examining each character.
+Sci_Position Document::CountUnits(Sci_Position startPos, Sci_Position endPos, int lineCharacterIndex) const {
+	if (SC_CP_UTF8 != dbcsCodePage)
+		return endPos - startPos;
+	Sci_Position count = 0;
+	Sci_Position pos = startPos;
+	while (pos < endPos) {
+		Sci_Position width = 1;
+		const int character = GetCharacterAndWidth(pos, &width);
+		count += ((lineCharacterIndex == SC_LINECHARACTERINDEX_UTF16) && (character >= 0x10000)) ? 2 : 1;
+		pos += width;
+	}
+	return count;
+}
+
+int Document::LineCharacterIndex() const {
+	return cb.LineCharacterIndex();
+}
+
+void Document::AllocateLineCharacterIndex(int lineCharacterIndex) {
+	cb.AllocateLineCharacterIndex(lineCharacterIndex);
+}
+
+void Document::ReleaseLineCharacterIndex(int lineCharacterIndex) {
+	cb.ReleaseLineCharacterIndex(lineCharacterIndex);
+}
+
+// The character index conversions use the line character index when allocated
+// and otherwise count from the start of the document.
+
+Sci_Position Document::IndexLineStart(Sci_Position line, int lineCharacterIndex) const {
+	if ((SC_CP_UTF8 != dbcsCodePage) || (cb.LineCharacterIndex() & lineCharacterIndex))
+		return cb.IndexLineStart(line, lineCharacterIndex);
+	return CountUnits(0, LineStart(line), lineCharacterIndex);
+}
+
+Sci_Position Document::LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const {
+	if ((SC_CP_UTF8 != dbcsCodePage) || (cb.LineCharacterIndex() & lineCharacterIndex))
+		return cb.LineFromPositionIndex(pos, lineCharacterIndex);
+	return LineFromPosition(PositionFromIndex(pos, lineCharacterIndex));
+}
+
+Sci_Position Document::IndexFromPosition(Sci_Position pos, int lineCharacterIndex) const {
+	const Sci_Position line = LineFromPosition(pos);
+	return IndexLineStart(line, lineCharacterIndex) + CountUnits(LineStart(line), pos, lineCharacterIndex);
+}
+
+Sci_Position Document::PositionFromIndex(Sci_Position index, int lineCharacterIndex) const {
+	if (SC_CP_UTF8 != dbcsCodePage)
+		return ClampPositionIntoDocument(index);
+	Sci_Position pos = 0;
+	Sci_Position indexPos = 0;
+	if (cb.LineCharacterIndex() & lineCharacterIndex) {
+		const Sci_Position line = cb.LineFromPositionIndex(index, lineCharacterIndex);
+		pos = LineStart(line);
+		indexPos = cb.IndexLineStart(line, lineCharacterIndex);
+	}
+	const Sci_Position length = Length();
+	while ((pos < length) && (indexPos < index)) {
+		Sci_Position width = 1;
+		const int character = GetCharacterAndWidth(pos, &width);
+		const Sci_Position units = ((lineCharacterIndex == SC_LINECHARACTERINDEX_UTF16) && (character >= 0x10000)) ? 2 : 1;
+		if (indexPos + units > index)
+			break;	// Inside a surrogate pair
+		indexPos += units;
+		pos += width;
+	}
+	return pos;
+}
+
+Sci_Position Document::FindColumn(Sci_Position line, int column) {
+	Sci_Position position = LineStart(line);
 	if ((line >= 0) && (line < LinesTotal())) {
 		int columnCurrent = 0;
 		while ((columnCurrent < column) && (position < Length())) {
@@ -1270,7 +2426,7 @@ int Document::FindColumn(int line, int column) {
 	return position;
 }
 
-void Document::Indent(bool forwards, int lineBottom, int lineTop) {
+void Document::Indent(bool forwards, Sci_Position lineBottom, Sci_Position lineTop) {
 	// Dedent - suck white space off the front of the line to dedent by equivalent of a tab
 	for (int line = lineBottom; line >= lineTop; line--) {
 		int indentOfLine = GetLineIndentation(line);
@@ -1346,9 +2502,9 @@ void Document::ConvertLineEnds(int eolModeSet) {
 
 }
 
-bool Document::IsWhiteLine(int line) const {
+bool Document::IsWhiteLine(Sci_Position line) const {
 	int currentChar = LineStart(line);
-	int endLine = LineEnd(line);
+	Sci_Position endLine = LineEnd(line);
 	while (currentChar < endLine) {
 		if (cb.CharAt(currentChar) != ' ' && cb.CharAt(currentChar) != '\t') {
 			return false;
@@ -1358,8 +2514,8 @@ bool Document::IsWhiteLine(int line) const {
 	return true;
 }
 
-int Document::ParaUp(int pos) const {
-	int line = LineFromPosition(pos);
+Sci_Position Document::ParaUp(Sci_Position pos) const {
+	Sci_Position line = LineFromPosition(pos);
 	line--;
 	while (line >= 0 && IsWhiteLine(line)) { // skip empty lines
 		line--;
@@ -1371,8 +2527,8 @@ int Document::ParaUp(int pos) const {
 	return LineStart(line);
 }
 
-int Document::ParaDown(int pos) const {
-	int line = LineFromPosition(pos);
+Sci_Position Document::ParaDown(Sci_Position pos) const {
+	Sci_Position line = LineFromPosition(pos);
 	while (line < LinesTotal() && !IsWhiteLine(line)) { // skip non-empty lines
 		line++;
 	}
@@ -1395,7 +2551,7 @@ CharClassify::cc Document::WordCharClass(unsigned char ch) const {
  * Used by commmands that want to select whole words.
  * Finds the start of word at pos when delta < 0 or the end of the word when delta >= 0.
  */
-int Document::ExtendWordSelect(int pos, int delta, bool onlyWordCharacters) {
+Sci_Position Document::ExtendWordSelect(Sci_Position pos, int delta, bool onlyWordCharacters) {
 	CharClassify::cc ccStart = CharClassify::ccWord;
 	if (delta < 0) {
 		if (!onlyWordCharacters)
@@ -1418,7 +2574,7 @@ int Document::ExtendWordSelect(int pos, int delta, bool onlyWordCharacters) {
  * additional movement to transit white space.
  * Used by cursor movement by word commands.
  */
-int Document::NextWordStart(int pos, int delta) {
+Sci_Position Document::NextWordStart(Sci_Position pos, int delta) {
 	if (delta < 0) {
 		while (pos > 0 && (WordCharClass(cb.CharAt(pos - 1)) == CharClassify::ccSpace))
 			pos--;
@@ -1445,7 +2601,7 @@ int Document::NextWordStart(int pos, int delta) {
  * additional movement to transit white space.
  * Used by cursor movement by word commands.
  */
-int Document::NextWordEnd(int pos, int delta) {
+Sci_Position Document::NextWordEnd(Sci_Position pos, int delta) {
 	if (delta < 0) {
 		if (pos > 0) {
 			CharClassify::cc ccStart = WordCharClass(cb.CharAt(pos-1));
@@ -1476,7 +2632,7 @@ int Document::NextWordEnd(int pos, int delta) {
  * Check that the character at the given position is a word or punctuation character and that
  * the previous character is of a different character class.
  */
-bool Document::IsWordStartAt(int pos) const {
+bool Document::IsWordStartAt(Sci_Position pos) const {
 	if (pos > 0) {
 		CharClassify::cc ccPos = WordCharClass(CharAt(pos));
 		return (ccPos == CharClassify::ccWord || ccPos == CharClassify::ccPunctuation) &&
@@ -1489,7 +2645,7 @@ bool Document::IsWordStartAt(int pos) const {
  * Check that the character at the given position is a word or punctuation character and that
  * the next character is of a different character class.
  */
-bool Document::IsWordEndAt(int pos) const {
+bool Document::IsWordEndAt(Sci_Position pos) const {
 	if (pos < Length()) {
 		CharClassify::cc ccPrev = WordCharClass(CharAt(pos-1));
 		return (ccPrev == CharClassify::ccWord || ccPrev == CharClassify::ccPunctuation) &&
@@ -1502,11 +2658,11 @@ bool Document::IsWordEndAt(int pos) const {
  * Check that the given range is has transitions between character classes at both
  * ends and where the characters on the inside are word or punctuation characters.
  */
-bool Document::IsWordAt(int start, int end) const {
+bool Document::IsWordAt(Sci_Position start, Sci_Position end) const {
 	return IsWordStartAt(start) && IsWordEndAt(end);
 }
 
-bool Document::MatchesWordOptions(bool word, bool wordStart, int pos, int length) const {
+bool Document::MatchesWordOptions(bool word, bool wordStart, Sci_Position pos, Sci_Position length) const {
 	return (!word && !wordStart) ||
 			(word && IsWordAt(pos, pos + length)) ||
 			(wordStart && IsWordStartAt(pos));
@@ -1526,7 +2682,7 @@ void Document::SetCaseFolder(CaseFolder *pcf_) {
  * searches (just pass minPos > maxPos to do a backward search)
  * Has not been tested with backwards DBCS searches yet.
  */
-long Document::FindText(int minPos, int maxPos, const char *search,
+long Document::FindText(Sci_Position minPos, Sci_Position maxPos, const char *search,
                         bool caseSensitive, bool word, bool wordStart, bool regExp, int flags,
                         int *length) {
 	if (*length <= 0)
@@ -1549,7 +2705,7 @@ long Document::FindText(int minPos, int maxPos, const char *search,
 
 		//Platform::DebugPrintf("Find %d %d %s %d\n", startPos, endPos, ft->lpstrText, lengthFind);
 		const int limitPos = Platform::Maximum(startPos, endPos);
-		int pos = startPos;
+		Sci_Position pos = startPos;
 		if (!forward) {
 			// Back all of a character
 			pos = NextPosition(pos, increment);
@@ -1689,7 +2845,7 @@ const char *Document::SubstituteByPosition(const char *text, int *length) {
 		return 0;
 }
 
-int Document::LinesTotal() const {
+Sci_Position Document::LinesTotal() const {
 	return cb.Lines();
 }
 
@@ -1710,19 +2866,23 @@ void Document::SetStylingBits(int bits) {
 	stylingBitsMask = (1 << stylingBits) - 1;
 }
 
-void SCI_METHOD Document::StartStyling(int position, char mask) {
+void SCI_METHOD Document::StartStyling(Sci_Position position, char mask) {
 	stylingMask = mask;
 	endStyled = position;
 }
 
-bool SCI_METHOD Document::SetStyleFor(int length, char style) {
+bool SCI_METHOD Document::SetStyleFor(Sci_Position length, char style) {
 	if (enteredStyling != 0) {
 		return false;
 	} else {
 		enteredStyling++;
 		style &= stylingMask;
-		int prevEndStyled = endStyled;
+		Sci_Position prevEndStyled = endStyled;
 		if (cb.SetStyleFor(endStyled, length, style, stylingMask)) {
+			if (trackingChanges)
+				endStyleChanged = std::max(endStyleChanged, prevEndStyled + length);
+			else if ((prevEndStyled + length > reuseStart) && (prevEndStyled < reuseEnd))
+				DiscardReusableStyles();
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 			                   prevEndStyled, length);
 			NotifyModified(mh);
@@ -1733,14 +2893,14 @@ bool SCI_METHOD Document::SetStyleFor(int length, char style) {
 	}
 }
 
-bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
+bool SCI_METHOD Document::SetStyles(Sci_Position length, const char *styles) {
 	if (enteredStyling != 0) {
 		return false;
 	} else {
 		enteredStyling++;
 		bool didChange = false;
-		int startMod = 0;
-		int endMod = 0;
+		Sci_Position startMod = 0;
+		Sci_Position endMod = 0;
 		for (int iPos = 0; iPos < length; iPos++, endStyled++) {
 			PLATFORM_ASSERT(endStyled < Length());
 			if (cb.SetStyleAt(endStyled, styles[iPos], stylingMask)) {
@@ -1752,6 +2912,10 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 			}
 		}
 		if (didChange) {
+			if (trackingChanges)
+				endStyleChanged = std::max(endStyleChanged, endMod + 1);
+			else if ((endMod >= reuseStart) && (startMod < reuseEnd))
+				DiscardReusableStyles();
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 			                   startMod, endMod - startMod + 1);
 			NotifyModified(mh);
@@ -1761,13 +2925,17 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 	}
 }
 
-void Document::EnsureStyledTo(int pos) {
+void Document::EnsureStyledTo(Sci_Position pos) {
 	if ((enteredStyling == 0) && (pos > GetEndStyled())) {
 		IncrementStyleClock();
 		if (pli && !pli->UseContainerLexing()) {
-			int lineEndStyled = LineFromPosition(GetEndStyled());
-			int endStyledTo = LineStart(lineEndStyled);
-			pli->Colourise(endStyledTo, pos);
+			// Use the styles produced in the background before styling the rest here
+			pli->FinishBackground();
+			if (pos > GetEndStyled()) {
+				Sci_Position lineEndStyled = LineFromPosition(GetEndStyled());
+				Sci_Position endStyledTo = LineStart(lineEndStyled);
+				pli->Colourise(endStyledTo, pos);
+			}
 		} else {
 			// Ask the watchers to style, and stop as soon as one responds.
 			for (std::vector<WatcherWithUserData>::iterator it = watchers.begin();
@@ -1778,23 +2946,97 @@ void Document::EnsureStyledTo(int pos) {
 	}
 }
 
+void Document::DiscardReusableStyles() {
+	reuseStart = 0;
+	reuseEnd = 0;
+}
+
+void Document::TrackStylingChanges(bool track) {
+	trackingChanges = track;
+	endStyleChanged = -1;
+	lineStateChanged = -1;
+	lineLevelChanged = -1;
+	reuseBreak = 0;
+	if (!track) {
+		// Styles before endStyled are from this pass
+		if (reuseEnd <= endStyled)
+			DiscardReusableStyles();
+		else
+			reuseStart = std::max(reuseStart, endStyled);
+	}
+}
+
+bool Document::StylingConvergedAt(Sci_Position pos, bool levels) const {
+	if ((reuseStart >= reuseEnd) || (pos > reuseEnd))
+		return false;
+	const Sci_Position line = LineFromPosition(pos);
+	if (LineStart(line) != pos)
+		return false;
+	// The first line after the start of the earlier styles and after the last change
+	Sci_Position lineSame = std::max(LineFromPosition(reuseStart) + 1, lineStateChanged + 1);
+	if (endStyleChanged > 0)
+		lineSame = std::max(lineSame, LineFromPosition(endStyleChanged - 1) + 1);
+	if (levels)
+		lineSame = std::max(lineSame, lineLevelChanged + 1);
+	return (line - lineSame) >= convergeLines;
+}
+
+void Document::ReuseStylesTo(Sci_Position pos) {
+	if (endStyled < pos)
+		endStyled = pos;
+	TrackStylingChanges(false);
+}
+
+bool Document::CanStyleInBackground() const {
+	return pli && pli->CanStyleInBackground();
+}
+
+void Document::StyleInBackground(Sci_Position priorityEnd) {
+	if ((enteredStyling == 0) && pli)
+		pli->StyleInBackground(priorityEnd);
+}
+
+bool Document::CommitBackgroundStyles() {
+	return (enteredStyling == 0) && pli && pli->CommitBackground();
+}
+
+void Document::FinishBackgroundStyles() {
+	if ((enteredStyling == 0) && pli)
+		pli->FinishBackground();
+}
+
+void Document::SetLexingThreads(int threads) {
+	lexingThreads = std::max(threads, 1);
+}
+
 void Document::LexerChanged() {
+	DiscardReusableStyles();
 	// Tell the watchers the lexer has changed.
 	for (std::vector<WatcherWithUserData>::iterator it = watchers.begin(); it != watchers.end(); ++it) {
 		it->watcher->NotifyLexerChanged(this, it->userData);
 	}
 }
 
-int SCI_METHOD Document::SetLineState(int line, int state) {
-	int statePrevious = static_cast<LineState *>(perLineData[ldState])->SetLineState(line, state);
+int SCI_METHOD Document::SetLineState(Sci_Position line, int state) {
+	int statePrevious;
+	{
+		std::unique_lock<std::mutex> lock(lineDataLock->mutex);
+		statePrevious = static_cast<LineState *>(perLineData[ldState])->SetLineState(line, state);
+	}
 	if (state != statePrevious) {
+		if (trackingChanges)
+			lineStateChanged = std::max(lineStateChanged, line);
+		else if ((LineStart(line + 1) > reuseStart) && (LineStart(line) < reuseEnd))
+			DiscardReusableStyles();
 		DocModification mh(SC_MOD_CHANGELINESTATE, LineStart(line), 0, 0, 0, line);
 		NotifyModified(mh);
 	}
 	return statePrevious;
 }
 
-int SCI_METHOD Document::GetLineState(int line) const {
+int SCI_METHOD Document::GetLineState(Sci_Position line) const {
+	// Reading may allocate line states
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
 	return static_cast<LineState *>(perLineData[ldState])->GetLineState(line);
 }
 
@@ -1802,29 +3044,51 @@ int Document::GetMaxLineState() {
 	return static_cast<LineState *>(perLineData[ldState])->GetMaxLineState();
 }
 
-void SCI_METHOD Document::ChangeLexerState(int start, int end) {
+void Document::CopyLineData(Sci_Position lineFirst, Sci_Position lines, int *levels, int *lineStates) {
+	std::unique_lock<std::mutex> lock(lineDataLock->mutex);
+	const LineLevels *pll = static_cast<LineLevels *>(perLineData[ldLevels]);
+	LineState *pls = static_cast<LineState *>(perLineData[ldState]);
+	const Sci_Position maxLineState = pls->GetMaxLineState();
+	for (Sci_Position i = 0; i < lines; i++) {
+		const Sci_Position line = lineFirst + i;
+		levels[i] = pll->GetLevel(line);
+		// Line states are only allocated by the document when used
+		lineStates[i] = (line < maxLineState) ? pls->GetLineState(line) : 0;
+	}
+}
+
+void SCI_METHOD Document::ChangeLexerState(Sci_Position start, Sci_Position end) {
+	// A change reported for text not yet styled in this pass only stops the earlier styles
+	// being kept from there. Otherwise the lexer changed state it holds for later text so
+	// styles there can not be kept.
+	if (trackingChanges && (start > endStyled)) {
+		if ((reuseBreak <= endStyled) || (start < reuseBreak))
+			reuseBreak = start;
+	} else {
+		DiscardReusableStyles();
+	}
 	DocModification mh(SC_MOD_LEXERSTATE, start, end-start, 0, 0, 0);
 	NotifyModified(mh);
 }
 
-StyledText Document::MarginStyledText(int line) const {
+StyledText Document::MarginStyledText(Sci_Position line) const {
 	LineAnnotation *pla = static_cast<LineAnnotation *>(perLineData[ldMargin]);
 	return StyledText(pla->Length(line), pla->Text(line),
 		pla->MultipleStyles(line), pla->Style(line), pla->Styles(line));
 }
 
-void Document::MarginSetText(int line, const char *text) {
+void Document::MarginSetText(Sci_Position line, const char *text) {
 	static_cast<LineAnnotation *>(perLineData[ldMargin])->SetText(line, text);
 	DocModification mh(SC_MOD_CHANGEMARGIN, LineStart(line), 0, 0, 0, line);
 	NotifyModified(mh);
 }
 
-void Document::MarginSetStyle(int line, int style) {
+void Document::MarginSetStyle(Sci_Position line, int style) {
 	static_cast<LineAnnotation *>(perLineData[ldMargin])->SetStyle(line, style);
 	NotifyModified(DocModification(SC_MOD_CHANGEMARGIN, LineStart(line), 0, 0, 0, line));
 }
 
-void Document::MarginSetStyles(int line, const unsigned char *styles) {
+void Document::MarginSetStyles(Sci_Position line, const unsigned char *styles) {
 	static_cast<LineAnnotation *>(perLineData[ldMargin])->SetStyles(line, styles);
 	NotifyModified(DocModification(SC_MOD_CHANGEMARGIN, LineStart(line), 0, 0, 0, line));
 }
@@ -1837,13 +3101,13 @@ void Document::MarginClearAll() {
 	static_cast<LineAnnotation *>(perLineData[ldMargin])->ClearAll();
 }
 
-StyledText Document::AnnotationStyledText(int line) const {
+StyledText Document::AnnotationStyledText(Sci_Position line) const {
 	LineAnnotation *pla = static_cast<LineAnnotation *>(perLineData[ldAnnotation]);
 	return StyledText(pla->Length(line), pla->Text(line),
 		pla->MultipleStyles(line), pla->Style(line), pla->Styles(line));
 }
 
-void Document::AnnotationSetText(int line, const char *text) {
+void Document::AnnotationSetText(Sci_Position line, const char *text) {
 	if (line >= 0 && line < LinesTotal()) {
 		const int linesBefore = AnnotationLines(line);
 		static_cast<LineAnnotation *>(perLineData[ldAnnotation])->SetText(line, text);
@@ -1854,19 +3118,19 @@ void Document::AnnotationSetText(int line, const char *text) {
 	}
 }
 
-void Document::AnnotationSetStyle(int line, int style) {
+void Document::AnnotationSetStyle(Sci_Position line, int style) {
 	static_cast<LineAnnotation *>(perLineData[ldAnnotation])->SetStyle(line, style);
 	DocModification mh(SC_MOD_CHANGEANNOTATION, LineStart(line), 0, 0, 0, line);
 	NotifyModified(mh);
 }
 
-void Document::AnnotationSetStyles(int line, const unsigned char *styles) {
+void Document::AnnotationSetStyles(Sci_Position line, const unsigned char *styles) {
 	if (line >= 0 && line < LinesTotal()) {
 		static_cast<LineAnnotation *>(perLineData[ldAnnotation])->SetStyles(line, styles);
 	}
 }
 
-int Document::AnnotationLines(int line) const {
+int Document::AnnotationLines(Sci_Position line) const {
 	return static_cast<LineAnnotation *>(perLineData[ldAnnotation])->Lines(line);
 }
 
@@ -1882,7 +3146,7 @@ void Document::IncrementStyleClock() {
 	styleClock = (styleClock + 1) % 0x100000;
 }
 
-void SCI_METHOD Document::DecorationFillRange(int position, int value, int fillLength) {
+void SCI_METHOD Document::DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) {
 	if (decorations.FillRange(position, value, fillLength)) {
 		DocModification mh(SC_MOD_CHANGEINDICATOR | SC_PERFORMED_USER,
 							position, fillLength);
@@ -1937,7 +3201,7 @@ bool Document::IsWordPartSeparator(char ch) const {
 	return (WordCharClass(ch) == CharClassify::ccWord) && IsPunctuation(ch);
 }
 
-int Document::WordPartLeft(int pos) {
+Sci_Position Document::WordPartLeft(Sci_Position pos) {
 	if (pos > 0) {
 		--pos;
 		char startChar = cb.CharAt(pos);
@@ -1987,9 +3251,9 @@ int Document::WordPartLeft(int pos) {
 	return pos;
 }
 
-int Document::WordPartRight(int pos) {
+Sci_Position Document::WordPartRight(Sci_Position pos) {
 	char startChar = cb.CharAt(pos);
-	int length = Length();
+	Sci_Position length = Length();
 	if (IsWordPartSeparator(startChar)) {
 		while (pos < length && IsWordPartSeparator(cb.CharAt(pos)))
 			++pos;
@@ -2031,7 +3295,7 @@ bool IsLineEndChar(char c) {
 	return (c == '\n' || c == '\r');
 }
 
-int Document::ExtendStyleRange(int pos, int delta, bool singleLine) {
+Sci_Position Document::ExtendStyleRange(Sci_Position pos, int delta, bool singleLine) {
 	int sStart = cb.StyleAt(pos);
 	if (delta < 0) {
 		while (pos > 0 && (cb.StyleAt(pos) == sStart) && (!singleLine || !IsLineEndChar(cb.CharAt(pos))))
@@ -2068,7 +3332,7 @@ static char BraceOpposite(char ch) {
 }
 
 // TODO: should be able to extend styled region to find matching brace
-int Document::BraceMatch(int position, int /*maxReStyle*/) {
+Sci_Position Document::BraceMatch(Sci_Position position, int /*maxReStyle*/) {
 	char chBrace = CharAt(position);
 	char chSeek = BraceOpposite(chBrace);
 	if (chSeek == '\0')
@@ -2175,7 +3439,7 @@ long BuiltinRegex::FindText(Document *doc, int minPos, int maxPos, const char *s
 		lineRangeStart--;
 		startPos = doc->LineEnd(lineRangeStart);
 	}
-	int pos = -1;
+	Sci_Position pos = -1;
 	int lenRet = 0;
 	char searchEnd = s[*length - 1];
 	char searchEndPrev = (*length > 1) ? s[*length - 2] : '\0';
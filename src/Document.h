@@ -16,7 +16,7 @@ namespace Scintilla {
  * A Position is a position within a document between two characters or at the beginning or end.
  * Sometimes used as a character index where it identifies the character after the position.
  */
-typedef int Position;
+typedef Sci_Position Position;
 const Position invalidPosition = -1;
 
 enum EncodingFamily { efEightBit, efUnicode, efDBCS };
@@ -158,27 +158,67 @@ public:
 };
 
 class Document;
+class BackgroundLexer;
+class LineDataLock;
 
 class LexInterface {
 protected:
 	Document *pdoc;
 	ILexer *instance;
 	bool performingStyle;	///< Prevent reentrance
+	BackgroundLexer *background;	///< Created when first styling in the background
+	ISnapshot *snapshotLast;	///< Held so the next snapshot shares its unchanged blocks
+	ISnapshot *TakeSnapshot();
+	bool LexInRanges(Sci_Position start, Sci_Position end, int styleStart);
+	bool LexUntilConverged(Sci_Position start, Sci_Position end, int styleStart);
 public:
-	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false) {
+	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false), background(0), snapshotLast(0) {
 	}
-	virtual ~LexInterface() {
-	}
-	void Colourise(int start, int end);
+	virtual ~LexInterface();
+	void Colourise(Sci_Position start, Sci_Position end);
 	int LineEndTypesSupported();
 	bool UseContainerLexing() const {
 		return instance == 0;
 	}
+
+	/// Styling in the background runs the lexer on a worker thread over a snapshot of the
+	/// document. Styles and fold levels are committed in chunks on the UI thread and are
+	/// discarded if the text has changed. The lexer must not be changed by the UI thread
+	/// without first stopping or finishing the background pass. Methods that only read the
+	/// lexer's settings may instead pause the pass with a BackgroundPause.
+	bool CanStyleInBackground() const;
+	/// Start or continue a pass to the end of the document, styling up to priorityEnd first.
+	void StyleInBackground(Sci_Position priorityEnd);
+	/// Commit the chunks that are ready and return true while more are expected.
+	bool CommitBackground();
+	/// Wait for the current chunk then commit what is ready.
+	void FinishBackground();
+	/// Wait for the current chunk and discard all background results.
+	void StopBackground();
+	/// The text changed so results from the current pass are no longer wanted.
+	void CancelBackground();
+	/// Wait for the current chunk and hold the pass before the next, keeping its results.
+	void PauseBackground();
+	void ResumeBackground();
+};
+
+/// Pauses the background pass while in scope.
+class BackgroundPause {
+	LexInterface *pli;
+	// Private so BackgroundPause objects can not be copied
+	BackgroundPause(const BackgroundPause &);
+public:
+	explicit BackgroundPause(LexInterface *pli_) : pli(pli_) {
+		pli->PauseBackground();
+	}
+	~BackgroundPause() {
+		pli->ResumeBackground();
+	}
 };
 
 /**
  */
-class Document : PerLine, public IDocumentWithLineEnd, public ILoader {
+class Document : PerLine, public IDocumentWithRangePointer, public ILoader {
 
 public:
 	/** Used to pair watcher pointer with user data. */
@@ -195,21 +235,38 @@ public:
 
 private:
 	int refCount;
+	int options;
 	CellBuffer cb;
 	CharClassify charClass;
 	CaseFolder *pcf;
 	char stylingMask;
-	int endStyled;
+	Sci_Position endStyled;
 	int styleClock;
 	int enteredModification;
 	int enteredStyling;
 	int enteredReadOnlyCount;
+	int lexingThreads;
+
+	// After an edit, the styles from an earlier pass remain for the unchanged text from
+	// reuseStart to reuseEnd. Styling that reproduces them for enough lines can stop.
+	Sci_Position reuseStart;
+	Sci_Position reuseEnd;
+	// While tracking, the last changes made by styling are recorded instead of discarding
+	// the reusable styles.
+	bool trackingChanges;
+	Sci_Position endStyleChanged;
+	Sci_Position lineStateChanged;
+	Sci_Position lineLevelChanged;
+	// While tracking, a lexer may report that the text from reuseBreak depends on state it
+	// changed so the earlier styles can only be kept up to there.
+	Sci_Position reuseBreak;
 
 	std::vector<WatcherWithUserData> watchers;
 
 	// ldSize is not real data - it is for dimensions and loops
 	enum lineData { ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldSize };
 	PerLine *perLineData[ldSize];
+	LineDataLock *lineDataLock;	///< Held while fold levels and line states change or are copied
 
 	bool matchesValid;
 	RegexSearchBase *regex;
@@ -234,7 +291,7 @@ public:
 
 	DecorationList decorations;
 
-	Document();
+	Document(int options_=0);
 	virtual ~Document();
 
 	int AddRef();
@@ -246,36 +303,49 @@ public:
 	int GetLineEndTypesAllowed() const { return cb.GetLineEndTypes(); }
 	bool SetLineEndTypesAllowed(int lineEndBitSet_);
 	int GetLineEndTypesActive() const { return cb.GetLineEndTypes(); }
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	int Options() const { return options; }
+	virtual void InsertLine(Sci_Position line);
+	virtual void InsertLines(Sci_Position line, Sci_Position lines);
+	virtual void RemoveLine(Sci_Position line);
 
 	int SCI_METHOD Version() const {
-		return dvLineEnd;
+		return dvRangePointer;
 	}
+	/// Increases with each change to the text. Not related to the interface Version.
+	int ContentVersion() const { return cb.ContentVersion(); }
+	/// A referenced view of the text, styles and lines that may be read on other threads
+	/// while editing continues. The caller must release it.
+	ISnapshot *Snapshot() { return cb.Snapshot(); }
+	/// Changes may be retrieved by version from the journal once a size is set.
+	void SetChangeJournalSize(int sizeLimit) { cb.SetChangeJournalSize(sizeLimit); }
+	int ChangeJournalSize() const { return cb.ChangeJournalSize(); }
+	void SetChangeJournalTextLimit(Sci_Position textLimit) { cb.SetChangeJournalTextLimit(textLimit); }
+	Sci_Position ChangeJournalTextLimit() const { return cb.ChangeJournalTextLimit(); }
+	const ChangeJournal &Journal() const { return cb.Journal(); }
 
 	void SCI_METHOD SetErrorStatus(int status);
 
-	int SCI_METHOD LineFromPosition(int pos) const;
-	int ClampPositionIntoDocument(int pos) const;
-	bool IsCrLf(int pos) const;
-	int LenChar(int pos);
-	bool InGoodUTF8(int pos, int &start, int &end) const;
-	int MovePositionOutsideChar(int pos, int moveDir, bool checkLineEnd=true);
-	int NextPosition(int pos, int moveDir) const;
-	bool NextCharacter(int &pos, int moveDir) const;	// Returns true if pos changed
-	int SCI_METHOD GetRelativePosition(int positionStart, int characterOffset) const;
-	int SCI_METHOD GetCharacterAndWidth(int position, int *pWidth) const;
+	Sci_Position SCI_METHOD LineFromPosition(Sci_Position pos) const;
+	Sci_Position ClampPositionIntoDocument(Sci_Position pos) const;
+	bool IsCrLf(Sci_Position pos) const;
+	int LenChar(Sci_Position pos);
+	bool InGoodUTF8(Sci_Position pos, int &start, int &end) const;
+	Sci_Position MovePositionOutsideChar(Sci_Position pos, int moveDir, bool checkLineEnd=true);
+	Sci_Position NextPosition(Sci_Position pos, int moveDir) const;
+	bool NextCharacter(Sci_Position &pos, int moveDir) const;	// Returns true if pos changed
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const;
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const;
 	int SCI_METHOD CodePage() const;
 	bool SCI_METHOD IsDBCSLeadByte(char ch) const;
 	int SafeSegment(const char *text, int length, int lengthSegment) const;
 	EncodingFamily CodePageFamily() const;
 
 	// Gateways to modifying document
-	void ModifiedAt(int pos);
+	void ModifiedAt(Sci_Position pos);
 	void CheckReadOnly();
-	bool DeleteChars(int pos, int len);
-	bool InsertString(int position, const char *s, int insertLength);
-	int SCI_METHOD AddData(char *data, int length);
+	bool DeleteChars(Sci_Position pos, Sci_Position len);
+	bool InsertString(Sci_Position position, const char *s, Sci_Position insertLength);
+	int SCI_METHOD AddData(char *data, Sci_Position length);
 	void * SCI_METHOD ConvertToDocument();
 	int Undo();
 	int Redo();
@@ -289,106 +359,147 @@ public:
 	void BeginUndoAction() { cb.BeginUndoAction(); }
 	void EndUndoAction() { cb.EndUndoAction(); }
 	void AddUndoAction(int token, bool mayCoalesce) { cb.AddUndoAction(token, mayCoalesce); }
+	void SetUndoMemoryLimit(Sci_Position memoryLimit) { cb.SetUndoMemoryLimit(memoryLimit); }
+	Sci_Position UndoMemoryLimit() const { return cb.UndoMemoryLimit(); }
+	void SetUndoStepLimit(int stepLimit) { cb.SetUndoStepLimit(stepLimit); }
+	int UndoStepLimit() const { return cb.UndoStepLimit(); }
+	Sci_Position UndoMemory() const { return cb.UndoMemory(); }
+	bool SaveUndoHistory(const char *path) const { return cb.SaveUndoHistory(path); }
+	bool LoadUndoHistory(MappedFile *file);
 	void SetSavePoint();
 	bool IsSavePoint() const { return cb.IsSavePoint(); }
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
-	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
-	int GapPosition() const { return cb.GapPosition(); }
-
-	int SCI_METHOD GetLineIndentation(int line);
-	void SetLineIndentation(int line, int indent);
-	int GetLineIndentPosition(int line) const;
-	int GetColumn(int position);
-	int CountCharacters(int startPos, int endPos);
-	int FindColumn(int line, int column);
-	void Indent(bool forwards, int lineBottom, int lineTop);
+	const char *RangePointer(Sci_Position position, Sci_Position rangeLength) { return cb.RangePointer(position, rangeLength); }
+	Sci_Position GapPosition() const { return cb.GapPosition(); }
+	const char * SCI_METHOD ContiguousRangePointer(Sci_Position position, Sci_Position *lengthContiguous) {
+		return cb.ContiguousRangePointer(position, *lengthContiguous);
+	}
+
+	int SCI_METHOD GetLineIndentation(Sci_Position line);
+	void SetLineIndentation(Sci_Position line, int indent);
+	Sci_Position GetLineIndentPosition(Sci_Position line) const;
+	int GetColumn(Sci_Position position);
+	Sci_Position CountCharacters(Sci_Position startPos, Sci_Position endPos);
+	Sci_Position CountUnits(Sci_Position startPos, Sci_Position endPos, int lineCharacterIndex) const;
+	int LineCharacterIndex() const;
+	void AllocateLineCharacterIndex(int lineCharacterIndex);
+	void ReleaseLineCharacterIndex(int lineCharacterIndex);
+	Sci_Position IndexLineStart(Sci_Position line, int lineCharacterIndex) const;
+	Sci_Position LineFromPositionIndex(Sci_Position pos, int lineCharacterIndex) const;
+	Sci_Position IndexFromPosition(Sci_Position pos, int lineCharacterIndex) const;
+	Sci_Position PositionFromIndex(Sci_Position index, int lineCharacterIndex) const;
+	Sci_Position FindColumn(Sci_Position line, int column);
+	void Indent(bool forwards, Sci_Position lineBottom, Sci_Position lineTop);
 	static std::string TransformLineEnds(const char *s, size_t len, int eolModeWanted);
 	void ConvertLineEnds(int eolModeSet);
 	void SetReadOnly(bool set) { cb.SetReadOnly(set); }
 	bool IsReadOnly() const { return cb.IsReadOnly(); }
 
-	bool InsertChar(int pos, char ch);
-	bool InsertCString(int position, const char *s);
-	void DelChar(int pos);
-	void DelCharBack(int pos);
+	bool InsertChar(Sci_Position pos, char ch);
+	bool InsertCString(Sci_Position position, const char *s);
+	void DelChar(Sci_Position pos);
+	void DelCharBack(Sci_Position pos);
 
-	char CharAt(int position) const { return cb.CharAt(position); }
-	void SCI_METHOD GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+	char CharAt(Sci_Position position) const { return cb.CharAt(position); }
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 		cb.GetCharRange(buffer, position, lengthRetrieve);
 	}
-	char SCI_METHOD StyleAt(int position) const { return cb.StyleAt(position); }
-	void GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const {
+	char SCI_METHOD StyleAt(Sci_Position position) const { return cb.StyleAt(position); }
+	void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 		cb.GetStyleRange(buffer, position, lengthRetrieve);
 	}
-	int GetMark(int line);
-	int MarkerNext(int lineStart, int mask) const;
-	int AddMark(int line, int markerNum);
-	void AddMarkSet(int line, int valueSet);
-	void DeleteMark(int line, int markerNum);
+	int GetMark(Sci_Position line);
+	Sci_Position MarkerNext(Sci_Position lineStart, int mask) const;
+	int AddMark(Sci_Position line, int markerNum);
+	void AddMarkSet(Sci_Position line, int valueSet);
+	void DeleteMark(Sci_Position line, int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	void DeleteAllMarks(int markerNum);
-	int LineFromHandle(int markerHandle);
-	int SCI_METHOD LineStart(int line) const;
-	int SCI_METHOD LineEnd(int line) const;
-	int LineEndPosition(int position) const;
-	bool IsLineEndPosition(int position) const;
-	bool IsPositionInLineEnd(int position) const;
-	int VCHomePosition(int position) const;
-
-	int SCI_METHOD SetLevel(int line, int level);
-	int SCI_METHOD GetLevel(int line) const;
+	Sci_Position LineFromHandle(int markerHandle);
+	Sci_Position SCI_METHOD LineStart(Sci_Position line) const;
+	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const;
+	Sci_Position LineEndPosition(Sci_Position position) const;
+	bool IsLineEndPosition(Sci_Position position) const;
+	bool IsPositionInLineEnd(Sci_Position position) const;
+	Sci_Position VCHomePosition(Sci_Position position) const;
+
+	int SCI_METHOD SetLevel(Sci_Position line, int level);
+	int SCI_METHOD GetLevel(Sci_Position line) const;
 	void ClearLevels();
-	int GetLastChild(int lineParent, int level=-1, int lastLine=-1);
-	int GetFoldParent(int line) const;
-	void GetHighlightDelimiters(HighlightDelimiter &hDelimiter, int line, int lastLine);
+	Sci_Position GetLastChild(Sci_Position lineParent, int level=-1, Sci_Position lastLine=-1);
+	Sci_Position GetFoldParent(Sci_Position line) const;
+	void GetHighlightDelimiters(HighlightDelimiter &hDelimiter, Sci_Position line, Sci_Position lastLine);
 
 	void Indent(bool forwards);
-	int ExtendWordSelect(int pos, int delta, bool onlyWordCharacters=false);
-	int NextWordStart(int pos, int delta);
-	int NextWordEnd(int pos, int delta);
-	int SCI_METHOD Length() const { return cb.Length(); }
-	void Allocate(int newSize) { cb.Allocate(newSize); }
-	bool MatchesWordOptions(bool word, bool wordStart, int pos, int length) const;
+	Sci_Position ExtendWordSelect(Sci_Position pos, int delta, bool onlyWordCharacters=false);
+	Sci_Position NextWordStart(Sci_Position pos, int delta);
+	Sci_Position NextWordEnd(Sci_Position pos, int delta);
+	Sci_Position SCI_METHOD Length() const { return cb.Length(); }
+	void Allocate(Sci_Position newSize) { cb.Allocate(newSize); }
+	bool UseMappedFile(MappedFile *file);
+	bool MatchesWordOptions(bool word, bool wordStart, Sci_Position pos, Sci_Position length) const;
 	bool HasCaseFolder(void) const;
 	void SetCaseFolder(CaseFolder *pcf_);
-	long FindText(int minPos, int maxPos, const char *search, bool caseSensitive, bool word,
+	long FindText(Sci_Position minPos, Sci_Position maxPos, const char *search, bool caseSensitive, bool word,
 		bool wordStart, bool regExp, int flags, int *length);
 	const char *SubstituteByPosition(const char *text, int *length);
-	int LinesTotal() const;
+	Sci_Position LinesTotal() const;
 
 	void SetDefaultCharClasses(bool includeWordClass);
 	void SetCharClasses(const unsigned char *chars, CharClassify::cc newCharClass);
 	int GetCharsOfClass(CharClassify::cc charClass, unsigned char *buffer);
 	void SetStylingBits(int bits);
-	void SCI_METHOD StartStyling(int position, char mask);
-	bool SCI_METHOD SetStyleFor(int length, char style);
-	bool SCI_METHOD SetStyles(int length, const char *styles);
-	int GetEndStyled() const { return endStyled; }
-	void EnsureStyledTo(int pos);
+	void SCI_METHOD StartStyling(Sci_Position position, char mask);
+	bool SCI_METHOD SetStyleFor(Sci_Position length, char style);
+	bool SCI_METHOD SetStyles(Sci_Position length, const char *styles);
+	Sci_Position GetEndStyled() const { return endStyled; }
+	void EnsureStyledTo(Sci_Position pos);
+	/// Styles from an earlier pass that may be kept when restyling reproduces them.
+	Sci_Position ReuseStart() const { return reuseStart; }
+	Sci_Position ReuseEnd() const { return reuseEnd; }
+	Sci_Position ReuseBreak() const { return reuseBreak; }
+	void DiscardReusableStyles();
+	void TrackStylingChanges(bool track);
+	/// True when styling through pos reproduced the earlier styles and line states, and
+	/// also the fold levels when levels is set, for enough lines before pos.
+	bool StylingConvergedAt(Sci_Position pos, bool levels) const;
+	/// Keep the earlier styles up to pos as styling has converged with them.
+	void ReuseStylesTo(Sci_Position pos);
+	/// Background styling only applies to documents with a lexer.
+	bool CanStyleInBackground() const;
+	void StyleInBackground(Sci_Position priorityEnd);
+	/// Commit styles produced in the background and return true while more are expected.
+	bool CommitBackgroundStyles();
+	void FinishBackgroundStyles();
+	/// Lexers that can restart at some lines may lex large ranges on several threads.
+	void SetLexingThreads(int threads);
+	int LexingThreads() const { return lexingThreads; }
 	void LexerChanged();
 	int GetStyleClock() const { return styleClock; }
 	void IncrementStyleClock();
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) {
 		decorations.SetCurrentIndicator(indicator);
 	}
-	void SCI_METHOD DecorationFillRange(int position, int value, int fillLength);
+	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength);
 
-	int SCI_METHOD SetLineState(int line, int state);
-	int SCI_METHOD GetLineState(int line) const;
+	int SCI_METHOD SetLineState(Sci_Position line, int state);
+	int SCI_METHOD GetLineState(Sci_Position line) const;
 	int GetMaxLineState();
-	void SCI_METHOD ChangeLexerState(int start, int end);
-
-	StyledText MarginStyledText(int line) const;
-	void MarginSetStyle(int line, int style);
-	void MarginSetStyles(int line, const unsigned char *styles);
-	void MarginSetText(int line, const char *text);
+	/// Copy the fold levels and line states of lines for a lexer on another thread.
+	void CopyLineData(Sci_Position lineFirst, Sci_Position lines, int *levels, int *lineStates);
+	void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end);
+
+	StyledText MarginStyledText(Sci_Position line) const;
+	void MarginSetStyle(Sci_Position line, int style);
+	void MarginSetStyles(Sci_Position line, const unsigned char *styles);
+	void MarginSetText(Sci_Position line, const char *text);
 	void MarginClearAll();
 
-	StyledText AnnotationStyledText(int line) const;
-	void AnnotationSetText(int line, const char *text);
-	void AnnotationSetStyle(int line, int style);
-	void AnnotationSetStyles(int line, const unsigned char *styles);
-	int AnnotationLines(int line) const;
+	StyledText AnnotationStyledText(Sci_Position line) const;
+	void AnnotationSetText(Sci_Position line, const char *text);
+	void AnnotationSetStyle(Sci_Position line, int style);
+	void AnnotationSetStyles(Sci_Position line, const unsigned char *styles);
+	int AnnotationLines(Sci_Position line) const;
 	void AnnotationClearAll();
 
 	bool AddWatcher(DocWatcher *watcher, void *userData);
@@ -396,19 +507,21 @@ public:
 
 	CharClassify::cc WordCharClass(unsigned char ch) const;
 	bool IsWordPartSeparator(char ch) const;
-	int WordPartLeft(int pos);
-	int WordPartRight(int pos);
-	int ExtendStyleRange(int pos, int delta, bool singleLine = false);
-	bool IsWhiteLine(int line) const;
-	int ParaUp(int pos) const;
-	int ParaDown(int pos) const;
+	Sci_Position WordPartLeft(Sci_Position pos);
+	Sci_Position WordPartRight(Sci_Position pos);
+	Sci_Position ExtendStyleRange(Sci_Position pos, int delta, bool singleLine = false);
+	bool IsWhiteLine(Sci_Position line) const;
+	Sci_Position ParaUp(Sci_Position pos) const;
+	Sci_Position ParaDown(Sci_Position pos) const;
 	int IndentSize() const { return actualIndentInChars; }
-	int BraceMatch(int position, int maxReStyle);
+	Sci_Position BraceMatch(Sci_Position position, int maxReStyle);
 
 private:
-	bool IsWordStartAt(int pos) const;
-	bool IsWordEndAt(int pos) const;
-	bool IsWordAt(int start, int end) const;
+	bool IsWordStartAt(Sci_Position pos) const;
+	bool IsWordEndAt(Sci_Position pos) const;
+	bool IsWordAt(Sci_Position start, Sci_Position end) const;
+
+	void ModifiedText(Sci_Position pos, Sci_Position lengthInserted, Sci_Position lengthDeleted);
 
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
@@ -444,18 +557,18 @@ public:
 class DocModification {
 public:
   	int modificationType;
-	int position;
- 	int length;
- 	int linesAdded;	/**< Negative if lines deleted. */
+	Sci_Position position;
+ 	Sci_Position length;
+ 	Sci_Position linesAdded;	/**< Negative if lines deleted. */
  	const char *text;	/**< Only valid for changes to text, not for changes to style. */
- 	int line;
+ 	Sci_Position line;
 	int foldLevelNow;
 	int foldLevelPrev;
 	int annotationLinesAdded;
 	int token;
 
-	DocModification(int modificationType_, int position_=0, int length_=0,
-		int linesAdded_=0, const char *text_=0, int line_=0) :
+	DocModification(int modificationType_, Sci_Position position_=0, Sci_Position length_=0,
+		Sci_Position linesAdded_=0, const char *text_=0, Sci_Position line_=0) :
 		modificationType(modificationType_),
 		position(position_),
 		length(length_),
@@ -467,7 +580,7 @@ public:
 		annotationLinesAdded(0),
 		token(0) {}
 
-	DocModification(int modificationType_, const Action &act, int linesAdded_=0) :
+	DocModification(int modificationType_, const Action &act, Sci_Position linesAdded_=0) :
 		modificationType(modificationType_),
 		position(act.position),
 		length(act.lenData),
@@ -492,7 +605,7 @@ public:
 	virtual void NotifySavePoint(Document *doc, void *userData, bool atSavePoint) = 0;
 	virtual void NotifyModified(Document *doc, DocModification mh, void *userData) = 0;
 	virtual void NotifyDeleted(Document *doc, void *userData) = 0;
-	virtual void NotifyStyleNeeded(Document *doc, void *userData, int endPos) = 0;
+	virtual void NotifyStyleNeeded(Document *doc, void *userData, Sci_Position endPos) = 0;
 	virtual void NotifyLexerChanged(Document *doc, void *userData) = 0;
 	virtual void NotifyErrorOccurred(Document *doc, void *userData, int status) = 0;
 };
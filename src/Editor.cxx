@@ -204,6 +204,7 @@ Editor::Editor() {
 	paintAbandonedByStyling = false;
 	paintingAllText = false;
 	willRedrawAll = false;
+	backgroundStyling = false;
 
 	modEventMask = SC_MODEVENTMASKALL;
 
@@ -1629,14 +1630,14 @@ bool Editor::WrapLines(enum wrapScope ws) {
 		wrapPending.Reset();
 
 	} else if (wrapPending.NeedsWrap()) {
-		wrapPending.start = std::min(wrapPending.start, pdoc->LinesTotal());
+		wrapPending.start = std::min(wrapPending.start, static_cast<int>(pdoc->LinesTotal()));
 		if (!SetIdle(true)) {
 			// Idle processing not supported so full wrap required.
 			ws = wsAll;
 		}
 		// Decide where to start wrapping
 		int lineToWrap = wrapPending.start;
-		int lineToWrapEnd = std::min(wrapPending.end, pdoc->LinesTotal());
+		int lineToWrapEnd = std::min(wrapPending.end, static_cast<int>(pdoc->LinesTotal()));
 		const int lineDocTop = cs.DocFromDisplay(topLine);
 		const int subLineTop = topLine - cs.DisplayFromDoc(lineDocTop);
 		if (ws == wsVisible) {
@@ -1659,7 +1660,7 @@ bool Editor::WrapLines(enum wrapScope ws) {
 		} else if (ws == wsIdle) {
 			lineToWrapEnd = lineToWrap + LinesOnScreen() + 100;
 		}
-		const int lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
+		const int lineEndNeedWrap = std::min(wrapPending.end, static_cast<int>(pdoc->LinesTotal()));
 		lineToWrapEnd = std::min(lineToWrapEnd, lineEndNeedWrap);
 
 		// Ensure all lines being wrapped are styled.
@@ -6577,12 +6578,15 @@ bool Editor::Idle() {
 			wrappingDone = true;
 	}
 
+	// Commit styles produced by the worker thread.
+	bool stylingDone = !backgroundStyling || !pdoc->CommitBackgroundStyles();
+
 	// Add more idle things to do here, but make sure idleDone is
 	// set correctly before the function returns. returning
 	// false will stop calling this idle funtion until SetIdle() is
 	// called again.
 
-	idleDone = wrappingDone; // && thatDone && theOtherThingDone...
+	idleDone = wrappingDone && stylingDone; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -6615,6 +6619,11 @@ void Editor::StyleToPositionInView(Position pos) {
 	int endWindow = (vs.marginInside) ? (PositionAfterArea(GetClientRectangle())) : (pdoc->Length());
 	if (pos > endWindow)
 		pos = endWindow;
+	if (backgroundStyling && pdoc->CanStyleInBackground() && SetIdle(true)) {
+		// Styles for the window are committed first when idle then the rest of the document
+		pdoc->StyleInBackground(endWindow);
+		return;
+	}
 	int styleAtEnd = pdoc->StyleAt(pos-1);
 	pdoc->EnsureStyledTo(pos);
 	if ((endWindow > pos) && (styleAtEnd != pdoc->StyleAt(pos-1))) {
@@ -12,6 +12,7 @@
 #include <assert.h>
 
 #include <string>
+#include <vector>
 
 #include "Platform.h"
 
@@ -29,93 +30,255 @@ using namespace Scintilla;
 
 LexerManager *LexerManager::theInstance = NULL;
 
+//------------------------------------------
+//
+// ExternalLexer
+//
+//------------------------------------------
+
+namespace {
+
+// Wraps each lexer made by a library so the library knows when it is released. Calls are
+// only made through the interface version of the wrapped lexer.
+class ExternalLexer : public ILexerWithRestart {
+	ILexer *lexer;
+	LoadedLibrary *library;
+	ILexerWithSubStyles *WithSubStyles() const {
+		return static_cast<ILexerWithSubStyles *>(lexer);
+	}
+	ILexerWithRestart *WithRestart() const {
+		return static_cast<ILexerWithRestart *>(lexer);
+	}
+	// Private so ExternalLexer objects can not be copied
+	ExternalLexer(const ExternalLexer &);
+public:
+	ExternalLexer(ILexer *lexer_, LoadedLibrary *library_) : lexer(lexer_), library(library_) {
+		library->LexerCreated();
+	}
+	virtual ~ExternalLexer() {
+	}
+	int SCI_METHOD Version() const {
+		return lexer->Version();
+	}
+	void SCI_METHOD Release() {
+		lexer->Release();
+		LoadedLibrary *libraryLexer = library;
+		delete this;
+		libraryLexer->LexerReleased();
+	}
+	const char * SCI_METHOD PropertyNames() {
+		return lexer->PropertyNames();
+	}
+	int SCI_METHOD PropertyType(const char *name) {
+		return lexer->PropertyType(name);
+	}
+	const char * SCI_METHOD DescribeProperty(const char *name) {
+		return lexer->DescribeProperty(name);
+	}
+	int SCI_METHOD PropertySet(const char *key, const char *val) {
+		return lexer->PropertySet(key, val);
+	}
+	const char * SCI_METHOD DescribeWordListSets() {
+		return lexer->DescribeWordListSets();
+	}
+	int SCI_METHOD WordListSet(int n, const char *wl) {
+		return lexer->WordListSet(n, wl);
+	}
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
+		lexer->Lex(startPos, lengthDoc, initStyle, pAccess);
+	}
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
+		lexer->Fold(startPos, lengthDoc, initStyle, pAccess);
+	}
+	void * SCI_METHOD PrivateCall(int operation, void *pointer) {
+		return lexer->PrivateCall(operation, pointer);
+	}
+	int SCI_METHOD LineEndTypesSupported() {
+		return WithSubStyles()->LineEndTypesSupported();
+	}
+	int SCI_METHOD AllocateSubStyles(int styleBase, int numberStyles) {
+		return WithSubStyles()->AllocateSubStyles(styleBase, numberStyles);
+	}
+	int SCI_METHOD SubStylesStart(int styleBase) {
+		return WithSubStyles()->SubStylesStart(styleBase);
+	}
+	int SCI_METHOD SubStylesLength(int styleBase) {
+		return WithSubStyles()->SubStylesLength(styleBase);
+	}
+	int SCI_METHOD StyleFromSubStyle(int subStyle) {
+		return WithSubStyles()->StyleFromSubStyle(subStyle);
+	}
+	int SCI_METHOD PrimaryStyleFromStyle(int style) {
+		return WithSubStyles()->PrimaryStyleFromStyle(style);
+	}
+	void SCI_METHOD FreeSubStyles() {
+		WithSubStyles()->FreeSubStyles();
+	}
+	void SCI_METHOD SetIdentifiers(int style, const char *identifiers) {
+		WithSubStyles()->SetIdentifiers(style, identifiers);
+	}
+	int SCI_METHOD DistanceToSecondaryStyles() {
+		return WithSubStyles()->DistanceToSecondaryStyles();
+	}
+	const char * SCI_METHOD GetSubStyleBases() {
+		return WithSubStyles()->GetSubStyleBases();
+	}
+	bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess) {
+		return WithRestart()->IsRestartLine(line, pAccess);
+	}
+	// Range lexers are released while this lexer is alive so they are not wrapped, except
+	// that a lexer which lexes ranges itself returns the wrapper.
+	ILexerWithRestart * SCI_METHOD RangeLexer() {
+		ILexerWithRestart *rangeLexer = WithRestart()->RangeLexer();
+		return (rangeLexer == lexer) ? this : rangeLexer;
+	}
+	void SCI_METHOD MergeRange(ILexerWithRestart *rangeLexer, Sci_Position lineStart, Sci_Position lineEnd) {
+		WithRestart()->MergeRange((rangeLexer == this) ? WithRestart() : rangeLexer, lineStart, lineEnd);
+	}
+};
+
+}
+
 //------------------------------------------
 //
 // ExternalLexerModule
 //
 //------------------------------------------
 
-void ExternalLexerModule::SetExternal(GetLexerFactoryFunction fFactory, int index) {
+void ExternalLexerModule::SetExternal(GetLexerFactoryFunction fFactory, int index, LoadedLibrary *library_) {
 	fneFactory = fFactory;
 	fnFactory = fFactory(index);
+	library = library_;
+}
+
+ILexer *ExternalLexerModule::Create() const {
+	ILexer *lexer = LexerModule::Create();
+	if (lexer && library)
+		return new ExternalLexer(lexer, library);
+	return lexer;
 }
 
 //------------------------------------------
 //
-// LexerLibrary
+// LoadedLibrary
 //
 //------------------------------------------
 
-LexerLibrary::LexerLibrary(const char *ModuleName) {
-	// Initialise some members...
-	first = NULL;
-	last = NULL;
-
-	// Load the DLL
+/// Open the library and add its lexers to the Catalogue. A library that could not be
+/// opened has no modules.
+LoadedLibrary::LoadedLibrary(const char *ModuleName) : lib(NULL), lexers(0), released(false) {
 	lib = DynamicLibrary::Load(ModuleName);
-	if (lib->IsValid()) {
-		m_sModuleName = ModuleName;
+	if (lib && lib->IsValid()) {
 		//Cannot use reinterpret_cast because: ANSI C++ forbids casting between pointers to functions and objects
 		GetLexerCountFn GetLexerCount = (GetLexerCountFn)(sptr_t)lib->FindFunction("GetLexerCount");
+		// Find functions in the DLL once for all of its lexers
+		GetLexerNameFn GetLexerName = (GetLexerNameFn)(sptr_t)lib->FindFunction("GetLexerName");
+		GetLexerFactoryFunction fnFactory = (GetLexerFactoryFunction)(sptr_t)lib->FindFunction("GetLexerFactory");
 
-		if (GetLexerCount) {
-			ExternalLexerModule *lex;
-			LexerMinder *lm;
-
-			// Find functions in the DLL
-			GetLexerNameFn GetLexerName = (GetLexerNameFn)(sptr_t)lib->FindFunction("GetLexerName");
-			GetLexerFactoryFunction fnFactory = (GetLexerFactoryFunction)(sptr_t)lib->FindFunction("GetLexerFactory");
-
+		if (GetLexerCount && GetLexerName && fnFactory) {
 			// Assign a buffer for the lexer name.
 			char lexname[100];
-			strcpy(lexname, "");
 
 			int nl = GetLexerCount();
 
 			for (int i = 0; i < nl; i++) {
-				GetLexerName(i, lexname, 100);
-				lex = new ExternalLexerModule(SCLEX_AUTOMATIC, NULL, lexname, NULL);
-				Catalogue::AddLexerModule(lex);
-
-				// Create a LexerMinder so we don't leak the ExternalLexerModule...
-				lm = new LexerMinder;
-				lm->self = lex;
-				lm->next = NULL;
-				if (first != NULL) {
-					last->next = lm;
-					last = lm;
-				} else {
-					first = lm;
-					last = lm;
-				}
+				strcpy(lexname, "");
+				GetLexerName(i, lexname, sizeof(lexname));
+				lexname[sizeof(lexname)-1] = '\0';
+				ExternalLexerModule *lex = new ExternalLexerModule(SCLEX_AUTOMATIC, NULL, lexname, NULL);
+				modules.push_back(lex);
 
 				// The external lexer needs to know how to call into its DLL to
 				// do its lexing and folding, we tell it here.
-				lex->SetExternal(fnFactory, i);
+				lex->SetExternal(fnFactory, i, this);
+				Catalogue::AddLexerModule(lex);
 			}
 		}
 	}
-	next = NULL;
 }
 
-LexerLibrary::~LexerLibrary() {
-	Release();
+/// Deletes the modules, which have already been removed from the Catalogue or are
+/// left in it when the Catalogue may already have been destroyed at exit.
+LoadedLibrary::~LoadedLibrary() {
+	for (std::vector<ExternalLexerModule *>::iterator it=modules.begin(); it != modules.end(); ++it) {
+		delete *it;
+	}
 	delete lib;
 }
 
-void LexerLibrary::Release() {
-	LexerMinder *lm;
-	LexerMinder *lmNext;
-	lm = first;
-	while (NULL != lm) {
-		lmNext = lm->next;
-		delete lm->self;
-		delete lm;
-		lm = lmNext;
+bool LoadedLibrary::Provides(const char *languageName) const {
+	for (std::vector<ExternalLexerModule *>::const_iterator it=modules.begin(); it != modules.end(); ++it) {
+		if (strcmp((*it)->languageName, languageName) == 0)
+			return true;
 	}
+	return false;
+}
+
+bool LoadedLibrary::HasModules() const {
+	return !modules.empty();
+}
+
+void LoadedLibrary::LexerCreated() {
+	lexers++;
+}
+
+void LoadedLibrary::LexerReleased() {
+	lexers--;
+	if (released && (lexers == 0))
+		delete this;
+}
+
+/// No more lexers can be made once the modules are removed from the Catalogue. The
+/// library is closed now or when the last of its lexers is released.
+void LoadedLibrary::Release(bool removeModules) {
+	if (removeModules) {
+		for (std::vector<ExternalLexerModule *>::iterator it=modules.begin(); it != modules.end(); ++it) {
+			Catalogue::RemoveLexerModule(*it);
+		}
+	}
+	released = true;
+	if (lexers == 0)
+		delete this;
+}
+
+//------------------------------------------
+//
+// LexerLibrary
+//
+//------------------------------------------
+
+LexerLibrary::LexerLibrary(const char *ModuleName) : loaded(NULL), m_sModuleName(ModuleName) {
+}
+
+LexerLibrary::~LexerLibrary() {
+	if (loaded)
+		loaded->Release(false);
+}
+
+bool LexerLibrary::Loaded() const {
+	return loaded != NULL;
+}
+
+/// Open the library and add its lexers to the Catalogue, returning true if there were any.
+/// A library that could not be opened is not tried again until it is released.
+bool LexerLibrary::Load() {
+	if (loaded)
+		return false;
+	loaded = new LoadedLibrary(m_sModuleName.c_str());
+	return loaded->HasModules();
+}
 
-	first = NULL;
-	last = NULL;
+bool LexerLibrary::Provides(const char *languageName) const {
+	return loaded && loaded->Provides(languageName);
+}
+
+/// Remove the lexers from the Catalogue so the library is opened again when next needed.
+/// The library is closed once no document uses any of its lexers.
+void LexerLibrary::Release() {
+	if (loaded) {
+		loaded->Release(true);
+		loaded = NULL;
+	}
 }
 
 //------------------------------------------
@@ -139,45 +302,77 @@ void LexerManager::DeleteInstance() {
 
 /// protected constructor - this is a singleton...
 LexerManager::LexerManager() {
-	first = NULL;
-	last = NULL;
 }
 
+/// Call Clear before deleting the manager while the Catalogue is still in use.
 LexerManager::~LexerManager() {
-	Clear();
+	Catalogue::SetLoader(0);
+	for (std::vector<LexerLibrary *>::iterator it=libraries.begin(); it != libraries.end(); ++it) {
+		delete *it;
+	}
 }
 
+/// Libraries are only remembered here and are opened when the Catalogue is asked for
+/// a language it does not have.
 void LexerManager::Load(const char *path) {
-	LoadLexerLibrary(path);
+	if (!Library(path))
+		libraries.push_back(new LexerLibrary(path));
+	Catalogue::SetLoader(LoadModules);
 }
 
-void LexerManager::LoadLexerLibrary(const char *module) {
-	for (LexerLibrary *ll = first; ll; ll= ll->next) {
-		if (strcmp(ll->m_sModuleName.c_str(), module) == 0)
+void LexerManager::Unload(const char *path) {
+	for (std::vector<LexerLibrary *>::iterator it=libraries.begin(); it != libraries.end(); ++it) {
+		if ((*it)->m_sModuleName == path) {
+			(*it)->Release();
+			delete *it;
+			libraries.erase(it);
 			return;
+		}
 	}
-	LexerLibrary *lib = new LexerLibrary(module);
-	if (NULL != first) {
-		last->next = lib;
-		last = lib;
-	} else {
-		first = lib;
-		last = lib;
-	}
+}
+
+/// Close the library so that a new version of it is opened when next needed.
+void LexerManager::Reload(const char *path) {
+	LexerLibrary *ll = Library(path);
+	if (ll)
+		ll->Release();
+	else
+		Load(path);
 }
 
 void LexerManager::Clear() {
-	if (NULL != first) {
-		LexerLibrary *cur = first;
-		LexerLibrary *next;
-		while (cur) {
-			next = cur->next;
-			delete cur;
-			cur = next;
+	for (std::vector<LexerLibrary *>::iterator it=libraries.begin(); it != libraries.end(); ++it) {
+		(*it)->Release();
+		delete *it;
+	}
+	libraries.clear();
+}
+
+bool LexerManager::LoadModules(const char *languageName) {
+	return GetInstance()->LoadLibraries(languageName);
+}
+
+/// Open libraries in the order they were added until one provides languageName
+/// or, when languageName is NULL, open all of them.
+bool LexerManager::LoadLibraries(const char *languageName) {
+	bool added = false;
+	for (std::vector<LexerLibrary *>::iterator it=libraries.begin(); it != libraries.end(); ++it) {
+		if (!(*it)->Loaded()) {
+			if ((*it)->Load())
+				added = true;
+			if (languageName && (*it)->Provides(languageName))
+				return true;
 		}
-		first = NULL;
-		last = NULL;
 	}
+	return added;
+}
+
+LexerLibrary *LexerManager::Library(const char *module) const {
+	for (std::vector<LexerLibrary *>::const_iterator it=libraries.begin(); it != libraries.end(); ++it) {
+		if ((*it)->m_sModuleName == module)
+			return *it;
+	}
+	return NULL;
 }
 
 //------------------------------------------
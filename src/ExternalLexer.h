@@ -8,7 +8,7 @@
 #ifndef EXTERNALLEXER_H
 #define EXTERNALLEXER_H
 
-#if PLAT_WIN
+#if PLAT_WIN && defined(_WIN32)
 #define EXT_LEXER_DECL __stdcall
 #else
 #define EXT_LEXER_DECL
@@ -23,43 +23,65 @@ typedef int (EXT_LEXER_DECL *GetLexerCountFn)();
 typedef void (EXT_LEXER_DECL *GetLexerNameFn)(unsigned int Index, char *name, int buflength);
 typedef LexerFactoryFunction(EXT_LEXER_DECL *GetLexerFactoryFunction)(unsigned int Index);
 
+class LoadedLibrary;
+
 /// Sub-class of LexerModule to use an external lexer.
 class ExternalLexerModule : public LexerModule {
 protected:
 	GetLexerFactoryFunction fneFactory;
-	char name[100];
+	LoadedLibrary *library;
+	std::string name;
+	// Private so ExternalLexerModule objects can not be copied
+	ExternalLexerModule(const ExternalLexerModule &);
 public:
 	ExternalLexerModule(int language_, LexerFunction fnLexer_,
 		const char *languageName_=0, LexerFunction fnFolder_=0) :
 		LexerModule(language_, fnLexer_, 0, fnFolder_),
-		fneFactory(0) {
-		strncpy(name, languageName_, sizeof(name));
-		name[sizeof(name)-1] = '\0';
-		languageName = name;
+		fneFactory(0), library(0), name(languageName_ ? languageName_ : "") {
+		languageName = name.c_str();
 	}
-	virtual void SetExternal(GetLexerFactoryFunction fFactory, int index);
+	virtual void SetExternal(GetLexerFactoryFunction fFactory, int index, LoadedLibrary *library_);
+	virtual ILexer *Create() const;
 };
 
-/// LexerMinder points to an ExternalLexerModule - so we don't leak them.
-class LexerMinder {
+/// An opened library along with the modules for its lexers. Documents may hold lexers
+/// made by the library after it is released so it is only closed, and its modules
+/// deleted, once it has been released and the last of its lexers has been released.
+class LoadedLibrary {
+	DynamicLibrary *lib;
+	std::vector<ExternalLexerModule *> modules;
+	int lexers;
+	bool released;
+	// Private so LoadedLibrary objects can not be copied
+	LoadedLibrary(const LoadedLibrary &);
+	~LoadedLibrary();
+
 public:
-	ExternalLexerModule *self;
-	LexerMinder *next;
+	explicit LoadedLibrary(const char *ModuleName);
+	bool Provides(const char *languageName) const;
+	bool HasModules() const;
+	void LexerCreated();
+	void LexerReleased();
+	void Release(bool removeModules);
 };
 
-/// LexerLibrary exists for every External Lexer DLL, contains LexerMinders.
+/// LexerLibrary exists for every external lexer library, whether loaded or not.
+/// The library is only opened when one of its lexers may be needed and its modules
+/// are added to the Catalogue then.
 class LexerLibrary {
-	DynamicLibrary	*lib;
-	LexerMinder		*first;
-	LexerMinder		*last;
+	LoadedLibrary *loaded;
+	// Private so LexerLibrary objects can not be copied
+	LexerLibrary(const LexerLibrary &);
 
 public:
-	LexerLibrary(const char *ModuleName);
+	explicit LexerLibrary(const char *ModuleName);
 	~LexerLibrary();
+	bool Loaded() const;
+	bool Load();
+	bool Provides(const char *languageName) const;
 	void Release();
 
-	LexerLibrary	*next;
-	std::string			m_sModuleName;
+	std::string m_sModuleName;
 };
 
 /// LexerManager manages external lexers, contains LexerLibrarys.
@@ -71,15 +93,18 @@ public:
 	static void DeleteInstance();
 
 	void Load(const char *path);
+	void Unload(const char *path);
+	void Reload(const char *path);
 	void Clear();
 
 private:
 	LexerManager();
 	static LexerManager *theInstance;
 
-	void LoadLexerLibrary(const char *module);
-	LexerLibrary *first;
-	LexerLibrary *last;
+	static bool LoadModules(const char *languageName);
+	bool LoadLibraries(const char *languageName);
+	LexerLibrary *Library(const char *module) const;
+	std::vector<LexerLibrary *> libraries;
 };
 
 class LMMinder {
@@ -16,20 +16,20 @@ namespace Scintilla {
 /// in a range.
 /// Used by the Partitioning class.
 
-class SplitVectorWithRangeAdd : public SplitVector<int> {
+class SplitVectorWithRangeAdd : public SplitVector<Sci_Position> {
 public:
-	SplitVectorWithRangeAdd(int growSize_) {
+	SplitVectorWithRangeAdd(Sci_Position growSize_) {
 		SetGrowSize(growSize_);
 		ReAllocate(growSize_);
 	}
 	~SplitVectorWithRangeAdd() {
 	}
-	void RangeAddDelta(int start, int end, int delta) {
+	void RangeAddDelta(Sci_Position start, Sci_Position end, Sci_Position delta) {
 		// end is 1 past end, so end-start is number of elements to change
-		int i = 0;
-		int rangeLength = end - start;
-		int range1Length = rangeLength;
-		int part1Left = part1Length - start;
+		Sci_Position i = 0;
+		Sci_Position rangeLength = end - start;
+		Sci_Position range1Length = rangeLength;
+		Sci_Position part1Left = part1Length - start;
 		if (range1Length > part1Left)
 			range1Length = part1Left;
 		while (i < range1Length) {
@@ -55,12 +55,12 @@ class Partitioning {
 private:
 	// To avoid calculating all the partition positions whenever any text is inserted
 	// there may be a step somewhere in the list.
-	int stepPartition;
-	int stepLength;
+	Sci_Position stepPartition;
+	Sci_Position stepLength;
 	SplitVectorWithRangeAdd *body;
 
 	// Move step forward
-	void ApplyStep(int partitionUpTo) {
+	void ApplyStep(Sci_Position partitionUpTo) {
 		if (stepLength != 0) {
 			body->RangeAddDelta(stepPartition+1, partitionUpTo + 1, stepLength);
 		}
@@ -72,14 +72,14 @@ private:
 	}
 
 	// Move step backward
-	void BackStep(int partitionDownTo) {
+	void BackStep(Sci_Position partitionDownTo) {
 		if (stepLength != 0) {
 			body->RangeAddDelta(partitionDownTo+1, stepPartition+1, -stepLength);
 		}
 		stepPartition = partitionDownTo;
 	}
 
-	void Allocate(int growSize) {
+	void Allocate(Sci_Position growSize) {
 		body = new SplitVectorWithRangeAdd(growSize);
 		stepPartition = 0;
 		stepLength = 0;
@@ -88,7 +88,7 @@ private:
 	}
 
 public:
-	Partitioning(int growSize) {
+	Partitioning(Sci_Position growSize) {
 		Allocate(growSize);
 	}
 
@@ -97,11 +97,11 @@ public:
 		body = 0;
 	}
 
-	int Partitions() const {
+	Sci_Position Partitions() const {
 		return body->Length()-1;
 	}
 
-	void InsertPartition(int partition, int pos) {
+	void InsertPartition(Sci_Position partition, Sci_Position pos) {
 		if (stepPartition < partition) {
 			ApplyStep(partition);
 		}
@@ -109,7 +109,7 @@ public:
 		stepPartition++;
 	}
 
-	void SetPartitionStartPosition(int partition, int pos) {
+	void SetPartitionStartPosition(Sci_Position partition, Sci_Position pos) {
 		ApplyStep(partition+1);
 		if ((partition < 0) || (partition > body->Length())) {
 			return;
@@ -117,7 +117,7 @@ public:
 		body->SetValueAt(partition, pos);
 	}
 
-	void InsertText(int partitionInsert, int delta) {
+	void InsertText(Sci_Position partitionInsert, Sci_Position delta) {
 		// Point all the partitions after the insertion point further along in the buffer
 		if (stepLength != 0) {
 			if (partitionInsert >= stepPartition) {
@@ -139,7 +139,7 @@ public:
 		}
 	}
 
-	void RemovePartition(int partition) {
+	void RemovePartition(Sci_Position partition) {
 		if (partition > stepPartition) {
 			ApplyStep(partition);
 			stepPartition--;
@@ -149,29 +149,29 @@ public:
 		body->Delete(partition);
 	}
 
-	int PositionFromPartition(int partition) const {
+	Sci_Position PositionFromPartition(Sci_Position partition) const {
 		PLATFORM_ASSERT(partition >= 0);
 		PLATFORM_ASSERT(partition < body->Length());
 		if ((partition < 0) || (partition >= body->Length())) {
 			return 0;
 		}
-		int pos = body->ValueAt(partition);
+		Sci_Position pos = body->ValueAt(partition);
 		if (partition > stepPartition)
 			pos += stepLength;
 		return pos;
 	}
 
 	/// Return value in range [0 .. Partitions() - 1] even for arguments outside interval
-	int PartitionFromPosition(int pos) const {
+	Sci_Position PartitionFromPosition(Sci_Position pos) const {
 		if (body->Length() <= 1)
 			return 0;
 		if (pos >= (PositionFromPartition(body->Length()-1)))
 			return body->Length() - 1 - 1;
-		int lower = 0;
-		int upper = body->Length()-1;
+		Sci_Position lower = 0;
+		Sci_Position upper = body->Length()-1;
 		do {
-			int middle = (upper + lower + 1) / 2; 	// Round high
-			int posMiddle = body->ValueAt(middle);
+			Sci_Position middle = (upper + lower + 1) / 2; 	// Round high
+			Sci_Position posMiddle = body->ValueAt(middle);
 			if (middle > stepPartition)
 				posMiddle += stepLength;
 			if (pos < posMiddle) {
@@ -184,13 +184,427 @@ public:
 	}
 
 	void DeleteAll() {
-		int growSize = body->GetGrowSize();
+		Sci_Position growSize = body->GetGrowSize();
 		delete body;
 		Allocate(growSize);
 	}
 };
 
 
+/// Divide an interval into multiple partitions with the same interface as Partitioning
+/// but where each operation takes logarithmic time wherever in the interval it occurs.
+/// Partitioning moves its single step linearly so edits that alternate between
+/// distant partitions cost time proportional to the number of partitions.
+/// Here the partition starts are held in blocks of up to blockSize positions relative
+/// to the start of their block. The number of partitions and the length of each block
+/// are summed in Fenwick trees so finding the block for a partition or position
+/// and changing a length update only O(log blocks) sums.
+/// Adding or removing a block moves the later blocks and rebuilds the trees which
+/// takes O(blocks) time rather than updating the trees in place. A block is only
+/// added when one splits after gaining about blockSize/2 partitions and only removed
+/// when one empties so this is amortized over about blockSize/2 partition changes
+/// and is still much less than Partitioning moving its step over every partition.
+
+class BlockPartitioning {
+private:
+	enum { blockSize = 128 };
+
+	SplitVectorWithRangeAdd **blocks;	///< Starts of partitions relative to start of block
+	Sci_Position *lengths;	///< Length of each block
+	Sci_Position *treeCounts;	///< Fenwick tree of partitions in each block
+	Sci_Position *treeLengths;	///< Fenwick tree of lengths of each block
+	Sci_Position blocksCount;
+	Sci_Position blocksAllocated;
+	Sci_Position topMask;	///< Highest power of 2 not greater than blocksCount
+	Sci_Position partitions;
+	Sci_Position length;
+	Sci_Position growSize;
+
+	// Cache of the last block found as access is mostly to nearby partitions
+	mutable Sci_Position cacheBlock;
+	mutable Sci_Position cacheFirst;
+	mutable Sci_Position cacheStart;
+
+	void RebuildTrees() {
+		for (Sci_Position i = 1; i <= blocksCount; i++) {
+			treeCounts[i] = blocks[i-1]->Length();
+			treeLengths[i] = lengths[i-1];
+		}
+		for (Sci_Position i = 1; i <= blocksCount; i++) {
+			const Sci_Position parent = i + (i & -i);
+			if (parent <= blocksCount) {
+				treeCounts[parent] += treeCounts[i];
+				treeLengths[parent] += treeLengths[i];
+			}
+		}
+		topMask = 1;
+		while (topMask * 2 <= blocksCount)
+			topMask *= 2;
+		cacheBlock = -1;
+	}
+
+	void AddToTree(Sci_Position *tree, Sci_Position block, Sci_Position delta) {
+		for (Sci_Position i = block + 1; i <= blocksCount; i += i & -i) {
+			tree[i] += delta;
+		}
+	}
+
+	void AddLength(Sci_Position block, Sci_Position delta) {
+		lengths[block] += delta;
+		AddToTree(treeLengths, block, delta);
+		cacheBlock = -1;
+	}
+
+	void AddCount(Sci_Position block, Sci_Position delta) {
+		partitions += delta;
+		AddToTree(treeCounts, block, delta);
+		cacheBlock = -1;
+	}
+
+	/// Find the block holding a partition along with the index of its first partition and its start.
+	void Locate(Sci_Position partition, Sci_Position &block, Sci_Position &first, Sci_Position &start) const {
+		if ((cacheBlock >= 0) && (partition >= cacheFirst) &&
+			(partition < cacheFirst + blocks[cacheBlock]->Length())) {
+			block = cacheBlock;
+			first = cacheFirst;
+			start = cacheStart;
+			return;
+		}
+		block = 0;
+		first = 0;
+		start = 0;
+		for (Sci_Position mask = topMask; mask; mask /= 2) {
+			const Sci_Position next = block + mask;
+			if ((next <= blocksCount) && (first + treeCounts[next] <= partition)) {
+				block = next;
+				first += treeCounts[next];
+				start += treeLengths[next];
+			}
+		}
+		cacheBlock = block;
+		cacheFirst = first;
+		cacheStart = start;
+	}
+
+	/// Find the last block starting at or before a position inside the interval.
+	void LocatePosition(Sci_Position pos, Sci_Position &block, Sci_Position &first, Sci_Position &start) const {
+		block = 0;
+		first = 0;
+		start = 0;
+		for (Sci_Position mask = topMask; mask; mask /= 2) {
+			const Sci_Position next = block + mask;
+			if ((next <= blocksCount) && (start + treeLengths[next] <= pos)) {
+				block = next;
+				first += treeCounts[next];
+				start += treeLengths[next];
+			}
+		}
+	}
+
+	/// Ensure there is room for blocksNeeded blocks. The trees must be rebuilt after.
+	void AllocateBlocks(Sci_Position blocksNeeded) {
+		if (blocksNeeded > blocksAllocated) {
+			Sci_Position newAllocated = blocksAllocated * 2;
+			while (newAllocated < blocksNeeded)
+				newAllocated *= 2;
+			SplitVectorWithRangeAdd **newBlocks = new SplitVectorWithRangeAdd *[newAllocated];
+			Sci_Position *newLengths = new Sci_Position[newAllocated];
+			memcpy(newBlocks, blocks, sizeof(blocks[0]) * blocksCount);
+			memcpy(newLengths, lengths, sizeof(lengths[0]) * blocksCount);
+			delete []blocks;
+			delete []lengths;
+			delete []treeCounts;
+			delete []treeLengths;
+			blocks = newBlocks;
+			lengths = newLengths;
+			treeCounts = new Sci_Position[newAllocated + 1];
+			treeLengths = new Sci_Position[newAllocated + 1];
+			blocksAllocated = newAllocated;
+		}
+	}
+
+	void InsertBlock(Sci_Position block, SplitVectorWithRangeAdd *body, Sci_Position lengthBlock) {
+		AllocateBlocks(blocksCount + 1);
+		memmove(blocks + block + 1, blocks + block, sizeof(blocks[0]) * (blocksCount - block));
+		memmove(lengths + block + 1, lengths + block, sizeof(lengths[0]) * (blocksCount - block));
+		blocks[block] = body;
+		lengths[block] = lengthBlock;
+		blocksCount++;
+		RebuildTrees();
+	}
+
+	void RemoveBlock(Sci_Position block) {
+		delete blocks[block];
+		memmove(blocks + block, blocks + block + 1, sizeof(blocks[0]) * (blocksCount - block - 1));
+		memmove(lengths + block, lengths + block + 1, sizeof(lengths[0]) * (blocksCount - block - 1));
+		blocksCount--;
+		RebuildTrees();
+	}
+
+	/// Move the upper half of a full block into a new block.
+	void SplitBlock(Sci_Position block) {
+		SplitVectorWithRangeAdd *body = blocks[block];
+		const Sci_Position half = body->Length() / 2;
+		const Sci_Position split = body->ValueAt(half);
+		SplitVectorWithRangeAdd *upper = new SplitVectorWithRangeAdd(blockSize);
+		for (Sci_Position i = half; i < body->Length(); i++) {
+			upper->Insert(i - half, body->ValueAt(i) - split);
+		}
+		body->DeleteRange(half, body->Length() - half);
+		const Sci_Position lengthUpper = lengths[block] - split;
+		lengths[block] = split;
+		InsertBlock(block + 1, upper, lengthUpper);
+	}
+
+	void Allocate(Sci_Position growSize_) {
+		growSize = growSize_;
+		blocksAllocated = 8;
+		blocks = new SplitVectorWithRangeAdd *[blocksAllocated];
+		lengths = new Sci_Position[blocksAllocated];
+		treeCounts = new Sci_Position[blocksAllocated + 1];
+		treeLengths = new Sci_Position[blocksAllocated + 1];
+		blocks[0] = new SplitVectorWithRangeAdd(growSize);
+		blocks[0]->Insert(0, 0);	// This value stays 0 for ever
+		lengths[0] = 0;
+		blocksCount = 1;
+		partitions = 1;
+		length = 0;
+		RebuildTrees();
+	}
+
+	void Deallocate() {
+		for (Sci_Position block = 0; block < blocksCount; block++) {
+			delete blocks[block];
+		}
+		delete []blocks;
+		blocks = 0;
+		delete []lengths;
+		lengths = 0;
+		delete []treeCounts;
+		treeCounts = 0;
+		delete []treeLengths;
+		treeLengths = 0;
+	}
+
+	// Private so BlockPartitioning objects can not be copied
+	BlockPartitioning(const BlockPartitioning &);
+
+public:
+	BlockPartitioning(Sci_Position growSize_) {
+		Allocate(growSize_);
+	}
+
+	~BlockPartitioning() {
+		Deallocate();
+	}
+
+	Sci_Position Partitions() const {
+		return partitions;
+	}
+
+	void InsertPartition(Sci_Position partition, Sci_Position pos) {
+		PLATFORM_ASSERT((partition >= 0) && (partition <= partitions));
+		if ((partition < 0) || (partition > partitions)) {
+			return;
+		}
+		// The new partition goes in the block of the partition before it
+		Sci_Position block = 0;
+		Sci_Position first = 0;
+		Sci_Position start = 0;
+		if (partition > 0)
+			Locate(partition - 1, block, first, start);
+		blocks[block]->Insert(partition - first, pos - start);
+		AddCount(block, 1);
+		if (blocks[block]->Length() > blockSize) {
+			SplitBlock(block);
+		}
+	}
+
+	/// Insert insertCount partitions starting at partition with the increasing start
+	/// positions in positions. Equivalent to calling InsertPartition for each but
+	/// fills whole blocks and rebuilds the trees once so is linear in insertCount.
+	void InsertPartitions(Sci_Position partition, const Sci_Position *positions, Sci_Position insertCount) {
+		PLATFORM_ASSERT((partition > 0) && (partition <= partitions));
+		if ((partition <= 0) || (partition > partitions) || (insertCount <= 0)) {
+			return;
+		}
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		Locate(partition - 1, block, first, start);
+		SplitVectorWithRangeAdd *body = blocks[block];
+		const Sci_Position offset = partition - first;
+		const Sci_Position lengthTail = body->Length() - offset;
+		if (body->Length() + insertCount <= blockSize) {
+			// Fits in the block
+			for (Sci_Position i = 0; i < insertCount; i++) {
+				body->Insert(offset + i, positions[i] - start);
+			}
+			AddCount(block, insertCount);
+			return;
+		}
+		// Take the partitions after the insertion point out of the block then
+		// append the new partitions followed by them, adding blocks as each fills.
+		Sci_Position *tail = new Sci_Position[lengthTail + 1];
+		for (Sci_Position i = 0; i < lengthTail; i++) {
+			tail[i] = start + body->ValueAt(offset + i);
+		}
+		body->DeleteRange(offset, lengthTail);
+		const Sci_Position end = start + lengths[block];
+		const Sci_Position total = insertCount + lengthTail;
+		const Sci_Position room = blockSize - offset;
+		const Sci_Position blocksAdded = (total - room + blockSize - 1) / blockSize;
+		AllocateBlocks(blocksCount + blocksAdded);
+		memmove(blocks + block + 1 + blocksAdded, blocks + block + 1, sizeof(blocks[0]) * (blocksCount - block - 1));
+		memmove(lengths + block + 1 + blocksAdded, lengths + block + 1, sizeof(lengths[0]) * (blocksCount - block - 1));
+		blocksCount += blocksAdded;
+		Sci_Position blockFill = block;
+		Sci_Position startFill = start;
+		for (Sci_Position i = 0; i < total; i++) {
+			const Sci_Position pos = (i < insertCount) ? positions[i] : tail[i - insertCount];
+			if (body->Length() >= blockSize) {
+				lengths[blockFill] = pos - startFill;
+				blockFill++;
+				startFill = pos;
+				body = new SplitVectorWithRangeAdd(blockSize);
+				blocks[blockFill] = body;
+			}
+			body->Insert(body->Length(), pos - startFill);
+		}
+		lengths[blockFill] = end - startFill;
+		delete []tail;
+		partitions += insertCount;
+		RebuildTrees();
+	}
+
+	void SetPartitionStartPosition(Sci_Position partition, Sci_Position pos) {
+		if ((partition <= 0) || (partition > partitions)) {
+			return;
+		}
+		if (partition == partitions) {
+			// End of the last partition
+			const Sci_Position delta = pos - length;
+			length += delta;
+			AddLength(blocksCount - 1, delta);
+			return;
+		}
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		Locate(partition, block, first, start);
+		if (partition > first) {
+			blocks[block]->SetValueAt(partition - first, pos - start);
+		} else {
+			// Start of a block so move the boundary with the previous block
+			const Sci_Position delta = pos - start;
+			SplitVectorWithRangeAdd *body = blocks[block];
+			body->RangeAddDelta(1, body->Length(), -delta);
+			AddLength(block - 1, delta);
+			AddLength(block, -delta);
+		}
+	}
+
+	void InsertText(Sci_Position partitionInsert, Sci_Position delta) {
+		// Point all the partitions after the insertion point further along in the buffer
+		if ((partitionInsert < 0) || (partitionInsert >= partitions)) {
+			return;
+		}
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		Locate(partitionInsert, block, first, start);
+		SplitVectorWithRangeAdd *body = blocks[block];
+		body->RangeAddDelta(partitionInsert - first + 1, body->Length(), delta);
+		length += delta;
+		AddLength(block, delta);
+	}
+
+	void RemovePartition(Sci_Position partition) {
+		if ((partition < 0) || (partition > partitions) || (partitions <= 1)) {
+			return;
+		}
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		if (partition == partitions) {
+			// Removing the end of the interval drops the last partition
+			Locate(partition - 1, block, first, start);
+			SplitVectorWithRangeAdd *body = blocks[block];
+			const Sci_Position lengthLast = lengths[block] - body->ValueAt(partition - 1 - first);
+			body->Delete(partition - 1 - first);
+			length -= lengthLast;
+			AddLength(block, -lengthLast);
+		} else {
+			Locate(partition, block, first, start);
+			SplitVectorWithRangeAdd *body = blocks[block];
+			if (partition > first) {
+				body->Delete(partition - first);
+			} else {
+				// First in its block so its length moves to the previous block
+				const Sci_Position moved = (body->Length() > 1) ? body->ValueAt(1) : lengths[block];
+				body->Delete(0);
+				body->RangeAddDelta(0, body->Length(), -moved);
+				AddLength(block, -moved);
+				if (block > 0) {
+					AddLength(block - 1, moved);
+				} else {
+					length -= moved;
+				}
+			}
+		}
+		AddCount(block, -1);
+		if (blocks[block]->Length() == 0) {
+			RemoveBlock(block);
+		}
+	}
+
+	Sci_Position PositionFromPartition(Sci_Position partition) const {
+		PLATFORM_ASSERT(partition >= 0);
+		PLATFORM_ASSERT(partition <= partitions);
+		if ((partition < 0) || (partition > partitions)) {
+			return 0;
+		}
+		if (partition == partitions)
+			return length;
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		Locate(partition, block, first, start);
+		return start + blocks[block]->ValueAt(partition - first);
+	}
+
+	/// Return value in range [0 .. Partitions() - 1] even for arguments outside interval
+	Sci_Position PartitionFromPosition(Sci_Position pos) const {
+		if (pos >= length)
+			return partitions - 1;
+		if (pos < 0)
+			return 0;
+		Sci_Position block;
+		Sci_Position first;
+		Sci_Position start;
+		LocatePosition(pos, block, first, start);
+		const SplitVectorWithRangeAdd *body = blocks[block];
+		const Sci_Position posInBlock = pos - start;
+		Sci_Position lower = 0;
+		Sci_Position upper = body->Length()-1;
+		while (lower < upper) {
+			const Sci_Position middle = (upper + lower + 1) / 2; 	// Round high
+			if (posInBlock < body->ValueAt(middle)) {
+				upper = middle - 1;
+			} else {
+				lower = middle;
+			}
+		}
+		return first + lower;
+	}
+
+	void DeleteAll() {
+		Deallocate();
+		Allocate(growSize);
+	}
+};
+
+
 #ifdef SCI_NAMESPACE
 }
 #endif
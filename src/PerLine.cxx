@@ -120,20 +120,26 @@ LineMarkers::~LineMarkers() {
 }
 
 void LineMarkers::Init() {
-	for (int line = 0; line < markers.Length(); line++) {
+	for (Sci_Position line = 0; line < markers.Length(); line++) {
 		delete markers[line];
 		markers[line] = 0;
 	}
 	markers.DeleteAll();
 }
 
-void LineMarkers::InsertLine(int line) {
+void LineMarkers::InsertLine(Sci_Position line) {
 	if (markers.Length()) {
 		markers.Insert(line, 0);
 	}
 }
 
-void LineMarkers::RemoveLine(int line) {
+void LineMarkers::InsertLines(Sci_Position line, Sci_Position lines) {
+	if (markers.Length()) {
+		markers.InsertValue(line, lines, 0);
+	}
+}
+
+void LineMarkers::RemoveLine(Sci_Position line) {
 	// Retain the markers from the deleted line by oring them into the previous line
 	if (markers.Length()) {
 		if (line > 0) {
@@ -143,9 +149,9 @@ void LineMarkers::RemoveLine(int line) {
 	}
 }
 
-int LineMarkers::LineFromHandle(int markerHandle) {
+Sci_Position LineMarkers::LineFromHandle(int markerHandle) {
 	if (markers.Length()) {
-		for (int line = 0; line < markers.Length(); line++) {
+		for (Sci_Position line = 0; line < markers.Length(); line++) {
 			if (markers[line]) {
 				if (markers[line]->Contains(markerHandle)) {
 					return line;
@@ -156,7 +162,7 @@ int LineMarkers::LineFromHandle(int markerHandle) {
 	return -1;
 }
 
-void LineMarkers::MergeMarkers(int pos) {
+void LineMarkers::MergeMarkers(Sci_Position pos) {
 	if (markers[pos + 1] != NULL) {
 		if (markers[pos] == NULL)
 			markers[pos] = new MarkerHandleSet;
@@ -166,18 +172,18 @@ void LineMarkers::MergeMarkers(int pos) {
 	}
 }
 
-int LineMarkers::MarkValue(int line) {
+int LineMarkers::MarkValue(Sci_Position line) {
 	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line])
 		return markers[line]->MarkValue();
 	else
 		return 0;
 }
 
-int LineMarkers::MarkerNext(int lineStart, int mask) const {
+Sci_Position LineMarkers::MarkerNext(Sci_Position lineStart, int mask) const {
 	if (lineStart < 0)
 		lineStart = 0;
-	int length = markers.Length();
-	for (int iLine = lineStart; iLine < length; iLine++) {
+	Sci_Position length = markers.Length();
+	for (Sci_Position iLine = lineStart; iLine < length; iLine++) {
 		MarkerHandleSet *onLine = markers[iLine];
 		if (onLine && ((onLine->MarkValue() & mask) != 0))
 		//if ((pdoc->GetMark(iLine) & lParam) != 0)
@@ -186,7 +192,7 @@ int LineMarkers::MarkerNext(int lineStart, int mask) const {
 	return -1;
 }
 
-int LineMarkers::AddMark(int line, int markerNum, int lines) {
+int LineMarkers::AddMark(Sci_Position line, int markerNum, Sci_Position lines) {
 	handleCurrent++;
 	if (!markers.Length()) {
 		// No existing markers so allocate one element per line
@@ -204,7 +210,7 @@ int LineMarkers::AddMark(int line, int markerNum, int lines) {
 	return handleCurrent;
 }
 
-bool LineMarkers::DeleteMark(int line, int markerNum, bool all) {
+bool LineMarkers::DeleteMark(Sci_Position line, int markerNum, bool all) {
 	bool someChanges = false;
 	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line]) {
 		if (markerNum == -1) {
@@ -223,7 +229,7 @@ bool LineMarkers::DeleteMark(int line, int markerNum, bool all) {
 }
 
 void LineMarkers::DeleteMarkFromHandle(int markerHandle) {
-	int line = LineFromHandle(markerHandle);
+	Sci_Position line = LineFromHandle(markerHandle);
 	if (line >= 0) {
 		markers[line]->RemoveHandle(markerHandle);
 		if (markers[line]->Length() == 0) {
@@ -240,14 +246,21 @@ void LineLevels::Init() {
 	levels.DeleteAll();
 }
 
-void LineLevels::InsertLine(int line) {
+void LineLevels::InsertLine(Sci_Position line) {
 	if (levels.Length()) {
 		int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
 		levels.InsertValue(line, 1, level);
 	}
 }
 
-void LineLevels::RemoveLine(int line) {
+void LineLevels::InsertLines(Sci_Position line, Sci_Position lines) {
+	if (levels.Length()) {
+		int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
+		levels.InsertValue(line, lines, level);
+	}
+}
+
+void LineLevels::RemoveLine(Sci_Position line) {
 	if (levels.Length()) {
 		// Move up following lines but merge header flag from this line
 		// to line before to avoid a temporary disappearence causing expansion.
@@ -260,7 +273,7 @@ void LineLevels::RemoveLine(int line) {
 	}
 }
 
-void LineLevels::ExpandLevels(int sizeNew) {
+void LineLevels::ExpandLevels(Sci_Position sizeNew) {
 	levels.InsertValue(levels.Length(), sizeNew - levels.Length(), SC_FOLDLEVELBASE);
 }
 
@@ -268,7 +281,7 @@ void LineLevels::ClearLevels() {
 	levels.DeleteAll();
 }
 
-int LineLevels::SetLevel(int line, int level, int lines) {
+int LineLevels::SetLevel(Sci_Position line, int level, Sci_Position lines) {
 	int prev = 0;
 	if ((line >= 0) && (line < lines)) {
 		if (!levels.Length()) {
@@ -282,7 +295,7 @@ int LineLevels::SetLevel(int line, int level, int lines) {
 	return prev;
 }
 
-int LineLevels::GetLevel(int line) const {
+int LineLevels::GetLevel(Sci_Position line) const {
 	if (levels.Length() && (line >= 0) && (line < levels.Length())) {
 		return levels[line];
 	} else {
@@ -297,7 +310,7 @@ void LineState::Init() {
 	lineStates.DeleteAll();
 }
 
-void LineState::InsertLine(int line) {
+void LineState::InsertLine(Sci_Position line) {
 	if (lineStates.Length()) {
 		lineStates.EnsureLength(line);
 		int val = (line < lineStates.Length()) ? lineStates[line] : 0;
@@ -305,20 +318,28 @@ void LineState::InsertLine(int line) {
 	}
 }
 
-void LineState::RemoveLine(int line) {
+void LineState::InsertLines(Sci_Position line, Sci_Position lines) {
+	if (lineStates.Length()) {
+		lineStates.EnsureLength(line);
+		int val = (line < lineStates.Length()) ? lineStates[line] : 0;
+		lineStates.InsertValue(line, lines, val);
+	}
+}
+
+void LineState::RemoveLine(Sci_Position line) {
 	if (lineStates.Length() > line) {
 		lineStates.Delete(line);
 	}
 }
 
-int LineState::SetLineState(int line, int state) {
+int LineState::SetLineState(Sci_Position line, int state) {
 	lineStates.EnsureLength(line + 1);
 	int stateOld = lineStates[line];
 	lineStates[line] = state;
 	return stateOld;
 }
 
-int LineState::GetLineState(int line) {
+int LineState::GetLineState(Sci_Position line) {
 	if (line < 0)
 		return 0;
 	lineStates.EnsureLength(line + 1);
@@ -362,42 +383,49 @@ void LineAnnotation::Init() {
 	ClearAll();
 }
 
-void LineAnnotation::InsertLine(int line) {
+void LineAnnotation::InsertLine(Sci_Position line) {
 	if (annotations.Length()) {
 		annotations.EnsureLength(line);
 		annotations.Insert(line, 0);
 	}
 }
 
-void LineAnnotation::RemoveLine(int line) {
+void LineAnnotation::InsertLines(Sci_Position line, Sci_Position lines) {
+	if (annotations.Length()) {
+		annotations.EnsureLength(line);
+		annotations.InsertValue(line, lines, 0);
+	}
+}
+
+void LineAnnotation::RemoveLine(Sci_Position line) {
 	if (annotations.Length() && (line < annotations.Length())) {
 		delete []annotations[line];
 		annotations.Delete(line);
 	}
 }
 
-bool LineAnnotation::MultipleStyles(int line) const {
+bool LineAnnotation::MultipleStyles(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
 		return reinterpret_cast<AnnotationHeader *>(annotations[line])->style == IndividualStyles;
 	else
 		return 0;
 }
 
-int LineAnnotation::Style(int line) const {
+int LineAnnotation::Style(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
 		return reinterpret_cast<AnnotationHeader *>(annotations[line])->style;
 	else
 		return 0;
 }
 
-const char *LineAnnotation::Text(int line) const {
+const char *LineAnnotation::Text(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
 		return annotations[line]+sizeof(AnnotationHeader);
 	else
 		return 0;
 }
 
-const unsigned char *LineAnnotation::Styles(int line) const {
+const unsigned char *LineAnnotation::Styles(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line] && MultipleStyles(line))
 		return reinterpret_cast<unsigned char *>(annotations[line] + sizeof(AnnotationHeader) + Length(line));
 	else
@@ -411,7 +439,7 @@ static char *AllocateAnnotation(int length, int style) {
 	return ret;
 }
 
-void LineAnnotation::SetText(int line, const char *text) {
+void LineAnnotation::SetText(Sci_Position line, const char *text) {
 	if (text && (line >= 0)) {
 		annotations.EnsureLength(line+1);
 		int style = Style(line);
@@ -433,14 +461,14 @@ void LineAnnotation::SetText(int line, const char *text) {
 }
 
 void LineAnnotation::ClearAll() {
-	for (int line = 0; line < annotations.Length(); line++) {
+	for (Sci_Position line = 0; line < annotations.Length(); line++) {
 		delete []annotations[line];
 		annotations[line] = 0;
 	}
 	annotations.DeleteAll();
 }
 
-void LineAnnotation::SetStyle(int line, int style) {
+void LineAnnotation::SetStyle(Sci_Position line, int style) {
 	annotations.EnsureLength(line+1);
 	if (!annotations[line]) {
 		annotations[line] = AllocateAnnotation(0, style);
@@ -448,7 +476,7 @@ void LineAnnotation::SetStyle(int line, int style) {
 	reinterpret_cast<AnnotationHeader *>(annotations[line])->style = static_cast<short>(style);
 }
 
-void LineAnnotation::SetStyles(int line, const unsigned char *styles) {
+void LineAnnotation::SetStyles(Sci_Position line, const unsigned char *styles) {
 	if (line >= 0) {
 		annotations.EnsureLength(line+1);
 		if (!annotations[line]) {
@@ -471,14 +499,14 @@ void LineAnnotation::SetStyles(int line, const unsigned char *styles) {
 	}
 }
 
-int LineAnnotation::Length(int line) const {
+int LineAnnotation::Length(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
 		return reinterpret_cast<AnnotationHeader *>(annotations[line])->length;
 	else
 		return 0;
 }
 
-int LineAnnotation::Lines(int line) const {
+int LineAnnotation::Lines(Sci_Position line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
 		return reinterpret_cast<AnnotationHeader *>(annotations[line])->lines;
 	else
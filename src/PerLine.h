@@ -49,16 +49,17 @@ public:
 	}
 	virtual ~LineMarkers();
 	virtual void Init();
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	virtual void InsertLine(Sci_Position line);
+	virtual void InsertLines(Sci_Position line, Sci_Position lines);
+	virtual void RemoveLine(Sci_Position line);
 
-	int MarkValue(int line);
-	int MarkerNext(int lineStart, int mask) const;
-	int AddMark(int line, int marker, int lines);
-	void MergeMarkers(int pos);
-	bool DeleteMark(int line, int markerNum, bool all);
+	int MarkValue(Sci_Position line);
+	Sci_Position MarkerNext(Sci_Position lineStart, int mask) const;
+	int AddMark(Sci_Position line, int marker, Sci_Position lines);
+	void MergeMarkers(Sci_Position pos);
+	bool DeleteMark(Sci_Position line, int markerNum, bool all);
 	void DeleteMarkFromHandle(int markerHandle);
-	int LineFromHandle(int markerHandle);
+	Sci_Position LineFromHandle(int markerHandle);
 };
 
 class LineLevels : public PerLine {
@@ -66,13 +67,14 @@ class LineLevels : public PerLine {
 public:
 	virtual ~LineLevels();
 	virtual void Init();
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	virtual void InsertLine(Sci_Position line);
+	virtual void InsertLines(Sci_Position line, Sci_Position lines);
+	virtual void RemoveLine(Sci_Position line);
 
-	void ExpandLevels(int sizeNew=-1);
+	void ExpandLevels(Sci_Position sizeNew=-1);
 	void ClearLevels();
-	int SetLevel(int line, int level, int lines);
-	int GetLevel(int line) const;
+	int SetLevel(Sci_Position line, int level, Sci_Position lines);
+	int GetLevel(Sci_Position line) const;
 };
 
 class LineState : public PerLine {
@@ -82,11 +84,12 @@ public:
 	}
 	virtual ~LineState();
 	virtual void Init();
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	virtual void InsertLine(Sci_Position line);
+	virtual void InsertLines(Sci_Position line, Sci_Position lines);
+	virtual void RemoveLine(Sci_Position line);
 
-	int SetLineState(int line, int state);
-	int GetLineState(int line);
+	int SetLineState(Sci_Position line, int state);
+	int GetLineState(Sci_Position line);
 	int GetMaxLineState() const;
 };
 
@@ -97,19 +100,20 @@ public:
 	}
 	virtual ~LineAnnotation();
 	virtual void Init();
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	virtual void InsertLine(Sci_Position line);
+	virtual void InsertLines(Sci_Position line, Sci_Position lines);
+	virtual void RemoveLine(Sci_Position line);
 
-	bool MultipleStyles(int line) const;
-	int Style(int line) const;
-	const char *Text(int line) const;
-	const unsigned char *Styles(int line) const;
-	void SetText(int line, const char *text);
+	bool MultipleStyles(Sci_Position line) const;
+	int Style(Sci_Position line) const;
+	const char *Text(Sci_Position line) const;
+	const unsigned char *Styles(Sci_Position line) const;
+	void SetText(Sci_Position line, const char *text);
 	void ClearAll();
-	void SetStyle(int line, int style);
-	void SetStyles(int line, const unsigned char *styles);
-	int Length(int line) const;
-	int Lines(int line) const;
+	void SetStyle(Sci_Position line, int style);
+	void SetStyles(Sci_Position line, const unsigned char *styles);
+	int Length(Sci_Position line) const;
+	int Lines(Sci_Position line) const;
 };
 
 #ifdef SCI_NAMESPACE
@@ -0,0 +1,364 @@
+// Scintilla source code edit control
+/** @file PieceTable.h
+ ** Data structure for holding text that handles insertions and deletions
+ ** scattered throughout a large document without moving the text.
+ **/
+// Copyright 1998-2013 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/// A piece table holds text as a sequence of pieces where each piece is a
+/// span of an append-only store. Inserting text appends it to the store
+/// and splits at most one piece so the cost of an edit depends on the number
+/// of pieces rather than on the distance from the previous edit as it does
+/// for a SplitVector.
+/// Text is never removed from the store by edits. DeleteAll and BufferPointer
+/// compact the store to hold just the current document and RangePointer drops
+/// text no longer used when joining pieces has made the store much larger.
+/// The initial text may be an original read-only buffer, such as a mapped file,
+/// which is used in place and never written so only edited spans are copied.
+/// Piece offsets below originalLength are in the original, others in the store.
+/// The piece start positions are held in a BlockPartitioning so finding the piece
+/// for a position and moving the following pieces take logarithmic time.
+/// Provides the same methods as SplitVector<char> so CellBuffer can use either.
+
+class PieceTable {
+private:
+	enum { compactMinimum = 0x10000 };
+	const char *original;
+	Sci_Position originalLength;
+	SegmentedVector<char> store;	///< Append-only and grows without copying
+	BlockPartitioning starts;	///< Position in the document of each piece
+	SplitVector<Sci_Position> offsets;	///< Offset of each piece in the original or store
+
+	// Cache of the last piece found by ValueAt as access is mostly sequential
+	mutable Sci_Position cacheStart;
+	mutable Sci_Position cacheEnd;
+	mutable Sci_Position cacheOffset;
+
+	void Init() {
+		original = 0;
+		originalLength = 0;
+		offsets.Insert(0, 0);
+		InvalidateCache();
+	}
+
+	void InvalidateCache() {
+		cacheStart = 0;
+		cacheEnd = 0;
+		cacheOffset = 0;
+	}
+
+	Sci_Position EndOffset() const {
+		return originalLength + store.Length();
+	}
+
+	char CharAtOffset(Sci_Position offset) const {
+		if (offset < originalLength)
+			return original[offset];
+		return store.ValueAt(offset - originalLength);
+	}
+
+	Sci_Position PieceLength(Sci_Position piece) const {
+		return starts.PositionFromPartition(piece + 1) - starts.PositionFromPartition(piece);
+	}
+
+	/// Pointer to the text at a distance into a piece which may be its end.
+	const char *PointerInPiece(Sci_Position piece, Sci_Position distance) const {
+		const Sci_Position offset = offsets.ValueAt(piece) + distance;
+		if (offsets.ValueAt(piece) < originalLength)
+			return original + offset;
+		Sci_Position lengthStore = 0;
+		if (distance < PieceLength(piece))
+			return store.SegmentAt(offset - originalLength, lengthStore);
+		// The end of the store may be the end of a segment so point after the last character
+		return store.SegmentAt(offset - originalLength - 1, lengthStore) + 1;
+	}
+
+	/// Copy the text used by pieces in the store to a new store, dropping text that has
+	/// been deleted or replaced by joining pieces.
+	void CompactStore() {
+		Sci_Position lengthUsed = 0;
+		for (Sci_Position piece = 0; piece < starts.Partitions(); piece++) {
+			if (offsets.ValueAt(piece) >= originalLength)
+				lengthUsed += PieceLength(piece);
+		}
+		char *text = new char[lengthUsed + 1];
+		Sci_Position offsetNew = 0;
+		for (Sci_Position piece = 0; piece < starts.Partitions(); piece++) {
+			if (offsets.ValueAt(piece) >= originalLength) {
+				const Sci_Position pieceLength = PieceLength(piece);
+				store.GetRange(text + offsetNew, offsets.ValueAt(piece) - originalLength, pieceLength);
+				offsets.SetValueAt(piece, originalLength + offsetNew);
+				offsetNew += pieceLength;
+			}
+		}
+		store.DeleteAll();
+		store.InsertFromArray(0, text, 0, lengthUsed);
+		delete []text;
+		InvalidateCache();
+	}
+
+	/// Ensure there is a piece starting at position, splitting the piece containing it
+	/// when needed, and return its index. Position at the end returns the number of pieces.
+	Sci_Position SplitAt(Sci_Position position) {
+		if (position >= Length())
+			return starts.Partitions();
+		const Sci_Position piece = starts.PartitionFromPosition(position);
+		const Sci_Position pieceStart = starts.PositionFromPartition(piece);
+		if (pieceStart == position)
+			return piece;
+		starts.InsertPartition(piece + 1, position);
+		offsets.Insert(piece + 1, offsets.ValueAt(piece) + position - pieceStart);
+		return piece + 1;
+	}
+
+	/// Replace the pieces covering a range with a single piece so that it
+	/// is contiguous in the store and return its index.
+	Sci_Position Consolidate(Sci_Position position, Sci_Position rangeLength) {
+		const Sci_Position pieceFirst = SplitAt(position);
+		const Sci_Position pieceEnd = SplitAt(position + rangeLength);
+		if (pieceEnd - pieceFirst > 1) {
+			char *text = new char[rangeLength];
+			GetRange(text, position, rangeLength);
+			const Sci_Position offset = EndOffset();
+			store.InsertFromArray(store.Length(), text, 0, rangeLength);
+			delete []text;
+			for (Sci_Position piece = pieceFirst + 1; piece < pieceEnd; piece++) {
+				starts.RemovePartition(pieceFirst + 1);
+			}
+			offsets.DeleteRange(pieceFirst + 1, pieceEnd - pieceFirst - 1);
+			offsets.SetValueAt(pieceFirst, offset);
+			InvalidateCache();
+			// Each join appends a copy so compact once the store is much larger than the
+			// document which keeps the cost of compacting in proportion to the joins
+			if (store.Length() > 2 * Length() + compactMinimum)
+				CompactStore();
+		}
+		return pieceFirst;
+	}
+
+	// Private so PieceTable objects can not be copied
+	PieceTable(const PieceTable &);
+
+public:
+	/// Construct an empty piece table.
+	PieceTable() : starts(256) {
+		offsets.SetGrowSize(256);
+		Init();
+	}
+
+	~PieceTable() {
+	}
+
+	/// Use text in place as the initial contents. The text must not change and
+	/// must remain valid until DeleteAll, BufferPointer, or destruction. Text that
+	/// becomes invalid, such as a mapped file truncated by another process, may
+	/// crash any later read so callers should copy text they can not keep valid.
+	void SetOriginal(const char *text, Sci_Position length) {
+		PLATFORM_ASSERT(Length() == 0);
+		if ((Length() != 0) || (length <= 0))
+			return;
+		store.DeleteAll();
+		original = text;
+		originalLength = length;
+		offsets.SetValueAt(0, 0);
+		starts.InsertText(0, length);
+		InvalidateCache();
+	}
+
+	/// Reserve space in the store, commonly before loading a file.
+	void ReAllocate(Sci_Position newSize) {
+		store.ReAllocate(newSize);
+	}
+
+	/// Retrieve the character at a particular position.
+	/// Retrieving positions outside the range of the buffer returns 0.
+	char ValueAt(Sci_Position position) const {
+		if ((position < cacheStart) || (position >= cacheEnd)) {
+			if ((position < 0) || (position >= Length()))
+				return 0;
+			const Sci_Position piece = starts.PartitionFromPosition(position);
+			cacheStart = starts.PositionFromPartition(piece);
+			cacheEnd = starts.PositionFromPartition(piece + 1);
+			cacheOffset = offsets.ValueAt(piece);
+		}
+		return CharAtOffset(cacheOffset + position - cacheStart);
+	}
+
+	/// Retrieve the length of the text.
+	Sci_Position Length() const {
+		return starts.PositionFromPartition(starts.Partitions());
+	}
+
+	/// Number of pieces currently used to represent the text.
+	Sci_Position Pieces() const {
+		return starts.Partitions();
+	}
+
+	/// Length of the store including text no longer used by any piece.
+	Sci_Position StoreLength() const {
+		return store.Length();
+	}
+
+	/// Insert text into the buffer from an array.
+	void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= Length()));
+		if (insertLength > 0) {
+			if ((positionToInsert < 0) || (positionToInsert > Length())) {
+				return;
+			}
+			const Sci_Position offset = EndOffset();
+			store.InsertFromArray(store.Length(), s, positionFrom, insertLength);
+			InvalidateCache();
+			if (Length() == 0) {
+				// Empty document has a single empty piece
+				offsets.SetValueAt(0, offset);
+				starts.InsertText(0, insertLength);
+				return;
+			}
+			const Sci_Position piece = SplitAt(positionToInsert);
+			if ((piece > 0) && (offsets.ValueAt(piece - 1) >= originalLength) &&
+				(offsets.ValueAt(piece - 1) + PieceLength(piece - 1) == offset)) {
+				// Continuing the previous insertion so extend its piece
+				starts.InsertText(piece - 1, insertLength);
+			} else {
+				starts.InsertPartition(piece, positionToInsert);
+				offsets.Insert(piece, offset);
+				starts.InsertText(piece, insertLength);
+			}
+		}
+	}
+
+	/// Delete a range from the buffer.
+	/// Deleting positions outside the current range fails.
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= Length()));
+		if ((position < 0) || ((position + deleteLength) > Length())) {
+			return;
+		}
+		if ((position == 0) && (deleteLength == Length())) {
+			DeleteAll();
+		} else if (deleteLength > 0) {
+			const Sci_Position pieceFirst = SplitAt(position);
+			const Sci_Position pieceEnd = SplitAt(position + deleteLength);
+			starts.InsertText(pieceFirst, -deleteLength);
+			for (Sci_Position piece = pieceFirst; piece < pieceEnd; piece++) {
+				starts.RemovePartition(pieceFirst + 1);
+			}
+			offsets.DeleteRange(pieceFirst, pieceEnd - pieceFirst);
+			InvalidateCache();
+		}
+	}
+
+	/// Delete all the buffer contents.
+	void DeleteAll() {
+		store.DeleteAll();
+		starts.DeleteAll();
+		offsets.DeleteAll();
+		Init();
+	}
+
+	// Retrieve a range of elements into an array
+	void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		if (retrieveLength <= 0)
+			return;
+		Sci_Position piece = starts.PartitionFromPosition(position);
+		Sci_Position pieceStart = starts.PositionFromPartition(piece);
+		while (retrieveLength > 0) {
+			const Sci_Position pieceEnd = starts.PositionFromPartition(piece + 1);
+			Sci_Position rangeLength = pieceEnd - position;
+			if (rangeLength > retrieveLength)
+				rangeLength = retrieveLength;
+			const Sci_Position offset = offsets.ValueAt(piece) + position - pieceStart;
+			if (offset < originalLength)
+				memcpy(buffer, original + offset, rangeLength);
+			else
+				store.GetRange(buffer, offset - originalLength, rangeLength);
+			buffer += rangeLength;
+			position += rangeLength;
+			retrieveLength -= rangeLength;
+			piece++;
+			pieceStart = pieceEnd;
+		}
+	}
+
+	/// Make the whole text contiguous, dropping deleted text from the store and
+	/// copying any original, and return a pointer to it followed by a NUL.
+	char *BufferPointer() {
+		const Sci_Position lengthText = Length();
+		if ((starts.Partitions() > 1) || (originalLength > 0) || (store.Length() != lengthText)) {
+			char *text = new char[lengthText];
+			GetRange(text, 0, lengthText);
+			store.DeleteAll();
+			store.InsertFromArray(0, text, 0, lengthText);
+			delete []text;
+			starts.DeleteAll();
+			starts.InsertText(0, lengthText);
+			offsets.DeleteAll();
+			Init();
+		}
+		return store.BufferPointer();
+	}
+
+	/// Return a pointer to a range of the text, joining pieces if needed.
+	/// An empty range, including one at the end, returns a pointer to where it is.
+	/// The pointer is valid until the next modification or RangePointer call.
+	const char *RangePointer(Sci_Position position, Sci_Position rangeLength) {
+		if (position < 0)
+			position = 0;
+		if (position >= Length()) {
+			if (Length() == 0)
+				return "";
+			const Sci_Position pieceLast = starts.Partitions() - 1;
+			return PointerInPiece(pieceLast, PieceLength(pieceLast));
+		}
+		if (rangeLength <= 0) {
+			const Sci_Position piece = starts.PartitionFromPosition(position);
+			return PointerInPiece(piece, position - starts.PositionFromPartition(piece));
+		}
+		if (rangeLength > Length() - position)
+			rangeLength = Length() - position;
+		const Sci_Position piece = Consolidate(position, rangeLength);
+		const Sci_Position offset = offsets.ValueAt(piece);
+		if (offset < originalLength)
+			return original + offset;
+		return store.RangePointer(offset - originalLength, rangeLength);
+	}
+
+	/// Return a pointer to the text at position without joining pieces or store segments and set
+	/// lengthContiguous to the number of bytes from there to the end of its piece or segment.
+	const char *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const {
+		if ((position < 0) || (position >= Length())) {
+			lengthContiguous = 0;
+			return 0;
+		}
+		const Sci_Position piece = starts.PartitionFromPosition(position);
+		const Sci_Position offset = offsets.ValueAt(piece) + position - starts.PositionFromPartition(piece);
+		lengthContiguous = starts.PositionFromPartition(piece + 1) - position;
+		if (offset < originalLength)
+			return original + offset;
+		Sci_Position lengthStore = 0;
+		const char *text = store.SegmentAt(offset - originalLength, lengthStore);
+		if (lengthStore < lengthContiguous)
+			lengthContiguous = lengthStore;
+		return text;
+	}
+
+	/// The end of the first piece: ranges before this can be retrieved without copying.
+	Sci_Position GapPosition() const {
+		return starts.PositionFromPartition(1);
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
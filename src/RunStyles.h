@@ -16,33 +16,33 @@ namespace Scintilla {
 
 class RunStyles {
 private:
-	Partitioning *starts;
+	BlockPartitioning *starts;
 	SplitVector<int> *styles;
-	int RunFromPosition(int position) const;
-	int SplitRun(int position);
-	void RemoveRun(int run);
-	void RemoveRunIfEmpty(int run);
-	void RemoveRunIfSameAsPrevious(int run);
+	Sci_Position RunFromPosition(Sci_Position position) const;
+	Sci_Position SplitRun(Sci_Position position);
+	void RemoveRun(Sci_Position run);
+	void RemoveRunIfEmpty(Sci_Position run);
+	void RemoveRunIfSameAsPrevious(Sci_Position run);
 	// Private so RunStyles objects can not be copied
 	RunStyles(const RunStyles &);
 public:
 	RunStyles();
 	~RunStyles();
-	int Length() const;
-	int ValueAt(int position) const;
-	int FindNextChange(int position, int end) const;
-	int StartRun(int position) const;
-	int EndRun(int position) const;
+	Sci_Position Length() const;
+	int ValueAt(Sci_Position position) const;
+	Sci_Position FindNextChange(Sci_Position position, Sci_Position end) const;
+	Sci_Position StartRun(Sci_Position position) const;
+	Sci_Position EndRun(Sci_Position position) const;
 	// Returns true if some values may have changed
-	bool FillRange(int &position, int value, int &fillLength);
-	void SetValueAt(int position, int value);
-	void InsertSpace(int position, int insertLength);
+	bool FillRange(Sci_Position &position, int value, Sci_Position &fillLength);
+	void SetValueAt(Sci_Position position, int value);
+	void InsertSpace(Sci_Position position, Sci_Position insertLength);
 	void DeleteAll();
-	void DeleteRange(int position, int deleteLength);
-	int Runs() const;
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength);
+	Sci_Position Runs() const;
 	bool AllSame() const;
 	bool AllSameAs(int value) const;
-	int Find(int value, int start) const;
+	Sci_Position Find(int value, Sci_Position start) const;
 
 	void Check() const;
 };
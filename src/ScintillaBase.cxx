@@ -524,6 +524,7 @@ LexState::LexState(Document *pdoc_) : LexInterface(pdoc_) {
 }
 
 LexState::~LexState() {
+	StopBackground();
 	if (instance) {
 		instance->Release();
 		instance = 0;
@@ -541,6 +542,7 @@ LexState *ScintillaBase::DocumentLexState()
 
 void LexState::SetLexerModule(const LexerModule *lex) {
 	if (lex != lexCurrent) {
+		StopBackground();
 		if (instance) {
 			instance->Release();
 			instance = 0;
@@ -580,6 +582,7 @@ const char *LexState::DescribeWordListSets()
 {
 	if (instance)
     {
+		BackgroundPause pause(this);
 		return instance->DescribeWordListSets();
 	} else
     {
@@ -591,6 +594,7 @@ void LexState::SetWordList(int n, const char *wl)
 {
 	if (instance)
     {
+		StopBackground();
 		int firstModification = instance->WordListSet(n, wl);
 		if (firstModification >= 0)
         {
@@ -609,6 +613,7 @@ const char *LexState::GetName() const {
 
 void *LexState::PrivateCall(int operation, void *pointer) {
 	if (pdoc && instance) {
+		StopBackground();
 		return instance->PrivateCall(operation, pointer);
 	} else {
 		return 0;
@@ -617,6 +622,7 @@ void *LexState::PrivateCall(int operation, void *pointer) {
 
 const char *LexState::PropertyNames() {
 	if (instance) {
+		BackgroundPause pause(this);
 		return instance->PropertyNames();
 	} else {
 		return 0;
@@ -625,6 +631,7 @@ const char *LexState::PropertyNames() {
 
 int LexState::PropertyType(const char *name) {
 	if (instance) {
+		BackgroundPause pause(this);
 		return instance->PropertyType(name);
 	} else {
 		return SC_TYPE_BOOLEAN;
@@ -633,6 +640,7 @@ int LexState::PropertyType(const char *name) {
 
 const char *LexState::DescribeProperty(const char *name) {
 	if (instance) {
+		BackgroundPause pause(this);
 		return instance->DescribeProperty(name);
 	} else {
 		return 0;
@@ -642,6 +650,7 @@ const char *LexState::DescribeProperty(const char *name) {
 void LexState::PropSet(const char *key, const char *val) {
 	props.Set(key, val);
 	if (instance) {
+		StopBackground();
 		int firstModification = instance->PropertySet(key, val);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
@@ -663,6 +672,7 @@ int LexState::PropGetExpanded(const char *key, char *result) const {
 
 int LexState::LineEndTypesSupported() {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->LineEndTypesSupported();
 	}
 	return 0;
@@ -670,6 +680,7 @@ int LexState::LineEndTypesSupported() {
 
 int LexState::AllocateSubStyles(int styleBase, int numberStyles) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		StopBackground();
 		return static_cast<ILexerWithSubStyles *>(instance)->AllocateSubStyles(styleBase, numberStyles);
 	}
 	return -1;
@@ -677,6 +688,7 @@ int LexState::AllocateSubStyles(int styleBase, int numberStyles) {
 
 int LexState::SubStylesStart(int styleBase) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->SubStylesStart(styleBase);
 	}
 	return -1;
@@ -684,6 +696,7 @@ int LexState::SubStylesStart(int styleBase) {
 
 int LexState::SubStylesLength(int styleBase) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->SubStylesLength(styleBase);
 	}
 	return 0;
@@ -691,6 +704,7 @@ int LexState::SubStylesLength(int styleBase) {
 
 int LexState::StyleFromSubStyle(int subStyle) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->StyleFromSubStyle(subStyle);
 	}
 	return 0;
@@ -698,6 +712,7 @@ int LexState::StyleFromSubStyle(int subStyle) {
 
 int LexState::PrimaryStyleFromStyle(int style) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->PrimaryStyleFromStyle(style);
 	}
 	return 0;
@@ -705,18 +720,21 @@ int LexState::PrimaryStyleFromStyle(int style) {
 
 void LexState::FreeSubStyles() {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		StopBackground();
 		static_cast<ILexerWithSubStyles *>(instance)->FreeSubStyles();
 	}
 }
 
 void LexState::SetIdentifiers(int style, const char *identifiers) {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		StopBackground();
 		static_cast<ILexerWithSubStyles *>(instance)->SetIdentifiers(style, identifiers);
 	}
 }
 
 int LexState::DistanceToSecondaryStyles() {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->DistanceToSecondaryStyles();
 	}
 	return 0;
@@ -724,6 +742,7 @@ int LexState::DistanceToSecondaryStyles() {
 
 const char *LexState::GetSubStyleBases() {
 	if (instance && (interfaceVersion >= lvSubStyles)) {
+		BackgroundPause pause(this);
 		return static_cast<ILexerWithSubStyles *>(instance)->GetSubStyleBases();
 	}
 	return "";
@@ -0,0 +1,316 @@
+// Scintilla source code edit control
+/** @file SegmentedVector.h
+ ** Data structure for holding large arrays as a sequence of separately
+ ** allocated segments so that growing never copies existing elements.
+ **/
+// Copyright 1998-2013 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef SEGMENTEDVECTOR_H
+#define SEGMENTEDVECTOR_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/// A variant of SplitVector that stores its elements in segments of about segmentSize
+/// elements found through a directory instead of a single allocation. SplitVector
+/// grows by allocating a new block and copying everything into it which briefly
+/// needs twice the memory. Here an insertion moves elements only within one segment
+/// and splits that segment when it is full.
+/// Contiguous access is through SegmentAt which returns each segment in turn.
+/// RangePointer and BufferPointer retain SplitVector's semantics by joining the
+/// segments covering the range into one allocation.
+
+template <typename T>
+class SegmentedVector {
+private:
+	Sci_Position segmentSize;
+	SplitVector<T *> segments;
+	SplitVector<Sci_Position> capacities;
+	BlockPartitioning starts;	///< Position of each segment
+
+	// Cache of the last segment found by ValueAt as access is mostly sequential
+	mutable Sci_Position cacheStart;
+	mutable Sci_Position cacheEnd;
+	mutable T *cacheBody;
+
+	void Init() {
+		segments.Insert(0, 0);
+		capacities.Insert(0, 0);
+		InvalidateCache();
+	}
+
+	void InvalidateCache() {
+		cacheStart = 0;
+		cacheEnd = 0;
+		cacheBody = 0;
+	}
+
+	Sci_Position SegmentLength(Sci_Position segment) const {
+		return starts.PositionFromPartition(segment + 1) - starts.PositionFromPartition(segment);
+	}
+
+	/// Add a segment holding segmentLength elements copied from s.
+	void InsertSegment(Sci_Position segment, const T *s, Sci_Position segmentLength, Sci_Position capacity) {
+		T *body = new T[capacity];
+		memcpy(body, s, sizeof(T) * segmentLength);
+		const Sci_Position position = starts.PositionFromPartition(segment);
+		starts.InsertPartition(segment, position);
+		starts.InsertText(segment, segmentLength);
+		segments.Insert(segment, body);
+		capacities.Insert(segment, capacity);
+	}
+
+	void RemoveSegment(Sci_Position segment) {
+		delete []segments.ValueAt(segment);
+		starts.RemovePartition(segment);
+		segments.Delete(segment);
+		capacities.Delete(segment);
+	}
+
+	/// Replace the segments covering a range with a single segment and return its index.
+	Sci_Position Join(Sci_Position position, Sci_Position rangeLength, Sci_Position extra) {
+		const Sci_Position segmentFirst = starts.PartitionFromPosition(position);
+		const Sci_Position segmentLast = starts.PartitionFromPosition(position + rangeLength - 1);
+		if ((segmentFirst == segmentLast) && (extra == 0))
+			return segmentFirst;
+		const Sci_Position start = starts.PositionFromPartition(segmentFirst);
+		const Sci_Position joinLength = starts.PositionFromPartition(segmentLast + 1) - start;
+		T *body = new T[joinLength + extra];
+		GetRange(body, start, joinLength);
+		for (Sci_Position segment = segmentFirst; segment <= segmentLast; segment++) {
+			delete []segments.ValueAt(segment);
+		}
+		for (Sci_Position segment = segmentFirst + 1; segment <= segmentLast; segment++) {
+			starts.RemovePartition(segmentFirst + 1);
+		}
+		segments.DeleteRange(segmentFirst + 1, segmentLast - segmentFirst);
+		capacities.DeleteRange(segmentFirst + 1, segmentLast - segmentFirst);
+		segments.SetValueAt(segmentFirst, body);
+		capacities.SetValueAt(segmentFirst, joinLength + extra);
+		InvalidateCache();
+		return segmentFirst;
+	}
+
+	// Private so SegmentedVector objects can not be copied
+	SegmentedVector(const SegmentedVector &);
+
+public:
+	/// Construct an empty segmented vector.
+	SegmentedVector(Sci_Position segmentSize_=65536) : segmentSize(segmentSize_), starts(8) {
+		Init();
+	}
+
+	~SegmentedVector() {
+		DeleteAll();
+	}
+
+	/// Storage grows a segment at a time so there is nothing to reserve.
+	void ReAllocate(Sci_Position) {
+	}
+
+	/// Retrieve the element at a particular position.
+	/// Retrieving positions outside the range of the buffer returns 0.
+	T ValueAt(Sci_Position position) const {
+		if ((position < cacheStart) || (position >= cacheEnd)) {
+			if ((position < 0) || (position >= Length()))
+				return 0;
+			const Sci_Position segment = starts.PartitionFromPosition(position);
+			cacheStart = starts.PositionFromPartition(segment);
+			cacheEnd = starts.PositionFromPartition(segment + 1);
+			cacheBody = segments.ValueAt(segment);
+		}
+		return cacheBody[position - cacheStart];
+	}
+
+	void SetValueAt(Sci_Position position, T v) {
+		PLATFORM_ASSERT((position >= 0) && (position < Length()));
+		if ((position < 0) || (position >= Length()))
+			return;
+		const Sci_Position segment = starts.PartitionFromPosition(position);
+		segments.ValueAt(segment)[position - starts.PositionFromPartition(segment)] = v;
+	}
+
+	/// Retrieve the length of the buffer.
+	Sci_Position Length() const {
+		return starts.PositionFromPartition(starts.Partitions());
+	}
+
+	/// Number of segments currently allocated.
+	Sci_Position Segments() const {
+		return segments.ValueAt(0) ? segments.Length() : 0;
+	}
+
+	/// Return a pointer to the element at position and set segmentLength to the number
+	/// of contiguous elements from there to the end of its segment.
+	const T *SegmentAt(Sci_Position position, Sci_Position &segmentLength) const {
+		if ((position < 0) || (position >= Length())) {
+			segmentLength = 0;
+			return 0;
+		}
+		const Sci_Position segment = starts.PartitionFromPosition(position);
+		const Sci_Position start = starts.PositionFromPartition(segment);
+		segmentLength = starts.PositionFromPartition(segment + 1) - position;
+		return segments.ValueAt(segment) + position - start;
+	}
+
+	/// Insert a single value into the buffer.
+	void Insert(Sci_Position position, T v) {
+		InsertFromArray(position, &v, 0, 1);
+	}
+
+	/// Insert a number of elements into the buffer setting their value.
+	void InsertValue(Sci_Position position, Sci_Position insertLength, T v) {
+		T values[256];
+		std::fill(values, values + 256, v);
+		while (insertLength > 0) {
+			const Sci_Position lengthChunk = std::min<Sci_Position>(insertLength, 256);
+			InsertFromArray(position, values, 0, lengthChunk);
+			position += lengthChunk;
+			insertLength -= lengthChunk;
+		}
+	}
+
+	/// Insert text into the buffer from an array.
+	void InsertFromArray(Sci_Position positionToInsert, const T s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= Length()));
+		if (insertLength <= 0)
+			return;
+		if ((positionToInsert < 0) || (positionToInsert > Length()))
+			return;
+		InvalidateCache();
+		s += positionFrom;
+		if (!segments.ValueAt(0)) {
+			segments.SetValueAt(0, new T[segmentSize]);
+			capacities.SetValueAt(0, segmentSize);
+		}
+		Sci_Position segment = starts.PartitionFromPosition(positionToInsert);
+		const Sci_Position offset = positionToInsert - starts.PositionFromPartition(segment);
+		const Sci_Position lengthSegment = SegmentLength(segment);
+		T *body = segments.ValueAt(segment);
+		if (lengthSegment + insertLength <= capacities.ValueAt(segment)) {
+			// Fits so only move the elements after the insertion point in this segment
+			memmove(body + offset + insertLength, body + offset, sizeof(T) * (lengthSegment - offset));
+			memcpy(body + offset, s, sizeof(T) * insertLength);
+			starts.InsertText(segment, insertLength);
+			return;
+		}
+		if (offset < lengthSegment) {
+			// Move the elements after the insertion point into their own segment
+			const Sci_Position lengthTail = lengthSegment - offset;
+			const Sci_Position capacityTail = std::max(segmentSize, lengthTail);
+			T *tail = new T[capacityTail];
+			memcpy(tail, body + offset, sizeof(T) * lengthTail);
+			starts.InsertPartition(segment + 1, positionToInsert);
+			segments.Insert(segment + 1, tail);
+			capacities.Insert(segment + 1, capacityTail);
+		}
+		// Fill this segment then add new segments
+		const Sci_Position lengthFill = std::min(insertLength, capacities.ValueAt(segment) - offset);
+		memcpy(body + offset, s, sizeof(T) * lengthFill);
+		starts.InsertText(segment, lengthFill);
+		s += lengthFill;
+		insertLength -= lengthFill;
+		while (insertLength > 0) {
+			segment++;
+			const Sci_Position lengthChunk = std::min(insertLength, segmentSize);
+			InsertSegment(segment, s, lengthChunk, segmentSize);
+			s += lengthChunk;
+			insertLength -= lengthChunk;
+		}
+	}
+
+	/// Delete one element from the buffer.
+	void Delete(Sci_Position position) {
+		DeleteRange(position, 1);
+	}
+
+	/// Delete a range from the buffer.
+	/// Deleting positions outside the current range fails.
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= Length()));
+		if ((position < 0) || ((position + deleteLength) > Length())) {
+			return;
+		}
+		if ((position == 0) && (deleteLength == Length())) {
+			// Full deallocation returns storage and is faster
+			DeleteAll();
+			return;
+		}
+		InvalidateCache();
+		while (deleteLength > 0) {
+			const Sci_Position segment = starts.PartitionFromPosition(position);
+			const Sci_Position offset = position - starts.PositionFromPartition(segment);
+			const Sci_Position lengthSegment = SegmentLength(segment);
+			const Sci_Position lengthRemove = std::min(deleteLength, lengthSegment - offset);
+			T *body = segments.ValueAt(segment);
+			memmove(body + offset, body + offset + lengthRemove,
+				sizeof(T) * (lengthSegment - offset - lengthRemove));
+			starts.InsertText(segment, -lengthRemove);
+			if ((lengthRemove == lengthSegment) && (segments.Length() > 1)) {
+				RemoveSegment(segment);
+			}
+			deleteLength -= lengthRemove;
+		}
+	}
+
+	/// Delete all the buffer contents.
+	void DeleteAll() {
+		for (Sci_Position segment = 0; segment < segments.Length(); segment++) {
+			delete []segments.ValueAt(segment);
+		}
+		segments.DeleteAll();
+		capacities.DeleteAll();
+		starts.DeleteAll();
+		Init();
+	}
+
+	// Retrieve a range of elements into an array
+	void GetRange(T *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		while (retrieveLength > 0) {
+			Sci_Position lengthSegment = 0;
+			const T *body = SegmentAt(position, lengthSegment);
+			const Sci_Position lengthCopy = std::min(retrieveLength, lengthSegment);
+			memcpy(buffer, body, sizeof(T) * lengthCopy);
+			buffer += lengthCopy;
+			position += lengthCopy;
+			retrieveLength -= lengthCopy;
+		}
+	}
+
+	/// Join all the segments into one followed by a 0 element.
+	T *BufferPointer() {
+		const Sci_Position lengthBody = Length();
+		if (lengthBody == 0) {
+			if (!segments.ValueAt(0)) {
+				segments.SetValueAt(0, new T[segmentSize]);
+				capacities.SetValueAt(0, segmentSize);
+			}
+			segments.ValueAt(0)[0] = 0;
+			return segments.ValueAt(0);
+		}
+		Sci_Position segment = 0;
+		if ((segments.Length() > 1) || (capacities.ValueAt(0) <= lengthBody))
+			segment = Join(0, lengthBody, 1);
+		T *body = segments.ValueAt(segment);
+		body[lengthBody] = 0;
+		return body;
+	}
+
+	/// Return a pointer to a range of elements, joining segments if needed.
+	/// The pointer is valid until the next modification.
+	T *RangePointer(Sci_Position position, Sci_Position rangeLength) {
+		if ((position < 0) || (position >= Length()) || (rangeLength <= 0)) {
+			return 0;
+		}
+		const Sci_Position segment = Join(position, rangeLength, 0);
+		return segments.ValueAt(segment) + position - starts.PositionFromPartition(segment);
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
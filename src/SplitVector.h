@@ -17,16 +17,16 @@ template <typename T>
 class SplitVector {
 protected:
 	T *body;
-	int size;
-	int lengthBody;
-	int part1Length;
-	int gapLength;	/// invariant: gapLength == size - lengthBody
-	int growSize;
+	Sci_Position size;
+	Sci_Position lengthBody;
+	Sci_Position part1Length;
+	Sci_Position gapLength;	/// invariant: gapLength == size - lengthBody
+	Sci_Position growSize;
 
 	/// Move the gap to a particular position so that insertion and
 	/// deletion at that point will not require much copying and
 	/// hence be fast.
-	void GapTo(int position) {
+	void GapTo(Sci_Position position) {
 		if (position != part1Length) {
 			if (position < part1Length) {
 				memmove(
@@ -45,7 +45,7 @@ protected:
 
 	/// Check that there is room in the buffer for an insertion,
 	/// reallocating if more space needed.
-	void RoomFor(int insertionLength) {
+	void RoomFor(Sci_Position insertionLength) {
 		if (gapLength <= insertionLength) {
 			while (growSize < size / 6)
 				growSize *= 2;
@@ -73,18 +73,18 @@ public:
 		body = 0;
 	}
 
-	int GetGrowSize() const {
+	Sci_Position GetGrowSize() const {
 		return growSize;
 	}
 
-	void SetGrowSize(int growSize_) {
+	void SetGrowSize(Sci_Position growSize_) {
 		growSize = growSize_;
 	}
 
 	/// Reallocate the storage for the buffer to be newSize and
 	/// copy exisiting contents to the new buffer.
 	/// Must not be used to decrease the size of the buffer.
-	void ReAllocate(int newSize) {
+	void ReAllocate(Sci_Position newSize) {
 		if (newSize > size) {
 			// Move the gap to the end
 			GapTo(lengthBody);
@@ -103,7 +103,7 @@ public:
 	/// Retrieving positions outside the range of the buffer returns 0.
 	/// The assertions here are disabled since calling code can be
 	/// simpler if out of range access works and returns 0.
-	T ValueAt(int position) const {
+	T ValueAt(Sci_Position position) const {
 		if (position < part1Length) {
 			//PLATFORM_ASSERT(position >= 0);
 			if (position < 0) {
@@ -121,7 +121,7 @@ public:
 		}
 	}
 
-	void SetValueAt(int position, T v) {
+	void SetValueAt(Sci_Position position, T v) {
 		if (position < part1Length) {
 			PLATFORM_ASSERT(position >= 0);
 			if (position < 0) {
@@ -139,7 +139,7 @@ public:
 		}
 	}
 
-	T &operator[](int position) const {
+	T &operator[](Sci_Position position) const {
 		PLATFORM_ASSERT(position >= 0 && position < lengthBody);
 		if (position < part1Length) {
 			return body[position];
@@ -149,13 +149,13 @@ public:
 	}
 
 	/// Retrieve the length of the buffer.
-	int Length() const {
+	Sci_Position Length() const {
 		return lengthBody;
 	}
 
 	/// Insert a single value into the buffer.
 	/// Inserting at positions outside the current range fails.
-	void Insert(int position, T v) {
+	void Insert(Sci_Position position, T v) {
 		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
 		if ((position < 0) || (position > lengthBody)) {
 			return;
@@ -170,7 +170,7 @@ public:
 
 	/// Insert a number of elements into the buffer setting their value.
 	/// Inserting at positions outside the current range fails.
-	void InsertValue(int position, int insertLength, T v) {
+	void InsertValue(Sci_Position position, Sci_Position insertLength, T v) {
 		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
 		if (insertLength > 0) {
 			if ((position < 0) || (position > lengthBody)) {
@@ -187,14 +187,14 @@ public:
 
 	/// Ensure at least length elements allocated,
 	/// appending zero valued elements if needed.
-	void EnsureLength(int wantedLength) {
+	void EnsureLength(Sci_Position wantedLength) {
 		if (Length() < wantedLength) {
 			InsertValue(Length(), wantedLength - Length(), 0);
 		}
 	}
 
 	/// Insert text into the buffer from an array.
-	void InsertFromArray(int positionToInsert, const T s[], int positionFrom, int insertLength) {
+	void InsertFromArray(Sci_Position positionToInsert, const T s[], Sci_Position positionFrom, Sci_Position insertLength) {
 		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= lengthBody));
 		if (insertLength > 0) {
 			if ((positionToInsert < 0) || (positionToInsert > lengthBody)) {
@@ -210,7 +210,7 @@ public:
 	}
 
 	/// Delete one element from the buffer.
-	void Delete(int position) {
+	void Delete(Sci_Position position) {
 		PLATFORM_ASSERT((position >= 0) && (position < lengthBody));
 		if ((position < 0) || (position >= lengthBody)) {
 			return;
@@ -220,7 +220,7 @@ public:
 
 	/// Delete a range from the buffer.
 	/// Deleting positions outside the current range fails.
-	void DeleteRange(int position, int deleteLength) {
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
 		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= lengthBody));
 		if ((position < 0) || ((position + deleteLength) > lengthBody)) {
 			return;
@@ -242,11 +242,11 @@ public:
 	}
 
 	// Retrieve a range of elements into an array
-	void GetRange(T *buffer, int position, int retrieveLength) const {
+	void GetRange(T *buffer, Sci_Position position, Sci_Position retrieveLength) const {
 		// Split into up to 2 ranges, before and after the split then use memcpy on each.
-		int range1Length = 0;
+		Sci_Position range1Length = 0;
 		if (position < part1Length) {
-			int part1AfterPosition = part1Length - position;
+			Sci_Position part1AfterPosition = part1Length - position;
 			range1Length = retrieveLength;
 			if (range1Length > part1AfterPosition)
 				range1Length = part1AfterPosition;
@@ -254,7 +254,7 @@ public:
 		memcpy(buffer, body + position, range1Length * sizeof(T));
 		buffer += range1Length;
 		position = position + range1Length + gapLength;
-		int range2Length = retrieveLength - range1Length;
+		Sci_Position range2Length = retrieveLength - range1Length;
 		memcpy(buffer, body + position, range2Length * sizeof(T));
 	}
 
@@ -265,7 +265,7 @@ public:
 		return body;
 	}
 
-	T *RangePointer(int position, int rangeLength) {
+	T *RangePointer(Sci_Position position, Sci_Position rangeLength) {
 		if (position < part1Length) {
 			if ((position + rangeLength) > part1Length) {
 				// Range overlaps gap, so move gap to start of range.
@@ -279,9 +279,24 @@ public:
 		}
 	}
 
-	int GapPosition() const {
+	Sci_Position GapPosition() const {
 		return part1Length; 
 	}
+
+	/// Return a pointer to the element at position without moving the gap and set
+	/// lengthContiguous to the number of elements from there to the gap or the end.
+	const T *ContiguousRangePointer(Sci_Position position, Sci_Position &lengthContiguous) const {
+		if ((position < 0) || (position >= lengthBody)) {
+			lengthContiguous = 0;
+			return 0;
+		}
+		if (position < part1Length) {
+			lengthContiguous = part1Length - position;
+			return body + position;
+		}
+		lengthContiguous = lengthBody - position;
+		return body + position + gapLength;
+	}
 };
 
 #ifdef SCI_NAMESPACE
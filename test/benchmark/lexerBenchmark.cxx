@@ -0,0 +1,623 @@
+// Scintilla source code edit control
+/** @file lexerBenchmark.cxx
+ ** Measure the throughput of every lexer in the Catalogue.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+// Each lexer is run over the examples in test/examples and over synthetic inputs that
+// are known to be hard for some lexers, such as very long lines or deep nesting.
+// Lexing and folding are timed separately against a minimal document that lives only
+// in memory or, with -document, against Scintilla's own Document so that the costs of
+// its storage and character decoding are included. Any rate below a minimum, or a stated fraction of the rate recorded in a
+// baseline file, is reported and makes the program exit with status 1.
+// Each measurement runs in its own process so a lexer which loops forever or crashes on
+// some input is reported as a failed measurement and the other measurements still run.
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "LexerModule.h"
+#include "Catalogue.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+// The parts of the platform layer used by Document and by LexCoffeeScript's folder.
+
+void Platform::Assert(const char *c, const char *file, int line) {
+	fprintf(stderr, "Assertion [%s] failed at %s %d\n", c, file, line);
+	abort();
+}
+
+void Platform::DebugPrintf(const char *, ...) {
+}
+
+bool Platform::IsDBCSLeadByte(int, char) {
+	return false;
+}
+
+int Platform::DBCSCharLength(int, const char *) {
+	return 1;
+}
+
+int Platform::DBCSCharMaxLength() {
+	return 2;
+}
+
+int Platform::Minimum(int a, int b) {
+	return (a < b) ? a : b;
+}
+
+int Platform::Maximum(int a, int b) {
+	return (a > b) ? a : b;
+}
+
+int Platform::Clamp(int val, int minVal, int maxVal) {
+	if (val > maxVal)
+		val = maxVal;
+	if (val < minVal)
+		val = minVal;
+	return val;
+}
+
+// A document held in memory which implements just what lexers need.
+class BenchDocument : public IDocumentWithRangePointer {
+	std::string text;
+	std::vector<Sci_Position> lineStarts;
+	std::vector<char> styles;
+	std::vector<int> levels;
+	std::vector<int> lineStates;
+	Sci_Position endStyled;
+	char styleMask;
+	int errorStatus;
+
+	// Private so BenchDocument objects can not be copied
+	BenchDocument(const BenchDocument &);
+	BenchDocument &operator=(const BenchDocument &);
+public:
+	explicit BenchDocument(const std::string &text_) : text(text_), endStyled(0), styleMask(0), errorStatus(0) {
+		lineStarts.push_back(0);
+		for (size_t i=0; i<text.length(); i++) {
+			if ((text[i] == '\n') || ((text[i] == '\r') && ((i+1 == text.length()) || (text[i+1] != '\n'))))
+				lineStarts.push_back(i+1);
+		}
+		Reset();
+	}
+	virtual ~BenchDocument() {
+	}
+	void Reset() {
+		styles.assign(text.length(), 0);
+		levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+		lineStates.assign(lineStarts.size(), 0);
+		endStyled = 0;
+		styleMask = 0;
+		errorStatus = 0;
+	}
+	Sci_Position Lines() const {
+		return lineStarts.size();
+	}
+	int ErrorStatus() const {
+		return errorStatus;
+	}
+
+	int SCI_METHOD Version() const {
+		return dvRangePointer;
+	}
+	void SCI_METHOD SetErrorStatus(int status) {
+		errorStatus = status;
+	}
+	Sci_Position SCI_METHOD Length() const {
+		return text.length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+		for (Sci_Position i=0; i<lengthRetrieve; i++) {
+			const Sci_Position pos = position + i;
+			buffer[i] = ((pos >= 0) && (pos < Length())) ? text[pos] : '\0';
+		}
+	}
+	char SCI_METHOD StyleAt(Sci_Position position) const {
+		if ((position < 0) || (position >= Length()))
+			return 0;
+		return styles[position];
+	}
+	Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const {
+		if (position <= 0)
+			return 0;
+		return std::upper_bound(lineStarts.begin(), lineStarts.end(), position) - lineStarts.begin() - 1;
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Position line) const {
+		if (line <= 0)
+			return 0;
+		if (line >= Lines())
+			return Length();
+		return lineStarts[line];
+	}
+	int SCI_METHOD GetLevel(Sci_Position line) const {
+		if ((line < 0) || (line >= Lines()))
+			return SC_FOLDLEVELBASE;
+		return levels[line];
+	}
+	int SCI_METHOD SetLevel(Sci_Position line, int level) {
+		if ((line < 0) || (line >= Lines()))
+			return SC_FOLDLEVELBASE;
+		const int prev = levels[line];
+		levels[line] = level;
+		return prev;
+	}
+	int SCI_METHOD GetLineState(Sci_Position line) const {
+		if ((line < 0) || (line >= Lines()))
+			return 0;
+		return lineStates[line];
+	}
+	int SCI_METHOD SetLineState(Sci_Position line, int state) {
+		if ((line < 0) || (line >= Lines()))
+			return 0;
+		const int prev = lineStates[line];
+		lineStates[line] = state;
+		return prev;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position, char mask) {
+		endStyled = position;
+		styleMask = mask;
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, char style) {
+		if ((length < 0) || (endStyled + length > Length()))
+			return false;
+		for (Sci_Position i=0; i<length; i++, endStyled++)
+			styles[endStyled] = static_cast<char>((styles[endStyled] & ~styleMask) | (style & styleMask));
+		return true;
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const char *styleArray) {
+		if ((length < 0) || (endStyled + length > Length()))
+			return false;
+		for (Sci_Position i=0; i<length; i++, endStyled++)
+			styles[endStyled] = static_cast<char>((styles[endStyled] & ~styleMask) | (styleArray[i] & styleMask));
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int) {
+	}
+	void SCI_METHOD DecorationFillRange(Sci_Position, int, Sci_Position) {
+	}
+	void SCI_METHOD ChangeLexerState(Sci_Position, Sci_Position) {
+	}
+	int SCI_METHOD CodePage() const {
+		return SC_CP_UTF8;
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char) const {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Position line) {
+		int indent = 0;
+		for (Sci_Position pos = LineStart(line); pos < Length(); pos++) {
+			if (text[pos] == ' ')
+				indent++;
+			else if (text[pos] == '\t')
+				indent = (indent / 8 + 1) * 8;
+			else
+				break;
+		}
+		return indent;
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const {
+		Sci_Position end = LineStart(line + 1);
+		if ((end > LineStart(line)) && (text[end-1] == '\n'))
+			end--;
+		if ((end > LineStart(line)) && (text[end-1] == '\r'))
+			end--;
+		return end;
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+		Sci_Position pos = positionStart;
+		while (characterOffset > 0) {
+			Sci_Position width = 1;
+			GetCharacterAndWidth(pos, &width);
+			pos += width;
+			if (pos > Length())
+				return INVALID_POSITION;
+			characterOffset--;
+		}
+		while (characterOffset < 0) {
+			if (pos <= 0)
+				return INVALID_POSITION;
+			pos--;
+			for (int trail=0; (trail < 3) && (pos > 0) && ((text[pos] & 0xC0) == 0x80); trail++)
+				pos--;
+			characterOffset++;
+		}
+		return pos;
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const {
+		if ((position < 0) || (position >= Length())) {
+			if (pWidth)
+				*pWidth = 1;
+			return 0;
+		}
+		const unsigned char lead = text[position];
+		int width = 1;
+		int character = lead;
+		if (lead >= 0xC2 && lead < 0xF5) {
+			const int trail = (lead >= 0xF0) ? 3 : ((lead >= 0xE0) ? 2 : 1);
+			int value = lead & (0x3F >> trail);
+			int i = 1;
+			for (; i <= trail; i++) {
+				if ((position + i >= Length()) || ((text[position + i] & 0xC0) != 0x80))
+					break;
+				value = (value << 6) | (text[position + i] & 0x3F);
+			}
+			if (i > trail) {
+				width = trail + 1;
+				character = value;
+			}
+		}
+		if (pWidth)
+			*pWidth = width;
+		return character;
+	}
+	const char * SCI_METHOD ContiguousRangePointer(Sci_Position position, Sci_Position *lengthContiguous) {
+		if ((position < 0) || (position >= Length())) {
+			*lengthContiguous = 0;
+			return 0;
+		}
+		*lengthContiguous = Length() - position;
+		return text.c_str() + position;
+	}
+};
+
+struct Input {
+	std::string name;
+	std::string text;
+	Input(const std::string &name_, const std::string &text_) : name(name_), text(text_) {
+	}
+};
+
+static std::string Repeated(const std::string &piece, size_t size) {
+	std::string text;
+	if (!piece.empty()) {
+		text.reserve(size + piece.length());
+		while (text.length() < size)
+			text += piece;
+	}
+	return text;
+}
+
+static bool ReadFile(const std::string &path, std::string &contents) {
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp)
+		return false;
+	char buffer[4096];
+	size_t lenRead;
+	while ((lenRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		contents.append(buffer, lenRead);
+	fclose(fp);
+	return true;
+}
+
+static void AddSyntheticInputs(std::vector<Input> &inputs, size_t size) {
+	// A single line with no line end
+	inputs.push_back(Input("longline", Repeated("word = other + 12.5e3; ", size)));
+	// Nothing but line ends
+	inputs.push_back(Input("newlines", Repeated("\n", size)));
+	// Brackets opened far deeper than any real code
+	inputs.push_back(Input("nesting", Repeated("(", size / 2) + Repeated(")", size / 2)));
+	// Strings, comments and escapes left unterminated on every line
+	inputs.push_back(Input("unterminated", Repeated("\"a\\\n'b\\\n/* c\n<!-- d\n{ e\n(* f\n[[ g\n", size)));
+	// Pseudo-random bytes from a fixed linear congruential generator so runs are comparable
+	std::string noise(size, ' ');
+	unsigned int seed = 1;
+	for (size_t i=0; i<size; i++) {
+		seed = seed * 1103515245 + 12345;
+		noise[i] = static_cast<char>(((seed >> 16) % 255) + 1);
+	}
+	inputs.push_back(Input("random", noise));
+}
+
+struct Result {
+	double lexRate;
+	double foldRate;
+	Result() : lexRate(0.0), foldRate(0.0) {
+	}
+};
+
+typedef std::map<std::string, Result> ResultMap;
+
+static std::string ResultKey(const char *lexerName, const std::string &inputName) {
+	return std::string(lexerName) + " " + inputName;
+}
+
+static bool ReadBaseline(const char *path, ResultMap &baseline) {
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	char lexerName[200];
+	char inputName[200];
+	Result result;
+	while (fscanf(fp, "%199s %199s %lf %lf", lexerName, inputName, &result.lexRate, &result.foldRate) == 4)
+		baseline[ResultKey(lexerName, inputName)] = result;
+	fclose(fp);
+	return true;
+}
+
+static double MegabytesPerSecond(size_t length, std::chrono::steady_clock::duration duration) {
+	const double seconds = std::chrono::duration<double>(duration).count();
+	return (length / 1e6) / std::max(seconds, 1e-6);
+}
+
+// Time lexing and folding the whole of an unstyled document, keeping the best rates.
+static void MeasureRun(const LexerModule *lexerModule, IDocument *pAccess, Result &best) {
+	const Sci_Position length = pAccess->Length();
+	ILexer *lexer = lexerModule->Create();
+	lexer->PropertySet("fold", "1");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	lexer->Lex(0, length, 0, pAccess);
+	std::chrono::steady_clock::time_point lexed = std::chrono::steady_clock::now();
+	lexer->Fold(0, length, 0, pAccess);
+	std::chrono::steady_clock::time_point folded = std::chrono::steady_clock::now();
+	lexer->Release();
+	best.lexRate = std::max(best.lexRate, MegabytesPerSecond(length, lexed - start));
+	best.foldRate = std::max(best.foldRate, MegabytesPerSecond(length, folded - lexed));
+}
+
+// Lex the input from scratch several times, each in a fresh document, taking the best rates.
+static Result Measure(const LexerModule *lexerModule, BenchDocument &doc, const std::string &text,
+	bool inDocument, int repeats) {
+	Result best;
+	for (int run=0; run<repeats; run++) {
+		if (inDocument) {
+			Document *pdoc = new Document();
+			pdoc->SetDBCSCodePage(SC_CP_UTF8);
+			pdoc->SetUndoCollection(false);
+			pdoc->InsertString(0, text.c_str(), static_cast<Sci_Position>(text.length()));
+			MeasureRun(lexerModule, pdoc, best);
+			delete pdoc;
+		} else {
+			doc.Reset();
+			MeasureRun(lexerModule, &doc, best);
+		}
+	}
+	return best;
+}
+
+#ifndef _WIN32
+
+// Measure in a child process which sends back its result through a pipe. When the child
+// does not finish in time it is killed. Returns false with the reason when no result came.
+static bool MeasureInChild(const LexerModule *lexerModule, BenchDocument &doc, const std::string &text,
+	bool inDocument, int repeats, int seconds, Result &result, std::string &failure) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		failure = "can not create pipe";
+		return false;
+	}
+	fflush(stdout);
+	const pid_t pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		failure = "can not fork";
+		return false;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		const Result measured = Measure(lexerModule, doc, text, inDocument, repeats);
+		const bool sent = write(fds[1], &measured, sizeof(measured)) == static_cast<ssize_t>(sizeof(measured));
+		_exit(sent ? 0 : 1);
+	}
+	close(fds[1]);
+
+	const std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	char *received = reinterpret_cast<char *>(&result);
+	size_t lengthReceived = 0;
+	bool timedOut = false;
+	while (lengthReceived < sizeof(result)) {
+		const long long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count();
+		struct pollfd pfd = { fds[0], POLLIN, 0 };
+		const int ready = (remaining > 0) ? poll(&pfd, 1, static_cast<int>(remaining)) : 0;
+		if (ready == 0) {
+			timedOut = true;
+			break;
+		}
+		if (ready < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		const ssize_t lenRead = read(fds[0], received + lengthReceived, sizeof(result) - lengthReceived);
+		if (lenRead <= 0)
+			break;
+		lengthReceived += lenRead;
+	}
+	close(fds[0]);
+	if (timedOut)
+		kill(pid, SIGKILL);
+	int status = 0;
+	while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR)) {
+	}
+	if (lengthReceived == sizeof(result))
+		return true;
+	char reason[100];
+	if (timedOut)
+		snprintf(reason, sizeof(reason), "did not finish in %d seconds", seconds);
+	else if (WIFSIGNALED(status))
+		snprintf(reason, sizeof(reason), "crashed with signal %d", WTERMSIG(status));
+	else
+		snprintf(reason, sizeof(reason), "exited with status %d", WEXITSTATUS(status));
+	failure = reason;
+	return false;
+}
+
+#endif
+
+static const char *examples[] = {
+	"x.asp", "x.cxx", "x.d", "x.html", "x.lua", "x.php", "x.pl", "x.py", "x.rb", "x.vb",
+};
+
+static void Usage() {
+	fprintf(stderr,
+		"Usage: lexerBenchmark [options] [file...]\n"
+		"  -lexer name      only measure the named lexer\n"
+		"  -size bytes      size each input is repeated to (default 1000000)\n"
+		"  -repeat n        take the best of n runs (default 1)\n"
+		"  -min rate        report rates below this many MB/s (default 1)\n"
+		"  -baseline file   report rates below a fraction of those in file\n"
+		"  -tolerance f     fraction of the baseline rate that may be lost (default 0.5)\n"
+		"  -save file       write the rates to file for use as a baseline\n"
+		"  -timeout seconds fail one lexer and input when it takes longer (default 60)\n"
+		"  -document        lex in a Scintilla Document instead of a minimal one\n"
+		"When no files are given, the examples in ../examples are read.\n");
+}
+
+int main(int argc, char *argv[]) {
+	const char *onlyLexer = 0;
+	size_t size = 1000000;
+	int repeats = 1;
+	double minimumRate = 1.0;
+	const char *baselinePath = 0;
+	double tolerance = 0.5;
+	const char *savePath = 0;
+	int timeLimit = 60;
+	bool inDocument = false;
+	std::vector<std::string> paths;
+	for (int arg=1; arg<argc; arg++) {
+		const bool hasValue = arg + 1 < argc;
+		if (hasValue && (0 == strcmp(argv[arg], "-lexer"))) {
+			onlyLexer = argv[++arg];
+		} else if (hasValue && (0 == strcmp(argv[arg], "-size"))) {
+			size = strtoul(argv[++arg], 0, 10);
+		} else if (hasValue && (0 == strcmp(argv[arg], "-repeat"))) {
+			repeats = std::max(atoi(argv[++arg]), 1);
+		} else if (hasValue && (0 == strcmp(argv[arg], "-min"))) {
+			minimumRate = atof(argv[++arg]);
+		} else if (hasValue && (0 == strcmp(argv[arg], "-baseline"))) {
+			baselinePath = argv[++arg];
+		} else if (hasValue && (0 == strcmp(argv[arg], "-tolerance"))) {
+			tolerance = atof(argv[++arg]);
+		} else if (hasValue && (0 == strcmp(argv[arg], "-timeout"))) {
+			timeLimit = std::max(atoi(argv[++arg]), 1);
+		} else if (hasValue && (0 == strcmp(argv[arg], "-save"))) {
+			savePath = argv[++arg];
+		} else if (0 == strcmp(argv[arg], "-document")) {
+			inDocument = true;
+		} else if (argv[arg][0] == '-') {
+			Usage();
+			return 2;
+		} else {
+			paths.push_back(argv[arg]);
+		}
+	}
+
+	if (paths.empty()) {
+		for (size_t e=0; e<sizeof(examples)/sizeof(examples[0]); e++)
+			paths.push_back(std::string("../examples/") + examples[e]);
+	}
+
+	ResultMap baseline;
+	if (baselinePath && !ReadBaseline(baselinePath, baseline)) {
+		fprintf(stderr, "Can not read baseline %s\n", baselinePath);
+		return 2;
+	}
+
+	std::vector<Input> inputs;
+	for (std::vector<std::string>::const_iterator it=paths.begin(); it != paths.end(); ++it) {
+		std::string contents;
+		if (!ReadFile(*it, contents)) {
+			fprintf(stderr, "Can not read %s\n", it->c_str());
+			return 2;
+		}
+		const size_t slash = it->find_last_of("/\\");
+		const std::string name = (slash == std::string::npos) ? *it : it->substr(slash + 1);
+		inputs.push_back(Input(name, Repeated(contents, size)));
+	}
+	AddSyntheticInputs(inputs, size);
+
+	FILE *fpSave = 0;
+	if (savePath) {
+		fpSave = fopen(savePath, "w");
+		if (!fpSave) {
+			fprintf(stderr, "Can not write %s\n", savePath);
+			return 2;
+		}
+	}
+
+	printf("%-16s %-14s %10s %10s\n", "lexer", "input", "lex MB/s", "fold MB/s");
+	int regressions = 0;
+	for (std::vector<Input>::const_iterator input=inputs.begin(); input != inputs.end(); ++input) {
+		BenchDocument doc(input->text);
+		for (int index=0; index<Catalogue::Count(); index++) {
+			const LexerModule *lexerModule = Catalogue::At(index);
+			const char *lexerName = lexerModule->languageName ? lexerModule->languageName : "unnamed";
+			if (onlyLexer && (0 != strcmp(lexerName, onlyLexer)))
+				continue;
+			Result result;
+#ifdef _WIN32
+			// Without fork, measurements run in this process and have no time limit
+			result = Measure(lexerModule, doc, input->text, inDocument, repeats);
+#else
+			std::string failure;
+			if (!MeasureInChild(lexerModule, doc, input->text, inDocument, repeats, timeLimit, result, failure)) {
+				regressions++;
+				printf("%-16s %-14s %10s %10s %s\n", lexerName, input->name.c_str(), "-", "-", failure.c_str());
+				fflush(stdout);
+				continue;
+			}
+#endif
+			std::string complaint;
+			if ((result.lexRate < minimumRate) || (result.foldRate < minimumRate))
+				complaint = " below minimum";
+			ResultMap::const_iterator itBase = baseline.find(ResultKey(lexerName, input->name));
+			if ((itBase != baseline.end()) &&
+				((result.lexRate < itBase->second.lexRate * (1.0 - tolerance)) ||
+				(result.foldRate < itBase->second.foldRate * (1.0 - tolerance))))
+				complaint += " below baseline";
+			if (!complaint.empty())
+				regressions++;
+			printf("%-16s %-14s %10.1f %10.1f%s\n", lexerName, input->name.c_str(),
+				result.lexRate, result.foldRate, complaint.c_str());
+			fflush(stdout);
+			if (fpSave)
+				fprintf(fpSave, "%s %s %.1f %.1f\n", lexerName, input->name.c_str(), result.lexRate, result.foldRate);
+		}
+	}
+	if (fpSave)
+		fclose(fpSave);
+
+	if (regressions) {
+		printf("%d measurements failed or regressed\n", regressions);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,85 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test Catalogue.
+// The unit tests build Catalogue with SCI_EMPTYCATALOGUE so it only holds the modules
+// added here. The catalogue is global so each test uses its own language numbers.
+
+static void ColouriseNothing(unsigned int, int, int, WordList *[], Accessor &) {
+}
+
+static LexerModule lmFirst(900, ColouriseNothing, "first");
+static LexerModule lmSecond(901, ColouriseNothing, "second");
+static LexerModule lmSameLanguage(910, ColouriseNothing, "samelanguage");
+static LexerModule lmSameLanguageLater(910, ColouriseNothing, "samelanguagelater");
+static LexerModule lmSameName(920, ColouriseNothing, "samename");
+static LexerModule lmSameNameLater(921, ColouriseNothing, "samename");
+static LexerModule lmAutomatic(SCLEX_AUTOMATIC, ColouriseNothing, "automatic");
+static LexerModule lmAddedTwice(930, ColouriseNothing, "addedtwice");
+static LexerModule lmUnnamed(940, ColouriseNothing);
+
+TEST(CatalogueTest, Find) {
+	Catalogue::AddLexerModule(&lmFirst);
+	Catalogue::AddLexerModule(&lmSecond);
+	EXPECT_EQ(&lmFirst, Catalogue::Find(900));
+	EXPECT_EQ(&lmSecond, Catalogue::Find(901));
+	EXPECT_EQ(&lmFirst, Catalogue::Find("first"));
+	EXPECT_EQ(&lmSecond, Catalogue::Find("second"));
+	EXPECT_EQ(0, Catalogue::Find(902));
+	EXPECT_EQ(0, Catalogue::Find("firs"));
+	EXPECT_EQ(0, Catalogue::Find("First"));
+	EXPECT_EQ(0, Catalogue::Find(static_cast<const char *>(0)));
+}
+
+TEST(CatalogueTest, FirstAddedIsFound) {
+	Catalogue::AddLexerModule(&lmSameLanguage);
+	Catalogue::AddLexerModule(&lmSameLanguageLater);
+	EXPECT_EQ(&lmSameLanguage, Catalogue::Find(910));
+	EXPECT_EQ(&lmSameLanguageLater, Catalogue::Find("samelanguagelater"));
+	Catalogue::AddLexerModule(&lmSameName);
+	Catalogue::AddLexerModule(&lmSameNameLater);
+	EXPECT_EQ(&lmSameName, Catalogue::Find("samename"));
+	EXPECT_EQ(&lmSameNameLater, Catalogue::Find(921));
+}
+
+TEST(CatalogueTest, AutomaticLanguage) {
+	Catalogue::AddLexerModule(&lmAutomatic);
+	EXPECT_GT(lmAutomatic.GetLanguage(), SCLEX_AUTOMATIC);
+	EXPECT_EQ(&lmAutomatic, Catalogue::Find(lmAutomatic.GetLanguage()));
+	EXPECT_EQ(&lmAutomatic, Catalogue::Find("automatic"));
+}
+
+TEST(CatalogueTest, AddedOnce) {
+	const int count = Catalogue::Count();
+	Catalogue::AddLexerModule(&lmAddedTwice);
+	Catalogue::AddLexerModule(&lmAddedTwice);
+	EXPECT_EQ(count + 1, Catalogue::Count());
+	EXPECT_EQ(&lmAddedTwice, Catalogue::At(count));
+	EXPECT_EQ(0, Catalogue::At(count + 1));
+	EXPECT_EQ(0, Catalogue::At(-1));
+}
+
+TEST(CatalogueTest, Unnamed) {
+	Catalogue::AddLexerModule(&lmUnnamed);
+	EXPECT_EQ(&lmUnnamed, Catalogue::Find(940));
+	EXPECT_EQ(0, Catalogue::Find(""));
+}
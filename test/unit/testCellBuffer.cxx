@@ -0,0 +1,1179 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "Sci_Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+
+#include <gtest/gtest.h>
+
+// Test CellBuffer styles with each style storage.
+
+class CellBufferStyleTest : public ::testing::TestWithParam<bool> {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer(false, GetParam());
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	CellBuffer *pcb;
+
+	void Insert(Sci_Position position, const char *s) {
+		bool startSequence = false;
+		pcb->InsertString(position, s, strlen(s), startSequence);
+	}
+
+	std::string Styles() {
+		std::string styles(pcb->Length(), '\0');
+		pcb->GetStyleRange(reinterpret_cast<unsigned char *>(&styles[0]), 0, pcb->Length());
+		return styles;
+	}
+};
+
+TEST_P(CellBufferStyleTest, IsUnstyledInitially) {
+	Insert(0, "abcdef");
+	EXPECT_EQ(6, pcb->Length());
+	EXPECT_EQ(std::string(6, '\0'), Styles());
+	EXPECT_EQ(0, pcb->StyleAt(-1));
+	EXPECT_EQ(0, pcb->StyleAt(6));
+}
+
+TEST_P(CellBufferStyleTest, SetStyleAt) {
+	Insert(0, "abcdef");
+	EXPECT_TRUE(pcb->SetStyleAt(2, 5));
+	EXPECT_FALSE(pcb->SetStyleAt(2, 5));
+	EXPECT_EQ(5, pcb->StyleAt(2));
+	EXPECT_EQ(0, pcb->StyleAt(3));
+	// Outside the buffer has no effect
+	EXPECT_FALSE(pcb->SetStyleAt(-1, 5));
+	EXPECT_FALSE(pcb->SetStyleAt(6, 5));
+	EXPECT_EQ(std::string("\0\0\5\0\0\0", 6), Styles());
+}
+
+TEST_P(CellBufferStyleTest, SetStyleFor) {
+	Insert(0, "abcdefgh");
+	EXPECT_TRUE(pcb->SetStyleFor(1, 4, 3, '\377'));
+	EXPECT_FALSE(pcb->SetStyleFor(2, 2, 3, '\377'));
+	EXPECT_TRUE(pcb->SetStyleFor(3, 4, 7, '\377'));
+	EXPECT_FALSE(pcb->SetStyleFor(3, 0, 9, '\377'));
+	EXPECT_EQ(std::string("\0\3\3\7\7\7\7\0", 8), Styles());
+}
+
+TEST_P(CellBufferStyleTest, Mask) {
+	Insert(0, "abcd");
+	pcb->SetStyleFor(0, 4, 0x21, '\377');
+	// Only the masked bits change
+	EXPECT_TRUE(pcb->SetStyleFor(1, 2, 0x02, 0x0f));
+	EXPECT_FALSE(pcb->SetStyleFor(1, 2, 0x02, 0x0f));
+	EXPECT_TRUE(pcb->SetStyleAt(3, 0x40, 0x40));
+	EXPECT_EQ(std::string("\x21\x22\x22\x61", 4), Styles());
+}
+
+TEST_P(CellBufferStyleTest, InsertedTextIsUnstyled) {
+	Insert(0, "abcdef");
+	pcb->SetStyleFor(0, 6, 4, '\377');
+	Insert(3, "123");
+	Insert(0, "<");
+	Insert(pcb->Length(), ">");
+	EXPECT_EQ(std::string("\0\4\4\4\0\0\0\4\4\4\0", 11), Styles());
+}
+
+TEST_P(CellBufferStyleTest, DeletedTextRemovesStyles) {
+	Insert(0, "abcdef");
+	pcb->SetStyleFor(0, 2, 1, '\377');
+	pcb->SetStyleFor(2, 2, 2, '\377');
+	pcb->SetStyleFor(4, 2, 3, '\377');
+	bool startSequence = false;
+	pcb->DeleteChars(1, 4, startSequence);
+	EXPECT_EQ(std::string("\1\3", 2), Styles());
+	pcb->DeleteChars(0, 2, startSequence);
+	EXPECT_EQ(0, pcb->Length());
+	Insert(0, "xy");
+	EXPECT_EQ(std::string("\0\0", 2), Styles());
+}
+
+TEST_P(CellBufferStyleTest, HighStyles) {
+	Insert(0, "abc");
+	pcb->SetStyleAt(1, '\377');
+	EXPECT_EQ('\377', pcb->StyleAt(1));
+	unsigned char styles[3];
+	pcb->GetStyleRange(styles, 0, 3);
+	EXPECT_EQ(0, styles[0]);
+	EXPECT_EQ(255, styles[1]);
+}
+
+TEST_P(CellBufferStyleTest, StylesAllocatedWhenFirstSet) {
+	Insert(0, "abcdef");
+	EXPECT_FALSE(pcb->HasStyles());
+	// Setting the default style or only bits outside the mask does not allocate
+	EXPECT_FALSE(pcb->SetStyleAt(1, 0));
+	EXPECT_FALSE(pcb->SetStyleFor(0, 6, 0, '\377'));
+	EXPECT_FALSE(pcb->SetStyleFor(0, 6, 0x10, 0x0f));
+	EXPECT_FALSE(pcb->HasStyles());
+	bool startSequence = false;
+	pcb->DeleteChars(1, 2, startSequence);
+	EXPECT_EQ(std::string(4, '\0'), Styles());
+	EXPECT_TRUE(pcb->SetStyleFor(1, 2, 6, '\377'));
+	EXPECT_TRUE(pcb->HasStyles());
+	Insert(4, "gh");
+	EXPECT_EQ(std::string("\0\6\6\0\0\0", 6), Styles());
+}
+
+INSTANTIATE_TEST_CASE_P(StyleStorage, CellBufferStyleTest, ::testing::Values(false, true));
+
+// Test the line character indices against counting the characters of each line.
+
+namespace {
+
+// Characters as UTF-32 and UTF-16 code units: plain, 2 byte, 3 byte, 4 byte,
+// and invalid bytes which count as one character each.
+const char *indexPieces[] = {
+	"a", "xyz", "\r", "\n", "\r\n", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\x80", "\xe2\x82", "\xf0"
+};
+
+void CountWidths(const std::string &text, Sci_Position &utf32, Sci_Position &utf16) {
+	utf32 = 0;
+	utf16 = 0;
+	size_t i = 0;
+	while (i < text.length()) {
+		const unsigned char ch = text[i];
+		size_t width = 1;
+		if ((ch >= 0xc2) && (ch < 0xe0) && (i + 1 < text.length()) && ((text[i+1] & 0xc0) == 0x80))
+			width = 2;
+		else if ((ch >= 0xe1) && (ch < 0xf0) && (i + 2 < text.length()) &&
+			((text[i+1] & 0xc0) == 0x80) && ((text[i+2] & 0xc0) == 0x80))
+			width = 3;
+		else if ((ch == 0xf0) && (i + 3 < text.length()) && (static_cast<unsigned char>(text[i+1]) >= 0x90) &&
+			((text[i+1] & 0xc0) == 0x80) && ((text[i+2] & 0xc0) == 0x80) && ((text[i+3] & 0xc0) == 0x80))
+			width = 4;
+		utf32++;
+		utf16 += (width == 4) ? 2 : 1;
+		i += width;
+	}
+}
+
+}
+
+class CellBufferIndexTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer();
+		pcb->SetUTF8Substance(true);
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	CellBuffer *pcb;
+
+	std::string Text() {
+		std::string text(pcb->Length(), '\0');
+		if (pcb->Length())
+			pcb->GetCharRange(&text[0], 0, pcb->Length());
+		return text;
+	}
+
+	void CheckIndices() {
+		const std::string text = Text();
+		Sci_Position utf32 = 0;
+		Sci_Position utf16 = 0;
+		for (Sci_Position line = 0; line <= pcb->Lines(); line++) {
+			ASSERT_EQ(utf32, pcb->IndexLineStart(line, SC_LINECHARACTERINDEX_UTF32)) << line;
+			ASSERT_EQ(utf16, pcb->IndexLineStart(line, SC_LINECHARACTERINDEX_UTF16)) << line;
+			if (line < pcb->Lines()) {
+				const Sci_Position start = pcb->LineStart(line);
+				Sci_Position widthUTF32 = 0;
+				Sci_Position widthUTF16 = 0;
+				CountWidths(text.substr(start, pcb->LineStart(line + 1) - start), widthUTF32, widthUTF16);
+				if (widthUTF32 > 0) {
+					ASSERT_EQ(line, pcb->LineFromPositionIndex(utf32 + widthUTF32 - 1, SC_LINECHARACTERINDEX_UTF32));
+				}
+				utf32 += widthUTF32;
+				utf16 += widthUTF16;
+			}
+		}
+	}
+};
+
+TEST_F(CellBufferIndexTest, NoIndexInitially) {
+	EXPECT_EQ(SC_LINECHARACTERINDEX_NONE, pcb->LineCharacterIndex());
+	bool startSequence = false;
+	pcb->InsertString(0, "a\xc3\xa9\nb", 5, startSequence);
+	// Without an index the character index is the position
+	EXPECT_EQ(4, pcb->IndexLineStart(1, SC_LINECHARACTERINDEX_UTF32));
+}
+
+TEST_F(CellBufferIndexTest, AllocateAndRelease) {
+	bool startSequence = false;
+	pcb->InsertString(0, "a\xc3\xa9\n\xf0\x9f\x98\x80\nc", 10, startSequence);
+	pcb->AllocateLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32 | SC_LINECHARACTERINDEX_UTF16);
+	pcb->AllocateLineCharacterIndex(SC_LINECHARACTERINDEX_UTF16);
+	EXPECT_EQ(SC_LINECHARACTERINDEX_UTF32 | SC_LINECHARACTERINDEX_UTF16, pcb->LineCharacterIndex());
+	EXPECT_EQ(3, pcb->IndexLineStart(1, SC_LINECHARACTERINDEX_UTF32));
+	EXPECT_EQ(5, pcb->IndexLineStart(2, SC_LINECHARACTERINDEX_UTF32));
+	EXPECT_EQ(6, pcb->IndexLineStart(2, SC_LINECHARACTERINDEX_UTF16));
+	EXPECT_EQ(7, pcb->IndexLineStart(3, SC_LINECHARACTERINDEX_UTF16));
+	EXPECT_EQ(1, pcb->LineFromPositionIndex(4, SC_LINECHARACTERINDEX_UTF16));
+	pcb->ReleaseLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32 | SC_LINECHARACTERINDEX_UTF16);
+	EXPECT_EQ(SC_LINECHARACTERINDEX_UTF16, pcb->LineCharacterIndex());
+	pcb->ReleaseLineCharacterIndex(SC_LINECHARACTERINDEX_UTF16);
+	EXPECT_EQ(SC_LINECHARACTERINDEX_NONE, pcb->LineCharacterIndex());
+}
+
+TEST_F(CellBufferIndexTest, UTF8Substance) {
+	bool startSequence = false;
+	pcb->InsertString(0, "\xc3\xa9\n\xc3\xa9", 5, startSequence);
+	pcb->AllocateLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32);
+	EXPECT_EQ(2, pcb->IndexLineStart(1, SC_LINECHARACTERINDEX_UTF32));
+	// Other encodings count each byte
+	pcb->SetUTF8Substance(false);
+	EXPECT_EQ(3, pcb->IndexLineStart(1, SC_LINECHARACTERINDEX_UTF32));
+	EXPECT_EQ(5, pcb->IndexLineStart(2, SC_LINECHARACTERINDEX_UTF32));
+}
+
+TEST_F(CellBufferIndexTest, MaintainedByEdits) {
+	pcb->AllocateLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32 | SC_LINECHARACTERINDEX_UTF16);
+	srand(7);
+	bool startSequence = false;
+	for (int i = 0; i < 2000; i++) {
+		if ((pcb->Length() > 0) && (rand() % 3 == 0)) {
+			const Sci_Position position = rand() % pcb->Length();
+			const Sci_Position deleteLength = std::min<Sci_Position>(rand() % 12 + 1, pcb->Length() - position);
+			pcb->DeleteChars(position, deleteLength, startSequence);
+		} else {
+			std::string insert;
+			const int pieces = (i % 50 == 0) ? 2000 : rand() % 5 + 1;
+			for (int p = 0; p < pieces; p++) {
+				insert += indexPieces[rand() % (sizeof(indexPieces) / sizeof(indexPieces[0]))];
+			}
+			const Sci_Position position = pcb->Length() ? rand() % (pcb->Length() + 1) : 0;
+			pcb->InsertString(position, insert.c_str(), insert.length(), startSequence);
+		}
+		if (i % 100 == 0) {
+			CheckIndices();
+		}
+	}
+	CheckIndices();
+	while (pcb->CanUndo()) {
+		const int steps = pcb->StartUndo();
+		for (int step = 0; step < steps; step++)
+			pcb->PerformUndoStep();
+	}
+	EXPECT_EQ(0, pcb->Length());
+	CheckIndices();
+}
+
+// Test the undo history of CellBuffer.
+
+class CellBufferUndoTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer();
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	CellBuffer *pcb;
+
+	bool Insert(Sci_Position position, const char *s) {
+		bool startSequence = false;
+		pcb->InsertString(position, s, strlen(s), startSequence);
+		return startSequence;
+	}
+
+	bool Delete(Sci_Position position, Sci_Position deleteLength) {
+		bool startSequence = false;
+		pcb->DeleteChars(position, deleteLength, startSequence);
+		return startSequence;
+	}
+
+	void Undo() {
+		const int steps = pcb->StartUndo();
+		for (int step = 0; step < steps; step++)
+			pcb->PerformUndoStep();
+	}
+
+	void Redo() {
+		const int steps = pcb->StartRedo();
+		for (int step = 0; step < steps; step++)
+			pcb->PerformRedoStep();
+	}
+
+	int UndoSteps() {
+		int steps = 0;
+		while (pcb->CanUndo()) {
+			Undo();
+			steps++;
+		}
+		return steps;
+	}
+
+	std::string Text() {
+		std::string text(pcb->Length(), '\0');
+		if (pcb->Length())
+			pcb->GetCharRange(&text[0], 0, pcb->Length());
+		return text;
+	}
+};
+
+TEST_F(CellBufferUndoTest, TypingCoalescesText) {
+	EXPECT_TRUE(Insert(0, "a"));
+	EXPECT_FALSE(Insert(1, "b"));
+	EXPECT_FALSE(Insert(2, "c"));
+	EXPECT_EQ(1, pcb->StartUndo());
+	const Action &action = pcb->GetUndoStep();
+	EXPECT_EQ(insertAction, action.at);
+	EXPECT_EQ(0, action.position);
+	ASSERT_EQ(3, action.lenData);
+	EXPECT_EQ(0, memcmp("abc", action.data, 3));
+	pcb->PerformUndoStep();
+	EXPECT_EQ("", Text());
+	Redo();
+	EXPECT_EQ("abc", Text());
+}
+
+TEST_F(CellBufferUndoTest, DeletionCoalescesText) {
+	Insert(0, "abcdef");
+	// Forward deletion extends the text of the action
+	EXPECT_TRUE(Delete(1, 1));
+	EXPECT_FALSE(Delete(1, 1));
+	EXPECT_FALSE(Delete(1, 1));
+	EXPECT_EQ("aef", Text());
+	EXPECT_EQ(1, pcb->StartUndo());
+	pcb->PerformUndoStep();
+	EXPECT_EQ("abcdef", Text());
+	// Backspace is a separate action for each character of the same user operation
+	EXPECT_TRUE(Delete(5, 1));
+	EXPECT_FALSE(Delete(4, 1));
+	EXPECT_EQ(2, pcb->StartUndo());
+	pcb->PerformUndoStep();
+	pcb->PerformUndoStep();
+	EXPECT_EQ("abcdef", Text());
+}
+
+TEST_F(CellBufferUndoTest, TypingAfterUndoReplacesRedo) {
+	Insert(0, "abc");
+	Insert(0, "x");
+	Undo();
+	EXPECT_TRUE(pcb->CanRedo());
+	Insert(1, "d");
+	EXPECT_FALSE(pcb->CanRedo());
+	EXPECT_EQ("adbc", Text());
+	Undo();
+	EXPECT_EQ("abc", Text());
+}
+
+TEST_F(CellBufferUndoTest, StepLimit) {
+	pcb->SetUndoStepLimit(3);
+	EXPECT_EQ(3, pcb->UndoStepLimit());
+	for (int i = 0; i < 10; i++) {
+		Insert(0, "ab");
+	}
+	EXPECT_EQ(3, UndoSteps());
+	EXPECT_EQ(14, pcb->Length());
+}
+
+TEST_F(CellBufferUndoTest, StepLimitRemovesSavePoint) {
+	pcb->SetUndoStepLimit(2);
+	Insert(0, "a");
+	pcb->SetSavePoint();
+	Insert(0, "b");
+	Undo();
+	EXPECT_TRUE(pcb->IsSavePoint());
+	Redo();
+	Insert(0, "c");
+	Insert(0, "d");
+	EXPECT_FALSE(pcb->IsSavePoint());
+	EXPECT_EQ(2, UndoSteps());
+	EXPECT_FALSE(pcb->IsSavePoint());
+	EXPECT_EQ("ba", Text());
+}
+
+TEST_F(CellBufferUndoTest, MemoryLimit) {
+	const Sci_Position memoryLimit = 512 * 1024;
+	pcb->SetUndoMemoryLimit(memoryLimit);
+	EXPECT_EQ(memoryLimit, pcb->UndoMemoryLimit());
+	const std::string block(10000, 'x');
+	for (int i = 0; i < 200; i++) {
+		Insert(0, block.c_str());
+		EXPECT_LE(pcb->UndoMemory(), memoryLimit);
+	}
+	const int steps = UndoSteps();
+	EXPECT_GT(steps, 10);
+	EXPECT_LT(steps, 60);
+	EXPECT_EQ((200 - steps) * block.length(), Text().length());
+	pcb->DeleteUndoHistory();
+	EXPECT_LT(pcb->UndoMemory(), 10000);
+}
+
+TEST_F(CellBufferUndoTest, CurrentOperationNotTrimmed) {
+	pcb->SetUndoMemoryLimit(1000);
+	pcb->BeginUndoAction();
+	for (int i = 0; i < 100; i++) {
+		Insert(0, "0123456789");
+	}
+	pcb->EndUndoAction();
+	EXPECT_EQ(1, UndoSteps());
+	EXPECT_EQ(0, pcb->Length());
+}
+
+// Random edits, undo and redo checked against the text at each step.
+
+TEST_F(CellBufferUndoTest, MatchesTextHistory) {
+	const int limits[] = {0, 1, 5, 40};
+	for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+		pcb->DeleteUndoHistory();
+		pcb->SetUndoStepLimit(limits[l]);
+		pcb->SetUndoMemoryLimit((l == 2) ? 64 * 1024 : 0);
+		std::vector<std::string> states(1, Text());
+		size_t current = 0;
+		srand(static_cast<unsigned int>(l + 11));
+		Sci_Position caret = 0;
+		for (int i = 0; i < 1000; i++) {
+			const int choice = rand() % 10;
+			if ((choice == 0) && pcb->CanUndo()) {
+				Undo();
+				ASSERT_GT(current, 0u);
+				current--;
+				ASSERT_EQ(states[current], Text());
+			} else if ((choice == 1) && pcb->CanRedo()) {
+				Redo();
+				current++;
+				ASSERT_EQ(states[current], Text());
+			} else {
+				bool startSequence;
+				if ((choice < 5) || (pcb->Length() == 0)) {
+					// Mostly typing at a caret that sometimes jumps
+					if ((rand() % 8 == 0) || (caret > pcb->Length()))
+						caret = rand() % (pcb->Length() + 1);
+					const char *inserts[] = {"a", "b", "\n", "long insertion", "c"};
+					const char *s = inserts[rand() % 5];
+					startSequence = Insert(caret, s);
+					caret += strlen(s);
+				} else {
+					if (caret >= pcb->Length())
+						caret = rand() % pcb->Length();
+					const Sci_Position deleteLength = std::min<Sci_Position>(rand() % 3 + 1, pcb->Length() - caret);
+					startSequence = Delete(caret, deleteLength);
+				}
+				states.resize(current + 1);
+				if (startSequence) {
+					states.push_back(Text());
+					current++;
+				} else {
+					states[current] = Text();
+				}
+			}
+			if (limits[l] > 0) {
+				int steps = 0;
+				while (pcb->CanUndo()) {
+					Undo();
+					steps++;
+				}
+				ASSERT_LE(steps, limits[l]);
+				for (int step = 0; step < steps; step++) {
+					Redo();
+				}
+				ASSERT_EQ(states[current], Text());
+			}
+		}
+		// Everything still in the history can be undone
+		while (pcb->CanUndo()) {
+			Undo();
+			ASSERT_GT(current, 0u);
+			current--;
+			ASSERT_EQ(states[current], Text());
+		}
+		if (limits[l] == 0) {
+			EXPECT_EQ(0u, current);
+		}
+	}
+}
+
+// Save an undo history to a file then load it into another buffer with the same text.
+
+namespace {
+
+// Reads a whole file into memory in place of mapping it.
+class FileContents : public MappedFile {
+	std::string contents;
+public:
+	explicit FileContents(const char *path, size_t lengthMaximum=std::string::npos) {
+		FILE *fp = fopen(path, "rb");
+		if (fp) {
+			char buffer[4096];
+			size_t lenRead;
+			while ((lenRead = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+				contents.append(buffer, lenRead);
+			}
+			fclose(fp);
+		}
+		contents = contents.substr(0, lengthMaximum);
+	}
+	virtual const char *Data() const {
+		return contents.c_str();
+	}
+	virtual size_t Length() const {
+		return contents.length();
+	}
+};
+
+const char *undoPath = "undoHistoryTest.sciundo";
+
+}
+
+class CellBufferUndoFileTest : public CellBufferUndoTest {
+protected:
+	virtual void TearDown() {
+		remove(undoPath);
+		CellBufferUndoTest::TearDown();
+	}
+
+	// A buffer with the same text as pcb but no undo history
+	CellBuffer *Copy() {
+		CellBuffer *pcbCopy = new CellBuffer();
+		const std::string text = Text();
+		pcbCopy->SetUndoCollection(false);
+		bool startSequence = false;
+		pcbCopy->InsertString(0, text.c_str(), text.length(), startSequence);
+		pcbCopy->SetUndoCollection(true);
+		return pcbCopy;
+	}
+};
+
+TEST_F(CellBufferUndoFileTest, SaveAndLoad) {
+	Insert(0, "abc");
+	pcb->AddUndoAction(-5, true);
+	Delete(1, 1);
+	pcb->SetSavePoint();
+	Insert(2, "xy");
+	Insert(0, "\n");
+	Undo();
+	EXPECT_EQ("acxy", Text());
+	ASSERT_TRUE(pcb->SaveUndoHistory(undoPath));
+
+	CellBuffer *pcbOriginal = pcb;
+	pcb = Copy();
+	EXPECT_FALSE(pcb->CanUndo());
+	FileContents *file = new FileContents(undoPath);
+	ASSERT_TRUE(pcb->LoadUndoHistory(file));
+	EXPECT_FALSE(pcb->IsSavePoint());
+	EXPECT_TRUE(pcb->CanRedo());
+	Redo();
+	EXPECT_EQ("\nacxy", Text());
+	Undo();
+	Undo();
+	EXPECT_TRUE(pcb->IsSavePoint());
+	EXPECT_EQ("ac", Text());
+	EXPECT_EQ(1, pcb->StartUndo());
+	EXPECT_EQ(removeAction, pcb->GetUndoStep().at);
+	pcb->PerformUndoStep();
+	EXPECT_EQ("abc", Text());
+	EXPECT_EQ(2, pcb->StartUndo());
+	EXPECT_EQ(containerAction, pcb->GetUndoStep().at);
+	EXPECT_EQ(-5, pcb->GetUndoStep().position);
+	pcb->PerformUndoStep();
+	pcb->PerformUndoStep();
+	EXPECT_EQ("", Text());
+	EXPECT_FALSE(pcb->CanUndo());
+	// Editing after loading keeps the loaded actions that can be undone
+	Redo();
+	Insert(3, "d");
+	Delete(0, 1);
+	EXPECT_EQ("bcd", Text());
+	EXPECT_EQ(2, UndoSteps());
+	EXPECT_EQ("", Text());
+	delete pcbOriginal;
+}
+
+TEST_F(CellBufferUndoFileTest, SaveReplacesLoaded) {
+	Insert(0, "abc");
+	Insert(0, "d");
+	ASSERT_TRUE(pcb->SaveUndoHistory(undoPath));
+	ASSERT_TRUE(pcb->LoadUndoHistory(new FileContents(undoPath)));
+	Insert(0, "e");
+	ASSERT_TRUE(pcb->SaveUndoHistory(undoPath));
+	CellBuffer *pcbOriginal = pcb;
+	pcb = Copy();
+	delete pcbOriginal;
+	ASSERT_TRUE(pcb->LoadUndoHistory(new FileContents(undoPath)));
+	EXPECT_EQ(3, UndoSteps());
+}
+
+TEST_F(CellBufferUndoFileTest, LoadRequiresSameText) {
+	Insert(0, "abc");
+	ASSERT_TRUE(pcb->SaveUndoHistory(undoPath));
+	CellBuffer *pcbOriginal = pcb;
+	pcb = Copy();
+	delete pcbOriginal;
+	Insert(1, "x");
+	FileContents file(undoPath);
+	EXPECT_FALSE(pcb->LoadUndoHistory(&file));
+	Delete(1, 1);
+	pcb->DeleteUndoHistory();
+	// Truncated files are rejected
+	for (size_t length = 0; length < file.Length(); length++) {
+		FileContents truncated(undoPath, length);
+		EXPECT_FALSE(pcb->LoadUndoHistory(&truncated));
+	}
+	EXPECT_FALSE(pcb->CanUndo());
+}
+
+TEST_F(CellBufferUndoFileTest, LoadRejectsActionsOutsideText) {
+	Insert(0, "abc");
+	ASSERT_TRUE(pcb->SaveUndoHistory(undoPath));
+	CellBuffer *pcbOriginal = pcb;
+	pcb = Copy();
+	delete pcbOriginal;
+	FileContents file(undoPath);
+	std::string contents(file.Data(), file.Length());
+	// The insertion is a type byte, its position, its length and its text
+	const size_t text = contents.find("abc");
+	ASSERT_NE(std::string::npos, text);
+	ASSERT_EQ(0, contents[text - 2]);
+	// Position 5 zigzag encoded is past the end of the text
+	contents[text - 2] = 10;
+	FILE *fp = fopen(undoPath, "wb");
+	ASSERT_TRUE(fp != NULL);
+	fwrite(contents.c_str(), 1, contents.length(), fp);
+	fclose(fp);
+	FileContents corrupt(undoPath);
+	EXPECT_FALSE(pcb->LoadUndoHistory(&corrupt));
+	EXPECT_FALSE(pcb->CanUndo());
+}
+
+// Test snapshots of CellBuffer with gap buffer and piece table text.
+
+namespace {
+
+// The contents of a buffer or snapshot copied in full for comparison.
+struct Contents {
+	std::string text;
+	std::string styles;
+	std::vector<Sci_Position> lineStarts;
+};
+
+template <typename BUFFER>
+Contents ContentsOf(BUFFER &buffer) {
+	Contents contents;
+	contents.text.resize(buffer.Length());
+	contents.styles.resize(buffer.Length());
+	if (buffer.Length()) {
+		buffer.GetCharRange(&contents.text[0], 0, buffer.Length());
+		buffer.GetStyleRange(reinterpret_cast<unsigned char *>(&contents.styles[0]), 0, buffer.Length());
+	}
+	for (Sci_Position line = 0; line <= buffer.Lines(); line++) {
+		contents.lineStarts.push_back(buffer.LineStart(line));
+	}
+	return contents;
+}
+
+}
+
+class CellBufferSnapshotTest : public ::testing::TestWithParam<bool> {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer(GetParam());
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	CellBuffer *pcb;
+
+	void Insert(Sci_Position position, const char *s) {
+		bool startSequence = false;
+		pcb->InsertString(position, s, strlen(s), startSequence);
+	}
+
+	void ExpectContents(const Contents &expected, ISnapshot *snapshot) {
+		const Contents actual = ContentsOf(*snapshot);
+		EXPECT_EQ(expected.text, actual.text);
+		EXPECT_EQ(expected.styles, actual.styles);
+		ASSERT_EQ(expected.lineStarts.size(), actual.lineStarts.size());
+		EXPECT_TRUE(expected.lineStarts == actual.lineStarts);
+		for (Sci_Position line = 0; line + 1 < static_cast<Sci_Position>(expected.lineStarts.size()); line++) {
+			const Sci_Position start = expected.lineStarts[line];
+			const Sci_Position end = expected.lineStarts[line + 1];
+			ASSERT_EQ(line, snapshot->LineFromPosition(start));
+			if (end > start) {
+				ASSERT_EQ(line, snapshot->LineFromPosition(end - 1));
+			}
+		}
+	}
+};
+
+TEST_P(CellBufferSnapshotTest, Empty) {
+	ISnapshot *snapshot = pcb->Snapshot();
+	EXPECT_EQ(0, snapshot->Length());
+	EXPECT_EQ(1, snapshot->Lines());
+	EXPECT_EQ(0, snapshot->LineStart(1));
+	EXPECT_EQ(0, snapshot->CharAt(0));
+	EXPECT_EQ(0, snapshot->LineFromPosition(10));
+	snapshot->Release();
+}
+
+TEST_P(CellBufferSnapshotTest, UnchangedByEdits) {
+	Insert(0, "ab\ncd\r\nef");
+	pcb->SetStyleFor(3, 2, 7, '\377');
+	const int version = pcb->ContentVersion();
+	ISnapshot *snapshot = pcb->Snapshot();
+	EXPECT_EQ(version, snapshot->Version());
+	const Contents expected = ContentsOf(*pcb);
+	Insert(1, "\n\n");
+	pcb->SetStyleFor(0, 4, 2, '\377');
+	EXPECT_NE(version, pcb->ContentVersion());
+	ExpectContents(expected, snapshot);
+	EXPECT_EQ('c', snapshot->CharAt(3));
+	EXPECT_EQ(7, snapshot->StyleAt(3));
+	EXPECT_EQ(0, snapshot->StyleAt(1));
+	EXPECT_EQ(3, snapshot->LineStart(1));
+	snapshot->Release();
+}
+
+TEST_P(CellBufferSnapshotTest, ReusedWhenUnchanged) {
+	Insert(0, "abc");
+	ISnapshot *snapshot = pcb->Snapshot();
+	ISnapshot *second = pcb->Snapshot();
+	EXPECT_EQ(snapshot, second);
+	second->Release();
+	// Setting the same style changes nothing
+	pcb->SetStyleFor(0, 3, 0, '\377');
+	second = pcb->Snapshot();
+	EXPECT_EQ(snapshot, second);
+	second->Release();
+	pcb->SetStyleFor(0, 1, 1, '\377');
+	second = pcb->Snapshot();
+	EXPECT_NE(snapshot, second);
+	EXPECT_EQ(snapshot->Version(), second->Version());
+	EXPECT_EQ(1, second->StyleAt(0));
+	second->Release();
+	snapshot->Release();
+}
+
+TEST_P(CellBufferSnapshotTest, ContiguousRangePointer) {
+	std::string text;
+	for (int i = 0; i < 5000; i++)
+		text += "line of text\n";
+	Insert(0, text.c_str());
+	Insert(30000, "inserted");
+	text.insert(30000, "inserted");
+	ISnapshot *snapshot = pcb->Snapshot();
+	std::string joined;
+	Sci_Position position = 0;
+	while (position < snapshot->Length()) {
+		Sci_Position lengthContiguous = 0;
+		const char *contiguous = snapshot->ContiguousRangePointer(position, lengthContiguous);
+		ASSERT_TRUE(contiguous != 0);
+		ASSERT_GT(lengthContiguous, 0);
+		joined.append(contiguous, lengthContiguous);
+		position += lengthContiguous;
+	}
+	EXPECT_EQ(text, joined);
+	Sci_Position lengthContiguous = 1;
+	EXPECT_EQ(0, snapshot->ContiguousRangePointer(snapshot->Length(), lengthContiguous));
+	EXPECT_EQ(0, lengthContiguous);
+	snapshot->Release();
+}
+
+TEST_P(CellBufferSnapshotTest, EditSharesUnchangedBlocks) {
+	std::string text;
+	for (int i = 0; i < 30000; i++)
+		text += "line of text\n";
+	Insert(0, text.c_str());
+	ISnapshot *previous = pcb->Snapshot();
+	const Sci_Position positionEdit = static_cast<Sci_Position>(text.length()) - 100;
+	Insert(positionEdit, "x");
+	// While the previous snapshot is held only the block with the edit is copied
+	ISnapshot *snapshot = pcb->Snapshot();
+	for (Sci_Position position = 0; position < positionEdit - 0x10000; position += 0x8000) {
+		Sci_Position lengthPrevious = 0;
+		Sci_Position length = 0;
+		EXPECT_EQ(previous->ContiguousRangePointer(position, lengthPrevious),
+			snapshot->ContiguousRangePointer(position, length)) << "position " << position;
+	}
+	Sci_Position lengthPrevious = 0;
+	Sci_Position length = 0;
+	EXPECT_NE(previous->ContiguousRangePointer(positionEdit, lengthPrevious),
+		snapshot->ContiguousRangePointer(positionEdit, length));
+	EXPECT_EQ('x', snapshot->CharAt(positionEdit));
+	previous->Release();
+	snapshot->Release();
+}
+
+// Random edits and styling with snapshots checked against full copies made at the
+// same time. Some snapshots are kept until the end to check they do not change and the
+// last snapshot is held until the next is made so that they share unchanged blocks.
+
+TEST_P(CellBufferSnapshotTest, MatchesContents) {
+	const int lineEndTypes[] = {SC_LINE_END_TYPE_DEFAULT, SC_LINE_END_TYPE_UNICODE};
+	for (size_t t = 0; t < sizeof(lineEndTypes) / sizeof(lineEndTypes[0]); t++) {
+		pcb->SetLineEndTypes(lineEndTypes[t]);
+		std::vector<ISnapshot *> kept;
+		std::vector<Contents> keptContents;
+		ISnapshot *previous = 0;
+		srand(static_cast<unsigned int>(t + 3));
+		const char *pieces[] = {"a", "bcd", "\r", "\n", "\r\n", "\xe2\x80\xa8", "\xc2\x85", "\xe2", "\x80"};
+		for (int i = 0; i < 1000; i++) {
+			const int choice = rand() % 10;
+			if ((choice < 3) && (pcb->Length() > 0)) {
+				const Sci_Position position = rand() % pcb->Length();
+				const Sci_Position deleteLength = std::min<Sci_Position>(rand() % 6 + 1, pcb->Length() - position);
+				bool startSequence = false;
+				pcb->DeleteChars(position, deleteLength, startSequence);
+			} else if ((choice < 5) && (pcb->Length() > 0)) {
+				const Sci_Position position = rand() % pcb->Length();
+				const Sci_Position lengthStyle = std::min<Sci_Position>(rand() % 20 + 1, pcb->Length() - position);
+				pcb->SetStyleFor(position, lengthStyle, static_cast<char>(rand() % 4), '\377');
+			} else {
+				std::string insert;
+				const int count = (i % 125 == 0) ? 5000 : rand() % 4 + 1;
+				for (int p = 0; p < count; p++) {
+					insert += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+				}
+				const Sci_Position position = pcb->Length() ? rand() % (pcb->Length() + 1) : 0;
+				bool startSequence = false;
+				pcb->InsertString(position, insert.c_str(), insert.length(), startSequence);
+			}
+			if (rand() % 80 == 0) {
+				ISnapshot *snapshot = pcb->Snapshot();
+				const Contents contents = ContentsOf(*pcb);
+				ExpectContents(contents, snapshot);
+				if (rand() % 5 == 0) {
+					snapshot->AddRef();
+					kept.push_back(snapshot);
+					keptContents.push_back(contents);
+				}
+				if (previous)
+					previous->Release();
+				previous = snapshot;
+			}
+		}
+		if (previous)
+			previous->Release();
+		for (size_t k = 0; k < kept.size(); k++) {
+			ExpectContents(keptContents[k], kept[k]);
+			kept[k]->Release();
+		}
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(TextStorage, CellBufferSnapshotTest, ::testing::Values(false, true));
+
+// Test the change journal of CellBuffer.
+
+class CellBufferJournalTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer();
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	CellBuffer *pcb;
+
+	void Insert(Sci_Position position, const char *s) {
+		bool startSequence = false;
+		pcb->InsertString(position, s, strlen(s), startSequence);
+	}
+
+	void Delete(Sci_Position position, Sci_Position deleteLength) {
+		bool startSequence = false;
+		pcb->DeleteChars(position, deleteLength, startSequence);
+	}
+
+	std::string Text() {
+		std::string text(pcb->Length(), '\0');
+		if (pcb->Length())
+			pcb->GetCharRange(&text[0], 0, pcb->Length());
+		return text;
+	}
+
+	std::string EntryText(int version) {
+		std::string text(pcb->Journal().EntryText(version, 0), '\0');
+		if (text.length())
+			pcb->Journal().EntryText(version, &text[0]);
+		return text;
+	}
+
+	// Apply the changes since version to the text at that version
+	std::string ApplyChangesSince(int version, std::string text) {
+		SplitVector<ChangeSpan> changes;
+		EXPECT_TRUE(pcb->Journal().ChangesSince(version, changes));
+		const std::string current = Text();
+		for (int i = 0; i < changes.Length(); i++) {
+			const ChangeSpan &change = changes[i];
+			if (i > 0) {
+				// In order and not overlapping
+				EXPECT_LT(changes[i - 1].position + changes[i - 1].lengthInserted, change.position + 1);
+			}
+			text.replace(change.position, change.lengthRemoved, current, change.position, change.lengthInserted);
+		}
+		return text;
+	}
+};
+
+TEST_F(CellBufferJournalTest, OffByDefault) {
+	EXPECT_EQ(0, pcb->ChangeJournalSize());
+	Insert(0, "abc");
+	Delete(1, 1);
+	EXPECT_EQ(2, pcb->ContentVersion());
+	EXPECT_EQ(2, pcb->Journal().VersionStart());
+	EXPECT_EQ(2, pcb->Journal().VersionEnd());
+	SplitVector<ChangeSpan> changes;
+	EXPECT_FALSE(pcb->Journal().ChangesSince(0, changes));
+	EXPECT_TRUE(pcb->Journal().ChangesSince(2, changes));
+	EXPECT_EQ(0, changes.Length());
+}
+
+TEST_F(CellBufferJournalTest, RecordsChanges) {
+	Insert(0, "abc");
+	pcb->SetChangeJournalSize(10);
+	pcb->SetChangeJournalTextLimit(100);
+	const int version = pcb->ContentVersion();
+	Insert(1, "xy");
+	Delete(0, 2);
+	EXPECT_EQ("ybc", Text());
+	EXPECT_EQ(version, pcb->Journal().VersionStart());
+	EXPECT_EQ(version + 2, pcb->Journal().VersionEnd());
+	EXPECT_EQ(0, pcb->Journal().Entry(version));
+	const JournalEntry *entry = pcb->Journal().Entry(version + 1);
+	ASSERT_TRUE(entry != 0);
+	EXPECT_TRUE(entry->insertion);
+	EXPECT_EQ(1, entry->position);
+	EXPECT_EQ(2, entry->length);
+	EXPECT_EQ("xy", EntryText(version + 1));
+	entry = pcb->Journal().Entry(version + 2);
+	ASSERT_TRUE(entry != 0);
+	EXPECT_FALSE(entry->insertion);
+	EXPECT_EQ(0, entry->position);
+	EXPECT_EQ(2, entry->length);
+	EXPECT_EQ("ax", EntryText(version + 2));
+
+	// Net change replaces "a" with "y"
+	SplitVector<ChangeSpan> changes;
+	EXPECT_TRUE(pcb->Journal().ChangesSince(version, changes));
+	ASSERT_EQ(1, changes.Length());
+	EXPECT_EQ(0, changes[0].position);
+	EXPECT_EQ(1, changes[0].lengthRemoved);
+	EXPECT_EQ(1, changes[0].lengthInserted);
+
+	// Removing inserted text leaves no change
+	Insert(3, "123");
+	Delete(3, 3);
+	EXPECT_TRUE(pcb->Journal().ChangesSince(version + 2, changes));
+	EXPECT_EQ(0, changes.Length());
+	EXPECT_FALSE(pcb->Journal().ChangesSince(version - 1, changes));
+	EXPECT_FALSE(pcb->Journal().ChangesSince(pcb->ContentVersion() + 1, changes));
+}
+
+TEST_F(CellBufferJournalTest, SizeLimit) {
+	pcb->SetChangeJournalSize(16);
+	for (int i = 0; i < 100; i++) {
+		Insert(0, "a");
+		EXPECT_LE(pcb->Journal().VersionEnd() - pcb->Journal().VersionStart(), 16);
+	}
+	EXPECT_EQ(100, pcb->Journal().VersionEnd());
+	EXPECT_GT(pcb->Journal().VersionStart(), 80);
+	SplitVector<ChangeSpan> changes;
+	EXPECT_FALSE(pcb->Journal().ChangesSince(80, changes));
+	EXPECT_TRUE(pcb->Journal().ChangesSince(pcb->Journal().VersionStart(), changes));
+	pcb->SetChangeJournalSize(0);
+	EXPECT_EQ(100, pcb->Journal().VersionStart());
+}
+
+TEST_F(CellBufferJournalTest, TextLimit) {
+	pcb->SetChangeJournalSize(100);
+	pcb->SetChangeJournalTextLimit(16);
+	Insert(0, "0123456789");
+	Insert(0, "abcdefghij");
+	// Text of the oldest change is dropped while its change is kept
+	EXPECT_EQ(0, pcb->Journal().EntryText(1, 0));
+	EXPECT_TRUE(pcb->Journal().Entry(1) != 0);
+	EXPECT_EQ("abcdefghij", EntryText(2));
+	// Text longer than the limit is never kept
+	Insert(0, "01234567890123456789");
+	EXPECT_EQ(0, pcb->Journal().EntryText(3, 0));
+	EXPECT_EQ("abcdefghij", EntryText(2));
+	Delete(0, 4);
+	EXPECT_EQ("0123", EntryText(4));
+	pcb->SetChangeJournalTextLimit(0);
+	EXPECT_EQ(0, pcb->Journal().EntryText(4, 0));
+}
+
+// Random edits with the text kept at some versions so that applying the
+// changes since each version to its text can be checked against the current text.
+
+TEST_F(CellBufferJournalTest, ChangesSinceMatchText) {
+	pcb->SetChangeJournalSize(1000);
+	std::vector<int> versions;
+	std::vector<std::string> texts;
+	srand(7);
+	for (int i = 0; i < 900; i++) {
+		if ((pcb->Length() > 0) && (rand() % 3 == 0)) {
+			const Sci_Position position = rand() % pcb->Length();
+			Delete(position, std::min<Sci_Position>(rand() % 8 + 1, pcb->Length() - position));
+		} else {
+			const char *pieces[] = {"a", "bc", "def", "ghij"};
+			const Sci_Position position = pcb->Length() ? rand() % (pcb->Length() + 1) : 0;
+			Insert(position, pieces[rand() % 4]);
+		}
+		if (rand() % 10 == 0) {
+			versions.push_back(pcb->ContentVersion());
+			texts.push_back(Text());
+		}
+	}
+	const std::string text = Text();
+	for (size_t v = 0; v < versions.size(); v++) {
+		ASSERT_EQ(text, ApplyChangesSince(versions[v], texts[v]));
+	}
+}
+
+// Compare the memory used by each style storage for the lexed example files
+// repeated to make a larger document. A style byte for each position uses the
+// document length while runs use a position and a value for each change of style.
+// The comparison is disabled by default as it only reports sizes; run it with
+//	./unitTest --gtest_also_run_disabled_tests --gtest_filter=*CellBufferStyleMemory*
+
+namespace {
+
+// Parse the {style}text format used for the .styled files.
+bool ReadStyled(const char *path, std::string &text, std::string &styles) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	std::string contents;
+	char buffer[4096];
+	size_t lenRead;
+	while ((lenRead = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+		contents.append(buffer, lenRead);
+	}
+	fclose(fp);
+	char style = 0;
+	for (size_t i = 0; i < contents.length(); i++) {
+		if (contents[i] == '{') {
+			size_t end = i + 1;
+			int value = 0;
+			while ((end < contents.length()) && (contents[end] >= '0') && (contents[end] <= '9')) {
+				value = value * 10 + contents[end] - '0';
+				end++;
+			}
+			if ((end > i + 1) && (end < contents.length()) && (contents[end] == '}')) {
+				style = static_cast<char>(value);
+				i = end;
+				continue;
+			}
+		}
+		text += contents[i];
+		styles += style;
+	}
+	return true;
+}
+
+const Sci_Position scaledLength = 1024 * 1024;
+
+}
+
+TEST(CellBufferStyleMemory, RunsSameAsBytes) {
+	std::string text;
+	std::string styles;
+	ASSERT_TRUE(ReadStyled("../examples/x.cxx.styled", text, styles));
+	CellBuffer cbBytes(false, false);
+	CellBuffer cbRuns(false, true);
+	bool startSequence = false;
+	cbBytes.InsertString(0, text.c_str(), text.length(), startSequence);
+	cbRuns.InsertString(0, text.c_str(), text.length(), startSequence);
+	for (Sci_Position i = 0; i < static_cast<Sci_Position>(text.length()); i++) {
+		cbBytes.SetStyleAt(i, styles[i]);
+		cbRuns.SetStyleAt(i, styles[i]);
+	}
+	// Deleting across runs joins them
+	cbBytes.DeleteChars(10, 50, startSequence);
+	cbRuns.DeleteChars(10, 50, startSequence);
+	const Sci_Position length = cbRuns.Length();
+	std::vector<unsigned char> stylesBytes(length);
+	std::vector<unsigned char> stylesRuns(length);
+	cbBytes.GetStyleRange(&stylesBytes[0], 0, length);
+	cbRuns.GetStyleRange(&stylesRuns[0], 0, length);
+	EXPECT_TRUE(stylesBytes == stylesRuns);
+}
+
+TEST(CellBufferStyleMemory, DISABLED_Examples) {
+	const char *examples[] = {
+		"x.asp", "x.cxx", "x.d", "x.html", "x.lua", "x.php", "x.pl", "x.py", "x.rb", "x.vb"
+	};
+	int filesRead = 0;
+	for (size_t e = 0; e < sizeof(examples) / sizeof(examples[0]); e++) {
+		const std::string path = std::string("../examples/") + examples[e] + ".styled";
+		std::string text;
+		std::string styles;
+		if (!ReadStyled(path.c_str(), text, styles) || text.empty())
+			continue;
+		filesRead++;
+		CellBuffer cbBytes(false, false);
+		CellBuffer cbRuns(false, true);
+		RunStyles rs;
+		bool startSequence = false;
+		cbBytes.SetUndoCollection(false);
+		cbRuns.SetUndoCollection(false);
+		while (cbRuns.Length() < scaledLength) {
+			const Sci_Position position = cbRuns.Length();
+			cbBytes.InsertString(position, text.c_str(), text.length(), startSequence);
+			cbRuns.InsertString(position, text.c_str(), text.length(), startSequence);
+			rs.InsertSpace(position, text.length());
+			Sci_Position i = 0;
+			while (i < static_cast<Sci_Position>(text.length())) {
+				Sci_Position lengthRun = 1;
+				while ((i + lengthRun < static_cast<Sci_Position>(text.length())) &&
+					(styles[i + lengthRun] == styles[i]))
+					lengthRun++;
+				cbBytes.SetStyleFor(position + i, lengthRun, styles[i], '\377');
+				cbRuns.SetStyleFor(position + i, lengthRun, styles[i], '\377');
+				Sci_Position positionFill = position + i;
+				Sci_Position lengthFill = lengthRun;
+				rs.FillRange(positionFill, static_cast<unsigned char>(styles[i]), lengthFill);
+				i += lengthRun;
+			}
+		}
+		const Sci_Position length = cbRuns.Length();
+		std::vector<unsigned char> stylesBytes(length);
+		std::vector<unsigned char> stylesRuns(length);
+		cbBytes.GetStyleRange(&stylesBytes[0], 0, length);
+		cbRuns.GetStyleRange(&stylesRuns[0], 0, length);
+		EXPECT_TRUE(stylesBytes == stylesRuns) << examples[e];
+		const size_t memoryBytes = length;
+		const size_t memoryRuns = rs.Runs() * (sizeof(Sci_Position) + sizeof(int));
+		printf("%-7s %8d bytes %7d runs: style bytes %8d style runs %8d (%.0f%%)\n",
+			examples[e], static_cast<int>(length), static_cast<int>(rs.Runs()),
+			static_cast<int>(memoryBytes), static_cast<int>(memoryRuns),
+			100.0 * memoryRuns / memoryBytes);
+	}
+	if (filesRead == 0)
+		printf("No example files found in ../examples\n");
+}
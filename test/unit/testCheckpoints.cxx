@@ -0,0 +1,135 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "SparseState.h"
+#include "Checkpoints.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test Checkpoints.
+
+class CheckpointsTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcp = new Checkpoints<int>(10);
+	}
+
+	virtual void TearDown() {
+		delete pcp;
+		pcp = 0;
+	}
+
+	// Record as a lexer would when styling lines [lineStart, lineEnd)
+	void Lex(int lineStart, int lineEnd) {
+		for (int line=lineStart; line<lineEnd; line++) {
+			if (pcp->Due(line))
+				pcp->Record(line, line * 100);
+		}
+	}
+
+	Checkpoints<int> *pcp;
+};
+
+TEST_F(CheckpointsTest, IsEmptyInitially) {
+	EXPECT_EQ(0u, pcp->size());
+	EXPECT_TRUE(pcp->Due(0));
+	int state = 7;
+	EXPECT_EQ(-1, pcp->Restart(5, state));
+	EXPECT_EQ(7, state);
+}
+
+TEST_F(CheckpointsTest, RecordsEachInterval) {
+	Lex(0, 35);
+	EXPECT_EQ(4u, pcp->size());
+	EXPECT_FALSE(pcp->Due(31));
+	EXPECT_TRUE(pcp->Due(40));
+}
+
+TEST_F(CheckpointsTest, RestartFromNearest) {
+	Lex(0, 100);
+	int state = 0;
+	EXPECT_EQ(50, pcp->Restart(57, state));
+	EXPECT_EQ(5000, state);
+	EXPECT_EQ(0, pcp->Restart(0, state));
+	EXPECT_EQ(0, state);
+}
+
+TEST_F(CheckpointsTest, RestartDiscardsLater) {
+	Lex(0, 100);
+	int state = 0;
+	EXPECT_EQ(40, pcp->Restart(40, state));
+	EXPECT_EQ(5u, pcp->size());
+	// Only checkpoints at or before the restart remain
+	EXPECT_EQ(40, pcp->Restart(95, state));
+	EXPECT_EQ(4000, state);
+}
+
+TEST_F(CheckpointsTest, RelexingRecordsAgain) {
+	Lex(0, 100);
+	int state = 0;
+	const int line = pcp->Restart(63, state);
+	EXPECT_EQ(60, line);
+	Lex(line, 80);
+	EXPECT_EQ(70, pcp->Restart(75, state));
+	EXPECT_EQ(7000, state);
+}
+
+TEST_F(CheckpointsTest, RestartNearOnlyWithinInterval) {
+	Lex(0, 100);
+	int state = 0;
+	EXPECT_EQ(50, pcp->RestartNear(57, state));
+	EXPECT_EQ(5000, state);
+	// Lexing stopped early so there are no checkpoints after line 50
+	state = 0;
+	EXPECT_EQ(-1, pcp->RestartNear(95, state));
+	EXPECT_EQ(0, state);
+	EXPECT_TRUE(pcp->Due(90));
+	EXPECT_EQ(50, pcp->Restart(95, state));
+	EXPECT_EQ(5000, state);
+}
+
+TEST_F(CheckpointsTest, RestartNearDiscardsLater) {
+	Lex(0, 100);
+	int state = 0;
+	pcp->Record(60, 6000);
+	pcp->Record(90, 9000);
+	EXPECT_EQ(-1, pcp->RestartNear(85, state));
+	EXPECT_EQ(60, pcp->Restart(95, state));
+}
+
+TEST_F(CheckpointsTest, LinesPassedOver) {
+	// Lexers may move over several lines at once and so miss some lines
+	pcp->Record(0, 1);
+	pcp->Record(13, 2);
+	pcp->Record(31, 3);
+	EXPECT_FALSE(pcp->Due(40));
+	EXPECT_TRUE(pcp->Due(41));
+	int state = 0;
+	EXPECT_EQ(13, pcp->Restart(30, state));
+	EXPECT_EQ(2, state);
+}
+
+TEST_F(CheckpointsTest, SameStateOnDifferentLines) {
+	pcp->Record(0, 1);
+	pcp->Record(10, 1);
+	int state = 0;
+	EXPECT_EQ(10, pcp->Restart(15, state));
+	EXPECT_EQ(1, state);
+}
+
+TEST_F(CheckpointsTest, Clear) {
+	Lex(0, 100);
+	pcp->Clear();
+	EXPECT_EQ(0u, pcp->size());
+	int state = 0;
+	EXPECT_EQ(-1, pcp->Restart(50, state));
+}
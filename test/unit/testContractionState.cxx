@@ -6,6 +6,7 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
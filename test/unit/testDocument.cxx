@@ -0,0 +1,859 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "LexerModule.h"
+
+#include <gtest/gtest.h>
+
+// Document only asks the platform about DBCS when a DBCS code page is set.
+
+bool Platform::IsDBCSLeadByte(int, char) {
+	return false;
+}
+
+int Platform::DBCSCharLength(int, const char *) {
+	return 1;
+}
+
+int Platform::DBCSCharMaxLength() {
+	return 2;
+}
+
+int Platform::Minimum(int a, int b) {
+	return (a < b) ? a : b;
+}
+
+int Platform::Maximum(int a, int b) {
+	return (a > b) ? a : b;
+}
+
+int Platform::Clamp(int val, int minVal, int maxVal) {
+	if (val > maxVal)
+		val = maxVal;
+	if (val < minVal)
+		val = minVal;
+	return val;
+}
+
+extern LexerModule lmCPP;
+extern LexerModule lmHTML;
+extern LexerModule lmLatex;
+extern LexerModule lmLua;
+extern LexerModule lmPerl;
+extern LexerModule lmPython;
+extern LexerModule lmSQL;
+extern LexerModule lmTCL;
+
+// Test that lexing a large document on several threads produces the same
+// styles, fold levels and line states as lexing it sequentially.
+
+// Forwards to a lexer while counting the ranges it lexes on their own threads and the
+// ranges that are merged rather than lexed again.
+class CountingLexer : public ILexerWithRestart {
+	ILexerWithRestart *lexer;
+public:
+	int ranges;
+	int merged;
+	explicit CountingLexer(ILexerWithRestart *lexer_) : lexer(lexer_), ranges(0), merged(0) {
+	}
+	virtual ~CountingLexer() {
+	}
+	int SCI_METHOD Version() const {
+		return lexer->Version();
+	}
+	void SCI_METHOD Release() {
+		lexer->Release();
+		delete this;
+	}
+	const char * SCI_METHOD PropertyNames() {
+		return lexer->PropertyNames();
+	}
+	int SCI_METHOD PropertyType(const char *name) {
+		return lexer->PropertyType(name);
+	}
+	const char * SCI_METHOD DescribeProperty(const char *name) {
+		return lexer->DescribeProperty(name);
+	}
+	int SCI_METHOD PropertySet(const char *key, const char *val) {
+		return lexer->PropertySet(key, val);
+	}
+	const char * SCI_METHOD DescribeWordListSets() {
+		return lexer->DescribeWordListSets();
+	}
+	int SCI_METHOD WordListSet(int n, const char *wl) {
+		return lexer->WordListSet(n, wl);
+	}
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
+		lexer->Lex(startPos, lengthDoc, initStyle, pAccess);
+	}
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument *pAccess) {
+		lexer->Fold(startPos, lengthDoc, initStyle, pAccess);
+	}
+	void * SCI_METHOD PrivateCall(int operation, void *pointer) {
+		return lexer->PrivateCall(operation, pointer);
+	}
+	int SCI_METHOD LineEndTypesSupported() {
+		return lexer->LineEndTypesSupported();
+	}
+	int SCI_METHOD AllocateSubStyles(int styleBase, int numberStyles) {
+		return lexer->AllocateSubStyles(styleBase, numberStyles);
+	}
+	int SCI_METHOD SubStylesStart(int styleBase) {
+		return lexer->SubStylesStart(styleBase);
+	}
+	int SCI_METHOD SubStylesLength(int styleBase) {
+		return lexer->SubStylesLength(styleBase);
+	}
+	int SCI_METHOD StyleFromSubStyle(int subStyle) {
+		return lexer->StyleFromSubStyle(subStyle);
+	}
+	int SCI_METHOD PrimaryStyleFromStyle(int style) {
+		return lexer->PrimaryStyleFromStyle(style);
+	}
+	void SCI_METHOD FreeSubStyles() {
+		lexer->FreeSubStyles();
+	}
+	void SCI_METHOD SetIdentifiers(int style, const char *identifiers) {
+		lexer->SetIdentifiers(style, identifiers);
+	}
+	int SCI_METHOD DistanceToSecondaryStyles() {
+		return lexer->DistanceToSecondaryStyles();
+	}
+	const char * SCI_METHOD GetSubStyleBases() {
+		return lexer->GetSubStyleBases();
+	}
+	bool SCI_METHOD IsRestartLine(Sci_Position line, IDocument *pAccess) {
+		return lexer->IsRestartLine(line, pAccess);
+	}
+	ILexerWithRestart * SCI_METHOD RangeLexer() {
+		ranges++;
+		// A lexer that can lex ranges concurrently returns itself
+		ILexerWithRestart *rangeLexer = lexer->RangeLexer();
+		return (rangeLexer == lexer) ? this : rangeLexer;
+	}
+	void SCI_METHOD MergeRange(ILexerWithRestart *rangeLexer, Sci_Position lineStart, Sci_Position lineEnd) {
+		merged++;
+		lexer->MergeRange((rangeLexer == this) ? lexer : rangeLexer, lineStart, lineEnd);
+	}
+};
+
+class TestLexer : public LexInterface {
+public:
+	TestLexer(Document *pdoc_, const LexerModule *lexerModule) : LexInterface(pdoc_) {
+		instance = lexerModule->Create();
+	}
+	~TestLexer() {
+		instance->Release();
+		instance = 0;
+	}
+	void PropertySet(const char *key, const char *val) {
+		instance->PropertySet(key, val);
+	}
+	void WordListSet(int n, const char *wl) {
+		instance->WordListSet(n, wl);
+	}
+	// Count what the instance does when lexing on several threads.
+	CountingLexer *Count() {
+		CountingLexer *counting = new CountingLexer(static_cast<ILexerWithRestart *>(instance));
+		instance = counting;
+		return counting;
+	}
+};
+
+static std::string ReadExample(const char *name) {
+	std::string text;
+	std::string path = std::string("../examples/") + name;
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (fp) {
+		char buffer[4096];
+		size_t lenRead;
+		while ((lenRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+			text.append(buffer, lenRead);
+		fclose(fp);
+	}
+	if (!text.empty() && (text[text.length()-1] != '\n'))
+		text += '\n';
+	return text;
+}
+
+class LexingThreadsTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		sequential = new Document();
+		threaded = new Document();
+		threaded->SetLexingThreads(4);
+		counting = 0;
+	}
+
+	virtual void TearDown() {
+		delete sequential;
+		sequential = 0;
+		delete threaded;
+		threaded = 0;
+	}
+
+	// Repeat the example to about 1.5 megabytes. When blockStart is set, a
+	// block of blockLines lines is opened near the middle and closed with
+	// blockEnd so that it spans a boundary between ranges.
+	std::string BuildText(const std::string &example, const char *blockStart, const char *blockEnd) {
+		std::string text;
+		while (text.length() < 1500000) {
+			text += example;
+			if (blockStart && (text.length() > 600000)) {
+				text += blockStart;
+				text += "\n";
+				for (int line=0; line<blockLines; line++)
+					text += "  spanning the middle of the document\n";
+				text += blockEnd;
+				text += "\n";
+				blockStart = 0;
+			}
+		}
+		return text;
+	}
+
+	void SetLexer(Document *pdoc, const LexerModule *lexerModule, const char *keywords,
+		const char *propertyKey, const char *propertyValue) {
+		TestLexer *lexer = new TestLexer(pdoc, lexerModule);
+		lexer->PropertySet("fold", "1");
+		if (propertyKey)
+			lexer->PropertySet(propertyKey, propertyValue);
+		lexer->WordListSet(0, keywords);
+		if (pdoc == threaded)
+			counting = lexer->Count();
+		pdoc->pli = lexer;
+	}
+
+	void CheckSameAsSequential(const LexerModule *lexerModule, const char *example, const char *keywords,
+		const char *blockStart=0, const char *blockEnd=0, const char *propertyKey=0, const char *propertyValue=0) {
+		const std::string text = BuildText(ReadExample(example), blockStart, blockEnd);
+		ASSERT_GT(text.length(), 1000000u) << example;
+		Document *docs[] = {sequential, threaded};
+		for (int d=0; d<2; d++) {
+			docs[d]->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+			SetLexer(docs[d], lexerModule, keywords, propertyKey, propertyValue);
+			docs[d]->EnsureStyledTo(docs[d]->Length());
+		}
+		ASSERT_EQ(sequential->Length(), threaded->GetEndStyled());
+		// The document was divided into ranges which were lexed on other threads
+		ASSERT_TRUE(counting);
+		ASSERT_GT(counting->ranges, 1) << example;
+		for (int pos=0; pos<sequential->Length(); pos++) {
+			ASSERT_EQ(sequential->StyleAt(pos), threaded->StyleAt(pos)) << example << " position " << pos;
+		}
+		for (int line=0; line<sequential->LinesTotal(); line++) {
+			ASSERT_EQ(sequential->GetLevel(line), threaded->GetLevel(line)) << example << " line " << line;
+			ASSERT_EQ(sequential->GetLineState(line), threaded->GetLineState(line)) << example << " line " << line;
+		}
+	}
+
+	static const int blockLines = 12000;
+
+	Document *sequential;
+	Document *threaded;
+	CountingLexer *counting;	///< Owned by the lexer of threaded
+};
+
+static const char cppKeywords[] = "double else if int return while";
+static const char luaKeywords[] = "end function if local return then";
+static const char pythonKeywords[] = "class def else for if import in return";
+
+TEST_F(LexingThreadsTest, CPP) {
+	CheckSameAsSequential(&lmCPP, "x.cxx", cppKeywords, 0, 0, "lexer.cpp.track.preprocessor", "0");
+	EXPECT_GT(counting->merged, 0);
+}
+
+TEST_F(LexingThreadsTest, CPPTrackingPreprocessor) {
+	// Definitions seen by earlier ranges affect later ones so every range is lexed again.
+	CheckSameAsSequential(&lmCPP, "x.cxx", cppKeywords);
+	EXPECT_EQ(0, counting->merged);
+}
+
+TEST_F(LexingThreadsTest, CPPCommentOverBoundary) {
+	CheckSameAsSequential(&lmCPP, "x.cxx", cppKeywords, "/*", "*/", "lexer.cpp.track.preprocessor", "0");
+	EXPECT_GT(counting->merged, 0);
+}
+
+TEST_F(LexingThreadsTest, Lua) {
+	CheckSameAsSequential(&lmLua, "x.lua", luaKeywords);
+}
+
+TEST_F(LexingThreadsTest, LuaCommentOverBoundary) {
+	CheckSameAsSequential(&lmLua, "x.lua", luaKeywords, "--[[", "]]");
+	EXPECT_GT(counting->merged, 0);
+}
+
+TEST_F(LexingThreadsTest, Python) {
+	CheckSameAsSequential(&lmPython, "x.py", pythonKeywords);
+	EXPECT_GT(counting->merged, 0);
+}
+
+TEST_F(LexingThreadsTest, PythonStringOverBoundary) {
+	CheckSameAsSequential(&lmPython, "x.py", pythonKeywords, "\"\"\"", "\"\"\"");
+	EXPECT_GT(counting->merged, 0);
+}
+
+// Test that restyling after edits, which may resume from the lexer's checkpoints and
+// stop where it reproduces the earlier styles, produces the same styles and fold levels
+// as lexing the edited text from scratch.
+
+static const char perlSample[] =
+	"use strict;\n"
+	"my $text = <<\"END\";\n"
+	"Here document $line with @interpolation\n"
+	"  spanning lines\n"
+	"END\n"
+	"print <<'RAW', \"after\\n\";\n"
+	"raw $text\n"
+	"RAW\n"
+	"\n"
+	"=pod\n"
+	"\n"
+	"Documentation for the module.\n"
+	"\n"
+	"=cut\n"
+	"\n"
+	"sub parse {\n"
+	"    my ($self, %args) = @_;\n"
+	"    my $re = qr{^\\s*(\\w+)\\s*=\\s*(.*?)$}x;\n"
+	"    my $s = q{nested {braces} here\n"
+	"        over two lines};\n"
+	"    $s =~ s/(\\d+)/<$1>/g;\n"
+	"    return \"multi-line\n"
+	"string with $s\";\n"
+	"}\n"
+	"format STDOUT =\n"
+	"@<<<<< @>>>>>\n"
+	"$name, $value\n"
+	".\n";
+
+static const char *perlInsertions[] = {
+	"<<EOT;\n", "EOT\n", "\"", "'", "q{", "}", "\n=head1 Name\n\n", "\n=cut\n", "#", "s/a/", "1.5e3", "\n",
+};
+
+class IncrementalLexingTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pdoc = new Document();
+		propertyKey = 0;
+		propertyValue = 0;
+	}
+
+	virtual void TearDown() {
+		delete pdoc;
+		pdoc = 0;
+	}
+
+	void SetLexer(Document *pdocLexed, const LexerModule *lexerModule, const char *keywords) {
+		TestLexer *lexer = new TestLexer(pdocLexed, lexerModule);
+		lexer->PropertySet("fold", "1");
+		if (propertyKey)
+			lexer->PropertySet(propertyKey, propertyValue);
+		lexer->WordListSet(0, keywords);
+		pdocLexed->pli = lexer;
+	}
+
+	void CheckSameAsFromScratch(const LexerModule *lexerModule, const char *keywords, int edit) {
+		const int length = pdoc->Length();
+		std::vector<char> text(length + 1);
+		pdoc->GetCharRange(&text[0], 0, length);
+		Document fresh;
+		fresh.InsertString(0, &text[0], length);
+		SetLexer(&fresh, lexerModule, keywords);
+		fresh.EnsureStyledTo(length);
+		pdoc->EnsureStyledTo(length);
+		ASSERT_EQ(length, pdoc->GetEndStyled()) << "edit " << edit;
+		// Only styles are compared as LexPerl sets the line state of POD lines without
+		// clearing it elsewhere, so line states may be left over from earlier text.
+		for (int pos=0; pos<length; pos++) {
+			ASSERT_EQ(fresh.StyleAt(pos), pdoc->StyleAt(pos)) << "edit " << edit << " position " << pos;
+		}
+		for (int line=0; line<pdoc->LinesTotal(); line++) {
+			ASSERT_EQ(fresh.GetLevel(line), pdoc->GetLevel(line)) << "edit " << edit << " line " << line;
+		}
+	}
+
+	void CheckEdits(const LexerModule *lexerModule, const char *keywords, const char *sample,
+		const char **insertions, size_t countInsertions) {
+		std::string text;
+		for (int i=0; i<200; i++)
+			text += sample;
+		pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+		SetLexer(pdoc, lexerModule, keywords);
+		pdoc->EnsureStyledTo(pdoc->Length());
+		// Pseudo-random edits from a fixed linear congruential generator
+		unsigned int seed = 1;
+		for (int edit=0; edit<40; edit++) {
+			seed = seed * 1103515245 + 12345;
+			const int pos = (seed >> 8) % pdoc->Length();
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) % 4 == 0) {
+				pdoc->DeleteChars(pos, std::min(1 + static_cast<int>((seed >> 8) % 20), static_cast<int>(pdoc->Length()) - pos));
+			} else {
+				const char *insertion = insertions[(seed >> 16) % countInsertions];
+				pdoc->InsertString(pos, insertion, static_cast<int>(strlen(insertion)));
+			}
+			// Style only the text after some edits as when it is displayed
+			if (edit % 2)
+				pdoc->EnsureStyledTo(std::min(pos + 1000, static_cast<int>(pdoc->Length())));
+			else
+				CheckSameAsFromScratch(lexerModule, keywords, edit);
+		}
+	}
+
+	Document *pdoc;
+	// An extra property for the lexer
+	const char *propertyKey;
+	const char *propertyValue;
+};
+
+static const char perlKeywords[] = "format my print q qr return s sub use";
+
+TEST_F(IncrementalLexingTest, Perl) {
+	CheckEdits(&lmPerl, perlKeywords, perlSample, perlInsertions, sizeof(perlInsertions) / sizeof(perlInsertions[0]));
+}
+
+TEST_F(IncrementalLexingTest, PerlEditsNearTopThenFarDown) {
+	std::string text;
+	for (int i=0; i<500; i++)
+		text += perlSample;
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmPerl, perlKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// A style set directly on a line between the edits shows whether lexing went over it
+	const int lineMarked = pdoc->LinesTotal() / 2;
+	pdoc->StartStyling(pdoc->LineStart(lineMarked), static_cast<char>(0xff));
+	pdoc->SetStyleFor(1, SCE_PL_ERROR);
+	pdoc->StartStyling(pdoc->Length(), static_cast<char>(0xff));
+	// Lexing stops soon after an edit near the top so no checkpoints are kept after it
+	pdoc->InsertString(pdoc->LineStart(3), "x", 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	// An edit far down resumes near it rather than from the checkpoints near the top
+	const int lineEdit = pdoc->LinesTotal() - 100;
+	pdoc->InsertString(pdoc->LineStart(lineEdit), "x", 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineEdit + 10));
+	EXPECT_EQ(SCE_PL_ERROR, pdoc->StyleAt(pdoc->LineStart(lineMarked)));
+}
+
+static const char cppSample[] =
+	"// Parse a line\n"
+	"static int Parse(const char *s) {\n"
+	"\tint n = 0;\n"
+	"\twhile (*s) {\n"
+	"\t\tif (*s == '\\\\')\n"
+	"\t\t\tn += 2; /* escape */\n"
+	"\t\ts++;\n"
+	"\t}\n"
+	"\treturn n;\n"
+	"}\n"
+	"\n";
+
+static const char cppPreprocessorSample[] =
+	"#ifdef FEATURE\n"
+	"int feature = 1;\n"
+	"#else\n"
+	"const char *s = R\"x(raw\n"
+	"string)x\";\n"
+	"#endif\n"
+	"#define LIMIT 10\n"
+	"int Limit() {\n"
+	"\treturn LIMIT;\n"
+	"}\n";
+
+static const char *cppInsertions[] = {
+	"{", "}", "/*", "*/", "\"", "//", "\n", "#if 0\n", "#endif\n", "#define FEATURE\n", "R\"x(", ")x\"", "x",
+};
+
+TEST_F(IncrementalLexingTest, CPP) {
+	CheckEdits(&lmCPP, cppKeywords, cppSample, cppInsertions, sizeof(cppInsertions) / sizeof(cppInsertions[0]));
+}
+
+// LexCPP styles a line comment started inside a preprocessor line differently when it
+// restyles from that line so these insertions do not start line comments.
+static const char *cppPreprocessorInsertions[] = {
+	"{", "}", "/*", "*/", "\"", "\n", "#if 0\n", "#endif\n", "#define FEATURE\n", "R\"x(", ")x\"", "x",
+};
+
+TEST_F(IncrementalLexingTest, CPPPreprocessor) {
+	std::string sample = std::string(cppSample) + cppPreprocessorSample;
+	CheckEdits(&lmCPP, cppKeywords, sample.c_str(), cppPreprocessorInsertions,
+		sizeof(cppPreprocessorInsertions) / sizeof(cppPreprocessorInsertions[0]));
+}
+
+TEST_F(IncrementalLexingTest, StopsWhenConverged) {
+	std::string text;
+	for (int i=0; i<1000; i++)
+		text += cppSample;
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// An edit inside one function only needs the text near it to be restyled
+	pdoc->InsertString(pdoc->LineStart(2), "x", 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 0);
+	// Starting a comment changes everything after it
+	pdoc->InsertString(pdoc->LineStart(2), "/*", 2);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_LT(pdoc->GetEndStyled(), pdoc->LineStart(1000));
+	// Removing it again restyles up to and then over the earlier styles left after the
+	// first 20 lines
+	pdoc->DeleteChars(pdoc->LineStart(2), 2);
+	pdoc->EnsureStyledTo(pdoc->LineStart(40));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 1);
+}
+
+TEST_F(IncrementalLexingTest, OpeningBraceRefolds) {
+	std::string text;
+	for (int i=0; i<100; i++)
+		text += cppSample;
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// The styles after an unmatched brace are the same but all the fold levels change
+	pdoc->InsertString(pdoc->LineStart(2), "{", 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 0);
+}
+
+TEST_F(IncrementalLexingTest, KeywordsRestyleEverything) {
+	std::string text;
+	for (int i=0; i<100; i++)
+		text += cppSample;
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	pdoc->InsertString(pdoc->LineStart(2), "x", 1);
+	// Changing keywords invalidates the earlier styles after the change
+	static_cast<TestLexer *>(pdoc->pli)->WordListSet(0, "int return");
+	pdoc->ModifiedAt(0);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	CheckSameAsFromScratch(&lmCPP, "int return", 0);
+}
+
+TEST_F(IncrementalLexingTest, IncludeGuardConverges) {
+	std::string text = "#ifndef SAMPLE_H\n#define SAMPLE_H\n";
+	for (int i=0; i<1000; i++)
+		text += cppSample;
+	text += "#endif\n";
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// The preprocessor state of the lines after an edit is kept with them
+	pdoc->InsertString(pdoc->LineStart(5), "x", 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 0);
+	// A definition that no conditional reads does not change any later styles
+	pdoc->InsertString(0, "#define UNUSED 1\n", 17);
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 1);
+}
+
+TEST_F(IncrementalLexingTest, DefinitionRestylesConditionalsReadingIt) {
+	std::string text = "#define FEATURE\n";
+	for (int i=0; i<500; i++)
+		text += cppSample;
+	text += "#ifdef FEATURE\nint feature = 1;\n#endif\n#if LIMIT\nint limit = 1;\n#endif\n";
+	for (int i=0; i<500; i++)
+		text += cppSample;
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int lineFeature = pdoc->LineFromPosition(static_cast<int>(text.find("int feature")));
+	EXPECT_EQ(SCE_C_WORD, pdoc->StyleAt(pdoc->LineStart(lineFeature)));
+	EXPECT_EQ(SCE_C_WORD | 0x40, pdoc->StyleAt(pdoc->LineStart(lineFeature + 3)));
+	// Removing the definition keeps the styles up to the conditional far below it that
+	// reads the definition, which is then lexed again when needed
+	pdoc->DeleteChars(0, pdoc->LineStart(1));
+	pdoc->EnsureStyledTo(pdoc->LineStart(20));
+	EXPECT_EQ(pdoc->LineStart(lineFeature - 2), pdoc->GetEndStyled());
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineFeature + 20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	EXPECT_EQ(SCE_C_WORD | 0x40, pdoc->StyleAt(pdoc->LineStart(lineFeature - 1)));
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 0);
+	// A definition read by an expression
+	pdoc->InsertString(0, "#define LIMIT 10\n", 17);
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineFeature + 20));
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	EXPECT_EQ(SCE_C_WORD, pdoc->StyleAt(pdoc->LineStart(lineFeature + 3)));
+	CheckSameAsFromScratch(&lmCPP, cppKeywords, 1);
+}
+
+TEST_F(IncrementalLexingTest, ManyDefinitions) {
+	// Each edit makes a different definition so values no longer used are collected
+	std::string text = "#define FEATURE 1\n";
+	for (int i=0; i<20; i++)
+		text += cppPreprocessorSample;
+	text += "#if FEATURE\nint feature = 1;\n#endif\n";
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	SetLexer(pdoc, &lmCPP, cppKeywords);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	for (int edit=0; edit<3000; edit++) {
+		pdoc->InsertString(17, (edit % 2) ? "a" : "b", 1);
+		pdoc->EnsureStyledTo(pdoc->Length());
+		if (edit % 1000 == 999)
+			CheckSameAsFromScratch(&lmCPP, cppKeywords, edit);
+	}
+}
+
+// These lexers set fold levels while lexing rather than in a separate folder.
+
+static const char htmlSample[] =
+	"<html>\n"
+	"<head>\n"
+	"<title>Sample</title>\n"
+	"</head>\n"
+	"<body>\n"
+	"<div class=\"a\">\n"
+	"<p>Text with <b>bold</b>\n"
+	"</p>\n"
+	"<!-- a comment\n"
+	"over lines -->\n"
+	"</div>\n"
+	"</body>\n"
+	"</html>\n";
+
+static const char *htmlInsertions[] = {
+	"<div>\n", "</div>\n", "<!--", "-->", "\"", "<p>", "<b>", "\n", "<", ">",
+};
+
+TEST_F(IncrementalLexingTest, HTML) {
+	propertyKey = "fold.html";
+	propertyValue = "1";
+	CheckEdits(&lmHTML, "b body div head html p title", htmlSample,
+		htmlInsertions, sizeof(htmlInsertions) / sizeof(htmlInsertions[0]));
+}
+
+static const char tclSample[] =
+	"proc add {a b} {\n"
+	"    set c [expr {$a + $b}]\n"
+	"    # comment\n"
+	"    if {$c > 10} {\n"
+	"        puts \"big\"\n"
+	"    }\n"
+	"    return $c\n"
+	"}\n";
+
+static const char *tclInsertions[] = {
+	"{", "}", "{\n", "}\n", "\"", "# ", "\n", "[", "]",
+};
+
+TEST_F(IncrementalLexingTest, Tcl) {
+	CheckEdits(&lmTCL, "expr if proc puts return set", tclSample,
+		tclInsertions, sizeof(tclInsertions) / sizeof(tclInsertions[0]));
+}
+
+static const char sqlSample[] =
+	"create procedure totals as\n"
+	"begin\n"
+	"    select name, -- comment\n"
+	"        case when total > 10 then 'big' else 'small' end\n"
+	"    from sales;\n"
+	"end;\n";
+
+static const char *sqlInsertions[] = {
+	"begin\n", "end;\n", "case ", "when ", "'", "/*", "*/", "-- ", ";", "\n",
+};
+
+static const char sqlKeywords[] = "as begin case create else end from procedure select then when";
+
+TEST_F(IncrementalLexingTest, SQL) {
+	CheckEdits(&lmSQL, sqlKeywords, sqlSample, sqlInsertions, sizeof(sqlInsertions) / sizeof(sqlInsertions[0]));
+}
+
+static const char latexSample[] =
+	"\\section{Results}\n"
+	"Text with $x + y$ inline.\n"
+	"\\begin{verbatim}\n"
+	"raw $ text\n"
+	"\\end{verbatim}\n"
+	"\\begin{math}\n"
+	"a^2 + b^2\n"
+	"\\end{math}\n";
+
+TEST_F(IncrementalLexingTest, HeldStatesOnlyChangedWhenDifferent) {
+	// Lexers that hold state by line only report it changed, which stops the earlier
+	// styles being kept, when an edit changes that state or the number of lines.
+	const LexerModule *modules[] = { &lmSQL, &lmLatex };
+	const char *samples[] = { sqlSample, latexSample };
+	const char *keywords[] = { sqlKeywords, "" };
+	// A line of plain text in each sample
+	const int linesText[] = { 2, 1 };
+	for (int m=0; m<2; m++) {
+		Document doc;
+		std::string text;
+		for (int i=0; i<1000; i++)
+			text += samples[m];
+		doc.InsertString(0, text.c_str(), static_cast<int>(text.length()));
+		SetLexer(&doc, modules[m], keywords[m]);
+		doc.EnsureStyledTo(doc.Length());
+		doc.InsertString(doc.LineStart(linesText[m]) + 1, "x", 1);
+		doc.EnsureStyledTo(doc.LineStart(40));
+		EXPECT_EQ(doc.Length(), doc.GetEndStyled()) << modules[m]->languageName;
+		// An added line moves the lines the states are held for
+		doc.InsertString(doc.LineStart(linesText[m]), "\n", 1);
+		doc.EnsureStyledTo(doc.LineStart(40));
+		EXPECT_LT(doc.GetEndStyled(), doc.Length()) << modules[m]->languageName;
+	}
+}
+
+// Test that styling in the background on a worker thread commits the same styles, fold
+// levels and line states as styling on the UI thread and that edits cancel a pass.
+
+class BackgroundLexingTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		background = new Document();
+		synchronous = new Document();
+	}
+
+	virtual void TearDown() {
+		delete background;
+		background = 0;
+		delete synchronous;
+		synchronous = 0;
+	}
+
+	static void Load(Document *pdoc, const std::string &text) {
+		pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+		TestLexer *lexer = new TestLexer(pdoc, &lmCPP);
+		lexer->PropertySet("fold", "1");
+		lexer->WordListSet(0, cppKeywords);
+		pdoc->pli = lexer;
+	}
+
+	// Several background chunks of the example
+	static std::string BuildText() {
+		const std::string example = ReadExample("x.cxx");
+		std::string text;
+		while (text.length() < 1200000)
+			text += example;
+		return text;
+	}
+
+	// Commit until the pass ends without styling on the UI thread.
+	void CommitAll() {
+		while (background->CommitBackgroundStyles()) {
+			std::this_thread::yield();
+		}
+	}
+
+	void CheckSameAsSynchronous() {
+		ASSERT_EQ(synchronous->Length(), background->Length());
+		synchronous->EnsureStyledTo(synchronous->Length());
+		ASSERT_EQ(background->Length(), background->GetEndStyled());
+		for (int pos=0; pos<synchronous->Length(); pos++) {
+			ASSERT_EQ(synchronous->StyleAt(pos), background->StyleAt(pos)) << "position " << pos;
+		}
+		for (int line=0; line<synchronous->LinesTotal(); line++) {
+			ASSERT_EQ(synchronous->GetLevel(line), background->GetLevel(line)) << "line " << line;
+			ASSERT_EQ(synchronous->GetLineState(line), background->GetLineState(line)) << "line " << line;
+		}
+	}
+
+	Document *background;
+	Document *synchronous;
+};
+
+TEST_F(BackgroundLexingTest, SameAsSynchronous) {
+	const std::string text = BuildText();
+	Load(background, text);
+	Load(synchronous, text);
+	ASSERT_TRUE(background->CanStyleInBackground());
+	background->StyleInBackground(0x8000);
+	CommitAll();
+	CheckSameAsSynchronous();
+}
+
+TEST_F(BackgroundLexingTest, EditCancelsPass) {
+	const std::string text = BuildText();
+	Load(background, text);
+	background->StyleInBackground(0);
+	while ((background->GetEndStyled() == 0) && background->CommitBackgroundStyles()) {
+		std::this_thread::yield();
+	}
+	ASSERT_GT(background->GetEndStyled(), 0);
+	// Opening a comment before the end of the pass changes the styles after it so the
+	// chunks lexed from the earlier text must not be committed
+	const int posEdit = background->Length() - 1000;
+	background->InsertString(posEdit, "/*", 2);
+	EXPECT_LE(background->GetEndStyled(), posEdit);
+	while (background->CommitBackgroundStyles()) {
+		EXPECT_LE(background->GetEndStyled(), posEdit);
+		std::this_thread::yield();
+	}
+	EXPECT_LE(background->GetEndStyled(), posEdit);
+
+	// A new pass continues from the styles that were committed, over fold levels and
+	// line states set before the edit
+	background->InsertString(0, "{\n", 2);
+	background->StyleInBackground(0);
+	CommitAll();
+	std::string edited = text;
+	edited.insert(posEdit, "/*");
+	edited.insert(0, "{\n");
+	Load(synchronous, edited);
+	CheckSameAsSynchronous();
+}
+
+TEST_F(BackgroundLexingTest, ReadingLexerKeepsPass) {
+	Load(background, BuildText());
+	background->StyleInBackground(0);
+	// Only pauses the pass so its chunks are still committed
+	EXPECT_EQ(SC_LINE_END_TYPE_UNICODE, background->pli->LineEndTypesSupported());
+	CommitAll();
+	EXPECT_EQ(background->Length(), background->GetEndStyled());
+}
+
+TEST_F(BackgroundLexingTest, ManyDefinitions) {
+	// Values are collected on the worker thread while the document may still use line
+	// states overwritten by passes that are cancelled before they are committed
+	std::string text;
+	for (int i=0; i<400; i++)
+		text += "#define FEATURE 1\n#if FEATURE\nint feature = 1;\n#endif\n";
+	Load(background, text);
+	unsigned int seed = 1;
+	for (int edit=0; edit<3000; edit++) {
+		seed = seed * 1103515245 + 12345;
+		const int pos = background->LineStart(((seed >> 8) % 400) * 4) + 17;
+		const char insertion = static_cast<char>('a' + edit % 26);
+		background->InsertString(pos, &insertion, 1);
+		text.insert(pos, 1, insertion);
+		background->StyleInBackground(0);
+		if (edit % 5 == 0)
+			background->EnsureStyledTo(std::min(pos + 1000, static_cast<int>(background->Length())));
+		else if (edit % 2)
+			background->CommitBackgroundStyles();
+		else
+			CommitAll();
+	}
+	CommitAll();
+	Load(synchronous, text);
+	CheckSameAsSynchronous();
+}
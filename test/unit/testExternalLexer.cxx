@@ -0,0 +1,266 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+#include "ExternalLexer.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test LexerManager with libraries that are simulated in this file instead of being
+// loaded from shared objects.
+
+static int libraryLoads = 0;
+static int libraryCloses = 0;
+static int factoryLookups = 0;
+static int lexersReleased = 0;
+
+static ILexer *CreateNothing() {
+	return 0;
+}
+
+class SimulatedLexer : public ILexer {
+public:
+	virtual ~SimulatedLexer() {
+	}
+	int SCI_METHOD Version() const {
+		return lvOriginal;
+	}
+	void SCI_METHOD Release() {
+		lexersReleased++;
+		delete this;
+	}
+	const char * SCI_METHOD PropertyNames() {
+		return "";
+	}
+	int SCI_METHOD PropertyType(const char *) {
+		return SC_TYPE_BOOLEAN;
+	}
+	const char * SCI_METHOD DescribeProperty(const char *) {
+		return "";
+	}
+	int SCI_METHOD PropertySet(const char *, const char *) {
+		return -1;
+	}
+	const char * SCI_METHOD DescribeWordListSets() {
+		return "";
+	}
+	int SCI_METHOD WordListSet(int, const char *) {
+		return -1;
+	}
+	void SCI_METHOD Lex(Sci_PositionU, Sci_Position, int, IDocument *) {
+	}
+	void SCI_METHOD Fold(Sci_PositionU, Sci_Position, int, IDocument *) {
+	}
+	void * SCI_METHOD PrivateCall(int, void *) {
+		return this;
+	}
+};
+
+static ILexer *CreateSimulated() {
+	return new SimulatedLexer();
+}
+
+static int EXT_LEXER_DECL GetLexerCountFirst() {
+	return 2;
+}
+
+static void EXT_LEXER_DECL GetLexerNameFirst(unsigned int Index, char *name, int buflength) {
+	strncpy(name, (Index == 0) ? "extalpha" : "extbeta", buflength);
+}
+
+static int EXT_LEXER_DECL GetLexerCountSecond() {
+	return 1;
+}
+
+static void EXT_LEXER_DECL GetLexerNameSecond(unsigned int, char *name, int buflength) {
+	strncpy(name, "extgamma", buflength);
+}
+
+// extbeta makes lexers while the other languages do not
+static LexerFactoryFunction EXT_LEXER_DECL GetLexerFactory(unsigned int Index) {
+	factoryLookups++;
+	return (Index == 1) ? CreateSimulated : CreateNothing;
+}
+
+class SimulatedLibrary : public DynamicLibrary {
+	bool first;
+public:
+	explicit SimulatedLibrary(bool first_) : first(first_) {
+		libraryLoads++;
+	}
+	virtual ~SimulatedLibrary() {
+		libraryCloses++;
+	}
+	virtual Function FindFunction(const char *name) {
+		if (0 == strcmp(name, "GetLexerCount"))
+			return first ? (Function)(sptr_t)GetLexerCountFirst : (Function)(sptr_t)GetLexerCountSecond;
+		if (0 == strcmp(name, "GetLexerName"))
+			return first ? (Function)(sptr_t)GetLexerNameFirst : (Function)(sptr_t)GetLexerNameSecond;
+		if (0 == strcmp(name, "GetLexerFactory"))
+			return (Function)(sptr_t)GetLexerFactory;
+		return 0;
+	}
+	virtual bool IsValid() {
+		return true;
+	}
+};
+
+class MissingLibrary : public DynamicLibrary {
+public:
+	MissingLibrary() {
+		libraryLoads++;
+	}
+	virtual Function FindFunction(const char *) {
+		return 0;
+	}
+	virtual bool IsValid() {
+		return false;
+	}
+};
+
+DynamicLibrary *DynamicLibrary::Load(const char *modulePath) {
+	if (0 == strcmp(modulePath, "libfirst.so"))
+		return new SimulatedLibrary(true);
+	if (0 == strcmp(modulePath, "libsecond.so"))
+		return new SimulatedLibrary(false);
+	return new MissingLibrary();
+}
+
+class ExternalLexerTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		libraryLoads = 0;
+		libraryCloses = 0;
+		factoryLookups = 0;
+		lexersReleased = 0;
+		plm = LexerManager::GetInstance();
+	}
+
+	virtual void TearDown() {
+		plm->Clear();
+		plm = 0;
+	}
+
+	LexerManager *plm;
+};
+
+TEST_F(ExternalLexerTest, OpenedWhenUsed) {
+	plm->Load("libfirst.so");
+	plm->Load("libsecond.so");
+	EXPECT_EQ(0, libraryLoads);
+	const LexerModule *lexAlpha = Catalogue::Find("extalpha");
+	ASSERT_TRUE(lexAlpha != 0);
+	EXPECT_STREQ("extalpha", lexAlpha->languageName);
+	EXPECT_GT(lexAlpha->GetLanguage(), SCLEX_AUTOMATIC);
+	EXPECT_EQ(lexAlpha, Catalogue::Find(lexAlpha->GetLanguage()));
+	// Only the library providing the language is opened
+	EXPECT_EQ(1, libraryLoads);
+	EXPECT_TRUE(Catalogue::Find("extbeta") != 0);
+	EXPECT_EQ(1, libraryLoads);
+	EXPECT_TRUE(Catalogue::Find("extgamma") != 0);
+	EXPECT_EQ(2, libraryLoads);
+	EXPECT_EQ(0, Catalogue::Find("extdelta"));
+	EXPECT_EQ(2, libraryLoads);
+}
+
+TEST_F(ExternalLexerTest, FactoriesFoundOnce) {
+	plm->Load("libfirst.so");
+	const LexerModule *lexAlpha = Catalogue::Find("extalpha");
+	ASSERT_TRUE(lexAlpha != 0);
+	EXPECT_EQ(2, factoryLookups);
+	EXPECT_EQ(0, lexAlpha->Create());
+	EXPECT_EQ(0, lexAlpha->Create());
+	EXPECT_EQ(2, factoryLookups);
+}
+
+TEST_F(ExternalLexerTest, CountOpensAll) {
+	const int count = Catalogue::Count();
+	plm->Load("libfirst.so");
+	plm->Load("libsecond.so");
+	EXPECT_EQ(count + 3, Catalogue::Count());
+	EXPECT_EQ(2, libraryLoads);
+}
+
+TEST_F(ExternalLexerTest, Unload) {
+	plm->Load("libfirst.so");
+	EXPECT_TRUE(Catalogue::Find("extalpha") != 0);
+	const int count = Catalogue::Count();
+	plm->Unload("libfirst.so");
+	EXPECT_EQ(1, libraryCloses);
+	EXPECT_EQ(count - 2, Catalogue::Count());
+	EXPECT_EQ(0, Catalogue::Find("extalpha"));
+	EXPECT_EQ(1, libraryLoads);
+}
+
+TEST_F(ExternalLexerTest, Reload) {
+	plm->Load("libfirst.so");
+	EXPECT_TRUE(Catalogue::Find("extalpha") != 0);
+	plm->Reload("libfirst.so");
+	EXPECT_EQ(1, libraryCloses);
+	EXPECT_EQ(1, libraryLoads);
+	EXPECT_TRUE(Catalogue::Find("extalpha") != 0);
+	EXPECT_EQ(2, libraryLoads);
+	// Loading a library again does not add its lexers twice
+	const int count = Catalogue::Count();
+	plm->Load("libfirst.so");
+	EXPECT_EQ(count, Catalogue::Count());
+}
+
+TEST_F(ExternalLexerTest, UnloadWhileLexerAlive) {
+	plm->Load("libfirst.so");
+	const LexerModule *lexBeta = Catalogue::Find("extbeta");
+	ASSERT_TRUE(lexBeta != 0);
+	ILexer *lexer = lexBeta->Create();
+	ASSERT_TRUE(lexer != 0);
+	// The library stays open while a document may still call its lexer
+	plm->Unload("libfirst.so");
+	EXPECT_EQ(0, Catalogue::Find("extbeta"));
+	EXPECT_EQ(0, libraryCloses);
+	EXPECT_STREQ("extbeta", lexBeta->languageName);
+	EXPECT_TRUE(lexer->PrivateCall(0, 0) != 0);
+	lexer->Release();
+	EXPECT_EQ(1, lexersReleased);
+	EXPECT_EQ(1, libraryCloses);
+}
+
+TEST_F(ExternalLexerTest, ReloadWhileLexerAlive) {
+	plm->Load("libfirst.so");
+	ILexer *lexer = Catalogue::Find("extbeta")->Create();
+	ASSERT_TRUE(lexer != 0);
+	plm->Reload("libfirst.so");
+	EXPECT_EQ(0, libraryCloses);
+	// New lexers come from the library opened again
+	const LexerModule *lexBeta = Catalogue::Find("extbeta");
+	ASSERT_TRUE(lexBeta != 0);
+	EXPECT_EQ(2, libraryLoads);
+	ILexer *lexerReloaded = lexBeta->Create();
+	lexer->Release();
+	EXPECT_EQ(1, libraryCloses);
+	plm->Clear();
+	EXPECT_EQ(1, libraryCloses);
+	lexerReloaded->Release();
+	EXPECT_EQ(2, lexersReleased);
+	EXPECT_EQ(2, libraryCloses);
+}
+
+TEST_F(ExternalLexerTest, MissingLibraryTriedOnce) {
+	plm->Load("libmissing.so");
+	EXPECT_EQ(0, Catalogue::Find("extdelta"));
+	EXPECT_EQ(0, Catalogue::Find("extdelta"));
+	EXPECT_EQ(1, libraryLoads);
+}
@@ -1,11 +1,15 @@
 // Unit Tests for Scintilla internal data structures
 
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include <algorithm>
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
 
@@ -14,7 +18,7 @@
 const int growSize = 4;
 
 const int lengthTestArray = 8;
-static const int testArray[lengthTestArray] = {3, 4, 5, 6, 7, 8, 9, 10};
+static const Sci_Position testArray[lengthTestArray] = {3, 4, 5, 6, 7, 8, 9, 10};
 
 // Test SplitVectorWithRangeAdd.
 
@@ -208,3 +212,213 @@ TEST_F(PartitioningTest, OutOfRangeDeathTest) {
 	ASSERT_DEATH(pp->PositionFromPartition(3), "Assertion");
 }
 #endif
+
+// Test BlockPartitioning.
+
+class BlockPartitioningTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pbp = new BlockPartitioning(growSize);
+	}
+
+	virtual void TearDown() {
+		delete pbp;
+		pbp = 0;
+	}
+
+	BlockPartitioning *pbp;
+};
+
+TEST_F(BlockPartitioningTest, IsEmptyInitially) {
+	EXPECT_EQ(1, pbp->Partitions());
+	EXPECT_EQ(0, pbp->PositionFromPartition(pbp->Partitions()));
+	EXPECT_EQ(0, pbp->PartitionFromPosition(0));
+}
+
+TEST_F(BlockPartitioningTest, TwoPartitions) {
+	pbp->InsertText(0, 2);
+	pbp->InsertPartition(1, 1);
+	EXPECT_EQ(2, pbp->Partitions());
+	EXPECT_EQ(0, pbp->PositionFromPartition(0));
+	EXPECT_EQ(1, pbp->PositionFromPartition(1));
+	EXPECT_EQ(2, pbp->PositionFromPartition(2));
+}
+
+TEST_F(BlockPartitioningTest, InverseSearch) {
+	pbp->InsertText(0, 3);
+	pbp->InsertPartition(1, 2);
+	pbp->SetPartitionStartPosition(1,1);
+
+	EXPECT_EQ(2, pbp->Partitions());
+	EXPECT_EQ(0, pbp->PositionFromPartition(0));
+	EXPECT_EQ(1, pbp->PositionFromPartition(1));
+	EXPECT_EQ(3, pbp->PositionFromPartition(2));
+
+	EXPECT_EQ(0, pbp->PartitionFromPosition(0));
+	EXPECT_EQ(1, pbp->PartitionFromPosition(1));
+	EXPECT_EQ(1, pbp->PartitionFromPosition(2));
+
+	EXPECT_EQ(1, pbp->PartitionFromPosition(3));
+}
+
+TEST_F(BlockPartitioningTest, DeletePartition) {
+	pbp->InsertText(0, 2);
+	pbp->InsertPartition(1, 1);
+	pbp->RemovePartition(1);
+	EXPECT_EQ(1, pbp->Partitions());
+	EXPECT_EQ(0, pbp->PositionFromPartition(0));
+	EXPECT_EQ(2, pbp->PositionFromPartition(1));
+}
+
+TEST_F(BlockPartitioningTest, TestMany) {
+	pbp->InsertText(0, 42);
+	for (int i=0; i<20; i++) {
+		pbp->InsertPartition(i+1, (i+1) * 2);
+	}
+	for (int i=20; i>0; i--) {
+		pbp->InsertText(i,2);
+	}
+	EXPECT_EQ(21, pbp->Partitions());
+	for (int i=1; i<20; i++) {
+		EXPECT_EQ(i*4 - 2, pbp->PositionFromPartition(i));
+		EXPECT_EQ(i, pbp->PartitionFromPosition(i*4 - 2));
+	}
+	pbp->InsertText(19,2);
+	EXPECT_EQ(3, pbp->PartitionFromPosition(10));
+	pbp->InsertText(0,2);
+	pbp->InsertText(0,-2);
+	pbp->RemovePartition(1);
+	EXPECT_EQ(0, pbp->PositionFromPartition(0));
+	EXPECT_EQ(6, pbp->PositionFromPartition(1));
+	EXPECT_EQ(10, pbp->PositionFromPartition(2));
+	pbp->RemovePartition(10);
+	EXPECT_EQ(46, pbp->PositionFromPartition(10));
+	EXPECT_EQ(10, pbp->PartitionFromPosition(46));
+	EXPECT_EQ(50, pbp->PositionFromPartition(11));
+	EXPECT_EQ(11, pbp->PartitionFromPosition(50));
+}
+
+// Apply the same pseudo-random operations to a Partitioning and check the results match.
+// Enough partitions are added to split and remove many blocks.
+
+TEST_F(BlockPartitioningTest, MatchesPartitioning) {
+	Partitioning reference(growSize);
+	srand(3);
+	reference.InsertText(0, 1);
+	pbp->InsertText(0, 1);
+	for (int i = 0; i < 20000; i++) {
+		const Sci_Position partitions = reference.Partitions();
+		const int op = rand() % 10;
+		if ((op < 4) || (partitions < 2)) {
+			// Split a partition
+			const Sci_Position partition = rand() % partitions;
+			const Sci_Position start = reference.PositionFromPartition(partition);
+			const Sci_Position lengthPartition = reference.PositionFromPartition(partition + 1) - start;
+			if (lengthPartition > 1) {
+				const Sci_Position pos = start + 1 + rand() % (lengthPartition - 1);
+				reference.InsertPartition(partition + 1, pos);
+				pbp->InsertPartition(partition + 1, pos);
+			}
+		} else if (op < 7) {
+			const Sci_Position partition = rand() % partitions;
+			const Sci_Position delta = rand() % 20 + 1;
+			reference.InsertText(partition, delta);
+			pbp->InsertText(partition, delta);
+		} else if (op < 9) {
+			const Sci_Position partition = rand() % (partitions - 1) + 1;
+			reference.RemovePartition(partition);
+			pbp->RemovePartition(partition);
+		} else {
+			const Sci_Position partition = rand() % (partitions - 1) + 1;
+			const Sci_Position low = reference.PositionFromPartition(partition - 1);
+			const Sci_Position high = reference.PositionFromPartition(partition + 1);
+			if (high - low > 1) {
+				const Sci_Position pos = low + 1 + rand() % (high - low - 1);
+				reference.SetPartitionStartPosition(partition, pos);
+				pbp->SetPartitionStartPosition(partition, pos);
+			}
+		}
+		ASSERT_EQ(reference.Partitions(), pbp->Partitions());
+		const Sci_Position probe = rand() % (reference.Partitions() + 1);
+		ASSERT_EQ(reference.PositionFromPartition(probe), pbp->PositionFromPartition(probe));
+		const Sci_Position pos = rand() % (reference.PositionFromPartition(reference.Partitions()) + 2);
+		ASSERT_EQ(reference.PartitionFromPosition(pos), pbp->PartitionFromPosition(pos));
+	}
+	for (Sci_Position partition = 0; partition <= reference.Partitions(); partition++) {
+		ASSERT_EQ(reference.PositionFromPartition(partition), pbp->PositionFromPartition(partition));
+	}
+}
+
+TEST_F(BlockPartitioningTest, InsertPartitionsMatchesInsertPartition) {
+	Partitioning reference(growSize);
+	srand(6);
+	Sci_Position positions[1000];
+	for (int i = 0; i < 300; i++) {
+		// Insert text into a partition then split it into insertCount + 1 partitions
+		const Sci_Position partition = rand() % reference.Partitions();
+		const Sci_Position insertCount = (i % 3 == 0) ? rand() % 1000 + 1 : rand() % 20 + 1;
+		reference.InsertText(partition, insertCount * 2);
+		pbp->InsertText(partition, insertCount * 2);
+		const Sci_Position start = reference.PositionFromPartition(partition);
+		for (Sci_Position j = 0; j < insertCount; j++) {
+			positions[j] = start + j * 2 + 1;
+			reference.InsertPartition(partition + 1 + j, positions[j]);
+		}
+		pbp->InsertPartitions(partition + 1, positions, insertCount);
+		ASSERT_EQ(reference.Partitions(), pbp->Partitions());
+		if (i % 4 == 0) {
+			for (int r = 0; r < 50 && reference.Partitions() > 1; r++) {
+				const Sci_Position partitionRemove = rand() % (reference.Partitions() - 1) + 1;
+				reference.RemovePartition(partitionRemove);
+				pbp->RemovePartition(partitionRemove);
+			}
+		}
+		for (int probe = 0; probe < 20; probe++) {
+			const Sci_Position pos = rand() % (reference.PositionFromPartition(reference.Partitions()) + 2);
+			ASSERT_EQ(reference.PartitionFromPosition(pos), pbp->PartitionFromPosition(pos));
+		}
+	}
+	for (Sci_Position partition = 0; partition <= reference.Partitions(); partition++) {
+		ASSERT_EQ(reference.PositionFromPartition(partition), pbp->PositionFromPartition(partition));
+	}
+}
+
+// Benchmark edits alternating between the start and end of a million partitions
+// which makes Partitioning move its step across all the partitions each time.
+// Disabled by default as it only reports timings; run it with
+//	./unitTest --gtest_also_run_disabled_tests --gtest_filter=*BlockPartitioningBenchmark*
+
+namespace {
+
+const Sci_Position benchPartitions = 1000000;
+const int benchEdits = 2000;
+
+template <typename PARTITIONING>
+double AlternatingEdits(PARTITIONING &partitioning) {
+	partitioning.InsertText(0, benchPartitions * 10);
+	for (Sci_Position i = 1; i < benchPartitions; i++) {
+		partitioning.InsertPartition(i, i * 10);
+	}
+	const clock_t start = clock();
+	for (int i = 0; i < benchEdits; i++) {
+		const Sci_Position partition = (i % 2) ? (benchPartitions - 2 - i) : i;
+		partitioning.InsertText(partition, 1);
+		partitioning.PositionFromPartition(partition + 1);
+		partitioning.PartitionFromPosition(partition * 10);
+	}
+	return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+}
+
+TEST(BlockPartitioningBenchmark, DISABLED_AlternatingEdits) {
+	Partitioning partitioning(256);
+	const double timePartitioning = AlternatingEdits(partitioning);
+	BlockPartitioning blockPartitioning(256);
+	const double timeBlockPartitioning = AlternatingEdits(blockPartitioning);
+	printf("Alternating edits over %d partitions: Partitioning %.3fs BlockPartitioning %.3fs\n",
+		static_cast<int>(benchPartitions), timePartitioning, timeBlockPartitioning);
+	for (Sci_Position partition = 0; partition <= partitioning.Partitions(); partition += 999) {
+		ASSERT_EQ(partitioning.PositionFromPartition(partition), blockPartitioning.PositionFromPartition(partition));
+	}
+}
@@ -0,0 +1,239 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "SegmentedVector.h"
+#include "PieceTable.h"
+
+#include <gtest/gtest.h>
+
+// Test PieceTable.
+
+class PieceTableTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		ppt = new PieceTable;
+	}
+
+	virtual void TearDown() {
+		delete ppt;
+		ppt = 0;
+	}
+
+	PieceTable *ppt;
+
+	std::string Text() {
+		std::string text(ppt->Length(), '\0');
+		if (ppt->Length())
+			ppt->GetRange(&text[0], 0, ppt->Length());
+		return text;
+	}
+};
+
+TEST_F(PieceTableTest, IsEmptyInitially) {
+	EXPECT_EQ(0, ppt->Length());
+	EXPECT_EQ(1, ppt->Pieces());
+	EXPECT_EQ(0, ppt->ValueAt(0));
+}
+
+TEST_F(PieceTableTest, InsertOne) {
+	ppt->InsertFromArray(0, "abc", 0, 3);
+	EXPECT_EQ(3, ppt->Length());
+	EXPECT_EQ('a', ppt->ValueAt(0));
+	EXPECT_EQ('c', ppt->ValueAt(2));
+	EXPECT_EQ(0, ppt->ValueAt(3));
+	EXPECT_EQ(0, ppt->ValueAt(-1));
+}
+
+TEST_F(PieceTableTest, TypingIsOnePiece) {
+	const char *s = "typing";
+	for (int i = 0; i < 6; i++) {
+		ppt->InsertFromArray(i, s, i, 1);
+	}
+	EXPECT_EQ("typing", Text());
+	EXPECT_EQ(1, ppt->Pieces());
+}
+
+TEST_F(PieceTableTest, InsertMiddleSplits) {
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	EXPECT_EQ("abc123def", Text());
+	EXPECT_EQ(3, ppt->Pieces());
+	ppt->InsertFromArray(0, "<", 0, 1);
+	ppt->InsertFromArray(ppt->Length(), ">", 0, 1);
+	EXPECT_EQ("<abc123def>", Text());
+}
+
+TEST_F(PieceTableTest, DeleteRange) {
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	ppt->DeleteRange(2, 5);
+	EXPECT_EQ("abef", Text());
+	ppt->DeleteRange(0, 1);
+	EXPECT_EQ("bef", Text());
+	ppt->DeleteRange(2, 1);
+	EXPECT_EQ("be", Text());
+	ppt->DeleteRange(0, 2);
+	EXPECT_EQ(0, ppt->Length());
+	EXPECT_EQ(1, ppt->Pieces());
+	ppt->InsertFromArray(0, "xy", 0, 2);
+	EXPECT_EQ("xy", Text());
+}
+
+TEST_F(PieceTableTest, RangePointerJoinsPieces) {
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	EXPECT_EQ(0, memcmp(ppt->RangePointer(1, 7), "bc123de", 7));
+	EXPECT_EQ(3, ppt->Pieces());
+	EXPECT_EQ("abc123def", Text());
+}
+
+TEST_F(PieceTableTest, RangePointerEmptyRanges) {
+	EXPECT_STREQ("", ppt->RangePointer(0, 0));
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	// Empty ranges point into the text without joining pieces
+	Sci_Position lengthContiguous = 0;
+	EXPECT_EQ(ppt->ContiguousRangePointer(4, lengthContiguous), ppt->RangePointer(4, 0));
+	EXPECT_EQ(ppt->ContiguousRangePointer(8, lengthContiguous) + 1, ppt->RangePointer(9, 0));
+	EXPECT_EQ(3, ppt->Pieces());
+	// Ending with an insertion
+	ppt->InsertFromArray(9, "gh", 0, 2);
+	EXPECT_EQ(ppt->ContiguousRangePointer(10, lengthContiguous) + 1, ppt->RangePointer(11, 0));
+}
+
+TEST_F(PieceTableTest, RangePointerCompactsStore) {
+	std::string text(100000, 'x');
+	ppt->InsertFromArray(0, text.c_str(), 0, static_cast<Sci_Position>(text.length()));
+	for (int i = 0; i < 100; i++) {
+		const Sci_Position position = i * 97;
+		ppt->InsertFromArray(position + 1, "ab", 0, 2);
+		text.insert(position + 1, "ab");
+		// Joining the pieces appends a copy of most of the text
+		EXPECT_EQ(0, memcmp(ppt->RangePointer(position, 90000), text.c_str() + position, 90000));
+		EXPECT_LE(ppt->StoreLength(), 3 * ppt->Length() + 0x10000);
+	}
+	EXPECT_EQ(text, Text());
+}
+
+TEST_F(PieceTableTest, ContiguousRangePointerWithinPiece) {
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	Sci_Position lengthContiguous = 0;
+	EXPECT_EQ(0, memcmp(ppt->ContiguousRangePointer(1, lengthContiguous), "bc", 2));
+	EXPECT_EQ(2, lengthContiguous);
+	EXPECT_EQ(0, memcmp(ppt->ContiguousRangePointer(4, lengthContiguous), "23", 2));
+	EXPECT_EQ(2, lengthContiguous);
+	EXPECT_EQ(0, memcmp(ppt->ContiguousRangePointer(6, lengthContiguous), "def", 3));
+	EXPECT_EQ(3, lengthContiguous);
+	EXPECT_EQ(0, ppt->ContiguousRangePointer(9, lengthContiguous));
+	EXPECT_EQ(0, lengthContiguous);
+	// Pieces are not joined
+	EXPECT_EQ(3, ppt->Pieces());
+}
+
+TEST_F(PieceTableTest, BufferPointer) {
+	ppt->InsertFromArray(0, "abcdef", 0, 6);
+	ppt->InsertFromArray(3, "123", 0, 3);
+	ppt->DeleteRange(0, 1);
+	EXPECT_STREQ("bc123def", ppt->BufferPointer());
+	EXPECT_EQ(1, ppt->Pieces());
+	EXPECT_EQ("bc123def", Text());
+}
+
+TEST_F(PieceTableTest, OriginalUsedInPlace) {
+	const char original[] = "abcdef";
+	ppt->SetOriginal(original, 6);
+	EXPECT_EQ(6, ppt->Length());
+	EXPECT_EQ(original + 2, ppt->RangePointer(2, 3));
+	ppt->InsertFromArray(6, "gh", 0, 2);
+	ppt->InsertFromArray(3, "12", 0, 2);
+	ppt->DeleteRange(0, 1);
+	EXPECT_EQ("bc12defgh", Text());
+	EXPECT_STREQ("abcdef", original);
+	EXPECT_STREQ("bc12defgh", ppt->BufferPointer());
+	EXPECT_EQ(1, ppt->Pieces());
+}
+
+// Apply the same pseudo-random edits to a SplitVector and check the results match.
+
+TEST_F(PieceTableTest, MatchesSplitVector) {
+	SplitVector<char> sv;
+	srand(1);
+	const char *letters = "abcdefghijklmnopqrstuvwxyz\r\n";
+	for (int i = 0; i < 5000; i++) {
+		if ((sv.Length() > 0) && (rand() % 3 == 0)) {
+			const Sci_Position position = rand() % sv.Length();
+			const Sci_Position deleteLength = std::min<Sci_Position>(rand() % 10 + 1, sv.Length() - position);
+			sv.DeleteRange(position, deleteLength);
+			ppt->DeleteRange(position, deleteLength);
+		} else {
+			const Sci_Position position = sv.Length() ? rand() % (sv.Length() + 1) : 0;
+			const Sci_Position from = rand() % 20;
+			const Sci_Position insertLength = rand() % 8 + 1;
+			sv.InsertFromArray(position, letters, from, insertLength);
+			ppt->InsertFromArray(position, letters, from, insertLength);
+		}
+		ASSERT_EQ(sv.Length(), ppt->Length());
+		if (i % 500 == 0) {
+			ppt->BufferPointer();
+		}
+	}
+	for (Sci_Position j = 0; j < sv.Length(); j++) {
+		ASSERT_EQ(sv.ValueAt(j), ppt->ValueAt(j));
+	}
+	EXPECT_EQ(0, memcmp(sv.BufferPointer(), ppt->BufferPointer(), sv.Length()));
+}
+
+// Benchmark scattered edits over a large document which is the worst case
+// for SplitVector as the gap moves across much of the text for each edit.
+// Disabled by default as it only reports timings; run it with
+//	./unitTest --gtest_also_run_disabled_tests --gtest_filter=*PieceTableBenchmark*
+
+namespace {
+
+const Sci_Position benchLength = 4 * 1024 * 1024;
+const int benchEdits = 2000;
+
+template <typename STORE>
+double ScatteredEdits(STORE &store) {
+	std::string text(benchLength, 'x');
+	store.InsertFromArray(0, text.c_str(), 0, benchLength);
+	unsigned int seed = 2;
+	const clock_t start = clock();
+	for (int i = 0; i < benchEdits; i++) {
+		seed = seed * 1103515245u + 12345u;
+		const Sci_Position position = (seed >> 4) % store.Length();
+		if (i % 2) {
+			store.DeleteRange(position, 1);
+		} else {
+			store.InsertFromArray(position, "edit", 0, 4);
+		}
+		store.ValueAt(position);
+	}
+	return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+}
+
+TEST(PieceTableBenchmark, DISABLED_ScatteredEdits) {
+	SplitVector<char> sv;
+	const double timeSplitVector = ScatteredEdits(sv);
+	PieceTable pt;
+	const double timePieceTable = ScatteredEdits(pt);
+	printf("Scattered edits on %d bytes: SplitVector %.3fs PieceTable %.3fs\n",
+		static_cast<int>(benchLength), timeSplitVector, timePieceTable);
+	ASSERT_EQ(sv.Length(), pt.Length());
+	EXPECT_EQ(0, memcmp(sv.BufferPointer(), pt.BufferPointer(), sv.Length()));
+}
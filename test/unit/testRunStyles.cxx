@@ -6,6 +6,7 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
@@ -94,8 +95,8 @@ TEST_F(RunStylesTest, LongerRuns) {
 
 TEST_F(RunStylesTest, FillRange) {
 	prs->InsertSpace(0, 5);
-	int startFill = 1;
-	int lengthFill = 3;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 3;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(1, startFill);
 	EXPECT_EQ(3, lengthFill);
@@ -115,14 +116,14 @@ TEST_F(RunStylesTest, FillRange) {
 
 TEST_F(RunStylesTest, FillRangeAlreadyFilled) {
 	prs->InsertSpace(0, 5);
-	int startFill = 1;
-	int lengthFill = 3;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 3;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(1, startFill);
 	EXPECT_EQ(3, lengthFill);
 
-	int startFill2 = 2;
-	int lengthFill2 = 1;
+	Sci_Position startFill2 = 2;
+	Sci_Position lengthFill2 = 1;
 	// Compiler warnings if 'false' used instead of '0' as expected value:
 	EXPECT_EQ(0, prs->FillRange(startFill2, 99, lengthFill2));
 	EXPECT_EQ(2, startFill2);
@@ -137,14 +138,14 @@ TEST_F(RunStylesTest, FillRangeAlreadyFilled) {
 
 TEST_F(RunStylesTest, FillRangeAlreadyPartFilled) {
 	prs->InsertSpace(0, 5);
-	int startFill = 1;
-	int lengthFill = 2;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 2;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(1, startFill);
 	EXPECT_EQ(2, lengthFill);
 
-	int startFill2 = 2;
-	int lengthFill2 = 2;
+	Sci_Position startFill2 = 2;
+	Sci_Position lengthFill2 = 2;
 	EXPECT_EQ(true, prs->FillRange(startFill2, 99, lengthFill2));
 	EXPECT_EQ(3, startFill2);
 	EXPECT_EQ(1, lengthFill2);
@@ -175,8 +176,8 @@ TEST_F(RunStylesTest, DeleteRange) {
 
 TEST_F(RunStylesTest, Find) {
 	prs->InsertSpace(0, 5);
-	int startFill = 1;
-	int lengthFill = 3;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 3;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(1, startFill);
 	EXPECT_EQ(3, lengthFill);
@@ -212,8 +213,8 @@ TEST_F(RunStylesTest, AllSame) {
 	EXPECT_EQ(true, prs->AllSame());
 	EXPECT_EQ(0, prs->AllSameAs(88));
 	EXPECT_EQ(true, prs->AllSameAs(0));
-	int startFill = 1;
-	int lengthFill = 3;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 3;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(0, prs->AllSame());
 	EXPECT_EQ(0, prs->AllSameAs(88));
@@ -228,8 +229,8 @@ TEST_F(RunStylesTest, FindWithReversion) {
 	prs->InsertSpace(0, 5);
 	EXPECT_EQ(1, prs->Runs());
 
-	int startFill = 1;
-	int lengthFill = 1;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 1;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(1, startFill);
 	EXPECT_EQ(1, lengthFill);
@@ -285,8 +286,8 @@ TEST_F(RunStylesTest, DeleteAll) {
 
 TEST_F(RunStylesTest, DeleteSecond) {
 	prs->InsertSpace(0, 3);
-	int startFill = 1;
-	int lengthFill = 1;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 1;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(3, prs->Length());
 	EXPECT_EQ(3, prs->Runs());
@@ -297,8 +298,8 @@ TEST_F(RunStylesTest, DeleteSecond) {
 
 TEST_F(RunStylesTest, DeleteEndRun) {
 	prs->InsertSpace(0, 2);
-	int startFill = 1;
-	int lengthFill = 1;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 1;
 	EXPECT_EQ(true, prs->FillRange(startFill, 99, lengthFill));
 	EXPECT_EQ(2, prs->Length());
 	EXPECT_EQ(2, prs->Runs());
@@ -318,8 +319,8 @@ TEST_F(RunStylesTest, DeleteEndRun) {
 
 TEST_F(RunStylesTest, OutsideBounds) {
 	prs->InsertSpace(0, 1);
-	int startFill = 1;
-	int lengthFill = 1;
+	Sci_Position startFill = 1;
+	Sci_Position lengthFill = 1;
 	prs->FillRange(startFill, 99, lengthFill);
 	EXPECT_EQ(1, prs->Length());
 	EXPECT_EQ(1, prs->Runs());
@@ -0,0 +1,164 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "SegmentedVector.h"
+
+#include <gtest/gtest.h>
+
+// Test SegmentedVector.
+
+const int segmentSize = 8;
+
+class SegmentedVectorTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		psv = new SegmentedVector<int>(segmentSize);
+	}
+
+	virtual void TearDown() {
+		delete psv;
+		psv = 0;
+	}
+
+	SegmentedVector<int> *psv;
+};
+
+const int lengthTestArray = 4;
+static const int testArray[4] = {3, 4, 5, 6};
+
+TEST_F(SegmentedVectorTest, IsEmptyInitially) {
+	EXPECT_EQ(0, psv->Length());
+	EXPECT_EQ(0, psv->Segments());
+	EXPECT_EQ(0, psv->ValueAt(0));
+}
+
+TEST_F(SegmentedVectorTest, InsertOne) {
+	psv->InsertValue(0, 10, 0);
+	psv->Insert(5, 3);
+	EXPECT_EQ(11, psv->Length());
+	for (int i=0; i<psv->Length(); i++) {
+		EXPECT_EQ((i == 5) ? 3 : 0, psv->ValueAt(i));
+	}
+	// Insertion into a full segment splits it
+	EXPECT_EQ(3, psv->Segments());
+}
+
+TEST_F(SegmentedVectorTest, InsertFromArray) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	psv->InsertFromArray(2, testArray, 1, 3);
+	EXPECT_EQ(7, psv->Length());
+	const int expected[] = {3, 4, 4, 5, 6, 5, 6};
+	for (int i=0; i<psv->Length(); i++) {
+		EXPECT_EQ(expected[i], psv->ValueAt(i));
+	}
+}
+
+TEST_F(SegmentedVectorTest, DeleteRangeAcrossSegments) {
+	for (int i=0; i<30; i++) {
+		psv->Insert(i, i);
+	}
+	EXPECT_EQ(4, psv->Segments());
+	psv->DeleteRange(5, 20);
+	EXPECT_EQ(10, psv->Length());
+	for (int i=0; i<psv->Length(); i++) {
+		EXPECT_EQ((i < 5) ? i : i + 20, psv->ValueAt(i));
+	}
+	psv->DeleteRange(0, psv->Length());
+	EXPECT_EQ(0, psv->Length());
+	EXPECT_EQ(0, psv->Segments());
+}
+
+TEST_F(SegmentedVectorTest, GrowsWithoutMoving) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	Sci_Position lengthSegment = 0;
+	const int *first = psv->SegmentAt(0, lengthSegment);
+	EXPECT_EQ(4, lengthSegment);
+	for (int i=0; i<1000; i++) {
+		psv->Insert(psv->Length(), i);
+	}
+	EXPECT_EQ(first, psv->SegmentAt(0, lengthSegment));
+	EXPECT_EQ(segmentSize, lengthSegment);
+}
+
+TEST_F(SegmentedVectorTest, SegmentIteration) {
+	for (int i=0; i<50; i++) {
+		psv->Insert(i, i);
+	}
+	Sci_Position position = 3;
+	while (position < psv->Length()) {
+		Sci_Position lengthSegment = 0;
+		const int *body = psv->SegmentAt(position, lengthSegment);
+		ASSERT_GT(lengthSegment, 0);
+		for (Sci_Position i=0; i<lengthSegment; i++) {
+			EXPECT_EQ(position + i, body[i]);
+		}
+		position += lengthSegment;
+	}
+	EXPECT_EQ(50, position);
+}
+
+TEST_F(SegmentedVectorTest, RangePointerJoins) {
+	for (int i=0; i<30; i++) {
+		psv->Insert(i, i);
+	}
+	const int *range = psv->RangePointer(5, 20);
+	for (int i=0; i<20; i++) {
+		EXPECT_EQ(i + 5, range[i]);
+	}
+	for (int i=0; i<30; i++) {
+		EXPECT_EQ(i, psv->ValueAt(i));
+	}
+}
+
+TEST_F(SegmentedVectorTest, BufferPointer) {
+	for (int i=0; i<30; i++) {
+		psv->Insert(i, i + 1);
+	}
+	const int *body = psv->BufferPointer();
+	for (int i=0; i<30; i++) {
+		EXPECT_EQ(i + 1, body[i]);
+	}
+	EXPECT_EQ(0, body[30]);
+	EXPECT_EQ(1, psv->Segments());
+	psv->Insert(15, 99);
+	EXPECT_EQ(99, psv->ValueAt(15));
+	EXPECT_EQ(30, psv->ValueAt(30));
+}
+
+// Apply the same pseudo-random edits to a SplitVector and check the results match.
+
+TEST_F(SegmentedVectorTest, MatchesSplitVector) {
+	SplitVector<int> sv;
+	srand(4);
+	int values[20];
+	for (int v=0; v<20; v++) {
+		values[v] = v * 7;
+	}
+	for (int i=0; i<5000; i++) {
+		if ((sv.Length() > 0) && (rand() % 3 == 0)) {
+			const Sci_Position position = rand() % sv.Length();
+			const Sci_Position deleteLength = std::min<Sci_Position>(rand() % 20 + 1, sv.Length() - position);
+			sv.DeleteRange(position, deleteLength);
+			psv->DeleteRange(position, deleteLength);
+		} else {
+			const Sci_Position position = sv.Length() ? rand() % (sv.Length() + 1) : 0;
+			const Sci_Position insertLength = rand() % 20 + 1;
+			sv.InsertFromArray(position, values, 0, insertLength);
+			psv->InsertFromArray(position, values, 0, insertLength);
+		}
+		ASSERT_EQ(sv.Length(), psv->Length());
+	}
+	for (Sci_Position j=0; j<sv.Length(); j++) {
+		ASSERT_EQ(sv.ValueAt(j), psv->ValueAt(j));
+	}
+	EXPECT_EQ(0, memcmp(sv.BufferPointer(), psv->BufferPointer(), sizeof(int) * (sv.Length() + 1)));
+}
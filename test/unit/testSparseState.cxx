@@ -201,6 +201,29 @@ TEST_F(SparseStateTest, MergeIgnoreRepeat) {
 	EXPECT_EQ(34, pss->ValueAt(4));
 }
 
+TEST_F(SparseStateTest, ReplaceAfter) {
+	pss->Set(0, 30);
+	pss->Set(2, 32);
+	pss->Set(4, 34);
+	SparseState<int> before(*pss);
+
+	// Setting a line again discards the later states which are then taken back
+	pss->Set(1, 30);
+	EXPECT_EQ(1u, pss->size());
+	pss->ReplaceAfter(1, before);
+	EXPECT_EQ(3u, pss->size());
+	EXPECT_EQ(30, pss->ValueAt(1));
+	EXPECT_EQ(32, pss->ValueAt(2));
+	EXPECT_EQ(34, pss->ValueAt(5));
+
+	// A state repeating the value before it is not added
+	pss->Set(2, 32);
+	pss->Set(3, 34);
+	pss->ReplaceAfter(3, before);
+	EXPECT_EQ(3u, pss->size());
+	EXPECT_EQ(34, pss->ValueAt(3));
+}
+
 class SparseStateStringTest : public ::testing::Test {
 protected:
 	virtual void SetUp() {
@@ -6,6 +6,7 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
 #include "SplitVector.h"
 
 #include <gtest/gtest.h>
@@ -190,6 +191,26 @@ TEST_F(SplitVectorTest, BufferPointer) {
 	}
 }
 
+TEST_F(SplitVectorTest, ContiguousRangePointer) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	psv->Insert(2, 9);
+	const Sci_Position gap = psv->GapPosition();
+	EXPECT_EQ(3, gap);
+	Sci_Position lengthContiguous = 0;
+	const int *before = psv->ContiguousRangePointer(1, lengthContiguous);
+	EXPECT_EQ(gap - 1, lengthContiguous);
+	EXPECT_EQ(4, before[0]);
+	EXPECT_EQ(9, before[1]);
+	const int *after = psv->ContiguousRangePointer(gap, lengthContiguous);
+	EXPECT_EQ(psv->Length() - gap, lengthContiguous);
+	EXPECT_EQ(5, after[0]);
+	EXPECT_EQ(6, after[1]);
+	// The gap does not move
+	EXPECT_EQ(gap, psv->GapPosition());
+	EXPECT_EQ(0, psv->ContiguousRangePointer(psv->Length(), lengthContiguous));
+	EXPECT_EQ(0, lengthContiguous);
+}
+
 TEST_F(SplitVectorTest, DeleteBackAndForth) {
 	psv->InsertValue(0, 10, 87);
 	for (int i=0; i<10; i+=2) {
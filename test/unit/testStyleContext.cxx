@@ -0,0 +1,153 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <assert.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "LexAccessor.h"
+#include "StyleContext.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test that StyleContext sees the same characters as the document decodes when it takes
+// bytes below 0x80 directly and asks the document for other characters.
+
+class StyleContextTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pdoc = new Document();
+	}
+
+	virtual void TearDown() {
+		delete pdoc;
+		pdoc = 0;
+	}
+
+	struct Character {
+		int position;
+		int ch;
+		int width;
+	};
+
+	void SetText(int codePage, const std::string &text) {
+		pdoc->SetDBCSCodePage(codePage);
+		pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	}
+
+	// Step over the text from start comparing each character and its neighbours with
+	// those decoded one by one by the document.
+	void CheckSteps(int start) {
+		std::vector<Character> characters;
+		for (int pos = start; pos < pdoc->Length();) {
+			Sci_Position width = 1;
+			Character character;
+			character.position = pos;
+			character.ch = pdoc->GetCharacterAndWidth(pos, &width);
+			// Single byte documents return signed bytes but StyleContext does not
+			if (!pdoc->dbcsCodePage)
+				character.ch = static_cast<unsigned char>(character.ch);
+			character.width = static_cast<int>(width);
+			characters.push_back(character);
+			pos += character.width;
+		}
+		ASSERT_FALSE(characters.empty());
+		LexAccessor styler(pdoc);
+		StyleContext sc(start, pdoc->Length() - start, 0, styler);
+		size_t i = 0;
+		// Styling to the end of the document goes one position past the end
+		for (; sc.More() && (static_cast<int>(sc.currentPos) < pdoc->Length()); sc.Forward(), i++) {
+			ASSERT_LT(i, characters.size());
+			ASSERT_EQ(characters[i].position, static_cast<int>(sc.currentPos));
+			EXPECT_EQ(characters[i].ch, sc.ch) << "position " << sc.currentPos;
+			EXPECT_EQ(characters[i].width, sc.width) << "position " << sc.currentPos;
+			EXPECT_EQ((i > 0) ? characters[i-1].ch : 0, sc.chPrev) << "position " << sc.currentPos;
+			EXPECT_EQ((i + 1 < characters.size()) ? characters[i+1].ch : 0, sc.chNext) << "position " << sc.currentPos;
+		}
+		sc.Complete();
+		EXPECT_EQ(characters.size(), i);
+	}
+
+	Document *pdoc;
+};
+
+TEST_F(StyleContextTest, ASCII) {
+	SetText(SC_CP_UTF8, "int x = 1;\r\nreturn x;\n\tdone");
+	CheckSteps(0);
+	CheckSteps(pdoc->LineStart(1));
+}
+
+TEST_F(StyleContextTest, SingleByte) {
+	// Without a multi-byte code page, bytes above 0x7F are characters on their own
+	SetText(0, "caf\xe9 \x80\xff\n");
+	CheckSteps(0);
+}
+
+static const char utf8Mixed[] =
+	"a\xc3\xa9"	// e acute
+	"\xe2\x82\xac"	// euro sign
+	"b\xf0\x9f\x98\x80"	// emoji outside the basic plane
+	"\xe2\x80\xa8"	// line separator
+	"c\x80"	// lone trail byte
+	"\xc3"	// lead byte without its trail byte
+	"d\xff\n";
+
+TEST_F(StyleContextTest, UTF8) {
+	SetText(SC_CP_UTF8, utf8Mixed);
+	CheckSteps(0);
+}
+
+TEST_F(StyleContextTest, UTF8StartsAndEndsMultiByte) {
+	SetText(SC_CP_UTF8, "\xc3\xa9x\xe2\x82\xac");
+	CheckSteps(0);
+}
+
+static const char shiftJISMixed[] =
+	"a\x95\x5c"	// trail byte is a backslash
+	"\x81\x40"	// trail byte is @
+	"\x83\x41"	// trail byte is A
+	"\"\x82\xa0\"\n"
+	"\x88\x9f;";
+
+TEST_F(StyleContextTest, DBCS) {
+	SetText(932, shiftJISMixed);
+	CheckSteps(0);
+	CheckSteps(pdoc->LineStart(1));
+}
+
+TEST_F(StyleContextTest, AcrossAccessorBuffer) {
+	// The accessor reads the document in blocks so characters straddle block boundaries
+	// when the pieces are repeated over several blocks.
+	std::string text = "x";
+	for (int i = 0; i < 1000; i++)
+		text += utf8Mixed;
+	SetText(SC_CP_UTF8, text);
+	CheckSteps(0);
+}
+
+TEST_F(StyleContextTest, DBCSAcrossAccessorBuffer) {
+	std::string text = "x";
+	for (int i = 0; i < 1000; i++)
+		text += shiftJISMixed;
+	SetText(932, text);
+	CheckSteps(0);
+}
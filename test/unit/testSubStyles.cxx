@@ -0,0 +1,142 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+
+#include "Platform.h"
+
+#include "SubStyles.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test SubStyles.
+
+static const char styleSubable[] = {11, 17, 0};
+
+class SubStylesTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pss = new SubStyles(styleSubable, 0x80, 0x40, 0x40);
+	}
+
+	virtual void TearDown() {
+		delete pss;
+		pss = 0;
+	}
+
+	SubStyles *pss;
+};
+
+TEST_F(SubStylesTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pss->Length(11));
+	EXPECT_EQ(-1, pss->Classifier(11).ValueFor("GFile", 5));
+	EXPECT_EQ(-1, pss->Classifier(11).ValueFor(std::string("GFile")));
+}
+
+TEST_F(SubStylesTest, Allocate) {
+	EXPECT_EQ(0x80, pss->Allocate(11, 3));
+	EXPECT_EQ(0x83, pss->Allocate(17, 2));
+	EXPECT_EQ(-1, pss->Allocate(12, 2));
+	EXPECT_EQ(3, pss->Length(11));
+	EXPECT_EQ(0x83, pss->Start(17));
+	EXPECT_EQ(11, pss->BaseStyle(0x82));
+	EXPECT_EQ(17, pss->BaseStyle(0x84));
+	EXPECT_EQ(0x85, pss->BaseStyle(0x85));
+}
+
+TEST_F(SubStylesTest, ValueFor) {
+	pss->Allocate(11, 2);
+	pss->SetIdentifiers(0x80, "GFile GFileInfo\tg_free\n");
+	pss->SetIdentifiers(0x81, "std vector");
+	const WordClassifier &classifier = pss->Classifier(11);
+	EXPECT_EQ(0x80, classifier.ValueFor("GFile", 5));
+	EXPECT_EQ(0x80, classifier.ValueFor("GFileInfo", 9));
+	EXPECT_EQ(0x80, classifier.ValueFor("g_free", 6));
+	EXPECT_EQ(0x81, classifier.ValueFor("vector", 6));
+	EXPECT_EQ(0x81, classifier.ValueFor(std::string("std")));
+	// Only the given length of the text is looked up
+	EXPECT_EQ(0x80, classifier.ValueFor("GFileInfo", 5));
+	EXPECT_EQ(0x81, classifier.ValueFor("std::vector", 3));
+	EXPECT_EQ(-1, classifier.ValueFor("GFil", 4));
+	EXPECT_EQ(-1, classifier.ValueFor("", 0));
+	EXPECT_EQ(-1, pss->Classifier(17).ValueFor("GFile", 5));
+}
+
+TEST_F(SubStylesTest, LaterIdentifiersReplaceEarlier) {
+	pss->Allocate(11, 2);
+	pss->SetIdentifiers(0x80, "string map");
+	pss->SetIdentifiers(0x81, "map set");
+	EXPECT_EQ(0x80, pss->Classifier(11).ValueFor("string", 6));
+	EXPECT_EQ(0x81, pss->Classifier(11).ValueFor("map", 3));
+	EXPECT_EQ(0x81, pss->Classifier(11).ValueFor("set", 3));
+}
+
+TEST_F(SubStylesTest, Free) {
+	pss->Allocate(11, 2);
+	pss->SetIdentifiers(0x80, "string");
+	pss->Free();
+	EXPECT_EQ(0, pss->Length(11));
+	EXPECT_EQ(-1, pss->Classifier(11).ValueFor("string", 6));
+	EXPECT_EQ(0x80, pss->Allocate(17, 1));
+}
+
+TEST_F(SubStylesTest, CopiesAreIndependent) {
+	pss->Allocate(11, 1);
+	pss->SetIdentifiers(0x80, "string");
+	SubStyles copy = *pss;
+	pss->SetIdentifiers(0x80, "map");
+	EXPECT_EQ(0x80, copy.Classifier(11).ValueFor("string", 6));
+	EXPECT_EQ(-1, copy.Classifier(11).ValueFor("map", 3));
+	EXPECT_EQ(0x80, pss->Classifier(11).ValueFor("map", 3));
+	copy.Free();
+	EXPECT_EQ(0x80, pss->Classifier(11).ValueFor("string", 6));
+}
+
+// Microbenchmark for classifying identifiers, half of which have substyles. It is
+// disabled by default as it only reports timings.
+
+TEST_F(SubStylesTest, DISABLED_BenchmarkValueFor) {
+	const int wordCount = 1000;
+	pss->Allocate(11, 4);
+	std::vector<std::string> identifiers;
+	std::string words[4];
+	unsigned int seed = 1;
+	for (int w=0; w<wordCount * 2; w++) {
+		std::string word;
+		seed = seed * 1103515245 + 12345;
+		const int length = 3 + (seed >> 16) % 14;
+		for (int c=0; c<length; c++) {
+			seed = seed * 1103515245 + 12345;
+			word += static_cast<char>('a' + (seed >> 16) % 26);
+		}
+		if (w < wordCount)
+			words[w % 4] += word + " ";
+		identifiers.push_back(word);
+	}
+	for (int s=0; s<4; s++)
+		pss->SetIdentifiers(0x80 + s, words[s].c_str());
+	const WordClassifier &classifier = pss->Classifier(11);
+	const int rounds = 300;
+	int found = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int round=0; round<rounds; round++) {
+		for (std::vector<std::string>::const_iterator it=identifiers.begin(); it != identifiers.end(); ++it) {
+			if (classifier.ValueFor(it->c_str(), it->length()) >= 0)
+				found++;
+		}
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-20s %8.1f ns per identifier over %d words\n", "ValueFor",
+		seconds * 1e9 / (static_cast<double>(rounds) * identifiers.size()), wordCount);
+	EXPECT_GE(found, rounds * wordCount);
+}
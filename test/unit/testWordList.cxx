@@ -0,0 +1,218 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Platform.h"
+
+#include "WordList.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+#include <gtest/gtest.h>
+
+// Test WordList.
+
+class WordListTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pwl = new WordList();
+	}
+
+	virtual void TearDown() {
+		delete pwl;
+		pwl = 0;
+	}
+
+	WordList *pwl;
+};
+
+TEST_F(WordListTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pwl->Length());
+	EXPECT_FALSE(*pwl);
+	EXPECT_FALSE(pwl->InList("int"));
+	EXPECT_FALSE(pwl->InListAbbreviated("int", '~'));
+}
+
+TEST_F(WordListTest, InList) {
+	pwl->Set("else struct i int\tintegral\nwhile");
+	EXPECT_EQ(6, pwl->Length());
+	EXPECT_TRUE(pwl->InList("int"));
+	EXPECT_TRUE(pwl->InList("i"));
+	EXPECT_TRUE(pwl->InList("while"));
+	EXPECT_TRUE(pwl->InList("integral"));
+	EXPECT_FALSE(pwl->InList(""));
+	EXPECT_FALSE(pwl->InList("in"));
+	EXPECT_FALSE(pwl->InList("inte"));
+	EXPECT_FALSE(pwl->InList("ints"));
+	EXPECT_FALSE(pwl->InList("Int"));
+	EXPECT_FALSE(pwl->InList("do"));
+}
+
+TEST_F(WordListTest, Set) {
+	pwl->Set("int char");
+	pwl->Set("long");
+	EXPECT_EQ(1, pwl->Length());
+	EXPECT_FALSE(pwl->InList("int"));
+	EXPECT_TRUE(pwl->InList("long"));
+	pwl->Set("");
+	EXPECT_EQ(0, pwl->Length());
+	EXPECT_FALSE(pwl->InList("long"));
+}
+
+TEST_F(WordListTest, OnlyLineEnds) {
+	WordList wl(true);
+	wl.Set("unsigned int\nlong");
+	EXPECT_EQ(2, wl.Length());
+	EXPECT_TRUE(wl.InList("unsigned int"));
+	EXPECT_TRUE(wl.InList("long"));
+	EXPECT_FALSE(wl.InList("unsigned"));
+}
+
+TEST_F(WordListTest, HighBytes) {
+	pwl->Set("caf\xc3\xa9 \xe2\x82\xac");
+	EXPECT_TRUE(pwl->InList("caf\xc3\xa9"));
+	EXPECT_TRUE(pwl->InList("\xe2\x82\xac"));
+	EXPECT_FALSE(pwl->InList("caf"));
+}
+
+TEST_F(WordListTest, Prefixes) {
+	pwl->Set("^GTK_ gint");
+	EXPECT_TRUE(pwl->InList("GTK_"));
+	EXPECT_TRUE(pwl->InList("GTK_X"));
+	EXPECT_TRUE(pwl->InList("GTK_MAJOR_VERSION"));
+	EXPECT_TRUE(pwl->InList("gint"));
+	EXPECT_FALSE(pwl->InList("GTK"));
+	EXPECT_FALSE(pwl->InList("GDK_X"));
+	EXPECT_TRUE(pwl->InListAbbreviated("GTK_X", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("GTK", '~'));
+}
+
+TEST_F(WordListTest, Abbreviated) {
+	pwl->Set("def~ine e~xit set_opt~ions until x~ y~");
+	EXPECT_TRUE(pwl->InListAbbreviated("def", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("defi", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("define", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("de", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("defines", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("defx", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("ex", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("exit", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("set_opt", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("set_options", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("set_", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("until", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("unti", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("x", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("xy", '~'));
+	// Words are abbreviated at the marker passed in
+	EXPECT_FALSE(pwl->InListAbbreviated("def", '!'));
+	EXPECT_TRUE(pwl->InListAbbreviated("set", '_'));
+	EXPECT_TRUE(pwl->InListAbbreviated("setopt", '_'));
+	// A marker straight after the first character needs a second character to match
+	EXPECT_FALSE(pwl->InListAbbreviated("e", '~'));
+	// Without abbreviation, only exact matches count
+	EXPECT_FALSE(pwl->InList("def"));
+	EXPECT_TRUE(pwl->InList("def~ine"));
+	EXPECT_TRUE(pwl->InList("until"));
+}
+
+TEST_F(WordListTest, Copy) {
+	pwl->Set("int char ^GTK_ def~ine");
+	WordList copy(*pwl);
+	pwl->Set("long");
+	EXPECT_EQ(4, copy.Length());
+	EXPECT_TRUE(copy.InList("char"));
+	EXPECT_TRUE(copy.InList("GTK_X"));
+	EXPECT_TRUE(copy.InListAbbreviated("defi", '~'));
+	EXPECT_FALSE(copy.InList("long"));
+	WordList assigned;
+	assigned = copy;
+	EXPECT_TRUE(assigned.InList("int"));
+	EXPECT_TRUE(assigned.InListAbbreviated("def", '~'));
+	EXPECT_FALSE(assigned != copy);
+}
+
+// Microbenchmarks for looking up words in a list as large as the SQL and CSS lists
+// in SciTE. They are disabled by default as they only report timings; run them with
+//	./unitTest --gtest_also_run_disabled_tests --gtest_filter=*WordListBenchmark*
+
+class WordListBenchmark : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		// Identifiers of 4 to 20 characters from a fixed linear congruential generator
+		// so that runs are comparable. Many share their first character.
+		unsigned int seed = 1;
+		std::string list;
+		for (int w=0; w<wordCount; w++) {
+			std::string word;
+			seed = seed * 1103515245 + 12345;
+			const int length = 4 + (seed >> 16) % 17;
+			for (int c=0; c<length; c++) {
+				seed = seed * 1103515245 + 12345;
+				word += static_cast<char>('a' + (seed >> 16) % 26);
+			}
+			if ((w % 10) == 0)
+				word.insert(3, "~");
+			list += word;
+			list += ' ';
+			words.push_back(word);
+		}
+		wl.Set(list.c_str());
+		// Half the lookups are for words in the list, the others differ in the last character.
+		for (size_t w=0; w<words.size(); w++) {
+			std::string probe = words[w];
+			const size_t marker = probe.find('~');
+			if (marker != std::string::npos)
+				probe.erase(marker, 1);
+			if (w % 2)
+				probe[probe.length()-1] = '#';
+			probes.push_back(probe);
+		}
+	}
+
+	template <typename Lookup>
+	void Time(const char *name, Lookup lookup) {
+		const int rounds = 200;
+		int found = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int round=0; round<rounds; round++) {
+			for (std::vector<std::string>::const_iterator it=probes.begin(); it != probes.end(); ++it) {
+				if (lookup(wl, it->c_str()))
+					found++;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const double lookups = static_cast<double>(rounds) * probes.size();
+		printf("%-20s %8.1f ns per lookup over %d words\n", name, seconds * 1e9 / lookups, wordCount);
+		EXPECT_GT(found, 0);
+	}
+
+	static const int wordCount = 3000;
+
+	WordList wl;
+	std::vector<std::string> words;
+	std::vector<std::string> probes;
+};
+
+static bool LookupInList(const WordList &wl, const char *s) {
+	return wl.InList(s);
+}
+
+static bool LookupInListAbbreviated(const WordList &wl, const char *s) {
+	return wl.InListAbbreviated(s, '~');
+}
+
+TEST_F(WordListBenchmark, DISABLED_InList) {
+	Time("InList", LookupInList);
+}
+
+TEST_F(WordListBenchmark, DISABLED_InListAbbreviated) {
+	Time("InListAbbreviated", LookupInListAbbreviated);
+}
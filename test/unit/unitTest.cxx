@@ -6,12 +6,13 @@
         Partitioning
         RunStyles
         ContractionState
+        CellBuffer styles
 
     To do:
         Decoration
         DecorationList
         PerLine *
-        CellBuffer *
+        CellBuffer text and undo
         Range
         StyledText
         CaseFolder ...
@@ -44,6 +45,11 @@ void Platform::Assert(const char *c, const char *file, int line) {
 	abort();
 }
 
+// Needed for CellBuffer which reports bad ranges
+
+void Platform::DebugPrintf(const char *, ...) {
+}
+
 int main(int argc, char **argv) {
 	testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();